@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2020 - 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import "AVAudioPCMBuffer+SFBBufferUtilities.h"
+#import "SFBAudioBufferAnalysis.hpp"
+
+@implementation AVAudioPCMBuffer (SFBBufferUtilities)
+
+- (AVAudioFrameCount)prependContentsOfBuffer:(AVAudioPCMBuffer *)buffer
+{
+	return [self insertFromBuffer:buffer readingFromOffset:0 frameLength:buffer.frameLength atOffset:0];
+}
+
+- (AVAudioFrameCount)prependFromBuffer:(AVAudioPCMBuffer *)buffer readingFromOffset:(AVAudioFrameCount)offset
+{
+	if(offset > buffer.frameLength)
+		return 0;
+	return [self insertFromBuffer:buffer readingFromOffset:offset frameLength:(buffer.frameLength - offset) atOffset:0];
+}
+
+- (AVAudioFrameCount)prependFromBuffer:(AVAudioPCMBuffer *)buffer readingFromOffset:(AVAudioFrameCount)offset frameLength:(AVAudioFrameCount)frameLength
+{
+	return [self insertFromBuffer:buffer readingFromOffset:offset frameLength:frameLength atOffset:0];
+}
+
+- (AVAudioFrameCount)appendContentsOfBuffer:(AVAudioPCMBuffer *)buffer
+{
+	return [self insertFromBuffer:buffer readingFromOffset:0 frameLength:buffer.frameLength atOffset:self.frameLength];
+}
+
+- (AVAudioFrameCount)appendFromBuffer:(AVAudioPCMBuffer *)buffer readingFromOffset:(AVAudioFrameCount)offset
+{
+	if(offset > buffer.frameLength)
+		return 0;
+	return [self insertFromBuffer:buffer readingFromOffset:offset frameLength:(buffer.frameLength - offset) atOffset:self.frameLength];
+}
+
+- (AVAudioFrameCount)appendFromBuffer:(AVAudioPCMBuffer *)buffer readingFromOffset:(AVAudioFrameCount)offset frameLength:(AVAudioFrameCount)frameLength
+{
+	return [self insertFromBuffer:buffer readingFromOffset:offset frameLength:frameLength atOffset:self.frameLength];
+}
+
+- (AVAudioFrameCount)insertContentsOfBuffer:(AVAudioPCMBuffer *)buffer atOffset:(AVAudioFrameCount)offset
+{
+	return [self insertFromBuffer:buffer readingFromOffset:0 frameLength:buffer.frameLength atOffset:offset];
+}
+
+- (AVAudioFrameCount)insertFromBuffer:(AVAudioPCMBuffer *)buffer readingFromOffset:(AVAudioFrameCount)readOffset frameLength:(AVAudioFrameCount)frameLength atOffset:(AVAudioFrameCount)writeOffset
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([self.format isEqual:buffer.format]);
+
+	if(readOffset > buffer.frameLength || writeOffset > self.frameLength || frameLength == 0 || buffer.frameLength == 0)
+		return 0;
+
+	AVAudioFrameCount framesToInsert = MIN(self.frameCapacity - self.frameLength, MIN(frameLength, buffer.frameLength - readOffset));
+
+	const AudioStreamBasicDescription *asbd = self.format.streamDescription;
+	const AudioBufferList *src_abl = buffer.audioBufferList;
+	const AudioBufferList *dst_abl = self.audioBufferList;
+
+	AVAudioFrameCount framesToMove = self.frameLength - writeOffset;
+	if(framesToMove) {
+		AVAudioFrameCount moveToOffset = writeOffset + framesToInsert;
+		for(UInt32 i = 0; i < dst_abl->mNumberBuffers; ++i) {
+			const unsigned char *srcbuf = (const unsigned char *)dst_abl->mBuffers[i].mData + (writeOffset * asbd->mBytesPerFrame);
+			unsigned char *dstbuf = (unsigned char *)dst_abl->mBuffers[i].mData + (moveToOffset * asbd->mBytesPerFrame);
+			memmove(dstbuf, srcbuf, framesToMove * asbd->mBytesPerFrame);
+		}
+	}
+
+	if(framesToInsert) {
+		for(UInt32 i = 0; i < src_abl->mNumberBuffers; ++i) {
+			const unsigned char *srcbuf = (const unsigned char *)src_abl->mBuffers[i].mData + (readOffset * asbd->mBytesPerFrame);
+			unsigned char *dstbuf = (unsigned char *)dst_abl->mBuffers[i].mData + (writeOffset * asbd->mBytesPerFrame);
+			memcpy(dstbuf, srcbuf, framesToInsert * asbd->mBytesPerFrame);
+		}
+
+		self.frameLength += framesToInsert;
+	}
+
+	return framesToInsert;
+}
+
+- (AVAudioFrameCount)trimFirst:(AVAudioFrameCount)frameLength
+{
+	return [self trimAtOffset:0 frameLength:frameLength];
+}
+
+- (AVAudioFrameCount)trimLast:(AVAudioFrameCount)frameLength
+{
+	AVAudioFrameCount framesToTrim = MIN(frameLength, self.frameLength);
+	self.frameLength -= framesToTrim;
+	return framesToTrim;
+}
+
+- (AVAudioFrameCount)trimAtOffset:(AVAudioFrameCount)offset frameLength:(AVAudioFrameCount)frameLength
+{
+	if(offset > self.frameLength || frameLength == 0)
+		return 0;
+
+	AVAudioFrameCount framesToTrim = MIN(frameLength, self.frameLength - offset);
+
+	const AudioStreamBasicDescription *asbd = self.format.streamDescription;
+	const AudioBufferList *abl = self.audioBufferList;
+
+	AVAudioFrameCount framesToMove = self.frameLength - (offset + framesToTrim);
+	if(framesToMove) {
+		AVAudioFrameCount moveFromOffset = offset + framesToTrim;
+		for(UInt32 i = 0; i < abl->mNumberBuffers; ++i) {
+			const unsigned char *srcbuf = (const unsigned char *)abl->mBuffers[i].mData + (moveFromOffset * asbd->mBytesPerFrame);
+			unsigned char *dstbuf = (unsigned char *)abl->mBuffers[i].mData + (offset * asbd->mBytesPerFrame);
+			memmove(dstbuf, srcbuf, framesToMove * asbd->mBytesPerFrame);
+		}
+	}
+
+	self.frameLength -= framesToTrim;
+
+	return framesToTrim;
+}
+
+- (AVAudioFrameCount)fillRemainderWithSilence
+{
+	return [self insertSilenceAtOffset:self.frameLength frameLength:self.frameCapacity - self.frameLength];
+}
+
+- (AVAudioFrameCount)appendSilenceOfLength:(AVAudioFrameCount)frameLength
+{
+	return [self insertSilenceAtOffset:self.frameLength frameLength:frameLength];
+}
+
+- (AVAudioFrameCount)insertSilenceAtOffset:(AVAudioFrameCount)offset frameLength:(AVAudioFrameCount)frameLength
+{
+	if(offset > self.frameLength || frameLength == 0)
+		return 0;
+
+	AVAudioFrameCount framesToZero = MIN(self.frameCapacity - self.frameLength, frameLength);
+
+	const AudioStreamBasicDescription *asbd = self.format.streamDescription;
+	const AudioBufferList *abl = self.audioBufferList;
+
+	NSAssert((asbd->mFormatFlags & kAudioFormatFlagIsFloat) || ((asbd->mFormatFlags & kAudioFormatFlagIsSignedInteger) && (asbd->mFormatFlags & kAudioFormatFlagIsPacked)), @"Inserting silence for unsigned integer or unpacked samples not supported");
+
+	AVAudioFrameCount framesToMove = self.frameLength - offset;
+	if(framesToMove) {
+		AVAudioFrameCount moveToOffset = offset + framesToZero;
+		for(UInt32 i = 0; i < abl->mNumberBuffers; ++i) {
+			const unsigned char *srcbuf = (const unsigned char *)abl->mBuffers[i].mData + (offset * asbd->mBytesPerFrame);
+			unsigned char *dstbuf = (unsigned char *)abl->mBuffers[i].mData + (moveToOffset * asbd->mBytesPerFrame);
+			memmove(dstbuf, srcbuf, framesToMove * asbd->mBytesPerFrame);
+		}
+	}
+
+	if(framesToZero) {
+		for(UInt32 i = 0; i < abl->mNumberBuffers; ++i) {
+			unsigned char *dstbuf = (uint8_t *)abl->mBuffers[i].mData + (offset * asbd->mBytesPerFrame);
+			memset(dstbuf, 0, framesToZero * asbd->mBytesPerFrame);
+		}
+
+		self.frameLength += framesToZero;
+	}
+
+	return framesToZero;
+}
+
+- (BOOL)isEmpty
+{
+	return self.frameLength == 0;
+}
+
+- (BOOL)isFull
+{
+	return self.frameLength == self.frameCapacity;
+}
+
+- (BOOL)isDigitalSilence
+{
+	if(self.frameLength == 0)
+		return YES;
+	return SFB::AudioBufferAnalysis::IsDigitalSilence(self.audioBufferList, *self.format.streamDescription, self.frameLength);
+}
+
+@end
+
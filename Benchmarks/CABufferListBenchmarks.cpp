@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <cstdint>
+#import <cstring>
+#import <vector>
+
+#import "SFBCABufferList.hpp"
+
+#import "SFBBenchmark.hpp"
+
+namespace {
+
+using namespace SFB::Benchmark;
+
+/// The channel counts benchmarked
+constexpr uint32_t sChannelCounts [] = { 1, 2, 8 };
+/// The number of valid frames in the edited buffer
+constexpr uint32_t sFrameLength = 4096;
+/// The number of frames inserted and trimmed by each edit
+constexpr uint32_t sEditFrames = 256;
+
+/// Returns the 32-bit float format used by the benchmarks
+SFB::CAStreamBasicDescription Format(uint32_t channelCount, bool interleaved) noexcept
+{
+	return SFB::CAStreamBasicDescription(SFB::CommonPCMFormat::float32, 48000, channelCount, interleaved);
+}
+
+/// Returns a buffer with a capacity of @c frameCapacity frames containing @c frameLength frames of non-zero audio
+SFB::CABufferList MakeBuffer(const SFB::CAStreamBasicDescription& format, uint32_t frameCapacity, uint32_t frameLength)
+{
+	SFB::CABufferList buffer(format, frameCapacity);
+	buffer.SetFrameLength(frameLength);
+	for(UInt32 i = 0; i < buffer->mNumberBuffers; ++i) {
+		auto samples = static_cast<float *>(buffer->mBuffers[i].mData);
+		const auto sampleCount = buffer->mBuffers[i].mDataByteSize / sizeof(float);
+		for(size_t j = 0; j < sampleCount; ++j)
+			samples[j] = 0.5f;
+	}
+	return buffer;
+}
+
+/// Adds the fields identifying a buffer list benchmark to @c result
+Result& Describe(Result& result, uint32_t channelCount, bool interleaved)
+{
+	return result.Add("channels", uint64_t{channelCount}).Add("interleaved", interleaved);
+}
+
+/// The edit positions benchmarked
+enum class Position { front, middle, end };
+
+/// Returns the name of @c position
+const char * PositionName(Position position) noexcept
+{
+	switch(position) {
+		case Position::front:		return "front";
+		case Position::middle:		return "middle";
+		case Position::end:			return "end";
+	}
+	return "";
+}
+
+/// Returns the frame offset of @c position in a buffer containing @c sFrameLength frames
+uint32_t PositionOffset(Position position) noexcept
+{
+	switch(position) {
+		case Position::front:		return 0;
+		case Position::middle:		return sFrameLength / 2;
+		case Position::end:			return sFrameLength;
+	}
+	return 0;
+}
+
+/// Alternately inserts and trims @c sEditFrames frames at @c position, timing each operation separately
+///
+/// The trim restores the buffer so every insertion starts from the same frame length, although the headroom left by
+/// trims at the front is reused by the insertions that follow.
+void BenchmarkInsertAndTrim(uint32_t channelCount, bool interleaved, Position position, uint64_t iterations)
+{
+	const auto format = Format(channelCount, interleaved);
+	auto buffer = MakeBuffer(format, sFrameLength + sEditFrames, sFrameLength);
+	const auto source = MakeBuffer(format, sEditFrames, sEditFrames);
+	const auto offset = PositionOffset(position);
+
+	std::vector<uint64_t> insertSamples;
+	std::vector<uint64_t> trimSamples;
+	insertSamples.reserve(iterations);
+	trimSamples.reserve(iterations);
+
+	for(uint64_t i = 0; i < iterations + iterations / 10; ++i) {
+		const auto insertStart = Now();
+		const auto inserted = buffer.InsertFromBuffer(source, 0, sEditFrames, offset);
+		const auto trimStart = Now();
+		const auto trimmed = buffer.TrimAtOffset(offset, inserted);
+		const auto trimEnd = Now();
+
+		if(inserted != sEditFrames || trimmed != inserted) {
+			ReportFailure("InsertFromBuffer");
+			return;
+		}
+
+		// The first tenth of the iterations are warm-up
+		if(i >= iterations / 10) {
+			insertSamples.push_back(trimStart - insertStart);
+			trimSamples.push_back(trimEnd - trimStart);
+		}
+	}
+
+	for(const auto& [operation, samples] : { std::pair{ "InsertFromBuffer", &insertSamples }, std::pair{ "TrimAtOffset", &trimSamples } }) {
+		Result result(operation);
+		Describe(result, channelCount, interleaved).Add("position", PositionName(position)).Add("frames", uint64_t{sEditFrames}).Add(Summarize(*samples)).Emit();
+	}
+}
+
+/// Inserts @c sEditFrames frames of silence in the middle of a buffer, removing them untimed after each insertion
+void BenchmarkInsertSilence(uint32_t channelCount, bool interleaved, uint64_t iterations)
+{
+	const auto format = Format(channelCount, interleaved);
+	auto buffer = MakeBuffer(format, sFrameLength + sEditFrames, sFrameLength);
+	const auto offset = PositionOffset(Position::middle);
+
+	std::vector<uint64_t> samples;
+	samples.reserve(iterations);
+
+	for(uint64_t i = 0; i < iterations + iterations / 10; ++i) {
+		const auto start = Now();
+		const auto inserted = buffer.InsertSilence(offset, sEditFrames);
+		const auto end = Now();
+
+		if(inserted != sEditFrames || buffer.TrimAtOffset(offset, inserted) != inserted) {
+			ReportFailure("InsertSilence");
+			return;
+		}
+
+		if(i >= iterations / 10)
+			samples.push_back(end - start);
+	}
+
+	Result result("InsertSilence");
+	Describe(result, channelCount, interleaved).Add("position", PositionName(Position::middle)).Add("frames", uint64_t{sEditFrames}).Add(Summarize(samples)).Emit();
+}
+
+/// Scans silent buffers and buffers whose only non-zero sample is the last, the worst case for both
+void BenchmarkIsDigitalSilence(uint32_t channelCount, bool interleaved, uint64_t iterations)
+{
+	const auto format = Format(channelCount, interleaved);
+
+	for(auto silent : { true, false }) {
+		auto buffer = MakeBuffer(format, sFrameLength, sFrameLength);
+		for(UInt32 i = 0; i < buffer->mNumberBuffers; ++i)
+			std::memset(buffer->mBuffers[i].mData, 0, buffer->mBuffers[i].mDataByteSize);
+		if(!silent) {
+			auto& last = buffer->mBuffers[buffer->mNumberBuffers - 1];
+			static_cast<float *>(last.mData)[last.mDataByteSize / sizeof(float) - 1] = 0.5f;
+		}
+
+		// The result is accumulated so the scan can't be discarded
+		uint64_t silentCount = 0;
+		const auto summary = MeasureOperation(iterations, [&] {
+			silentCount += buffer.IsDigitalSilence();
+		});
+
+		if(silentCount != (silent ? iterations + iterations / 10 : 0)) {
+			ReportFailure("IsDigitalSilence");
+			return;
+		}
+
+		Result result("IsDigitalSilence");
+		Describe(result, channelCount, interleaved).Add("silent", silent).Add("frames", uint64_t{sFrameLength}).Add(summary).Emit();
+	}
+}
+
+} // namespace
+
+/// Benchmarks editing and analyzing @c CABufferList objects
+///
+/// Usage: CABufferListBenchmarks [--iterations=N]
+int main(int argc, char *argv[])
+{
+	const auto iterations = Option(argc, argv, "iterations", 100000);
+
+	for(auto channelCount : sChannelCounts) {
+		for(auto interleaved : { false, true }) {
+			for(auto position : { Position::front, Position::middle, Position::end })
+				BenchmarkInsertAndTrim(channelCount, interleaved, position, iterations);
+			BenchmarkInsertSilence(channelCount, interleaved, iterations);
+			BenchmarkIsDigitalSilence(channelCount, interleaved, iterations);
+		}
+	}
+
+	return ExitStatus();
+}
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <atomic>
+#import <cstdint>
+#import <cstring>
+#import <thread>
+#import <vector>
+
+#import "SFBMPMCRingBuffer.hpp"
+
+#import "SFBBenchmark.hpp"
+
+namespace {
+
+using namespace SFB::Benchmark;
+
+/// The total thread counts benchmarked, half producers and half consumers
+constexpr uint32_t sThreadCounts [] = { 2, 4, 8, 16 };
+/// The number of slots claimed at once in batched transfers
+constexpr uint32_t sBatchSize = 16;
+
+/// The measurements of one thread
+struct ThreadMeasurements
+{
+	/// The latencies of successful operations
+	std::vector<uint64_t> mSamples;
+	/// The number of operations that found the buffer full or empty
+	uint64_t mFailures = 0;
+	/// Whether the thread was bound to its processor
+	bool mPinned = false;
+};
+
+/// Performs @c elementCount transfers using @c operation, which returns the number of elements it transferred
+template <typename F>
+void Run(ThreadMeasurements& measurements, uint64_t elementCount, F&& operation)
+{
+	uint64_t transferred = 0;
+	while(transferred < elementCount) {
+		const auto start = Now();
+		const auto count = operation(elementCount - transferred);
+		const auto end = Now();
+		if(count > 0) {
+			measurements.mSamples.push_back(end - start);
+			transferred += count;
+		}
+		else {
+			++measurements.mFailures;
+			std::this_thread::yield();
+		}
+	}
+}
+
+/// Transfers 64-bit elements between @c threadCount / 2 producers and as many consumers
+///
+/// Thread @c i is bound to processor @c i modulo the number of processors, so producers and consumers alternate
+/// across processors. Each producer writes and each consumer reads @c elementsPerThread elements.
+/// @param batched Whether elements are transferred using @c TryWrite() and @c TryRead() or in batches of
+/// @c sBatchSize using the claim methods
+void BenchmarkContention(uint32_t threadCount, bool batched, uint32_t capacity, uint64_t elementsPerThread)
+{
+	SFB::MPMCRingBuffer rb;
+	if(!rb.Allocate(sizeof(uint64_t), capacity)) {
+		ReportFailure("MPMCRingBuffer");
+		return;
+	}
+
+	const auto producerCount = threadCount / 2;
+	std::vector<ThreadMeasurements> measurements(threadCount);
+	for(auto& m : measurements)
+		m.mSamples.reserve(elementsPerThread);
+
+	const auto write = [&rb, batched](uint64_t remaining) -> uint64_t {
+		const uint64_t value = remaining;
+		if(!batched)
+			return rb.TryWrite(&value);
+		SFB::MPMCRingBuffer::SlotRange range;
+		const auto count = rb.ClaimWrite(static_cast<uint32_t>(std::min<uint64_t>(sBatchSize, remaining)), range);
+		for(uint32_t i = 0; i < count; ++i)
+			std::memcpy(rb.WriteSlot(range, i), &value, sizeof value);
+		if(count)
+			rb.CommitWrite(range);
+		return count;
+	};
+
+	const auto read = [&rb, batched](uint64_t remaining) -> uint64_t {
+		uint64_t value;
+		if(!batched)
+			return rb.TryRead(&value);
+		SFB::MPMCRingBuffer::SlotRange range;
+		const auto count = rb.ClaimRead(static_cast<uint32_t>(std::min<uint64_t>(sBatchSize, remaining)), range);
+		for(uint32_t i = 0; i < count; ++i)
+			std::memcpy(&value, rb.ReadSlot(range, i), sizeof value);
+		if(count)
+			rb.CommitRead(range);
+		return count;
+	};
+
+	// All threads start together so none measures the others' startup
+	std::atomic_uint32_t ready = 0;
+	std::vector<std::thread> threads;
+	const auto start = Now();
+	for(uint32_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back([&, i] {
+			auto& m = measurements[i];
+			m.mPinned = PinCurrentThread(i);
+			ready.fetch_add(1);
+			while(ready.load() < threadCount)
+				std::this_thread::yield();
+
+			// Even threads produce and odd threads consume
+			if(i % 2 == 0)
+				Run(m, elementsPerThread, write);
+			else
+				Run(m, elementsPerThread, read);
+		});
+	}
+	for(auto& thread : threads)
+		thread.join();
+	const auto elapsed = std::max<uint64_t>(Now() - start, 1);
+
+	const auto elementsPerSecond = static_cast<double>(producerCount * elementsPerThread) * 1e9 / static_cast<double>(elapsed);
+	for(auto side : { 0u, 1u }) {
+		std::vector<uint64_t> samples;
+		uint64_t failures = 0;
+		bool pinned = true;
+		for(uint32_t i = side; i < threadCount; i += 2) {
+			samples.insert(samples.end(), measurements[i].mSamples.begin(), measurements[i].mSamples.end());
+			failures += measurements[i].mFailures;
+			pinned = pinned && measurements[i].mPinned;
+		}
+
+		Result result("MPMCRingBuffer");
+		result.Add("threads", uint64_t{threadCount}).Add("batch", uint64_t{batched ? sBatchSize : 1}).Add("capacity", uint64_t{capacity});
+		result.Add("side", side == 0 ? "write" : "read").Add(Summarize(samples)).Add("failed_attempts", failures);
+		result.Add("elements_per_second", elementsPerSecond).Add("pinned", pinned).Add("processors", uint64_t{ProcessorCount()}).Emit();
+	}
+}
+
+} // namespace
+
+/// Benchmarks contended transfers through an @c MPMCRingBuffer
+///
+/// Usage: MPMCRingBufferBenchmarks [--elements=N] [--capacity=N]
+///
+/// @c --elements is the number of elements written by each producer and read by each consumer.
+int main(int argc, char *argv[])
+{
+	const auto elementsPerThread = Option(argc, argv, "elements", 200000);
+	const auto capacity = static_cast<uint32_t>(Option(argc, argv, "capacity", 1024));
+
+	for(auto threadCount : sThreadCounts) {
+		for(auto batched : { false, true })
+			BenchmarkContention(threadCount, batched, capacity, elementsPerThread);
+	}
+
+	return ExitStatus();
+}
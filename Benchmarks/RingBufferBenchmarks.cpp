@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <atomic>
+#import <cstdint>
+#import <vector>
+
+#import "SFBAudioRingBuffer.hpp"
+#import "SFBCABufferList.hpp"
+#import "SFBCARingBuffer.hpp"
+#import "SFBRingBuffer.hpp"
+
+#import "SFBBenchmark.hpp"
+#import "SFBLegacyRingBuffer.hpp"
+
+namespace {
+
+using namespace SFB::Benchmark;
+
+/// The channel counts benchmarked
+constexpr uint32_t sChannelCounts [] = { 1, 2, 8 };
+/// The block sizes benchmarked, in frames
+constexpr uint32_t sBlockFrames [] = { 64, 256, 1024 };
+/// The capacity of each ring buffer, in blocks
+constexpr uint32_t sCapacityBlocks = 4;
+
+/// Returns the non-interleaved 32-bit float format used by the audio ring buffers
+SFB::CAStreamBasicDescription Format(uint32_t channelCount) noexcept
+{
+	return SFB::CAStreamBasicDescription(SFB::CommonPCMFormat::float32, 48000, channelCount, false);
+}
+
+/// Returns a buffer containing @c frameCount frames of audio
+SFB::CABufferList MakeBuffer(const SFB::CAStreamBasicDescription& format, uint32_t frameCount)
+{
+	SFB::CABufferList buffer(format, frameCount);
+	buffer.SetFrameLength(frameCount);
+	for(UInt32 i = 0; i < buffer->mNumberBuffers; ++i)
+		std::memset(buffer->mBuffers[i].mData, static_cast<int>(i + 1), buffer->mBuffers[i].mDataByteSize);
+	return buffer;
+}
+
+/// Transfers interleaved blocks through a @c RingBuffer or a @c LegacyRingBuffer
+///
+/// The layout distinguishes the current ring buffer, whose positions are padded to separate cache lines and cached
+/// by the opposite side, from the legacy one, whose adjacent positions are both loaded on every call.
+/// @param layout The name of the layout of @c T
+template <typename T>
+void BenchmarkRingBuffer(const char *layout, uint32_t channelCount, uint32_t blockFrames, uint64_t blockCount)
+{
+	const uint32_t blockBytes = channelCount * blockFrames * sizeof(float);
+
+	T rb;
+	if(!rb.Allocate(blockBytes * sCapacityBlocks)) {
+		ReportFailure("RingBuffer");
+		return;
+	}
+
+	std::vector<uint8_t> source(blockBytes, 1);
+	std::vector<uint8_t> destination(blockBytes);
+
+	// Partial transfers resume within the block
+	const auto measurements = MeasureTransfer(blockCount * blockBytes, [&](uint64_t transferred) -> uint64_t {
+		const auto offset = static_cast<uint32_t>(transferred % blockBytes);
+		return rb.Write(source.data() + offset, blockBytes - offset);
+	}, [&](uint64_t transferred) -> uint64_t {
+		const auto offset = static_cast<uint32_t>(transferred % blockBytes);
+		return rb.Read(destination.data() + offset, blockBytes - offset);
+	});
+
+	Result result("RingBuffer");
+	result.Add("layout", layout).Add("channels", uint64_t{channelCount}).Add("block_frames", uint64_t{blockFrames});
+	EmitTransfer(result, measurements, blockCount * blockBytes);
+}
+
+/// Transfers non-interleaved blocks through an @c AudioRingBuffer
+void BenchmarkAudioRingBuffer(uint32_t channelCount, uint32_t blockFrames, uint64_t blockCount)
+{
+	const auto format = Format(channelCount);
+
+	SFB::AudioRingBuffer rb;
+	if(!rb.Allocate(format, blockFrames * sCapacityBlocks)) {
+		ReportFailure("AudioRingBuffer");
+		return;
+	}
+
+	auto source = MakeBuffer(format, blockFrames);
+	auto destination = MakeBuffer(format, blockFrames);
+
+	// Whole blocks are transferred so the buffer lists never need offsetting
+	const auto measurements = MeasureTransfer(blockCount * blockFrames, [&](uint64_t) -> uint64_t {
+		if(rb.FramesAvailableToWrite() < blockFrames)
+			return 0;
+		return rb.Write(source.ABL(), blockFrames);
+	}, [&](uint64_t) -> uint64_t {
+		if(rb.FramesAvailableToRead() < blockFrames)
+			return 0;
+		return rb.Read(destination.ABL(), blockFrames);
+	});
+
+	Result result("AudioRingBuffer");
+	result.Add("channels", uint64_t{channelCount}).Add("block_frames", uint64_t{blockFrames});
+	EmitTransfer(result, measurements, blockCount * blockFrames * format.mBytesPerFrame * channelCount);
+}
+
+/// Transfers timestamped non-interleaved blocks through a @c CARingBuffer
+void BenchmarkCARingBuffer(uint32_t channelCount, uint32_t blockFrames, uint64_t blockCount)
+{
+	const auto format = Format(channelCount);
+	const auto capacityFrames = blockFrames * sCapacityBlocks;
+
+	SFB::CARingBuffer rb;
+	if(!rb.Allocate(format, capacityFrames)) {
+		ReportFailure("CARingBuffer");
+		return;
+	}
+
+	auto source = MakeBuffer(format, blockFrames);
+	auto destination = MakeBuffer(format, blockFrames);
+
+	// A CARingBuffer overwrites unread audio so the writer waits for the reader to keep up
+	std::atomic_uint64_t framesRead = 0;
+
+	const auto measurements = MeasureTransfer(blockCount * blockFrames, [&](uint64_t framesWritten) -> uint64_t {
+		if(framesWritten + blockFrames - framesRead.load(std::memory_order_acquire) > capacityFrames)
+			return 0;
+		return rb.Write(source.ABL(), blockFrames, static_cast<int64_t>(framesWritten)) ? blockFrames : 0;
+	}, [&](uint64_t transferred) -> uint64_t {
+		int64_t startTime, endTime;
+		if(!rb.GetTimeBounds(startTime, endTime) || endTime < static_cast<int64_t>(transferred + blockFrames))
+			return 0;
+		if(!rb.Read(destination.ABL(), blockFrames, static_cast<int64_t>(transferred)))
+			return 0;
+		framesRead.store(transferred + blockFrames, std::memory_order_release);
+		return blockFrames;
+	});
+
+	Result result("CARingBuffer");
+	result.Add("channels", uint64_t{channelCount}).Add("block_frames", uint64_t{blockFrames});
+	EmitTransfer(result, measurements, blockCount * blockFrames * format.mBytesPerFrame * channelCount);
+}
+
+} // namespace
+
+/// Benchmarks single-producer, single-consumer transfers through the ring buffers
+///
+/// Usage: RingBufferBenchmarks [--blocks=N]
+int main(int argc, char *argv[])
+{
+	const auto blockCount = Option(argc, argv, "blocks", 100000);
+
+	for(auto channelCount : sChannelCounts) {
+		for(auto blockFrames : sBlockFrames) {
+			BenchmarkRingBuffer<SFB::RingBuffer>("padded", channelCount, blockFrames, blockCount);
+			BenchmarkRingBuffer<LegacyRingBuffer>("legacy", channelCount, blockFrames, blockCount);
+			BenchmarkAudioRingBuffer(channelCount, blockFrames, blockCount);
+			BenchmarkCARingBuffer(channelCount, blockFrames, blockCount);
+		}
+	}
+
+	return ExitStatus();
+}
@@ -0,0 +1,331 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <algorithm>
+#import <atomic>
+#import <chrono>
+#import <cstdint>
+#import <cstdio>
+#import <cstdlib>
+#import <cstring>
+#import <string>
+#import <thread>
+#import <utility>
+#import <vector>
+
+#if __APPLE__
+#import <mach/mach.h>
+#import <mach/thread_policy.h>
+#else
+#import <pthread.h>
+#import <sched.h>
+#endif
+
+namespace SFB {
+namespace Benchmark {
+
+#pragma mark Timing
+
+/// Returns a monotonic timestamp in nanoseconds
+inline uint64_t Now() noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// A summary of operation latencies in nanoseconds
+struct LatencySummary
+{
+	/// The number of operations
+	uint64_t mCount = 0;
+	/// The median latency
+	uint64_t mP50 = 0;
+	/// The 99th percentile latency
+	uint64_t mP99 = 0;
+	/// The 99.9th percentile latency
+	uint64_t mP999 = 0;
+	/// The largest latency
+	uint64_t mMax = 0;
+};
+
+/// Sorts @c samples and returns their summary
+inline LatencySummary Summarize(std::vector<uint64_t>& samples)
+{
+	LatencySummary summary;
+	if(samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+	const auto percentile = [&samples](double p) {
+		const auto rank = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+		return samples[std::min(rank, samples.size() - 1)];
+	};
+
+	summary.mCount = samples.size();
+	summary.mP50 = percentile(0.5);
+	summary.mP99 = percentile(0.99);
+	summary.mP999 = percentile(0.999);
+	summary.mMax = samples.back();
+	return summary;
+}
+
+#pragma mark Thread placement
+
+/// Returns the number of logical processors
+inline unsigned ProcessorCount() noexcept
+{
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/// Binds the calling thread to @c processor
+///
+/// On macOS this sets an affinity tag per processor, which the scheduler treats as a hint to keep threads with
+/// different tags on different cores. Apple silicon ignores affinity tags.
+/// @param processor The index of the processor, taken modulo the number of processors
+/// @return @c true if the thread was bound or the hint was accepted
+inline bool PinCurrentThread(unsigned processor) noexcept
+{
+	processor %= ProcessorCount();
+#if __APPLE__
+	thread_affinity_policy_data_t policy = { static_cast<integer_t>(processor + 1) };
+	const auto thread = mach_thread_self();
+	const auto result = thread_policy_set(thread, THREAD_AFFINITY_POLICY, reinterpret_cast<thread_policy_t>(&policy), THREAD_AFFINITY_POLICY_COUNT);
+	mach_port_deallocate(mach_task_self(), thread);
+	return result == KERN_SUCCESS;
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(processor, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#endif
+}
+
+#pragma mark Results
+
+/// A benchmark result emitted as one line of JSON
+///
+/// Results are written as JSON Lines so the output of a run can be consumed directly by other tools, for example
+/// @code
+/// Benchmarks | jq -s 'map(select(.benchmark == "RingBuffer"))'
+/// @endcode
+class Result
+{
+
+public:
+
+	/// Creates a result for @c benchmark
+	explicit Result(const char *benchmark)
+	{
+		Add("benchmark", benchmark);
+	}
+
+	/// Adds a string field
+	Result& Add(const char *key, const char *value)
+	{
+		Key(key);
+		mJSON += '"';
+		for(auto c = value; *c; ++c) {
+			if(*c == '"' || *c == '\\')
+				mJSON += '\\';
+			mJSON += *c;
+		}
+		mJSON += '"';
+		return *this;
+	}
+
+	/// Adds an integer field
+	Result& Add(const char *key, uint64_t value)
+	{
+		Key(key);
+		mJSON += std::to_string(value);
+		return *this;
+	}
+
+	/// Adds a floating-point field
+	Result& Add(const char *key, double value)
+	{
+		char buf [32];
+		std::snprintf(buf, sizeof buf, "%.6g", value);
+		Key(key);
+		mJSON += buf;
+		return *this;
+	}
+
+	/// Adds a boolean field
+	Result& Add(const char *key, bool value)
+	{
+		Key(key);
+		mJSON += value ? "true" : "false";
+		return *this;
+	}
+
+	/// Adds the fields of a latency summary
+	Result& Add(const LatencySummary& summary)
+	{
+		return Add("operations", summary.mCount).Add("p50_ns", summary.mP50).Add("p99_ns", summary.mP99).Add("p99_9_ns", summary.mP999).Add("max_ns", summary.mMax);
+	}
+
+	/// Writes the result to @c stdout
+	void Emit() const
+	{
+		std::printf("{%s}\n", mJSON.c_str());
+		std::fflush(stdout);
+	}
+
+private:
+
+	/// Appends a key to the JSON object
+	void Key(const char *key)
+	{
+		if(!mJSON.empty())
+			mJSON += ',';
+		mJSON += '"';
+		mJSON += key;
+		mJSON += "\":";
+	}
+
+	/// The members of the JSON object
+	std::string mJSON;
+
+};
+
+#pragma mark Producer and consumer transfers
+
+/// The measurements of a transfer between a producer and a consumer
+struct TransferMeasurements
+{
+	/// The latencies of the producer's successful operations
+	LatencySummary mWrite;
+	/// The latencies of the consumer's successful operations
+	LatencySummary mRead;
+	/// The elapsed time of the transfer in nanoseconds
+	uint64_t mElapsed = 0;
+	/// Whether both threads were bound to their processors
+	bool mPinned = false;
+};
+
+/// Transfers @c unitCount units from a producer thread to a consumer thread on separate processors
+///
+/// @c write and @c read are called repeatedly with the number of units transferred so far by that side and return the
+/// number of units they transferred, which may be zero if no space or data is available. Only calls that transfer
+/// at least one unit are timed, so the latencies exclude polling.
+/// @param unitCount The number of units to transfer
+/// @param write A callable with the signature @c uint64_t(uint64_t) run on the producer thread
+/// @param read A callable with the signature @c uint64_t(uint64_t) run on the consumer thread
+template <typename W, typename R>
+TransferMeasurements MeasureTransfer(uint64_t unitCount, W&& write, R&& read)
+{
+	std::vector<uint64_t> writeSamples;
+	std::vector<uint64_t> readSamples;
+	writeSamples.reserve(1024 * 1024);
+	readSamples.reserve(1024 * 1024);
+
+	std::atomic_uint ready = 0;
+	std::atomic_bool producerPinned = false;
+	std::atomic_bool consumerPinned = false;
+
+	// Both threads start together so neither measures the other's startup
+	const auto run = [&ready, unitCount](auto& operation, std::vector<uint64_t>& samples, std::atomic_bool& pinned, unsigned processor) {
+		pinned = PinCurrentThread(processor);
+		ready.fetch_add(1);
+		while(ready.load() < 2)
+			std::this_thread::yield();
+
+		uint64_t transferred = 0;
+		while(transferred < unitCount) {
+			const auto start = Now();
+			const auto count = operation(transferred);
+			const auto end = Now();
+			if(count > 0) {
+				samples.push_back(end - start);
+				transferred += count;
+			}
+			else
+				std::this_thread::yield();
+		}
+	};
+
+	const auto start = Now();
+	std::thread producer([&] { run(write, writeSamples, producerPinned, 0); });
+	std::thread consumer([&] { run(read, readSamples, consumerPinned, 1); });
+	producer.join();
+	consumer.join();
+
+	TransferMeasurements measurements;
+	measurements.mElapsed = Now() - start;
+	measurements.mWrite = Summarize(writeSamples);
+	measurements.mRead = Summarize(readSamples);
+	measurements.mPinned = producerPinned && consumerPinned;
+	return measurements;
+}
+
+/// Emits the results of a transfer as separate write and read results
+/// @param result A result containing the fields identifying the benchmark
+/// @param measurements The measurements of the transfer
+/// @param byteCount The number of bytes transferred
+inline void EmitTransfer(const Result& result, const TransferMeasurements& measurements, uint64_t byteCount)
+{
+	const auto bytesPerSecond = static_cast<double>(byteCount) * 1e9 / static_cast<double>(std::max<uint64_t>(measurements.mElapsed, 1));
+	for(const auto& [side, summary] : { std::pair{ "write", measurements.mWrite }, std::pair{ "read", measurements.mRead } }) {
+		Result sideResult = result;
+		sideResult.Add("side", side).Add(summary).Add("bytes_per_second", bytesPerSecond).Add("pinned", measurements.mPinned).Emit();
+	}
+}
+
+#pragma mark Single-threaded operations
+
+/// Times @c iterations calls of @c operation after @c iterations/10 untimed warm-up calls
+/// @param iterations The number of timed calls
+/// @param operation A callable with the signature @c void()
+template <typename F>
+LatencySummary MeasureOperation(uint64_t iterations, F&& operation)
+{
+	for(uint64_t i = 0; i < iterations / 10; ++i)
+		operation();
+
+	std::vector<uint64_t> samples;
+	samples.reserve(iterations);
+	for(uint64_t i = 0; i < iterations; ++i) {
+		const auto start = Now();
+		operation();
+		samples.push_back(Now() - start);
+	}
+
+	return Summarize(samples);
+}
+
+#pragma mark Running benchmarks
+
+/// The number of benchmarks that could not be run
+inline int sFailureCount = 0;
+
+/// Reports that @c benchmark could not be run
+inline void ReportFailure(const char *benchmark) noexcept
+{
+	std::fprintf(stderr, "%s failed\n", benchmark);
+	++sFailureCount;
+}
+
+/// Returns the process exit status for the benchmarks run so far
+inline int ExitStatus() noexcept
+{
+	return sFailureCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/// Returns the value of the command line option @c --name=value or @c fallback
+inline uint64_t Option(int argc, char *argv[], const char *name, uint64_t fallback) noexcept
+{
+	const auto length = std::strlen(name);
+	for(int i = 1; i < argc; ++i) {
+		if(!std::strncmp(argv[i], "--", 2) && !std::strncmp(argv[i] + 2, name, length) && argv[i][2 + length] == '=')
+			return std::strtoull(argv[i] + 3 + length, nullptr, 10);
+	}
+	return fallback;
+}
+
+} // namespace Benchmark
+} // namespace SFB
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2014 - 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <algorithm>
+#import <atomic>
+#import <cstdint>
+#import <cstdlib>
+#import <cstring>
+
+namespace SFB {
+namespace Benchmark {
+
+/// The byte ring buffer as it was before its positions were padded to separate cache lines and cached by each side
+///
+/// The read and write positions share a cache line and every read or write loads both with acquire semantics, so
+/// the producer and consumer contend for the line on each call. This exists only to compare against
+/// @c SFB::RingBuffer and copies data the same way.
+class LegacyRingBuffer
+{
+
+public:
+
+	LegacyRingBuffer() noexcept = default;
+
+	LegacyRingBuffer(const LegacyRingBuffer& rhs) = delete;
+	LegacyRingBuffer& operator=(const LegacyRingBuffer& rhs) = delete;
+
+	~LegacyRingBuffer()
+	{
+		std::free(mBuffer);
+	}
+
+	/// Allocates space for at least @c capacityBytes - 1 bytes of data, rounded up to a power of two
+	/// @param capacityBytes The desired capacity in the range [2..2147483648]
+	/// @return @c true on success, @c false otherwise
+	bool Allocate(uint32_t capacityBytes) noexcept
+	{
+		if(capacityBytes < 2 || capacityBytes > 0x80000000)
+			return false;
+
+		std::free(mBuffer);
+		capacityBytes = static_cast<uint32_t>(1 << (32 - __builtin_clz(capacityBytes - 1)));
+
+		mBuffer = static_cast<uint8_t *>(std::malloc(capacityBytes));
+		if(!mBuffer)
+			return false;
+
+		mCapacityBytes = capacityBytes;
+		mCapacityBytesMask = capacityBytes - 1;
+		mReadPosition = 0;
+		mWritePosition = 0;
+
+		return true;
+	}
+
+	/// Reads at most @c byteCount bytes into @c destinationBuffer and returns the number of bytes read
+	uint32_t Read(void * const destinationBuffer, uint32_t byteCount) noexcept
+	{
+		if(!destinationBuffer || byteCount == 0)
+			return 0;
+
+		auto writePosition = mWritePosition.load(std::memory_order_acquire);
+		auto readPosition = mReadPosition.load(std::memory_order_acquire);
+
+		uint32_t bytesAvailable;
+		if(writePosition > readPosition)
+			bytesAvailable = writePosition - readPosition;
+		else
+			bytesAvailable = (writePosition - readPosition + mCapacityBytes) & mCapacityBytesMask;
+
+		if(bytesAvailable == 0)
+			return 0;
+
+		auto bytesToRead = std::min(bytesAvailable, byteCount);
+		if(readPosition + bytesToRead > mCapacityBytes) {
+			auto bytesAfterReadPointer = mCapacityBytes - readPosition;
+			std::memcpy(destinationBuffer, mBuffer + readPosition, bytesAfterReadPointer);
+			std::memcpy(static_cast<uint8_t *>(destinationBuffer) + bytesAfterReadPointer, mBuffer, bytesToRead - bytesAfterReadPointer);
+		}
+		else
+			std::memcpy(destinationBuffer, mBuffer + readPosition, bytesToRead);
+
+		mReadPosition.store((readPosition + bytesToRead) & mCapacityBytesMask, std::memory_order_release);
+
+		return bytesToRead;
+	}
+
+	/// Writes at most @c byteCount bytes from @c sourceBuffer and returns the number of bytes written
+	uint32_t Write(const void * const sourceBuffer, uint32_t byteCount) noexcept
+	{
+		if(!sourceBuffer || byteCount == 0)
+			return 0;
+
+		auto writePosition = mWritePosition.load(std::memory_order_acquire);
+		auto readPosition = mReadPosition.load(std::memory_order_acquire);
+
+		uint32_t bytesAvailable;
+		if(writePosition > readPosition)
+			bytesAvailable = ((readPosition - writePosition + mCapacityBytes) & mCapacityBytesMask) - 1;
+		else if(writePosition < readPosition)
+			bytesAvailable = (readPosition - writePosition) - 1;
+		else
+			bytesAvailable = mCapacityBytes - 1;
+
+		if(bytesAvailable == 0)
+			return 0;
+
+		auto bytesToWrite = std::min(bytesAvailable, byteCount);
+		if(writePosition + bytesToWrite > mCapacityBytes) {
+			auto bytesAfterWritePointer = mCapacityBytes - writePosition;
+			std::memcpy(mBuffer + writePosition, sourceBuffer, bytesAfterWritePointer);
+			std::memcpy(mBuffer, static_cast<const uint8_t *>(sourceBuffer) + bytesAfterWritePointer, bytesToWrite - bytesAfterWritePointer);
+		}
+		else
+			std::memcpy(mBuffer + writePosition, sourceBuffer, bytesToWrite);
+
+		mWritePosition.store((writePosition + bytesToWrite) & mCapacityBytesMask, std::memory_order_release);
+
+		return bytesToWrite;
+	}
+
+private:
+
+	/// The memory buffer holding the data
+	uint8_t * _Nullable mBuffer = nullptr;
+
+	/// The capacity of @c mBuffer in bytes
+	uint32_t mCapacityBytes = 0;
+	/// The capacity of @c mBuffer in bytes minus one
+	uint32_t mCapacityBytesMask = 0;
+
+	/// The offset into @c mBuffer of the write location
+	std::atomic_uint32_t mWritePosition = 0;
+	/// The offset into @c mBuffer of the read location
+	std::atomic_uint32_t mReadPosition = 0;
+
+};
+
+} // namespace Benchmark
+} // namespace SFB
@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cstdlib>
+#import <cstring>
+
+#import <sys/mman.h>
+
+#import "SFBAllocationPolicy.hpp"
+#import "SFBMirroredMemory.hpp"
+
+namespace {
+
+/// Returns the alignment in bytes of memory allocated by @c AllocateMemory using @c policy
+///
+/// Locked memory is page-aligned because @c mlock does not nest: unlocking one allocation would unlock any page it shares
+/// with another locked allocation.
+size_t AllocationAlignment(const SFB::AllocationPolicy& policy) noexcept
+{
+	const auto alignment = SFB::EffectiveAlignment(policy);
+	return policy.mLockMemory ? std::max(alignment, SFB::VirtualMemoryPageSize()) : alignment;
+}
+
+/// Returns the number of bytes allocated by @c AllocateMemory for a request of @c byteCount bytes using @c policy
+/// @note Locked memory is rounded up to whole pages
+size_t AllocationSize(size_t byteCount, const SFB::AllocationPolicy& policy) noexcept
+{
+	if(!policy.mLockMemory)
+		return byteCount;
+	const auto pageSize = SFB::VirtualMemoryPageSize();
+	return (byteCount + pageSize - 1) & ~(pageSize - 1);
+}
+
+} // namespace
+
+SFB::AllocationPolicy SFB::AllocationPolicy::PageAligned() noexcept
+{
+	return { .mAlignment = VirtualMemoryPageSize() };
+}
+
+size_t SFB::EffectiveAlignment(const AllocationPolicy& policy) noexcept
+{
+	return std::max(policy.mAlignment, alignof(std::max_align_t));
+}
+
+size_t SFB::AlignedSize(size_t byteCount, const AllocationPolicy& policy) noexcept
+{
+	const auto alignment = EffectiveAlignment(policy);
+	return (byteCount + alignment - 1) & ~(alignment - 1);
+}
+
+void * SFB::AllocateMemory(size_t byteCount, const AllocationPolicy& policy) noexcept
+{
+	if(byteCount == 0)
+		return nullptr;
+
+	const auto alignment = AllocationAlignment(policy);
+	byteCount = AllocationSize(byteCount, policy);
+
+	void *memory = nullptr;
+	if(alignment > alignof(std::max_align_t)) {
+		if(posix_memalign(&memory, alignment, byteCount) != 0)
+			return nullptr;
+	}
+	else {
+		memory = std::malloc(byteCount);
+		if(!memory)
+			return nullptr;
+	}
+
+	// Prefaulting zero-fills the memory
+	if(!policy.mPrefaultMemory)
+		std::memset(memory, 0, byteCount);
+
+	if(!PrepareMemory(memory, byteCount, policy)) {
+		std::free(memory);
+		return nullptr;
+	}
+
+	return memory;
+}
+
+void SFB::DeallocateMemory(void *memory, size_t byteCount, const AllocationPolicy& policy) noexcept
+{
+	if(memory) {
+		UnprepareMemory(memory, AllocationSize(byteCount, policy), policy);
+		std::free(memory);
+	}
+}
+
+bool SFB::PrepareMemory(void *memory, size_t byteCount, const AllocationPolicy& policy) noexcept
+{
+	// Writing to each page forces the kernel to map it now instead of on first use by the real-time thread
+	if(policy.mPrefaultMemory)
+		std::memset(memory, 0, byteCount);
+
+	if(policy.mLockMemory && mlock(memory, byteCount) != 0)
+		return false;
+
+	return true;
+}
+
+void SFB::UnprepareMemory(void *memory, size_t byteCount, const AllocationPolicy& policy) noexcept
+{
+	if(policy.mLockMemory)
+		munlock(memory, byteCount);
+}
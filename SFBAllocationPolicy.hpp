@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstddef>
+
+namespace SFB {
+
+/// Options controlling how the memory for a buffer is allocated
+///
+/// The default policy matches @c std::malloc. Locked and prefaulted memory is resident and mapped before
+/// @c Allocate() returns so the first accesses on a real-time thread do not cause page faults.
+struct AllocationPolicy
+{
+	/// The alignment of each channel buffer, in bytes
+	/// @note This must be @c 0 or a power of two. @c 0 selects the alignment of @c std::malloc
+	size_t mAlignment = 0;
+	/// The number of bytes of unused space following each channel buffer
+	/// @note Padding prevents the channel buffers of a single allocation from mapping to the same cache sets
+	/// when the channel buffer size is a multiple of a large power of two. The size of each channel buffer plus
+	/// its padding is rounded up to a multiple of the alignment, so at least @c mChannelPadding bytes follow it.
+	size_t mChannelPadding = 0;
+	/// Whether the memory is locked into physical memory using @c mlock
+	/// @note Locked memory is allocated in whole pages so unlocking one allocation cannot unlock another
+	bool mLockMemory = false;
+	/// Whether every page of the memory is written after allocation
+	bool mPrefaultMemory = false;
+
+	/// Returns a policy aligning channel buffers to 64 bytes
+	static constexpr AllocationPolicy CacheLineAligned() noexcept
+	{
+		return { .mAlignment = 64 };
+	}
+
+	/// Returns a policy aligning channel buffers to the virtual memory page size
+	static AllocationPolicy PageAligned() noexcept;
+
+	/// Returns a policy suitable for buffers accessed on a real-time thread
+	///
+	/// Channel buffers are aligned to 64 bytes and separated by 128 bytes of padding, and the memory is locked and prefaulted.
+	static constexpr AllocationPolicy RealTime() noexcept
+	{
+		return { .mAlignment = 64, .mChannelPadding = 128, .mLockMemory = true, .mPrefaultMemory = true };
+	}
+};
+
+/// Returns the alignment in bytes used for @c policy
+size_t EffectiveAlignment(const AllocationPolicy& policy) noexcept;
+
+/// Returns @c byteCount rounded up to a multiple of the alignment used for @c policy
+size_t AlignedSize(size_t byteCount, const AllocationPolicy& policy) noexcept;
+
+/// Allocates memory according to @c policy
+/// @note The memory is zero-filled
+/// @param byteCount The number of bytes to allocate
+/// @param policy The allocation policy
+/// @return The address of the allocation, aligned as specified by @c policy, or @c nullptr on error
+void * _Nullable AllocateMemory(size_t byteCount, const AllocationPolicy& policy) noexcept;
+
+/// Deallocates memory allocated by @c AllocateMemory
+/// @param memory The address returned by @c AllocateMemory or @c nullptr
+/// @param byteCount The @c byteCount value passed to @c AllocateMemory
+/// @param policy The @c policy value passed to @c AllocateMemory
+void DeallocateMemory(void * _Nullable memory, size_t byteCount, const AllocationPolicy& policy) noexcept;
+
+/// Prefaults and locks existing memory as specified by @c policy
+/// @note Prefaulting overwrites the memory with zeroes
+/// @note Locks do not nest, so memory to be locked should consist of whole pages not shared with other locked memory
+/// @param memory The address of the memory
+/// @param byteCount The size of the memory in bytes
+/// @param policy The allocation policy
+/// @return @c true on success, @c false if the memory could not be locked
+bool PrepareMemory(void * _Nonnull memory, size_t byteCount, const AllocationPolicy& policy) noexcept;
+
+/// Unlocks memory prepared by @c PrepareMemory
+/// @param memory The @c memory value passed to @c PrepareMemory
+/// @param byteCount The @c byteCount value passed to @c PrepareMemory
+/// @param policy The @c policy value passed to @c PrepareMemory
+void UnprepareMemory(void * _Nonnull memory, size_t byteCount, const AllocationPolicy& policy) noexcept;
+
+} // namespace SFB
@@ -0,0 +1,355 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <bit>
+#import <cmath>
+#import <cstring>
+#import <type_traits>
+
+#import <Accelerate/Accelerate.h>
+
+#import "SFBAudioBufferAnalysis.hpp"
+
+namespace {
+
+/// @c true if the host stores multi-byte values most significant byte first
+constexpr bool sHostIsBigEndian = kAudioFormatFlagsNativeEndian == kAudioFormatFlagIsBigEndian;
+
+/// The number of samples examined between checks for a non-silent sample
+constexpr uint32_t sBlockSize = 64;
+
+/// Returns @c value with its bytes reversed
+inline uint16_t ByteSwap(uint16_t value) noexcept { return __builtin_bswap16(value); }
+/// Returns @c value with its bytes reversed
+inline uint32_t ByteSwap(uint32_t value) noexcept { return __builtin_bswap32(value); }
+/// Returns @c value with its bytes reversed
+inline uint64_t ByteSwap(uint64_t value) noexcept { return __builtin_bswap64(value); }
+
+/// Decodes floating point samples of type @c T, optionally byte swapping
+template <typename T, bool Swap>
+struct FloatDecoder
+{
+	using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+
+	static constexpr uint32_t sBytesPerSample = sizeof(T);
+
+	/// Returns the sample at @c p as an unsigned integer
+	static Bits Load(const uint8_t * const _Nonnull p) noexcept
+	{
+		Bits bits;
+		std::memcpy(&bits, p, sizeof bits);
+		if constexpr(Swap)
+			bits = ByteSwap(bits);
+		return bits;
+	}
+
+	/// Returns zero if the sample at @c p is silent
+	/// @note The sign bit is discarded so that @c -0 is treated as silence
+	uint64_t Residue(const uint8_t * const _Nonnull p) const noexcept
+	{
+		return static_cast<Bits>(Load(p) << 1);
+	}
+
+	/// Returns the value of the sample at @c p
+	double Value(const uint8_t * const _Nonnull p) const noexcept
+	{
+		return std::bit_cast<T>(Load(p));
+	}
+
+	/// The factor mapping sample values to full scale
+	double mScale = 1;
+};
+
+/// Decodes @c Size byte integer samples stored in the specified byte order
+template <uint32_t Size, bool BigEndian>
+struct IntegerDecoder
+{
+	static constexpr uint32_t sBytesPerSample = Size;
+
+	/// Creates a decoder for the integer format described by @c format
+	explicit IntegerDecoder(const SFB::CAStreamBasicDescription& format) noexcept
+	{
+		// Move the valid bits to the most significant end of a 64-bit word, offset unsigned samples
+		// so silence is zero, then shift back with sign extension
+		const auto wordBits = Size * 8;
+		const auto validBits = format.mBitsPerChannel;
+		mLeftShift = 64 - (format.IsAlignedHigh() ? wordBits : validBits);
+		mRightShift = 64 - validBits;
+		mSignFlip = format.IsSignedInteger() ? 0 : (uint64_t{1} << 63);
+		mScale = std::ldexp(1.0, -static_cast<int>(validBits - 1));
+	}
+
+	/// Returns the sample word at @c p in the low bits of an unsigned integer
+	static uint64_t Load(const uint8_t * const _Nonnull p) noexcept
+	{
+		if constexpr(Size == 1)
+			return *p;
+		else if constexpr(Size == 3) {
+			if constexpr(BigEndian)
+				return (uint64_t{p[0]} << 16) | (uint64_t{p[1]} << 8) | p[2];
+			else
+				return (uint64_t{p[2]} << 16) | (uint64_t{p[1]} << 8) | p[0];
+		}
+		else {
+			using Word = std::conditional_t<Size == 2, uint16_t, std::conditional_t<Size == 4, uint32_t, uint64_t>>;
+			Word word;
+			std::memcpy(&word, p, sizeof word);
+			if constexpr(BigEndian != sHostIsBigEndian)
+				word = ByteSwap(word);
+			return word;
+		}
+	}
+
+	/// Returns the signed value of the sample at @c p, which is zero for silence
+	int64_t Integer(const uint8_t * const _Nonnull p) const noexcept
+	{
+		return static_cast<int64_t>((Load(p) << mLeftShift) ^ mSignFlip) >> mRightShift;
+	}
+
+	/// Returns zero if the sample at @c p is silent
+	uint64_t Residue(const uint8_t * const _Nonnull p) const noexcept
+	{
+		return static_cast<uint64_t>(Integer(p));
+	}
+
+	/// Returns the value of the sample at @c p
+	double Value(const uint8_t * const _Nonnull p) const noexcept
+	{
+		return static_cast<double>(Integer(p));
+	}
+
+	/// The left shift placing the valid bits in the most significant bits
+	uint32_t mLeftShift;
+	/// The right shift returning the valid bits to the least significant bits
+	uint32_t mRightShift;
+	/// The bit pattern offsetting unsigned samples so silence is zero
+	uint64_t mSignFlip;
+	/// The factor mapping sample values to full scale
+	double mScale;
+};
+
+/// Returns the size in bytes of a single sample in @c format or @c 0 if @c format is not supported
+uint32_t SupportedBytesPerSample(const SFB::CAStreamBasicDescription& format) noexcept
+{
+	if(!format.IsPCM() || format.mChannelsPerFrame == 0 || format.mBytesPerFrame == 0)
+		return 0;
+
+	const auto interleavedChannelCount = format.InterleavedChannelCount();
+	if(format.mBytesPerFrame % interleavedChannelCount)
+		return 0;
+
+	const auto bytesPerSample = format.mBytesPerFrame / interleavedChannelCount;
+	if(format.IsFloat())
+		return (bytesPerSample * 8 == format.mBitsPerChannel && (bytesPerSample == 4 || bytesPerSample == 8)) ? bytesPerSample : 0;
+
+	if(format.mBitsPerChannel == 0 || format.mBitsPerChannel > bytesPerSample * 8)
+		return 0;
+
+	switch(bytesPerSample) {
+		case 1: case 2: case 3: case 4: case 8:
+			return bytesPerSample;
+		default:
+			return 0;
+	}
+}
+
+/// Calls @c f with the decoder for @c format and returns the result or returns @c unsupported if @c format is not supported
+template <typename R, typename F>
+R WithDecoder(const SFB::CAStreamBasicDescription& format, R unsupported, F&& f) noexcept
+{
+	const auto bytesPerSample = SupportedBytesPerSample(format);
+	const auto bigEndian = format.IsBigEndian();
+	const auto swap = bigEndian != sHostIsBigEndian;
+
+	if(format.IsFloat()) {
+		if(bytesPerSample == 4)
+			return swap ? f(FloatDecoder<float, true>{}) : f(FloatDecoder<float, false>{});
+		else if(bytesPerSample == 8)
+			return swap ? f(FloatDecoder<double, true>{}) : f(FloatDecoder<double, false>{});
+		return unsupported;
+	}
+
+	switch(bytesPerSample) {
+		case 1:		return f(IntegerDecoder<1, false>(format));
+		case 2:		return bigEndian ? f(IntegerDecoder<2, true>(format)) : f(IntegerDecoder<2, false>(format));
+		case 3:		return bigEndian ? f(IntegerDecoder<3, true>(format)) : f(IntegerDecoder<3, false>(format));
+		case 4:		return bigEndian ? f(IntegerDecoder<4, true>(format)) : f(IntegerDecoder<4, false>(format));
+		case 8:		return bigEndian ? f(IntegerDecoder<8, true>(format)) : f(IntegerDecoder<8, false>(format));
+		default:	return unsupported;
+	}
+}
+
+/// Returns the number of valid frames in @c buffer
+inline uint32_t ValidFrameCount(const AudioBuffer& buffer, const SFB::CAStreamBasicDescription& format, uint32_t frameLength) noexcept
+{
+	return std::min(frameLength, buffer.mDataByteSize / format.mBytesPerFrame);
+}
+
+/// Returns the index of the first non-silent sample in a contiguous run of samples, or @c sampleCount if all are silent
+template <typename D>
+uint32_t FirstNonSilentSample(const uint8_t * const _Nonnull data, uint32_t sampleCount, const D& decoder) noexcept
+{
+	uint32_t i = 0;
+
+	// Merge the residues of a block of samples so the inner loop has no early exit and may be vectorized
+	for(; i + sBlockSize <= sampleCount; i += sBlockSize) {
+		uint64_t residue = 0;
+		for(uint32_t j = 0; j < sBlockSize; ++j)
+			residue |= decoder.Residue(data + (i + j) * D::sBytesPerSample);
+		if(residue)
+			break;
+	}
+
+	// Locate the non-silent sample in the block, or examine the remaining samples
+	for(; i < sampleCount; ++i) {
+		if(decoder.Residue(data + i * D::sBytesPerSample))
+			return i;
+	}
+
+	return sampleCount;
+}
+
+/// Returns the peak absolute value of @c frameCount samples spaced @c stride bytes apart
+template <typename D>
+double StridedPeak(const uint8_t * const _Nonnull data, uint32_t frameCount, uint32_t stride, const D& decoder) noexcept
+{
+	double min = 0;
+	double max = 0;
+	for(uint32_t i = 0; i < frameCount; ++i) {
+		const auto value = decoder.Value(data + i * stride);
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+	return std::max(-min, max) * decoder.mScale;
+}
+
+/// Returns the root mean square of @c frameCount samples spaced @c stride bytes apart
+template <typename D>
+double StridedRMS(const uint8_t * const _Nonnull data, uint32_t frameCount, uint32_t stride, const D& decoder) noexcept
+{
+	// Independent partial sums shorten the dependency chain
+	double sums[4] = { 0, 0, 0, 0 };
+	uint32_t i = 0;
+	for(; i + 4 <= frameCount; i += 4) {
+		for(uint32_t j = 0; j < 4; ++j) {
+			const auto value = decoder.Value(data + (i + j) * stride);
+			sums[j] += value * value;
+		}
+	}
+	for(; i < frameCount; ++i) {
+		const auto value = decoder.Value(data + i * stride);
+		sums[0] += value * value;
+	}
+
+	return std::sqrt(((sums[0] + sums[1]) + (sums[2] + sums[3])) / frameCount) * decoder.mScale;
+}
+
+/// Returns the address of the first sample of @c channel in @c bufferList
+inline const uint8_t * _Nullable ChannelData(const AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& format, uint32_t channel, uint32_t& bufferIndex) noexcept
+{
+	const auto interleavedChannelCount = format.InterleavedChannelCount();
+	bufferIndex = channel / interleavedChannelCount;
+	if(bufferIndex >= bufferList->mNumberBuffers)
+		return nullptr;
+	const auto channelOffset = (channel % interleavedChannelCount) * (format.mBytesPerFrame / interleavedChannelCount);
+	return static_cast<const uint8_t *>(bufferList->mBuffers[bufferIndex].mData) + channelOffset;
+}
+
+} // namespace
+
+bool SFB::AudioBufferAnalysis::IsDigitalSilence(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameLength) noexcept
+{
+	return WithDecoder(format, false, [&](const auto& decoder) {
+		const auto interleavedChannelCount = format.InterleavedChannelCount();
+		for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+			const auto& buffer = bufferList->mBuffers[i];
+			const auto sampleCount = ValidFrameCount(buffer, format, frameLength) * interleavedChannelCount;
+			if(FirstNonSilentSample(static_cast<const uint8_t *>(buffer.mData), sampleCount, decoder) != sampleCount)
+				return false;
+		}
+		return true;
+	});
+}
+
+uint32_t SFB::AudioBufferAnalysis::FirstNonSilentFrame(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameLength) noexcept
+{
+	return WithDecoder(format, uint32_t{0}, [&](const auto& decoder) {
+		const auto interleavedChannelCount = format.InterleavedChannelCount();
+		auto firstNonSilentFrame = frameLength;
+		for(UInt32 i = 0; i < bufferList->mNumberBuffers && firstNonSilentFrame > 0; ++i) {
+			const auto& buffer = bufferList->mBuffers[i];
+			// Frames past the earliest non-silent frame seen so far need not be examined
+			const auto sampleCount = ValidFrameCount(buffer, format, firstNonSilentFrame) * interleavedChannelCount;
+			const auto sample = FirstNonSilentSample(static_cast<const uint8_t *>(buffer.mData), sampleCount, decoder);
+			if(sample != sampleCount)
+				firstNonSilentFrame = sample / interleavedChannelCount;
+		}
+		return firstNonSilentFrame;
+	});
+}
+
+double SFB::AudioBufferAnalysis::Peak(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameLength, uint32_t channel) noexcept
+{
+	if(channel >= format.mChannelsPerFrame)
+		return 0;
+
+	return WithDecoder(format, 0.0, [&](const auto& decoder) {
+		uint32_t bufferIndex;
+		const auto data = ChannelData(bufferList, format, channel, bufferIndex);
+		if(!data)
+			return 0.0;
+
+		const auto frameCount = ValidFrameCount(bufferList->mBuffers[bufferIndex], format, frameLength);
+		if(frameCount == 0)
+			return 0.0;
+
+		using D = std::decay_t<decltype(decoder)>;
+		if constexpr(std::is_same_v<D, FloatDecoder<float, false>>) {
+			float peak;
+			vDSP_maxmgv(reinterpret_cast<const float *>(data), format.InterleavedChannelCount(), &peak, frameCount);
+			return static_cast<double>(peak);
+		}
+		else if constexpr(std::is_same_v<D, FloatDecoder<double, false>>) {
+			double peak;
+			vDSP_maxmgvD(reinterpret_cast<const double *>(data), format.InterleavedChannelCount(), &peak, frameCount);
+			return peak;
+		}
+		else
+			return StridedPeak(data, frameCount, format.mBytesPerFrame, decoder);
+	});
+}
+
+double SFB::AudioBufferAnalysis::RMS(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameLength, uint32_t channel) noexcept
+{
+	if(channel >= format.mChannelsPerFrame)
+		return 0;
+
+	return WithDecoder(format, 0.0, [&](const auto& decoder) {
+		uint32_t bufferIndex;
+		const auto data = ChannelData(bufferList, format, channel, bufferIndex);
+		if(!data)
+			return 0.0;
+
+		const auto frameCount = ValidFrameCount(bufferList->mBuffers[bufferIndex], format, frameLength);
+		if(frameCount == 0)
+			return 0.0;
+
+		using D = std::decay_t<decltype(decoder)>;
+		if constexpr(std::is_same_v<D, FloatDecoder<float, false>>) {
+			float rms;
+			vDSP_rmsqv(reinterpret_cast<const float *>(data), format.InterleavedChannelCount(), &rms, frameCount);
+			return static_cast<double>(rms);
+		}
+		else if constexpr(std::is_same_v<D, FloatDecoder<double, false>>) {
+			double rms;
+			vDSP_rmsqvD(reinterpret_cast<const double *>(data), format.InterleavedChannelCount(), &rms, frameCount);
+			return rms;
+		}
+		else
+			return StridedRMS(data, frameCount, format.mBytesPerFrame, decoder);
+	});
+}
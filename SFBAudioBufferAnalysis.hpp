@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdint>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+namespace AudioBufferAnalysis {
+
+// Linear PCM audio with 32- or 64-bit floating point samples or 8-, 16-, 24-, 32-, or 64-bit integer samples is
+// supported in any byte order, packed or unpacked, and interleaved or non-interleaved.
+//
+// Native-endian floating point peak and RMS levels are computed using Accelerate. Other formats use
+// kernels written to be vectorized by the compiler which examine blocks of samples at a time.
+//
+// The functions examine at most the first @c frameLength frames of each buffer in @c bufferList, limited
+// by the buffer's @c mDataByteSize. They do not allocate memory and are safe to call from a real-time context.
+
+/// Returns @c true if @c bufferList contains only digital silence
+///
+/// Silence is a floating point value of @c 0 (of either sign) or an integer value equal to the midpoint of the
+/// sample range, which is @c 0 for signed integers.
+/// @param bufferList The audio to examine
+/// @param format The format of @c bufferList
+/// @param frameLength The number of valid frames in @c bufferList
+/// @return @c true if all samples are silent, @c false otherwise or if @c format is not supported
+bool IsDigitalSilence(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameLength) noexcept;
+
+/// Returns the offset of the first frame in @c bufferList containing a non-silent sample in any channel
+/// @param bufferList The audio to examine
+/// @param format The format of @c bufferList
+/// @param frameLength The number of valid frames in @c bufferList
+/// @return The offset of the first non-silent frame, @c frameLength if all frames are silent, or @c 0 if @c format is not supported
+uint32_t FirstNonSilentFrame(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameLength) noexcept;
+
+/// Returns the peak absolute sample value in a channel of @c bufferList
+///
+/// Integer samples are scaled so that full scale is @c 1.
+/// @param bufferList The audio to examine
+/// @param format The format of @c bufferList
+/// @param frameLength The number of valid frames in @c bufferList
+/// @param channel The channel to examine
+/// @return The peak value, or @c 0 if @c channel is out of range or @c format is not supported
+double Peak(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameLength, uint32_t channel) noexcept;
+
+/// Returns the root mean square of the sample values in a channel of @c bufferList
+///
+/// Integer samples are scaled so that full scale is @c 1.
+/// @param bufferList The audio to examine
+/// @param format The format of @c bufferList
+/// @param frameLength The number of valid frames in @c bufferList
+/// @param channel The channel to examine
+/// @return The RMS value, or @c 0 if @c channel is out of range or @c format is not supported
+double RMS(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameLength, uint32_t channel) noexcept;
+
+} // namespace AudioBufferAnalysis
+} // namespace SFB
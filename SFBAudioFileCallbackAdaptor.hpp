@@ -0,0 +1,515 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <algorithm>
+#import <atomic>
+#import <condition_variable>
+#import <cstring>
+#import <memory>
+#import <mutex>
+#import <vector>
+
+#import <dispatch/dispatch.h>
+#import <sys/types.h>
+
+#import "SFBByteStream.hpp"
+#import "SFBCAAudioFile.hpp"
+
+CF_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+/// An audio file source reading from a buffer in memory
+struct AudioFileMemorySource
+{
+	/// The audio file data
+	const void * _Nullable mData;
+	/// The size of @c mData in bytes
+	size_t mSize;
+
+	/// Returns the size of the audio file in bytes
+	inline SInt64 Size() const noexcept
+	{
+		return static_cast<SInt64>(mSize);
+	}
+
+	/// Reads bytes of the audio file
+	inline size_t Read(SInt64 position, void *buffer, size_t count) const noexcept
+	{
+		if(!mData || position < 0 || static_cast<size_t>(position) >= mSize)
+			return 0;
+		count = std::min(count, mSize - static_cast<size_t>(position));
+		std::memcpy(buffer, static_cast<const uint8_t *>(mData) + position, count);
+		return count;
+	}
+};
+
+/// An audio file source reading from a @c ByteStream
+struct AudioFileByteStreamSource
+{
+	/// The audio file data
+	ByteStream mByteStream;
+
+	/// Returns the size of the audio file in bytes
+	inline SInt64 Size() const noexcept
+	{
+		return static_cast<SInt64>(mByteStream.Length());
+	}
+
+	/// Reads bytes of the audio file
+	inline size_t Read(SInt64 position, void *buffer, size_t count) noexcept
+	{
+		if(position < 0 || static_cast<size_t>(position) >= mByteStream.Length())
+			return 0;
+		mByteStream.SetPosition(static_cast<size_t>(position));
+		return mByteStream.Read(buffer, count);
+	}
+};
+
+/// Adapts a typed byte source to the @c AudioFile callback API with read-ahead buffering
+///
+/// @c AudioFile issues many small reads while parsing a file. The adaptor coalesces them into fetches of whole,
+/// aligned blocks which are kept in a small cache. Reads at least as large as a block bypass the cache. When reads
+/// proceed sequentially the next block is fetched asynchronously so it is ready before it is needed.
+///
+/// @c Source must provide the following members:
+/// @code
+/// SInt64 Size();                                          // The size of the file in bytes
+/// size_t Read(SInt64 position, void *buffer, size_t count); // Returns the number of bytes read
+/// @endcode
+/// To support writing, @c Source must also provide:
+/// @code
+/// size_t Write(SInt64 position, const void *buffer, size_t count); // Returns the number of bytes written
+/// bool SetSize(SInt64 size);
+/// @endcode
+/// @c Source may throw exceptions, which are reported to @c AudioFile as errors. Calls to @c Source are serialized
+/// but may be made from a background thread when prefetching is enabled.
+/// @note The adaptor must outlive any @c CAAudioFile opened with it
+/// @tparam Source The type of the byte source
+template <typename Source>
+class AudioFileCallbackAdaptor
+{
+
+public:
+
+	/// @c true if @c Source supports writing
+	static constexpr bool sIsWritable = requires(Source& source, SInt64 position, const void *buffer, size_t count) {
+		source.Write(position, buffer, count);
+		source.SetSize(position);
+	};
+
+	/// Buffering options
+	struct Options
+	{
+		/// The size of a cache block in bytes
+		size_t mBlockSize = 64 * 1024;
+		/// The number of cache blocks or @c 0 to disable buffering
+		size_t mBlockCount = 4;
+		/// Whether to fetch the next block asynchronously during sequential reads
+		bool mPrefetch = true;
+	};
+
+	/// Information on the effectiveness of buffering
+	struct AdaptorStatistics
+	{
+		/// The number of read requests from @c AudioFile
+		uint64_t mReadRequests;
+		/// The number of read requests satisfied from the cache
+		uint64_t mCacheHits;
+		/// The number of reads from the source
+		uint64_t mSourceReads;
+		/// The number of bytes read from the source
+		uint64_t mBytesFetched;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates an @c AudioFileCallbackAdaptor for @c source
+	/// @param source The byte source
+	/// @param options The buffering options
+	/// @throw @c std::bad_alloc
+	explicit AudioFileCallbackAdaptor(Source source, const Options& options = {})
+	: mSource(std::move(source)), mOptions(options), mUseCounter(0), mLastBlockRead(-1), mPendingPrefetches(0), mWriteGeneration(0), mReadRequests(0), mCacheHits(0), mSourceReads(0), mBytesFetched(0)
+	{
+		mOptions.mBlockSize = std::max(mOptions.mBlockSize, static_cast<size_t>(1));
+		// Prefetching needs a block to read from and a block to fill
+		if(mOptions.mBlockCount < 2)
+			mOptions.mPrefetch = false;
+
+		mBlocks.resize(mOptions.mBlockCount);
+		for(auto& block : mBlocks)
+			block.mData = std::make_unique<uint8_t[]>(mOptions.mBlockSize);
+	}
+
+	// This class is non-copyable
+	AudioFileCallbackAdaptor(const AudioFileCallbackAdaptor& rhs) = delete;
+
+	// This class is non-assignable
+	AudioFileCallbackAdaptor& operator=(const AudioFileCallbackAdaptor& rhs) = delete;
+
+	/// Waits for pending prefetches and destroys the @c AudioFileCallbackAdaptor
+	~AudioFileCallbackAdaptor()
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		mCondition.wait(lock, [this] { return mPendingPrefetches == 0; });
+	}
+
+	// This class is non-movable
+	AudioFileCallbackAdaptor(AudioFileCallbackAdaptor&& rhs) = delete;
+
+	// This class is non-move assignable
+	AudioFileCallbackAdaptor& operator=(AudioFileCallbackAdaptor&& rhs) = delete;
+
+#pragma mark Opening
+
+	/// Opens @c audioFile using the adaptor's callbacks
+	/// @param audioFile The @c CAAudioFile to open
+	/// @param fileTypeHint A hint for the file type or @c 0
+	/// @throw @c std::system_error
+	void Open(CAAudioFile& audioFile, AudioFileTypeID fileTypeHint = 0)
+	{
+		if constexpr(sIsWritable)
+			audioFile.OpenWithCallbacks(this, ReadProc, WriteProc, GetSizeProc, SetSizeProc, fileTypeHint);
+		else
+			audioFile.OpenWithCallbacks(this, ReadProc, nullptr, GetSizeProc, nullptr, fileTypeHint);
+	}
+
+	/// Creates a new audio file in @c audioFile using the adaptor's callbacks
+	/// @param audioFile The @c CAAudioFile to initialize
+	/// @param fileType The type of the file to create
+	/// @param format The format of the audio data
+	/// @param flags Flags for creating the file
+	/// @throw @c std::system_error
+	void Initialize(CAAudioFile& audioFile, AudioFileTypeID fileType, const AudioStreamBasicDescription& format, AudioFileFlags flags) requires sIsWritable
+	{
+		audioFile.InitializeWithCallbacks(this, ReadProc, WriteProc, GetSizeProc, SetSizeProc, fileType, format, flags);
+	}
+
+#pragma mark Source and statistics
+
+	/// Returns the byte source
+	/// @note The source must not be used while a callback or prefetch may be in progress
+	inline Source& GetSource() noexcept
+	{
+		return mSource;
+	}
+
+	/// Returns the buffering statistics
+	/// @note This method is safe to call from any thread
+	AdaptorStatistics Statistics() const noexcept
+	{
+		return {
+			.mReadRequests = mReadRequests.load(std::memory_order_relaxed),
+			.mCacheHits = mCacheHits.load(std::memory_order_relaxed),
+			.mSourceReads = mSourceReads.load(std::memory_order_relaxed),
+			.mBytesFetched = mBytesFetched.load(std::memory_order_relaxed),
+		};
+	}
+
+private:
+
+	/// A cached block of the source
+	struct Block
+	{
+		/// The offset of the block in the source or @c -1 if the block is unused
+		SInt64 mOffset = -1;
+		/// The number of valid bytes in @c mData
+		size_t mLength = 0;
+		/// The value of @c mUseCounter when the block was last used
+		uint64_t mLastUse = 0;
+		/// @c true while the block is being fetched
+		bool mLoading = false;
+		/// The block data
+		std::unique_ptr<uint8_t[]> mData;
+	};
+
+	/// The context for a prefetch
+	struct PrefetchContext
+	{
+		/// The adaptor
+		AudioFileCallbackAdaptor *mAdaptor;
+		/// The block to fill
+		Block *mBlock;
+		/// The value of @c mWriteGeneration when the prefetch was scheduled
+		uint64_t mWriteGeneration;
+	};
+
+#pragma mark Source access
+
+	/// Reads from the source
+	/// @return The number of bytes read or @c -1 on error
+	ssize_t FetchFromSource(SInt64 position, void *buffer, size_t count) noexcept
+	{
+		std::lock_guard<std::mutex> lock(mSourceLock);
+		try {
+			const auto bytesRead = mSource.Read(position, buffer, count);
+			mSourceReads.fetch_add(1, std::memory_order_relaxed);
+			mBytesFetched.fetch_add(bytesRead, std::memory_order_relaxed);
+			return static_cast<ssize_t>(bytesRead);
+		}
+		catch(...) {
+			return -1;
+		}
+	}
+
+	/// Returns the cached block at @c offset or @c nullptr
+	Block * _Nullable FindBlock(SInt64 offset) noexcept
+	{
+		for(auto& block : mBlocks) {
+			if(block.mOffset == offset)
+				return &block;
+		}
+		return nullptr;
+	}
+
+	/// Returns the least recently used block other than @c exclude that is not being fetched or @c nullptr
+	Block * _Nullable VictimBlock(const Block * _Nullable exclude = nullptr) noexcept
+	{
+		Block *victim = nullptr;
+		for(auto& block : mBlocks) {
+			if(&block != exclude && !block.mLoading && (!victim || block.mLastUse < victim->mLastUse))
+				victim = &block;
+		}
+		return victim;
+	}
+
+	/// Marks @c block as loading @c offset
+	void BeginLoading(Block& block, SInt64 offset) noexcept
+	{
+		block.mOffset = offset;
+		block.mLength = 0;
+		block.mLoading = true;
+	}
+
+	/// Completes loading @c block
+	/// @note The fetched data is discarded if the source was written while it was being fetched
+	void EndLoading(Block& block, ssize_t bytesRead, uint64_t writeGeneration) noexcept
+	{
+		block.mLoading = false;
+		if(bytesRead < 0 || writeGeneration != mWriteGeneration)
+			block.mOffset = -1;
+		else
+			block.mLength = static_cast<size_t>(bytesRead);
+		mCondition.notify_all();
+	}
+
+	/// Schedules an asynchronous fetch of the block at @c offset
+	/// @param offset The offset of the block to fetch
+	/// @param current The block being read, which is never evicted for the prefetch
+	void Prefetch(SInt64 offset, const Block& current) noexcept
+	{
+		if(FindBlock(offset))
+			return;
+
+		auto block = VictimBlock(&current);
+		if(!block)
+			return;
+
+		auto context = new (std::nothrow) PrefetchContext{ this, block, mWriteGeneration };
+		if(!context)
+			return;
+
+		BeginLoading(*block, offset);
+		++mPendingPrefetches;
+
+		dispatch_async_f(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), context, [](void *ctx) {
+			auto context = static_cast<PrefetchContext *>(ctx);
+			auto adaptor = context->mAdaptor;
+			auto block = context->mBlock;
+
+			// A loading block is not accessed by other threads so its data may be filled without the lock
+			const auto bytesRead = adaptor->FetchFromSource(block->mOffset, block->mData.get(), adaptor->mOptions.mBlockSize);
+
+			std::lock_guard<std::mutex> lock(adaptor->mLock);
+			adaptor->EndLoading(*block, bytesRead, context->mWriteGeneration);
+			--adaptor->mPendingPrefetches;
+			delete context;
+		});
+	}
+
+	/// Reads bytes through the cache
+	/// @return The number of bytes read or @c -1 on error
+	ssize_t Read(SInt64 position, void *buffer, size_t count) noexcept
+	{
+		mReadRequests.fetch_add(1, std::memory_order_relaxed);
+
+		if(mBlocks.empty() || count >= mOptions.mBlockSize)
+			return FetchFromSource(position, buffer, count);
+
+		const auto blockSize = static_cast<SInt64>(mOptions.mBlockSize);
+		bool hit = true;
+		size_t bytesRead = 0;
+
+		std::unique_lock<std::mutex> lock(mLock);
+		while(bytesRead < count) {
+			const auto offset = position + static_cast<SInt64>(bytesRead);
+			const auto blockOffset = offset - (offset % blockSize);
+
+			auto block = FindBlock(blockOffset);
+			if(block && block->mLoading) {
+				mCondition.wait(lock, [block] { return !block->mLoading; });
+				// A failed fetch leaves the block unused
+				continue;
+			}
+
+			if(!block) {
+				hit = false;
+				block = VictimBlock();
+				if(!block) {
+					mCondition.wait(lock);
+					continue;
+				}
+
+				const auto writeGeneration = mWriteGeneration;
+				BeginLoading(*block, blockOffset);
+				lock.unlock();
+				const auto fetched = FetchFromSource(blockOffset, block->mData.get(), mOptions.mBlockSize);
+				lock.lock();
+				EndLoading(*block, fetched, writeGeneration);
+				if(fetched < 0)
+					return -1;
+				if(block->mOffset != blockOffset)
+					continue;
+			}
+
+			block->mLastUse = ++mUseCounter;
+
+			const auto blockPosition = static_cast<size_t>(offset - blockOffset);
+			if(blockPosition >= block->mLength)
+				break;
+
+			const auto bytesToCopy = std::min(count - bytesRead, block->mLength - blockPosition);
+			std::memcpy(static_cast<uint8_t *>(buffer) + bytesRead, block->mData.get() + blockPosition, bytesToCopy);
+			bytesRead += bytesToCopy;
+
+			// Reading the block after the previously read block indicates sequential access
+			if(mOptions.mPrefetch && blockOffset == mLastBlockRead + blockSize && block->mLength == mOptions.mBlockSize)
+				Prefetch(blockOffset + blockSize, *block);
+			mLastBlockRead = blockOffset;
+
+			// A short block is the end of the source
+			if(block->mLength < mOptions.mBlockSize)
+				break;
+		}
+
+		if(hit)
+			mCacheHits.fetch_add(1, std::memory_order_relaxed);
+
+		return static_cast<ssize_t>(bytesRead);
+	}
+
+	/// Discards all cached blocks
+	void InvalidateCache() noexcept
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		++mWriteGeneration;
+		for(auto& block : mBlocks) {
+			// Blocks being fetched are discarded when the fetch completes
+			if(!block.mLoading)
+				block.mOffset = -1;
+		}
+		mLastBlockRead = -1;
+	}
+
+#pragma mark AudioFile callbacks
+
+	/// @c AudioFile_ReadProc
+	static OSStatus ReadProc(void *inClientData, SInt64 inPosition, UInt32 requestCount, void *buffer, UInt32 *actualCount)
+	{
+		auto adaptor = static_cast<AudioFileCallbackAdaptor *>(inClientData);
+		const auto bytesRead = adaptor->Read(inPosition, buffer, requestCount);
+		if(bytesRead < 0) {
+			*actualCount = 0;
+			return kAudioFileUnspecifiedError;
+		}
+		*actualCount = static_cast<UInt32>(bytesRead);
+		return noErr;
+	}
+
+	/// @c AudioFile_WriteProc
+	static OSStatus WriteProc(void *inClientData, SInt64 inPosition, UInt32 requestCount, const void *buffer, UInt32 *actualCount)
+	{
+		auto adaptor = static_cast<AudioFileCallbackAdaptor *>(inClientData);
+		adaptor->InvalidateCache();
+		try {
+			std::lock_guard<std::mutex> lock(adaptor->mSourceLock);
+			*actualCount = static_cast<UInt32>(adaptor->mSource.Write(inPosition, buffer, requestCount));
+			return noErr;
+		}
+		catch(...) {
+			*actualCount = 0;
+			return kAudioFileUnspecifiedError;
+		}
+	}
+
+	/// @c AudioFile_GetSizeProc
+	static SInt64 GetSizeProc(void *inClientData)
+	{
+		auto adaptor = static_cast<AudioFileCallbackAdaptor *>(inClientData);
+		try {
+			std::lock_guard<std::mutex> lock(adaptor->mSourceLock);
+			return adaptor->mSource.Size();
+		}
+		catch(...) {
+			return 0;
+		}
+	}
+
+	/// @c AudioFile_SetSizeProc
+	static OSStatus SetSizeProc(void *inClientData, SInt64 inSize)
+	{
+		auto adaptor = static_cast<AudioFileCallbackAdaptor *>(inClientData);
+		adaptor->InvalidateCache();
+		try {
+			std::lock_guard<std::mutex> lock(adaptor->mSourceLock);
+			if(!adaptor->mSource.SetSize(inSize))
+				return kAudioFileUnspecifiedError;
+			return noErr;
+		}
+		catch(...) {
+			return kAudioFileUnspecifiedError;
+		}
+	}
+
+	/// The byte source
+	Source mSource;
+	/// The buffering options
+	Options mOptions;
+
+	/// The lock serializing access to @c mSource
+	std::mutex mSourceLock;
+
+	/// The lock protecting the cache
+	std::mutex mLock;
+	/// Signaled when a block finishes loading or a prefetch completes
+	std::condition_variable mCondition;
+	/// The cache blocks
+	std::vector<Block> mBlocks;
+	/// Incremented on each block use
+	uint64_t mUseCounter;
+	/// The offset of the most recently read block
+	SInt64 mLastBlockRead;
+	/// The number of scheduled prefetches that have not completed
+	size_t mPendingPrefetches;
+	/// Incremented when the source is modified
+	uint64_t mWriteGeneration;
+
+	/// The number of read requests
+	std::atomic_uint64_t mReadRequests;
+	/// The number of read requests satisfied from the cache
+	std::atomic_uint64_t mCacheHits;
+	/// The number of source reads
+	std::atomic_uint64_t mSourceReads;
+	/// The number of bytes read from the source
+	std::atomic_uint64_t mBytesFetched;
+
+};
+
+} // namespace SFB
+
+CF_ASSUME_NONNULL_END
@@ -0,0 +1,304 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdint>
+#import <cstring>
+
+namespace SFB {
+namespace AudioInterleaving {
+
+/// Interleaves audio samples from separate channel buffers into a single buffer.
+///
+/// Two, four, six, and eight channel audio with 2- or 4-byte samples (for example @c int16_t and @c float) is
+/// interleaved using vector shuffles. Other layouts are interleaved one sample at a time.
+/// @param destination The address of the first interleaved frame
+/// @param source A callable with the signature @c const @c uint8_t*(uint32_t) returning the address of the first sample in a channel
+/// @param channelCount The number of channels
+/// @param bytesPerSample The size of a single sample in bytes
+/// @param frameCount The number of frames to interleave
+template <typename F>
+void Interleave(uint8_t * const _Nonnull destination, F&& source, uint32_t channelCount, uint32_t bytesPerSample, uint32_t frameCount) noexcept;
+
+/// Deinterleaves audio samples from a single buffer into separate channel buffers.
+///
+/// Two, four, six, and eight channel audio with 2- or 4-byte samples (for example @c int16_t and @c float) is
+/// deinterleaved using vector shuffles. Other layouts are deinterleaved one sample at a time.
+/// @param destination A callable with the signature @c uint8_t*(uint32_t) returning the address of the first sample in a channel
+/// @param source The address of the first interleaved frame
+/// @param channelCount The number of channels
+/// @param bytesPerSample The size of a single sample in bytes
+/// @param frameCount The number of frames to deinterleave
+template <typename F>
+void Deinterleave(F&& destination, const uint8_t * const _Nonnull source, uint32_t channelCount, uint32_t bytesPerSample, uint32_t frameCount) noexcept;
+
+// Implementation details follow
+
+namespace detail {
+
+/// Two 64-bit lanes
+using V2x64 = uint64_t __attribute__((vector_size(16)));
+/// Four 32-bit lanes
+using V4x32 = uint32_t __attribute__((vector_size(16)));
+/// Eight 16-bit lanes
+using V8x16 = uint16_t __attribute__((vector_size(16)));
+
+/// Returns the interleaved low halves of @c a and @c b
+inline V4x32 ZipLow(V4x32 a, V4x32 b) noexcept { return __builtin_shufflevector(a, b, 0, 4, 1, 5); }
+/// Returns the interleaved high halves of @c a and @c b
+inline V4x32 ZipHigh(V4x32 a, V4x32 b) noexcept { return __builtin_shufflevector(a, b, 2, 6, 3, 7); }
+/// Returns the even lanes of @c a followed by the even lanes of @c b
+inline V4x32 Even(V4x32 a, V4x32 b) noexcept { return __builtin_shufflevector(a, b, 0, 2, 4, 6); }
+/// Returns the odd lanes of @c a followed by the odd lanes of @c b
+inline V4x32 Odd(V4x32 a, V4x32 b) noexcept { return __builtin_shufflevector(a, b, 1, 3, 5, 7); }
+
+/// Returns the interleaved low halves of @c a and @c b
+inline V8x16 ZipLow(V8x16 a, V8x16 b) noexcept { return __builtin_shufflevector(a, b, 0, 8, 1, 9, 2, 10, 3, 11); }
+/// Returns the interleaved high halves of @c a and @c b
+inline V8x16 ZipHigh(V8x16 a, V8x16 b) noexcept { return __builtin_shufflevector(a, b, 4, 12, 5, 13, 6, 14, 7, 15); }
+/// Returns the even lanes of @c a followed by the even lanes of @c b
+inline V8x16 Even(V8x16 a, V8x16 b) noexcept { return __builtin_shufflevector(a, b, 0, 2, 4, 6, 8, 10, 12, 14); }
+/// Returns the odd lanes of @c a followed by the odd lanes of @c b
+inline V8x16 Odd(V8x16 a, V8x16 b) noexcept { return __builtin_shufflevector(a, b, 1, 3, 5, 7, 9, 11, 13, 15); }
+
+/// Interleaves the lanes of @c a, @c b, and @c c into @c out
+inline void Zip3(V2x64 a, V2x64 b, V2x64 c, V2x64 * const _Nonnull out) noexcept
+{
+	out[0] = __builtin_shufflevector(a, b, 0, 2);
+	out[1] = __builtin_shufflevector(c, a, 0, 3);
+	out[2] = __builtin_shufflevector(b, c, 1, 3);
+}
+
+/// Deinterleaves the lanes of @c in into @c a, @c b, and @c c
+inline void Unzip3(const V2x64 * const _Nonnull in, V2x64& a, V2x64& b, V2x64& c) noexcept
+{
+	a = __builtin_shufflevector(in[0], in[1], 0, 3);
+	b = __builtin_shufflevector(in[0], in[2], 1, 2);
+	c = __builtin_shufflevector(in[1], in[2], 0, 3);
+}
+
+/// Interleaves the lanes of @c a, @c b, and @c c into @c out
+inline void Zip3(V4x32 a, V4x32 b, V4x32 c, V4x32 * const _Nonnull out) noexcept
+{
+	const V4x32 low = __builtin_shufflevector(a, b, 0, 4, 1, 5);
+	const V4x32 high = __builtin_shufflevector(a, b, 2, 6, 3, 7);
+	out[0] = __builtin_shufflevector(low, c, 0, 1, 4, 2);
+	const V4x32 t = __builtin_shufflevector(low, c, 3, 5, 3, 5);
+	out[1] = __builtin_shufflevector(t, high, 0, 1, 4, 5);
+	out[2] = __builtin_shufflevector(high, c, 6, 2, 3, 7);
+}
+
+/// Deinterleaves the lanes of @c in into @c a, @c b, and @c c
+inline void Unzip3(const V4x32 * const _Nonnull in, V4x32& a, V4x32& b, V4x32& c) noexcept
+{
+	a = __builtin_shufflevector(__builtin_shufflevector(in[0], in[1], 0, 3, 6, 6), in[2], 0, 1, 2, 5);
+	b = __builtin_shufflevector(__builtin_shufflevector(in[0], in[1], 1, 4, 7, 7), in[2], 0, 1, 2, 6);
+	c = __builtin_shufflevector(__builtin_shufflevector(in[0], in[1], 2, 5, 5, 5), in[2], 0, 1, 4, 7);
+}
+
+/// Interleaves complete vectors of frames for a power of two channel count
+/// @return The number of frames interleaved
+template <typename V, uint32_t N, typename F>
+uint32_t InterleavePowerOfTwo(uint8_t * const _Nonnull destination, F& source, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	const uint32_t lanes = sizeof(V) / bytesPerSample;
+	uint32_t frame = 0;
+	for(; frame + lanes <= frameCount; frame += lanes) {
+		V v[N];
+		for(uint32_t i = 0; i < N; ++i)
+			std::memcpy(&v[i], source(i) + frame * bytesPerSample, sizeof(V));
+		// Each round is a perfect shuffle; log2(N) rounds transpose the channels into frames
+		for(uint32_t round = 1; round < N; round <<= 1) {
+			V t[N];
+			for(uint32_t i = 0; i < N / 2; ++i) {
+				t[2 * i] = ZipLow(v[i], v[i + N / 2]);
+				t[2 * i + 1] = ZipHigh(v[i], v[i + N / 2]);
+			}
+			std::memcpy(v, t, sizeof v);
+		}
+		std::memcpy(destination + frame * N * bytesPerSample, v, sizeof v);
+	}
+	return frame;
+}
+
+/// Deinterleaves complete vectors of frames for a power of two channel count
+/// @return The number of frames deinterleaved
+template <typename V, uint32_t N, typename F>
+uint32_t DeinterleavePowerOfTwo(F& destination, const uint8_t * const _Nonnull source, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	const uint32_t lanes = sizeof(V) / bytesPerSample;
+	uint32_t frame = 0;
+	for(; frame + lanes <= frameCount; frame += lanes) {
+		V v[N];
+		std::memcpy(v, source + frame * N * bytesPerSample, sizeof v);
+		for(uint32_t round = 1; round < N; round <<= 1) {
+			V t[N];
+			for(uint32_t i = 0; i < N / 2; ++i) {
+				t[i] = Even(v[2 * i], v[2 * i + 1]);
+				t[i + N / 2] = Odd(v[2 * i], v[2 * i + 1]);
+			}
+			std::memcpy(v, t, sizeof v);
+		}
+		for(uint32_t i = 0; i < N; ++i)
+			std::memcpy(destination(i) + frame * bytesPerSample, &v[i], sizeof(V));
+	}
+	return frame;
+}
+
+/// Interleaves complete vectors of frames for six channels
+/// @note Channel pairs are interleaved into lanes of type @c U which are then interleaved three ways
+/// @return The number of frames interleaved
+template <typename V, typename U, typename F>
+uint32_t InterleaveSix(uint8_t * const _Nonnull destination, F& source, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	const uint32_t lanes = sizeof(V) / bytesPerSample;
+	uint32_t frame = 0;
+	for(; frame + lanes <= frameCount; frame += lanes) {
+		V v[6];
+		for(uint32_t i = 0; i < 6; ++i)
+			std::memcpy(&v[i], source(i) + frame * bytesPerSample, sizeof(V));
+		U out[6];
+		Zip3(U(ZipLow(v[0], v[1])), U(ZipLow(v[2], v[3])), U(ZipLow(v[4], v[5])), out);
+		Zip3(U(ZipHigh(v[0], v[1])), U(ZipHigh(v[2], v[3])), U(ZipHigh(v[4], v[5])), out + 3);
+		std::memcpy(destination + frame * 6 * bytesPerSample, out, sizeof out);
+	}
+	return frame;
+}
+
+/// Deinterleaves complete vectors of frames for six channels
+/// @return The number of frames deinterleaved
+template <typename V, typename U, typename F>
+uint32_t DeinterleaveSix(F& destination, const uint8_t * const _Nonnull source, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	const uint32_t lanes = sizeof(V) / bytesPerSample;
+	uint32_t frame = 0;
+	for(; frame + lanes <= frameCount; frame += lanes) {
+		U in[6];
+		std::memcpy(in, source + frame * 6 * bytesPerSample, sizeof in);
+		U low[3], high[3];
+		Unzip3(in, low[0], low[1], low[2]);
+		Unzip3(in + 3, high[0], high[1], high[2]);
+		for(uint32_t i = 0; i < 3; ++i) {
+			const V even = Even(V(low[i]), V(high[i]));
+			const V odd = Odd(V(low[i]), V(high[i]));
+			std::memcpy(destination(2 * i) + frame * bytesPerSample, &even, sizeof(V));
+			std::memcpy(destination(2 * i + 1) + frame * bytesPerSample, &odd, sizeof(V));
+		}
+	}
+	return frame;
+}
+
+/// Interleaves frames one sample at a time
+template <uint32_t S, typename F>
+void InterleaveScalar(uint8_t * const _Nonnull destination, F& source, uint32_t channelCount, uint32_t frameCount, uint32_t frame) noexcept
+{
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		const uint8_t *src = source(channel) + frame * S;
+		uint8_t *dst = destination + (frame * channelCount + channel) * S;
+		for(uint32_t i = frame; i < frameCount; ++i, src += S, dst += channelCount * S)
+			std::memcpy(dst, src, S);
+	}
+}
+
+/// Deinterleaves frames one sample at a time
+template <uint32_t S, typename F>
+void DeinterleaveScalar(F& destination, const uint8_t * const _Nonnull source, uint32_t channelCount, uint32_t frameCount, uint32_t frame) noexcept
+{
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		uint8_t *dst = destination(channel) + frame * S;
+		const uint8_t *src = source + (frame * channelCount + channel) * S;
+		for(uint32_t i = frame; i < frameCount; ++i, dst += S, src += channelCount * S)
+			std::memcpy(dst, src, S);
+	}
+}
+
+} // namespace detail
+
+template <typename F>
+void Interleave(uint8_t * const destination, F&& source, uint32_t channelCount, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	using namespace detail;
+
+	uint32_t frame = 0;
+	if(bytesPerSample == 4) {
+		switch(channelCount) {
+			case 2: frame = InterleavePowerOfTwo<V4x32, 2>(destination, source, bytesPerSample, frameCount); break;
+			case 4: frame = InterleavePowerOfTwo<V4x32, 4>(destination, source, bytesPerSample, frameCount); break;
+			case 6: frame = InterleaveSix<V4x32, V2x64>(destination, source, bytesPerSample, frameCount); break;
+			case 8: frame = InterleavePowerOfTwo<V4x32, 8>(destination, source, bytesPerSample, frameCount); break;
+		}
+	}
+	else if(bytesPerSample == 2) {
+		switch(channelCount) {
+			case 2: frame = InterleavePowerOfTwo<V8x16, 2>(destination, source, bytesPerSample, frameCount); break;
+			case 4: frame = InterleavePowerOfTwo<V8x16, 4>(destination, source, bytesPerSample, frameCount); break;
+			case 6: frame = InterleaveSix<V8x16, V4x32>(destination, source, bytesPerSample, frameCount); break;
+			case 8: frame = InterleavePowerOfTwo<V8x16, 8>(destination, source, bytesPerSample, frameCount); break;
+		}
+	}
+
+	if(frame == frameCount)
+		return;
+
+	switch(bytesPerSample) {
+		case 1: 	InterleaveScalar<1>(destination, source, channelCount, frameCount, frame); 	break;
+		case 2: 	InterleaveScalar<2>(destination, source, channelCount, frameCount, frame); 	break;
+		case 3: 	InterleaveScalar<3>(destination, source, channelCount, frameCount, frame); 	break;
+		case 4: 	InterleaveScalar<4>(destination, source, channelCount, frameCount, frame); 	break;
+		case 8: 	InterleaveScalar<8>(destination, source, channelCount, frameCount, frame); 	break;
+		default:
+			for(uint32_t i = frame; i < frameCount; ++i) {
+				for(uint32_t channel = 0; channel < channelCount; ++channel)
+					std::memcpy(destination + (i * channelCount + channel) * bytesPerSample, source(channel) + i * bytesPerSample, bytesPerSample);
+			}
+			break;
+	}
+}
+
+template <typename F>
+void Deinterleave(F&& destination, const uint8_t * const source, uint32_t channelCount, uint32_t bytesPerSample, uint32_t frameCount) noexcept
+{
+	using namespace detail;
+
+	uint32_t frame = 0;
+	if(bytesPerSample == 4) {
+		switch(channelCount) {
+			case 2: frame = DeinterleavePowerOfTwo<V4x32, 2>(destination, source, bytesPerSample, frameCount); break;
+			case 4: frame = DeinterleavePowerOfTwo<V4x32, 4>(destination, source, bytesPerSample, frameCount); break;
+			case 6: frame = DeinterleaveSix<V4x32, V2x64>(destination, source, bytesPerSample, frameCount); break;
+			case 8: frame = DeinterleavePowerOfTwo<V4x32, 8>(destination, source, bytesPerSample, frameCount); break;
+		}
+	}
+	else if(bytesPerSample == 2) {
+		switch(channelCount) {
+			case 2: frame = DeinterleavePowerOfTwo<V8x16, 2>(destination, source, bytesPerSample, frameCount); break;
+			case 4: frame = DeinterleavePowerOfTwo<V8x16, 4>(destination, source, bytesPerSample, frameCount); break;
+			case 6: frame = DeinterleaveSix<V8x16, V4x32>(destination, source, bytesPerSample, frameCount); break;
+			case 8: frame = DeinterleavePowerOfTwo<V8x16, 8>(destination, source, bytesPerSample, frameCount); break;
+		}
+	}
+
+	if(frame == frameCount)
+		return;
+
+	switch(bytesPerSample) {
+		case 1: 	DeinterleaveScalar<1>(destination, source, channelCount, frameCount, frame); 	break;
+		case 2: 	DeinterleaveScalar<2>(destination, source, channelCount, frameCount, frame); 	break;
+		case 3: 	DeinterleaveScalar<3>(destination, source, channelCount, frameCount, frame); 	break;
+		case 4: 	DeinterleaveScalar<4>(destination, source, channelCount, frameCount, frame); 	break;
+		case 8: 	DeinterleaveScalar<8>(destination, source, channelCount, frameCount, frame); 	break;
+		default:
+			for(uint32_t i = frame; i < frameCount; ++i) {
+				for(uint32_t channel = 0; channel < channelCount; ++channel)
+					std::memcpy(destination(channel) + i * bytesPerSample, source + (i * channelCount + channel) * bytesPerSample, bytesPerSample);
+			}
+			break;
+	}
+}
+
+} // namespace AudioInterleaving
+} // namespace SFB
@@ -0,0 +1,304 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <limits>
+#import <new>
+
+#import <libkern/OSByteOrder.h>
+
+#import "SFBAudioPacketIndex.hpp"
+#import "SFBByteStream.hpp"
+
+namespace {
+
+/// The first four bytes of the sidecar representation
+constexpr uint32_t sSidecarMagic = 'SFPI';
+/// The version of the sidecar representation
+constexpr uint32_t sSidecarVersion = 1;
+
+/// The number of packets read at a time when building an index
+constexpr UInt32 sBuildBatchPackets = 1024;
+
+/// Appends @c value to @c buf in little-endian byte order
+template <typename T>
+void AppendLE(std::vector<uint8_t>& buf, T value)
+{
+	for(size_t i = 0; i < sizeof(T); ++i)
+		buf.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+}
+
+/// Appends @c value to @c buf as an unsigned LEB128 variable-length integer
+void AppendVarint(std::vector<uint8_t>& buf, uint64_t value)
+{
+	while(value >= 0x80) {
+		buf.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	buf.push_back(static_cast<uint8_t>(value));
+}
+
+/// Reads an unsigned LEB128 variable-length integer from @c stream
+bool ReadVarint(SFB::ByteStream& stream, uint64_t& value) noexcept
+{
+	value = 0;
+	for(unsigned shift = 0; shift < 64; shift += 7) {
+		uint8_t byte;
+		if(!stream.Read(byte))
+			return false;
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+} // namespace
+
+#pragma mark Creation and Destruction
+
+SFB::AudioPacketIndex::AudioPacketIndex() noexcept
+: mPacketCount(0), mBytesPerPacket(0), mFramesPerPacket(0), mMaximumPacketSize(0), mValidFrames(0), mPrimingFrames(0), mRemainderFrames(0), mAudioDataByteCount(0)
+{}
+
+SFB::AudioPacketIndex SFB::AudioPacketIndex::Build(CAAudioFile& audioFile)
+{
+	const auto format = audioFile.FileDataFormat();
+
+	AudioPacketIndex index;
+	index.mPacketCount = static_cast<int64_t>(audioFile.AudioDataPacketCount());
+	index.mBytesPerPacket = format.mBytesPerPacket;
+	index.mFramesPerPacket = format.mFramesPerPacket;
+	index.mMaximumPacketSize = audioFile.MaximumPacketSize();
+	index.mAudioDataByteCount = audioFile.AudioDataByteCount();
+
+	// Packet sizes and frame counts must be read from the packet descriptions only if they vary
+	if(index.mBytesPerPacket == 0 || index.mFramesPerPacket == 0) {
+		if(index.mBytesPerPacket == 0)
+			index.mPacketOffsets.reserve(static_cast<size_t>(index.mPacketCount) + 1);
+		if(index.mFramesPerPacket == 0)
+			index.mPacketFrames.reserve(static_cast<size_t>(index.mPacketCount) + 1);
+
+		std::vector<uint8_t> buffer(static_cast<size_t>(std::max(index.mMaximumPacketSize, 1u)) * sBuildBatchPackets);
+		std::vector<AudioStreamPacketDescription> packetDescriptions(sBuildBatchPackets);
+
+		SInt64 byteOffset = 0;
+		int64_t frame = 0;
+
+		int64_t packet = 0;
+		while(packet < index.mPacketCount) {
+			auto packetCount = static_cast<UInt32>(std::min<int64_t>(sBuildBatchPackets, index.mPacketCount - packet));
+			auto byteCount = static_cast<UInt32>(buffer.size());
+			audioFile.ReadPacketData(false, byteCount, packetDescriptions.data(), packet, packetCount, buffer.data());
+			if(packetCount == 0)
+				break;
+
+			for(UInt32 i = 0; i < packetCount; ++i) {
+				const auto& packetDescription = packetDescriptions[i];
+				if(index.mBytesPerPacket == 0) {
+					index.mPacketOffsets.push_back(byteOffset);
+					byteOffset += packetDescription.mDataByteSize;
+				}
+				if(index.mFramesPerPacket == 0) {
+					index.mPacketFrames.push_back(frame);
+					frame += packetDescription.mVariableFramesInPacket;
+				}
+			}
+
+			packet += packetCount;
+		}
+
+		// A truncated file may contain fewer packets than reported
+		index.mPacketCount = packet;
+		if(index.mBytesPerPacket == 0)
+			index.mPacketOffsets.push_back(byteOffset);
+		if(index.mFramesPerPacket == 0)
+			index.mPacketFrames.push_back(frame);
+	}
+
+	const auto totalFrames = index.PacketStartFrame(index.mPacketCount);
+
+	// Not all formats support kAudioFilePropertyPacketTableInfo
+	try {
+		const auto packetTableInfo = audioFile.PacketTableInfo();
+		index.mPrimingFrames = static_cast<UInt32>(packetTableInfo.mPrimingFrames);
+		index.mRemainderFrames = static_cast<UInt32>(packetTableInfo.mRemainderFrames);
+		index.mValidFrames = packetTableInfo.mNumberValidFrames;
+	}
+	catch(const std::system_error&) {}
+
+	if(index.mValidFrames <= 0 || index.mValidFrames + index.mPrimingFrames + index.mRemainderFrames > totalFrames)
+		index.mValidFrames = std::max<int64_t>(totalFrames - index.mPrimingFrames - index.mRemainderFrames, 0);
+
+	return index;
+}
+
+#pragma mark Serialization
+
+std::vector<uint8_t> SFB::AudioPacketIndex::Serialize() const
+{
+	std::vector<uint8_t> buf;
+	buf.reserve(48 + (mPacketOffsets.empty() ? 0 : 2 * static_cast<size_t>(mPacketCount)) + (mPacketFrames.empty() ? 0 : 2 * static_cast<size_t>(mPacketCount)));
+
+	AppendLE(buf, sSidecarMagic);
+	AppendLE(buf, sSidecarVersion);
+	AppendLE(buf, static_cast<uint64_t>(mPacketCount));
+	AppendLE(buf, mBytesPerPacket);
+	AppendLE(buf, mFramesPerPacket);
+	AppendLE(buf, mMaximumPacketSize);
+	AppendLE(buf, static_cast<uint64_t>(mValidFrames));
+	AppendLE(buf, mPrimingFrames);
+	AppendLE(buf, mRemainderFrames);
+	AppendLE(buf, mAudioDataByteCount);
+
+	// Packet sizes and frame counts are small so they are stored as deltas using variable-length integers
+	for(int64_t packet = 0; packet < mPacketCount; ++packet) {
+		if(mBytesPerPacket == 0)
+			AppendVarint(buf, static_cast<uint64_t>(mPacketOffsets[packet + 1] - mPacketOffsets[packet]));
+		if(mFramesPerPacket == 0)
+			AppendVarint(buf, static_cast<uint64_t>(mPacketFrames[packet + 1] - mPacketFrames[packet]));
+	}
+
+	return buf;
+}
+
+bool SFB::AudioPacketIndex::Deserialize(const void *buf, size_t len) noexcept
+{
+	if(!buf)
+		return false;
+
+	ByteStream stream(buf, len);
+
+	uint32_t magic, version;
+	if(!stream.ReadLE(magic) || magic != sSidecarMagic || !stream.ReadLE(version) || version != sSidecarVersion)
+		return false;
+
+	AudioPacketIndex index;
+	uint64_t packetCount, validFrames;
+	if(!stream.ReadLE(packetCount) || !stream.ReadLE(index.mBytesPerPacket) || !stream.ReadLE(index.mFramesPerPacket) || !stream.ReadLE(index.mMaximumPacketSize) || !stream.ReadLE(validFrames) || !stream.ReadLE(index.mPrimingFrames) || !stream.ReadLE(index.mRemainderFrames) || !stream.ReadLE(index.mAudioDataByteCount))
+		return false;
+
+	index.mPacketCount = static_cast<int64_t>(packetCount);
+	index.mValidFrames = static_cast<int64_t>(validFrames);
+	if(index.mPacketCount < 0 || index.mValidFrames < 0)
+		return false;
+
+	if(index.mBytesPerPacket == 0 || index.mFramesPerPacket == 0) {
+		// Each packet occupies at least one byte
+		if(packetCount > stream.Remaining())
+			return false;
+
+		try {
+			if(index.mBytesPerPacket == 0)
+				index.mPacketOffsets.reserve(packetCount + 1);
+			if(index.mFramesPerPacket == 0)
+				index.mPacketFrames.reserve(packetCount + 1);
+		}
+		catch(const std::bad_alloc&) {
+			return false;
+		}
+
+		SInt64 byteOffset = 0;
+		int64_t frame = 0;
+		for(uint64_t packet = 0; packet < packetCount; ++packet) {
+			uint64_t delta;
+			if(index.mBytesPerPacket == 0) {
+				if(!ReadVarint(stream, delta) || delta > std::numeric_limits<uint32_t>::max())
+					return false;
+				index.mPacketOffsets.push_back(byteOffset);
+				byteOffset += static_cast<SInt64>(delta);
+			}
+			if(index.mFramesPerPacket == 0) {
+				if(!ReadVarint(stream, delta) || delta > std::numeric_limits<uint32_t>::max())
+					return false;
+				index.mPacketFrames.push_back(frame);
+				frame += static_cast<int64_t>(delta);
+			}
+		}
+
+		if(index.mBytesPerPacket == 0)
+			index.mPacketOffsets.push_back(byteOffset);
+		if(index.mFramesPerPacket == 0)
+			index.mPacketFrames.push_back(frame);
+	}
+
+	if(stream.Remaining() != 0 || index.mValidFrames + index.mPrimingFrames + index.mRemainderFrames > index.PacketStartFrame(index.mPacketCount))
+		return false;
+
+	*this = std::move(index);
+	return true;
+}
+
+bool SFB::AudioPacketIndex::Matches(const CAAudioFile& audioFile) const
+{
+	return audioFile.AudioDataPacketCount() == static_cast<UInt64>(mPacketCount) && audioFile.AudioDataByteCount() == mAudioDataByteCount;
+}
+
+#pragma mark Lookup
+
+bool SFB::AudioPacketIndex::Locate(int64_t frame, Location& location) const noexcept
+{
+	if(frame < 0 || frame >= mValidFrames)
+		return false;
+
+	const auto packetFrame = frame + mPrimingFrames;
+
+	int64_t packet;
+	if(mFramesPerPacket != 0)
+		packet = packetFrame / mFramesPerPacket;
+	else {
+		// The last element is the total number of frames, which is never a packet's starting frame
+		auto iter = std::upper_bound(mPacketFrames.cbegin(), mPacketFrames.cend() - 1, packetFrame);
+		packet = std::distance(mPacketFrames.cbegin(), iter) - 1;
+	}
+
+	if(packet < 0 || packet >= mPacketCount)
+		return false;
+
+	const auto byteOffset = PacketOffset(packet);
+	location.mPacket = packet;
+	location.mFrameOffset = static_cast<UInt32>(packetFrame - PacketStartFrame(packet));
+	location.mByteOffset = byteOffset;
+	location.mByteSize = static_cast<UInt32>(PacketOffset(packet + 1) - byteOffset);
+
+	return true;
+}
+
+UInt32 SFB::AudioPacketIndex::PacketFrameCount(int64_t packet) const noexcept
+{
+	if(packet < 0 || packet >= mPacketCount)
+		return 0;
+	return static_cast<UInt32>(PacketStartFrame(packet + 1) - PacketStartFrame(packet));
+}
+
+UInt32 SFB::AudioPacketIndex::PacketDescriptions(int64_t firstPacket, UInt32 packetCount, AudioStreamPacketDescription *packetDescriptions) const noexcept
+{
+	if(!packetDescriptions || firstPacket < 0 || firstPacket >= mPacketCount)
+		return 0;
+
+	packetCount = static_cast<UInt32>(std::min<int64_t>(packetCount, mPacketCount - firstPacket));
+
+	const auto firstByteOffset = PacketOffset(firstPacket);
+	for(UInt32 i = 0; i < packetCount; ++i) {
+		const auto packet = firstPacket + i;
+		const auto byteOffset = PacketOffset(packet);
+		packetDescriptions[i].mStartOffset = byteOffset - firstByteOffset;
+		packetDescriptions[i].mVariableFramesInPacket = mFramesPerPacket != 0 ? 0 : PacketFrameCount(packet);
+		packetDescriptions[i].mDataByteSize = static_cast<UInt32>(PacketOffset(packet + 1) - byteOffset);
+	}
+
+	return packetCount;
+}
+
+SInt64 SFB::AudioPacketIndex::PacketOffset(int64_t packet) const noexcept
+{
+	return mBytesPerPacket != 0 ? packet * mBytesPerPacket : mPacketOffsets[packet];
+}
+
+int64_t SFB::AudioPacketIndex::PacketStartFrame(int64_t packet) const noexcept
+{
+	return mFramesPerPacket != 0 ? packet * mFramesPerPacket : mPacketFrames[packet];
+}
@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdint>
+#import <vector>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCAAudioFile.hpp"
+
+CF_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+/// An index of the packets in an audio file allowing constant-cost seeking in variable bit rate formats
+///
+/// The index records the byte offset, byte size, and starting frame of every packet of audio data. It is built once
+/// by reading the file's packet descriptions and may be serialized to a compact sidecar representation and reloaded
+/// later without touching the audio file.
+///
+/// Frame positions are measured in valid frames, excluding priming frames, as in @c CAExtAudioFile. Packets are
+/// assumed to be stored contiguously, as @c CAAudioFile::ReadPacketData() presents them.
+/// @note Formats such as AAC require decoding to begin one or more packets before the target packet to prime the decoder
+class AudioPacketIndex
+{
+
+public:
+
+	/// The location of a frame in the audio data
+	struct Location
+	{
+		/// The packet containing the frame
+		int64_t mPacket;
+		/// The offset of the frame from the start of the packet
+		UInt32 mFrameOffset;
+		/// The byte offset of the packet from the start of the audio data
+		SInt64 mByteOffset;
+		/// The size of the packet in bytes
+		UInt32 mByteSize;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates an empty @c AudioPacketIndex
+	AudioPacketIndex() noexcept;
+
+	/// Copy constructor
+	AudioPacketIndex(const AudioPacketIndex& rhs) = default;
+
+	/// Assignment operator
+	AudioPacketIndex& operator=(const AudioPacketIndex& rhs) = default;
+
+	/// Destructor
+	~AudioPacketIndex() = default;
+
+	/// Move constructor
+	AudioPacketIndex(AudioPacketIndex&& rhs) noexcept = default;
+
+	/// Move assignment operator
+	AudioPacketIndex& operator=(AudioPacketIndex&& rhs) noexcept = default;
+
+	/// Builds an @c AudioPacketIndex from the packet descriptions in @c audioFile
+	/// @note For formats with a variable number of bytes or frames per packet this reads all audio data in the file
+	/// @param audioFile An open audio file
+	/// @return The packet index
+	/// @throw @c std::system_error
+	/// @throw @c std::bad_alloc
+	static AudioPacketIndex Build(CAAudioFile& audioFile);
+
+#pragma mark Serialization
+
+	/// Returns the sidecar representation of the index
+	/// @throw @c std::bad_alloc
+	std::vector<uint8_t> Serialize() const;
+
+	/// Replaces the index with one reloaded from a sidecar representation
+	/// @param buf The sidecar representation returned by @c Serialize()
+	/// @param len The length of @c buf in bytes
+	/// @return @c true on success, @c false if @c buf is not a valid sidecar representation
+	bool Deserialize(const void * _Nonnull buf, size_t len) noexcept;
+
+	/// Returns @c true if the index appears to describe the audio data in @c audioFile
+	/// @note This compares the packet count and audio data size without reading any audio data
+	/// @throw @c std::system_error
+	bool Matches(const CAAudioFile& audioFile) const;
+
+#pragma mark Index information
+
+	/// Returns @c true if the index is empty
+	inline bool IsEmpty() const noexcept
+	{
+		return mPacketCount == 0;
+	}
+
+	/// Returns the number of packets in the index
+	inline int64_t PacketCount() const noexcept
+	{
+		return mPacketCount;
+	}
+
+	/// Returns the number of valid frames in the audio data
+	inline int64_t FrameLength() const noexcept
+	{
+		return mValidFrames;
+	}
+
+	/// Returns the number of frames of decoder latency at the start of the audio data
+	inline UInt32 PrimingFrames() const noexcept
+	{
+		return mPrimingFrames;
+	}
+
+	/// Returns the number of unused frames in the last packet
+	inline UInt32 RemainderFrames() const noexcept
+	{
+		return mRemainderFrames;
+	}
+
+	/// Returns the size of the largest packet in bytes
+	inline UInt32 MaximumPacketSize() const noexcept
+	{
+		return mMaximumPacketSize;
+	}
+
+#pragma mark Lookup
+
+	/// Locates the packet containing @c frame
+	/// @note This method is O(log n) for formats with a variable number of frames per packet and O(1) otherwise
+	/// @param frame A valid frame position
+	/// @param location The location of @c frame
+	/// @return @c true on success, @c false if @c frame is out of range
+	bool Locate(int64_t frame, Location& location) const noexcept;
+
+	/// Returns the number of frames in @c packet or @c 0 if @c packet is out of range
+	UInt32 PacketFrameCount(int64_t packet) const noexcept;
+
+	/// Copies packet descriptions for a range of packets
+	///
+	/// The start offsets of the descriptions are relative to the start of @c firstPacket, so they describe the
+	/// packets as read into one buffer by @c CAAudioFile::ReadBytes().
+	/// @param firstPacket The first packet to describe
+	/// @param packetCount The number of packets to describe
+	/// @param packetDescriptions A buffer with space for @c packetCount packet descriptions
+	/// @return The number of packet descriptions copied
+	UInt32 PacketDescriptions(int64_t firstPacket, UInt32 packetCount, AudioStreamPacketDescription * _Nonnull packetDescriptions) const noexcept;
+
+private:
+
+	/// Returns the byte offset of @c packet from the start of the audio data
+	SInt64 PacketOffset(int64_t packet) const noexcept;
+
+	/// Returns the starting frame of @c packet, including priming frames
+	int64_t PacketStartFrame(int64_t packet) const noexcept;
+
+	/// The byte offset of each packet from the start of the audio data followed by the size of the audio data,
+	/// or empty if the number of bytes per packet is constant
+	std::vector<SInt64> mPacketOffsets;
+	/// The starting frame of each packet, including priming frames, followed by the total number of frames,
+	/// or empty if the number of frames per packet is constant
+	std::vector<int64_t> mPacketFrames;
+	/// The number of packets
+	int64_t mPacketCount;
+	/// The number of bytes in each packet or @c 0 if the number varies
+	UInt32 mBytesPerPacket;
+	/// The number of frames in each packet or @c 0 if the number varies
+	UInt32 mFramesPerPacket;
+	/// The size of the largest packet in bytes
+	UInt32 mMaximumPacketSize;
+	/// The number of valid frames
+	int64_t mValidFrames;
+	/// The number of priming frames
+	UInt32 mPrimingFrames;
+	/// The number of remainder frames
+	UInt32 mRemainderFrames;
+	/// The size of the audio data in bytes
+	UInt64 mAudioDataByteCount;
+
+};
+
+} // namespace SFB
+
+CF_ASSUME_NONNULL_END
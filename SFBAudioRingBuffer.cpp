@@ -5,20 +5,23 @@
 //
 
 #import <algorithm>
+#import <cstddef>
 #import <cstdlib>
 #import <cstring>
 #import <limits>
 
 #import "SFBAudioRingBuffer.hpp"
+#import "SFBAudioInterleaving.hpp"
+#import "SFBMirroredMemory.hpp"
 
 namespace {
 
-/// Copies non-interleaved audio from @c bufferList to @c buffers
+/// Copies audio from @c bufferList to @c buffers
 /// @param buffers The destination buffers
 /// @param dstOffset The byte offset in @c buffers to begin writing
 /// @param bufferList The source buffers
 /// @param srcOffset The byte offset in @c bufferList to begin reading
-/// @param byteCount The maximum number of bytes per non-interleaved buffer to read and write
+/// @param byteCount The maximum number of bytes per buffer to read and write
 inline void StoreABL(uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t dstOffset, const AudioBufferList * const _Nonnull bufferList, uint32_t srcOffset, uint32_t byteCount) noexcept
 {
 	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
@@ -28,12 +31,12 @@ inline void StoreABL(uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t
 	}
 }
 
-/// Copies non-interleaved audio from @c buffers to @c bufferList
+/// Copies audio from @c buffers to @c bufferList
 /// @param bufferList The destination buffers
 /// @param dstOffset The byte offset in @c bufferList to begin writing
 /// @param buffers The source buffers
 /// @param srcOffset The byte offset in @c bufferList to begin reading
-/// @param byteCount The maximum number of bytes per non-interleaved buffer to read and write
+/// @param byteCount The maximum number of bytes per buffer to read and write
 inline void FetchABL(AudioBufferList * const _Nonnull bufferList, uint32_t dstOffset, const uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t srcOffset, uint32_t byteCount) noexcept
 {
 	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
@@ -43,6 +46,78 @@ inline void FetchABL(AudioBufferList * const _Nonnull bufferList, uint32_t dstOf
 	}
 }
 
+/// Returns @c true if @c lhs and @c rhs differ at most in interleaving
+inline bool IsInterleavingEquivalent(const SFB::CAStreamBasicDescription& lhs, const SFB::CAStreamBasicDescription& rhs) noexcept
+{
+	SFB::CAStreamBasicDescription lhsNonInterleaved, rhsNonInterleaved;
+	if(!lhs.GetNonInterleavedEquivalent(lhsNonInterleaved) || !rhs.GetNonInterleavedEquivalent(rhsNonInterleaved))
+		return false;
+	return lhsNonInterleaved == rhsNonInterleaved;
+}
+
+/// Returns @c true if audio in @c format may be copied to or from a buffer in @c ringBufferFormat
+inline bool IsCompatibleFormat(const SFB::CAStreamBasicDescription& format, const SFB::CAStreamBasicDescription& ringBufferFormat) noexcept
+{
+	return format == ringBufferFormat || (format.IsInterleaved() != ringBufferFormat.IsInterleaved() && IsInterleavingEquivalent(format, ringBufferFormat));
+}
+
+/// Returns the number of frames that fit in every buffer in @c bufferList
+/// @param bufferList The buffers
+/// @param format The format of @c bufferList
+inline uint32_t FrameCapacity(const AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& format) noexcept
+{
+	uint32_t frameCapacity = std::numeric_limits<uint32_t>::max();
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+		frameCapacity = std::min(frameCapacity, bufferList->mBuffers[i].mDataByteSize / format.mBytesPerFrame);
+	return frameCapacity;
+}
+
+/// Copies audio from @c bufferList to @c buffers, interleaving or deinterleaving if the layouts differ
+/// @param buffers The destination buffers
+/// @param format The format of @c buffers
+/// @param dstOffset The frame offset in @c buffers to begin writing
+/// @param bufferList The source buffers
+/// @param bufferListFormat The format of @c bufferList
+/// @param srcOffset The frame offset in @c bufferList to begin reading
+/// @param frameCount The number of frames to read and write
+inline void StoreFrames(uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t dstOffset, const AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& bufferListFormat, uint32_t srcOffset, uint32_t frameCount) noexcept
+{
+	const auto wordSize = format.SampleWordSize();
+	if(format.IsInterleaved() == bufferListFormat.IsInterleaved())
+		StoreABL(buffers, dstOffset * format.mBytesPerFrame, bufferList, srcOffset * format.mBytesPerFrame, frameCount * format.mBytesPerFrame);
+	else if(format.IsInterleaved())
+		SFB::AudioInterleaving::Interleave(buffers[0] + dstOffset * format.mBytesPerFrame, [&](uint32_t channel) {
+			return static_cast<const uint8_t *>(bufferList->mBuffers[channel].mData) + srcOffset * wordSize;
+		}, format.mChannelsPerFrame, wordSize, frameCount);
+	else
+		SFB::AudioInterleaving::Deinterleave([&](uint32_t channel) {
+			return buffers[channel] + dstOffset * wordSize;
+		}, static_cast<const uint8_t *>(bufferList->mBuffers[0].mData) + srcOffset * bufferListFormat.mBytesPerFrame, format.mChannelsPerFrame, wordSize, frameCount);
+}
+
+/// Copies audio from @c buffers to @c bufferList, interleaving or deinterleaving if the layouts differ
+/// @param bufferList The destination buffers
+/// @param bufferListFormat The format of @c bufferList
+/// @param dstOffset The frame offset in @c bufferList to begin writing
+/// @param buffers The source buffers
+/// @param format The format of @c buffers
+/// @param srcOffset The frame offset in @c buffers to begin reading
+/// @param frameCount The number of frames to read and write
+inline void FetchFrames(AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& bufferListFormat, uint32_t dstOffset, const uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t srcOffset, uint32_t frameCount) noexcept
+{
+	const auto wordSize = format.SampleWordSize();
+	if(format.IsInterleaved() == bufferListFormat.IsInterleaved())
+		FetchABL(bufferList, dstOffset * format.mBytesPerFrame, buffers, srcOffset * format.mBytesPerFrame, frameCount * format.mBytesPerFrame);
+	else if(format.IsInterleaved())
+		SFB::AudioInterleaving::Deinterleave([&](uint32_t channel) {
+			return static_cast<uint8_t *>(bufferList->mBuffers[channel].mData) + dstOffset * wordSize;
+		}, buffers[0] + srcOffset * format.mBytesPerFrame, format.mChannelsPerFrame, wordSize, frameCount);
+	else
+		SFB::AudioInterleaving::Interleave(static_cast<uint8_t *>(bufferList->mBuffers[0].mData) + dstOffset * bufferListFormat.mBytesPerFrame, [&](uint32_t channel) {
+			return buffers[channel] + srcOffset * wordSize;
+		}, format.mChannelsPerFrame, wordSize, frameCount);
+}
+
 /// Returns the smallest power of two value greater than @c x
 /// @param x A value in the range [2..2147483648]
 /// @return The smallest power of two greater than @c x
@@ -53,27 +128,66 @@ inline constexpr uint32_t NextPowerOfTwo(uint32_t x) noexcept
 	return static_cast<uint32_t>(1 << (32 - __builtin_clz(x - 1)));
 }
 
+/// Returns the size in bytes of an @c AudioBufferList with @c streamCount buffers
+inline constexpr size_t BufferListSize(uint32_t streamCount) noexcept
+{
+	return offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * streamCount);
+}
+
+/// Returns the size in bytes of the @c streamCount channel pointers followed by the four buffer lists describing the read and write vectors
+inline constexpr size_t HeaderSize(uint32_t streamCount) noexcept
+{
+	return (streamCount * sizeof(uint8_t *)) + (4 * BufferListSize(streamCount));
+}
+
+/// Sets @c bufferList to describe @c frameCount frames of @c buffers starting at @c frameOffset
+/// @param bufferList The buffer list to set
+/// @param buffers The channel buffers
+/// @param format The format of @c buffers
+/// @param frameOffset The frame offset in @c buffers of the first frame
+/// @param frameCount The number of frames
+inline void SetBufferList(AudioBufferList * const _Nonnull bufferList, uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t frameOffset, uint32_t frameCount) noexcept
+{
+	bufferList->mNumberBuffers = format.ChannelStreamCount();
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		bufferList->mBuffers[i].mNumberChannels = format.InterleavedChannelCount();
+		bufferList->mBuffers[i].mDataByteSize = frameCount * format.mBytesPerFrame;
+		bufferList->mBuffers[i].mData = buffers[i] + (frameOffset * format.mBytesPerFrame);
+	}
+}
+
+/// Returns the distance in bytes between consecutive channel buffers in a single allocation
+inline size_t ChannelBufferStride(uint32_t capacityBytes, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(capacityBytes + policy.mChannelPadding, policy);
+}
+
+/// Returns the size in bytes of a single allocation holding the header followed by the channel buffers
+inline size_t SingleAllocationSize(uint32_t capacityBytes, uint32_t streamCount, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(HeaderSize(streamCount), policy) + (ChannelBufferStride(capacityBytes, policy) * streamCount);
+}
+
 }
 
 #pragma mark Creation and Destruction
 
 SFB::AudioRingBuffer::AudioRingBuffer() noexcept
-: mBuffers(nullptr), mCapacityFrames(0), mCapacityFramesMask(0), mWritePointer(0), mReadPointer(0)
+: mBuffers(nullptr), mReadBufferLists{nullptr, nullptr}, mWriteBufferLists{nullptr, nullptr}, mCapacityFrames(0), mCapacityFramesMask(0), mIsMirrored(false), mWritePointer(0), mReadPointer(0)
 {
 	assert(mWritePointer.is_lock_free());
 }
 
 SFB::AudioRingBuffer::~AudioRingBuffer()
 {
-	std::free(mBuffers);
+	Deallocate();
 }
 
 #pragma mark Buffer Management
 
-bool SFB::AudioRingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept
+bool SFB::AudioRingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, bool mirrored, const AllocationPolicy& policy) noexcept
 {
-	// Only non-interleaved formats are supported
-	if(format.IsInterleaved() || capacityFrames < 2 || capacityFrames > 0x80000000)
+	if(capacityFrames < 2 || capacityFrames > 0x80000000)
 		return false;
 
 	Deallocate();
@@ -81,29 +195,67 @@ bool SFB::AudioRingBuffer::Allocate(const CAStreamBasicDescription& format, uint
 	// Round up to the next power of two
 	capacityFrames = NextPowerOfTwo(static_cast<uint32_t>(capacityFrames));
 
-	mFormat = format;
-
-	mCapacityFrames = capacityFrames;
-	mCapacityFramesMask = capacityFrames - 1;
+	// The page size is a power of two so a capacity in frames of at least one page
+	// is always a multiple of the page size in bytes
+	if(mirrored)
+		capacityFrames = std::max(capacityFrames, static_cast<uint32_t>(VirtualMemoryPageSize()));
 
 	uint32_t capacityBytes = capacityFrames * format.mBytesPerFrame;
+	auto streamCount = format.ChannelStreamCount();
+
+	if(mirrored) {
+		// Each channel buffer is mapped separately
+		auto buffers = static_cast<uint8_t **>(std::calloc(1, HeaderSize(streamCount)));
+		if(!buffers)
+			return false;
+
+		for(UInt32 i = 0; i < streamCount; ++i) {
+			buffers[i] = static_cast<uint8_t *>(AllocateMirroredMemory(capacityBytes));
+			if(buffers[i] && !PrepareMemory(buffers[i], capacityBytes * 2, policy)) {
+				DeallocateMirroredMemory(buffers[i], capacityBytes);
+				buffers[i] = nullptr;
+			}
+			if(!buffers[i]) {
+				for(UInt32 j = 0; j < i; ++j) {
+					UnprepareMemory(buffers[j], capacityBytes * 2, policy);
+					DeallocateMirroredMemory(buffers[j], capacityBytes);
+				}
+				std::free(buffers);
+				return false;
+			}
+		}
+
+		mBuffers = buffers;
+	}
+	else {
+		// One memory allocation holds everything- first the pointers followed by the channel buffers
+		// The allocation is zero-filled
+		uint8_t *memoryChunk = static_cast<uint8_t *>(AllocateMemory(SingleAllocationSize(capacityBytes, streamCount, policy), policy));
+		if(!memoryChunk)
+			return false;
+
+		// Assign the pointers and channel buffers
+		mBuffers = reinterpret_cast<uint8_t **>(memoryChunk);
+		memoryChunk += AlignedSize(HeaderSize(streamCount), policy);
+		for(UInt32 i = 0; i < streamCount; ++i) {
+			mBuffers[i] = memoryChunk;
+			memoryChunk += ChannelBufferStride(capacityBytes, policy);
+		}
+	}
 
-	// One memory allocation holds everything- first the pointers followed by the deinterleaved channels
-	uint32_t allocationSize = (capacityBytes + sizeof(uint8_t *)) * format.mChannelsPerFrame;
-	uint8_t *memoryChunk = static_cast<uint8_t *>(std::malloc(allocationSize));
-	if(!memoryChunk)
-		return false;
+	// The buffer lists describing the read and write vectors follow the channel stream pointers
+	auto bufferLists = reinterpret_cast<uint8_t *>(mBuffers + streamCount);
+	for(auto i = 0; i < 2; ++i) {
+		mReadBufferLists[i] = reinterpret_cast<AudioBufferList *>(bufferLists + (i * BufferListSize(streamCount)));
+		mWriteBufferLists[i] = reinterpret_cast<AudioBufferList *>(bufferLists + ((2 + i) * BufferListSize(streamCount)));
+	}
 
-	// Zero the entire allocation
-	std::memset(memoryChunk, 0, allocationSize);
+	mFormat = format;
 
-	// Assign the pointers and channel buffers
-	mBuffers = reinterpret_cast<uint8_t **>(memoryChunk);
-	memoryChunk += format.mChannelsPerFrame * sizeof(uint8_t *);
-	for(UInt32 i = 0; i < format.mChannelsPerFrame; ++i) {
-		mBuffers[i] = memoryChunk;
-		memoryChunk += capacityBytes;
-	}
+	mCapacityFrames = capacityFrames;
+	mCapacityFramesMask = capacityFrames - 1;
+	mIsMirrored = mirrored;
+	mAllocationPolicy = policy;
 
 	mReadPointer = 0;
 	mWritePointer = 0;
@@ -114,13 +266,27 @@ bool SFB::AudioRingBuffer::Allocate(const CAStreamBasicDescription& format, uint
 void SFB::AudioRingBuffer::Deallocate() noexcept
 {
 	if(mBuffers) {
-		std::free(mBuffers);
+		const uint32_t capacityBytes = mCapacityFrames * mFormat.mBytesPerFrame;
+		const auto streamCount = mFormat.ChannelStreamCount();
+		if(mIsMirrored) {
+			for(UInt32 i = 0; i < streamCount; ++i) {
+				UnprepareMemory(mBuffers[i], capacityBytes * 2, mAllocationPolicy);
+				DeallocateMirroredMemory(mBuffers[i], capacityBytes);
+			}
+			std::free(mBuffers);
+		}
+		else
+			DeallocateMemory(mBuffers, SingleAllocationSize(capacityBytes, streamCount, mAllocationPolicy), mAllocationPolicy);
 		mBuffers = nullptr;
+		mReadBufferLists[0] = mReadBufferLists[1] = nullptr;
+		mWriteBufferLists[0] = mWriteBufferLists[1] = nullptr;
 
 		mFormat.Reset();
 
 		mCapacityFrames = 0;
 		mCapacityFramesMask = 0;
+		mIsMirrored = false;
+		mAllocationPolicy = {};
 
 		mReadPointer = 0;
 		mWritePointer = 0;
@@ -160,10 +326,29 @@ uint32_t SFB::AudioRingBuffer::FramesAvailableToWrite() const noexcept
 #pragma mark Reading and Writing Audio
 
 uint32_t SFB::AudioRingBuffer::Read(AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	return Read(bufferList, mFormat, frameCount);
+}
+
+uint32_t SFB::AudioRingBuffer::Read(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept
 {
 	if(!bufferList || frameCount == 0)
 		return 0;
 
+	if(!IsCompatibleFormat(format, mFormat))
+		return 0;
+
+	// Interleaving or deinterleaving requires the buffer list to match its format
+	if(format.IsInterleaved() != mFormat.IsInterleaved()) {
+		if(bufferList->mNumberBuffers != format.ChannelStreamCount())
+			return 0;
+		frameCount = std::min(frameCount, FrameCapacity(bufferList, format));
+		if(frameCount == 0)
+			return 0;
+	}
+
+	const Telemetry::Interval interval(mTelemetry, "AudioRingBuffer::Read");
+
 	auto writePointer = mWritePointer.load(std::memory_order_acquire);
 	auto readPointer = mReadPointer.load(std::memory_order_acquire);
 
@@ -173,34 +358,70 @@ uint32_t SFB::AudioRingBuffer::Read(AudioBufferList * const bufferList, uint32_t
 	else
 		framesAvailable = (writePointer - readPointer + mCapacityFrames) & mCapacityFramesMask;
 
+	mTelemetry.RecordFillLevel(framesAvailable);
+	if(framesAvailable < frameCount)
+		mTelemetry.RecordUnderrun(frameCount - framesAvailable);
+
 	if(framesAvailable == 0)
 		return 0;
 
 	auto framesToRead = std::min(framesAvailable, frameCount);
-	if(readPointer + framesToRead > mCapacityFrames) {
-		auto framesAfterReadPointer = mCapacityFrames - readPointer;
-		auto bytesAfterReadPointer = framesAfterReadPointer * mFormat.mBytesPerFrame;
-		FetchABL(bufferList, 0, mBuffers, readPointer * mFormat.mBytesPerFrame, bytesAfterReadPointer);
-		FetchABL(bufferList, bytesAfterReadPointer, mBuffers, 0, (framesToRead - framesAfterReadPointer) * mFormat.mBytesPerFrame);
-	}
-	else
-		FetchABL(bufferList, 0, mBuffers, readPointer * mFormat.mBytesPerFrame, framesToRead * mFormat.mBytesPerFrame);
+	FetchFramesAt(bufferList, format, 0, readPointer, framesToRead);
 
 	mReadPointer.store((readPointer + framesToRead) & mCapacityFramesMask, std::memory_order_release);
 
 	// Set the ABL buffer sizes
-	auto byteSize = static_cast<UInt32>(framesToRead) * mFormat.mBytesPerFrame;
+	auto byteSize = static_cast<UInt32>(framesToRead) * format.mBytesPerFrame;
 	for(UInt32 bufferIndex = 0; bufferIndex < bufferList->mNumberBuffers; ++bufferIndex)
 		bufferList->mBuffers[bufferIndex].mDataByteSize = byteSize;
 
 	return framesToRead;
 }
 
+uint32_t SFB::AudioRingBuffer::Skip(uint32_t frameCount) noexcept
+{
+	auto writePointer = mWritePointer.load(std::memory_order_acquire);
+	auto readPointer = mReadPointer.load(std::memory_order_acquire);
+
+	uint32_t framesAvailable;
+	if(writePointer > readPointer)
+		framesAvailable = writePointer - readPointer;
+	else
+		framesAvailable = (writePointer - readPointer + mCapacityFrames) & mCapacityFramesMask;
+
+	auto framesToSkip = std::min(framesAvailable, frameCount);
+	if(framesToSkip == 0)
+		return 0;
+
+	mReadPointer.store((readPointer + framesToSkip) & mCapacityFramesMask, std::memory_order_release);
+
+	return framesToSkip;
+}
+
 uint32_t SFB::AudioRingBuffer::Write(const AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	return Write(bufferList, mFormat, frameCount);
+}
+
+uint32_t SFB::AudioRingBuffer::Write(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept
 {
 	if(!bufferList || frameCount == 0)
 		return 0;
 
+	if(!IsCompatibleFormat(format, mFormat))
+		return 0;
+
+	// Interleaving or deinterleaving requires the buffer list to match its format
+	if(format.IsInterleaved() != mFormat.IsInterleaved()) {
+		if(bufferList->mNumberBuffers != format.ChannelStreamCount())
+			return 0;
+		frameCount = std::min(frameCount, FrameCapacity(bufferList, format));
+		if(frameCount == 0)
+			return 0;
+	}
+
+	const Telemetry::Interval interval(mTelemetry, "AudioRingBuffer::Write");
+
 	auto writePointer = mWritePointer.load(std::memory_order_acquire);
 	auto readPointer = mReadPointer.load(std::memory_order_acquire);
 
@@ -212,20 +433,211 @@ uint32_t SFB::AudioRingBuffer::Write(const AudioBufferList * const bufferList, u
 	else
 		framesAvailable = mCapacityFrames - 1;
 
+	// The fill level is that following the write
+	mTelemetry.RecordFillLevel(mCapacityFrames - 1 - framesAvailable + std::min(framesAvailable, frameCount));
+	if(framesAvailable < frameCount)
+		mTelemetry.RecordOverrun(frameCount - framesAvailable);
+
 	if(framesAvailable == 0)
 		return 0;
 
 	auto framesToWrite = std::min(framesAvailable, frameCount);
-	if(writePointer + framesToWrite > mCapacityFrames) {
-		auto framesAfterWritePointer = mCapacityFrames - writePointer;
-		auto bytesAfterWritePointer = framesAfterWritePointer * mFormat.mBytesPerFrame;
-		StoreABL(mBuffers, writePointer * mFormat.mBytesPerFrame, bufferList, 0, bytesAfterWritePointer);
-		StoreABL(mBuffers, 0, bufferList, bytesAfterWritePointer, (framesToWrite - framesAfterWritePointer) * mFormat.mBytesPerFrame);
-	}
-	else
-		StoreABL(mBuffers, writePointer * mFormat.mBytesPerFrame, bufferList, 0, framesToWrite * mFormat.mBytesPerFrame);
+	StoreFramesAt(writePointer, bufferList, format, 0, framesToWrite);
 
 	mWritePointer.store((writePointer + framesToWrite) & mCapacityFramesMask, std::memory_order_release);
 
 	return framesToWrite;
 }
+
+uint32_t SFB::AudioRingBuffer::Read(CABufferList& buffer, uint32_t offset, uint32_t frameCount) noexcept
+{
+	const ReadSegment segment{ &buffer, offset, frameCount };
+	return Read(std::span<const ReadSegment>(&segment, 1));
+}
+
+uint32_t SFB::AudioRingBuffer::Read(std::span<const ReadSegment> segments) noexcept
+{
+	const Telemetry::Interval interval(mTelemetry, "AudioRingBuffer::Read");
+
+	auto writePointer = mWritePointer.load(std::memory_order_acquire);
+	auto readPointer = mReadPointer.load(std::memory_order_acquire);
+
+	uint32_t framesAvailable;
+	if(writePointer > readPointer)
+		framesAvailable = writePointer - readPointer;
+	else
+		framesAvailable = (writePointer - readPointer + mCapacityFrames) & mCapacityFramesMask;
+
+	uint32_t framesRequested = 0;
+	uint32_t framesRead = 0;
+	for(const auto& segment : segments) {
+		auto& buffer = *segment.mBuffer;
+		if(!buffer || !IsCompatibleFormat(buffer.Format(), mFormat))
+			break;
+		if(segment.mOffset >= buffer.FrameCapacity())
+			continue;
+
+		auto framesToRead = std::min(segment.mFrameCount, buffer.FrameCapacity() - segment.mOffset);
+		framesRequested += framesToRead;
+
+		framesToRead = std::min(framesToRead, framesAvailable - framesRead);
+		if(framesToRead == 0)
+			continue;
+
+		// Extend the frame length first so the destination byte sizes cover the frames read and they fit following the headroom
+		buffer.SetFrameLength(std::max(buffer.FrameLength(), segment.mOffset + framesToRead));
+		FetchFramesAt(buffer.ABL(), buffer.Format(), segment.mOffset, (readPointer + framesRead) & mCapacityFramesMask, framesToRead);
+
+		framesRead += framesToRead;
+	}
+
+	mTelemetry.RecordFillLevel(framesAvailable);
+	if(framesRead < framesRequested)
+		mTelemetry.RecordUnderrun(framesRequested - framesRead);
+
+	if(framesRead > 0)
+		mReadPointer.store((readPointer + framesRead) & mCapacityFramesMask, std::memory_order_release);
+
+	return framesRead;
+}
+
+uint32_t SFB::AudioRingBuffer::Write(const CABufferList& buffer, uint32_t offset, uint32_t frameCount) noexcept
+{
+	const WriteSegment segment{ &buffer, offset, frameCount };
+	return Write(std::span<const WriteSegment>(&segment, 1));
+}
+
+uint32_t SFB::AudioRingBuffer::Write(std::span<const WriteSegment> segments) noexcept
+{
+	const Telemetry::Interval interval(mTelemetry, "AudioRingBuffer::Write");
+
+	auto writePointer = mWritePointer.load(std::memory_order_acquire);
+	auto readPointer = mReadPointer.load(std::memory_order_acquire);
+
+	uint32_t framesAvailable;
+	if(writePointer > readPointer)
+		framesAvailable = ((readPointer - writePointer + mCapacityFrames) & mCapacityFramesMask) - 1;
+	else if(writePointer < readPointer)
+		framesAvailable = (readPointer - writePointer) - 1;
+	else
+		framesAvailable = mCapacityFrames - 1;
+
+	uint32_t framesRequested = 0;
+	uint32_t framesWritten = 0;
+	for(const auto& segment : segments) {
+		const auto& buffer = *segment.mBuffer;
+		if(!buffer || !IsCompatibleFormat(buffer.Format(), mFormat))
+			break;
+		if(segment.mOffset >= buffer.FrameLength())
+			continue;
+
+		auto framesToWrite = std::min(segment.mFrameCount, buffer.FrameLength() - segment.mOffset);
+		framesRequested += framesToWrite;
+
+		framesToWrite = std::min(framesToWrite, framesAvailable - framesWritten);
+		if(framesToWrite == 0)
+			continue;
+
+		StoreFramesAt((writePointer + framesWritten) & mCapacityFramesMask, buffer.ABL(), buffer.Format(), segment.mOffset, framesToWrite);
+
+		framesWritten += framesToWrite;
+	}
+
+	// The fill level is that following the write
+	mTelemetry.RecordFillLevel(mCapacityFrames - 1 - framesAvailable + framesWritten);
+	if(framesWritten < framesRequested)
+		mTelemetry.RecordOverrun(framesRequested - framesWritten);
+
+	if(framesWritten > 0)
+		mWritePointer.store((writePointer + framesWritten) & mCapacityFramesMask, std::memory_order_release);
+
+	return framesWritten;
+}
+
+#pragma mark In-place Access
+
+void SFB::AudioRingBuffer::AdvanceReadPosition(uint32_t frameCount) noexcept
+{
+	mReadPointer.store((mReadPointer.load(std::memory_order_relaxed) + frameCount) & mCapacityFramesMask, std::memory_order_release);
+}
+
+void SFB::AudioRingBuffer::AdvanceWritePosition(uint32_t frameCount) noexcept
+{
+	mWritePointer.store((mWritePointer.load(std::memory_order_relaxed) + frameCount) & mCapacityFramesMask, std::memory_order_release);
+}
+
+const SFB::AudioRingBuffer::ReadBufferListPair SFB::AudioRingBuffer::ReadVector() const noexcept
+{
+	auto writePointer = mWritePointer.load(std::memory_order_acquire);
+	auto readPointer = mReadPointer.load(std::memory_order_relaxed);
+
+	uint32_t framesAvailable;
+	if(writePointer > readPointer)
+		framesAvailable = writePointer - readPointer;
+	else
+		framesAvailable = (writePointer - readPointer + mCapacityFrames) & mCapacityFramesMask;
+
+	if(framesAvailable == 0)
+		return {};
+
+	if(!mIsMirrored && readPointer + framesAvailable > mCapacityFrames) {
+		auto framesAfterReadPointer = mCapacityFrames - readPointer;
+		SetBufferList(mReadBufferLists[0], mBuffers, mFormat, readPointer, framesAfterReadPointer);
+		SetBufferList(mReadBufferLists[1], mBuffers, mFormat, 0, framesAvailable - framesAfterReadPointer);
+		return { { mReadBufferLists[0], framesAfterReadPointer }, { mReadBufferLists[1], framesAvailable - framesAfterReadPointer } };
+	}
+
+	SetBufferList(mReadBufferLists[0], mBuffers, mFormat, readPointer, framesAvailable);
+	return { { mReadBufferLists[0], framesAvailable }, {} };
+}
+
+const SFB::AudioRingBuffer::WriteBufferListPair SFB::AudioRingBuffer::WriteVector() const noexcept
+{
+	auto writePointer = mWritePointer.load(std::memory_order_relaxed);
+	auto readPointer = mReadPointer.load(std::memory_order_acquire);
+
+	uint32_t framesAvailable;
+	if(writePointer > readPointer)
+		framesAvailable = ((readPointer - writePointer + mCapacityFrames) & mCapacityFramesMask) - 1;
+	else if(writePointer < readPointer)
+		framesAvailable = (readPointer - writePointer) - 1;
+	else
+		framesAvailable = mCapacityFrames - 1;
+
+	if(framesAvailable == 0 || !mBuffers)
+		return {};
+
+	if(!mIsMirrored && writePointer + framesAvailable > mCapacityFrames) {
+		auto framesAfterWritePointer = mCapacityFrames - writePointer;
+		SetBufferList(mWriteBufferLists[0], mBuffers, mFormat, writePointer, framesAfterWritePointer);
+		SetBufferList(mWriteBufferLists[1], mBuffers, mFormat, 0, framesAvailable - framesAfterWritePointer);
+		return { { mWriteBufferLists[0], framesAfterWritePointer }, { mWriteBufferLists[1], framesAvailable - framesAfterWritePointer } };
+	}
+
+	SetBufferList(mWriteBufferLists[0], mBuffers, mFormat, writePointer, framesAvailable);
+	return { { mWriteBufferLists[0], framesAvailable }, {} };
+}
+
+#pragma mark Internal Copying
+
+void SFB::AudioRingBuffer::FetchFramesAt(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t dstOffset, uint32_t readPointer, uint32_t frameCount) const noexcept
+{
+	if(!mIsMirrored && readPointer + frameCount > mCapacityFrames) {
+		auto framesAfterReadPointer = mCapacityFrames - readPointer;
+		FetchFrames(bufferList, format, dstOffset, mBuffers, mFormat, readPointer, framesAfterReadPointer);
+		FetchFrames(bufferList, format, dstOffset + framesAfterReadPointer, mBuffers, mFormat, 0, frameCount - framesAfterReadPointer);
+	}
+	else
+		FetchFrames(bufferList, format, dstOffset, mBuffers, mFormat, readPointer, frameCount);
+}
+
+void SFB::AudioRingBuffer::StoreFramesAt(uint32_t writePointer, const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t srcOffset, uint32_t frameCount) noexcept
+{
+	if(!mIsMirrored && writePointer + frameCount > mCapacityFrames) {
+		auto framesAfterWritePointer = mCapacityFrames - writePointer;
+		StoreFrames(mBuffers, mFormat, writePointer, bufferList, format, srcOffset, framesAfterWritePointer);
+		StoreFrames(mBuffers, mFormat, 0, bufferList, format, srcOffset + framesAfterWritePointer, frameCount - framesAfterWritePointer);
+	}
+	else
+		StoreFrames(mBuffers, mFormat, writePointer, bufferList, format, srcOffset, frameCount);
+}
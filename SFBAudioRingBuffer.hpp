@@ -7,14 +7,22 @@
 #pragma once
 
 #import <atomic>
+#import <span>
+#import <utility>
 
 #import <CoreAudioTypes/CoreAudioTypes.h>
 
+#import "SFBAllocationPolicy.hpp"
+#import "SFBCABufferList.hpp"
 #import "SFBCAStreamBasicDescription.hpp"
+#import "SFBTelemetry.hpp"
 
 namespace SFB {
 
-/// A ring buffer supporting non-interleaved audio.
+/// A ring buffer supporting interleaved and non-interleaved audio.
+///
+/// Audio may be read and written using the same layout as the buffer's format, or using the opposite layout in which
+/// case it is interleaved or deinterleaved during the copy.
 ///
 /// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer model).
 class AudioRingBuffer
@@ -22,6 +30,28 @@ class AudioRingBuffer
 
 public:
 
+	/// A range of frames in a @c CABufferList receiving audio
+	struct ReadSegment
+	{
+		/// The buffer receiving the audio
+		CABufferList * _Nonnull mBuffer;
+		/// The frame offset in @c mBuffer to begin writing
+		uint32_t mOffset;
+		/// The desired number of frames
+		uint32_t mFrameCount;
+	};
+
+	/// A range of frames in a @c CABufferList containing audio
+	struct WriteSegment
+	{
+		/// The buffer containing the audio
+		const CABufferList * _Nonnull mBuffer;
+		/// The frame offset in @c mBuffer to begin reading
+		uint32_t mOffset;
+		/// The desired number of frames
+		uint32_t mFrameCount;
+	};
+
 #pragma mark Creation and Destruction
 
 	/// Creates a new @c AudioRingBuffer
@@ -46,13 +76,21 @@ public:
 #pragma mark Buffer management
 
 	/// Allocates space for audio data.
-	/// @note Only interleaved formats are supported.
+	///
+	/// If @c mirrored is @c true each channel buffer is mapped twice in consecutive virtual memory so
+	/// transfers that wrap around the end of the buffer are performed with a single copy per channel.
+	/// A mirrored buffer's capacity is at least one virtual memory page in frames.
+	///
+	/// @c policy controls the alignment and padding of the channel buffers and whether their memory is locked
+	/// and prefaulted. Mirrored channel buffers are always page aligned and are not padded.
 	/// @note This method is not thread safe.
 	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) frames are supported
 	/// @param format The format of the audio that will be written to and read from this buffer.
 	/// @param capacityFrames The desired capacity, in frames
+	/// @param mirrored Whether the channel buffers should be mapped twice in consecutive virtual memory
+	/// @param policy The allocation policy
 	/// @return @c true on success, @c false on error
-	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept;
+	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, bool mirrored = false, const AllocationPolicy& policy = {}) noexcept;
 
 	/// Frees the resources used by this @c AudioRingBuffer
 	/// @note This method is not thread safe.
@@ -76,6 +114,12 @@ public:
 		return mFormat;
 	}
 
+	/// Returns @c true if the channel buffers of this @c AudioRingBuffer are mapped twice in consecutive virtual memory
+	inline bool IsMirrored() const noexcept
+	{
+		return mIsMirrored;
+	}
+
 	/// Returns the number of frames available for reading
 	uint32_t FramesAvailableToRead() const noexcept;
 
@@ -90,31 +134,196 @@ public:
 	/// @return The number of frames actually read
 	uint32_t Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
 
+	/// Reads audio from the @c AudioRingBuffer and advances the read pointer, interleaving or deinterleaving as needed.
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param format The format of @c bufferList, which must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to read
+	/// @return The number of frames actually read, which is @c 0 if @c format is not supported
+	uint32_t Read(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept;
+
+	/// Advances the read pointer without copying audio
+	/// @param frameCount The desired number of frames to skip
+	/// @return The number of frames actually skipped
+	uint32_t Skip(uint32_t frameCount) noexcept;
+
 	/// Writes audio to the @c AudioRingBuffer and advances the write pointer.
 	/// @param bufferList An @c AudioBufferList containing the audio to copy
 	/// @param frameCount The desired number of frames to write
 	/// @return The number of frames actually written
 	uint32_t Write(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
 
+	/// Writes audio to the @c AudioRingBuffer and advances the write pointer, interleaving or deinterleaving as needed.
+	/// @param bufferList An @c AudioBufferList containing the audio to copy
+	/// @param format The format of @c bufferList, which must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to write
+	/// @return The number of frames actually written, which is @c 0 if @c format is not supported
+	uint32_t Write(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept;
+
+	/// Reads audio from the @c AudioRingBuffer into part of a buffer and advances the read pointer.
+	///
+	/// The audio is interleaved or deinterleaved as needed. The frame length of @c buffer is extended to include
+	/// the frames read if necessary.
+	/// @param buffer A buffer to receive the audio, whose format must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param offset The frame offset in @c buffer to begin writing
+	/// @param frameCount The desired number of frames to read, limited by the frame capacity of @c buffer
+	/// @return The number of frames actually read
+	uint32_t Read(CABufferList& buffer, uint32_t offset, uint32_t frameCount) noexcept;
+
+	/// Reads audio from the @c AudioRingBuffer into several buffer segments and advances the read pointer once.
+	///
+	/// The segments are filled in order until the @c AudioRingBuffer is empty, as if @c Read(CABufferList&, uint32_t, uint32_t)
+	/// were called for each segment. Processing stops at the first segment whose buffer has an incompatible format.
+	/// @param segments The buffer segments to receive the audio
+	/// @return The total number of frames actually read
+	uint32_t Read(std::span<const ReadSegment> segments) noexcept;
+
+	/// Writes audio from part of a buffer to the @c AudioRingBuffer and advances the write pointer.
+	///
+	/// The audio is interleaved or deinterleaved as needed.
+	/// @param buffer A buffer containing the audio, whose format must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param offset The frame offset in @c buffer to begin reading
+	/// @param frameCount The desired number of frames to write, limited by the frame length of @c buffer
+	/// @return The number of frames actually written
+	uint32_t Write(const CABufferList& buffer, uint32_t offset, uint32_t frameCount) noexcept;
+
+	/// Writes audio from several buffer segments to the @c AudioRingBuffer and advances the write pointer once.
+	///
+	/// The segments are written in order until the @c AudioRingBuffer is full, as if @c Write(const CABufferList&, uint32_t, uint32_t)
+	/// were called for each segment. Processing stops at the first segment whose buffer has an incompatible format.
+	/// @param segments The buffer segments containing the audio
+	/// @return The total number of frames actually written
+	uint32_t Write(std::span<const WriteSegment> segments) noexcept;
+
+#pragma mark In-place access
+
+	/// Advances the read pointer by the specified number of frames
+	/// @note @c frameCount must not exceed the number of frames in the regions returned by @c ReadVector()
+	void AdvanceReadPosition(uint32_t frameCount) noexcept;
+
+	/// Advances the write pointer by the specified number of frames
+	/// @note @c frameCount must not exceed the capacity of the regions returned by @c WriteVector()
+	void AdvanceWritePosition(uint32_t frameCount) noexcept;
+
+
+	/// A read-only region of the channel buffers
+	struct ReadBufferList {
+		/// The channel buffers in @c Format() or @c nullptr if the region is empty
+		const AudioBufferList * const _Nullable mBufferList;
+		/// The number of frames of valid audio in @c mBufferList
+		const uint32_t mFrameCount;
+
+		/// Construct an empty @c ReadBufferList
+		ReadBufferList() noexcept
+		: ReadBufferList(nullptr, 0)
+		{}
+
+		/// Construct a @c ReadBufferList for the specified channel buffers and frame count
+		/// @param bufferList The channel buffers
+		/// @param frameCount The number of frames of valid audio in @c bufferList
+		ReadBufferList(const AudioBufferList * const _Nullable bufferList, uint32_t frameCount) noexcept
+		: mBufferList(bufferList), mFrameCount(frameCount)
+		{}
+	};
+
+	/// A pair of @c ReadBufferList objects
+	using ReadBufferListPair = std::pair<const ReadBufferList, const ReadBufferList>;
+
+	/// Returns the read vector describing the audio currently available for reading
+	///
+	/// The regions point directly into the channel buffers so the audio may be processed in place, after which
+	/// @c AdvanceReadPosition() releases the frames to the writer. The second region is used only when the readable
+	/// audio wraps around the end of a buffer that is not mirrored.
+	/// @note The buffer lists are owned by the @c AudioRingBuffer and remain valid until the next call to @c ReadVector()
+	const ReadBufferListPair ReadVector() const noexcept;
+
+
+	/// A write-only region of the channel buffers
+	struct WriteBufferList {
+		/// The channel buffers in @c Format() or @c nullptr if the region is empty
+		AudioBufferList * const _Nullable mBufferList;
+		/// The capacity of @c mBufferList in frames
+		const uint32_t mFrameCapacity;
+
+		/// Construct an empty @c WriteBufferList
+		WriteBufferList() noexcept
+		: WriteBufferList(nullptr, 0)
+		{}
+
+		/// Construct a @c WriteBufferList for the specified channel buffers and capacity
+		/// @param bufferList The channel buffers
+		/// @param frameCapacity The capacity of @c bufferList in frames
+		WriteBufferList(AudioBufferList * const _Nullable bufferList, uint32_t frameCapacity) noexcept
+		: mBufferList(bufferList), mFrameCapacity(frameCapacity)
+		{}
+	};
+
+	/// A pair of @c WriteBufferList objects
+	using WriteBufferListPair = std::pair<const WriteBufferList, const WriteBufferList>;
+
+	/// Returns the write vector describing the space currently available for writing
+	///
+	/// The regions point directly into the channel buffers so an @c AudioConverter or decoder may render into them,
+	/// after which @c AdvanceWritePosition() publishes the frames to the reader. The second region is used only when
+	/// the writable space wraps around the end of a buffer that is not mirrored.
+	/// @note The buffer lists are owned by the @c AudioRingBuffer and remain valid until the next call to @c WriteVector()
+	const WriteBufferListPair WriteVector() const noexcept;
+
+#pragma mark Telemetry
+
+	/// Returns the telemetry recorded by the copying reads and writes
+	///
+	/// Fill levels are those observed by the reader or writer and may lag the other side.
+	/// @note All values are zero unless @c SFB_ENABLE_TELEMETRY is nonzero
+	/// @note This method is safe to call from any thread
+	inline TelemetryStatistics SampleTelemetry() const noexcept
+	{
+		return mTelemetry.Statistics();
+	}
+
+	/// Resets the telemetry recorded by the copying reads and writes
+	/// @note This method is safe to call from any thread
+	inline void ResetTelemetry() noexcept
+	{
+		mTelemetry.ResetStatistics();
+	}
+
 private:
 
+	/// Copies frames starting at @c readPointer to @c bufferList, handling wrap around
+	void FetchFramesAt(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t dstOffset, uint32_t readPointer, uint32_t frameCount) const noexcept;
+
+	/// Copies frames from @c bufferList to the buffer starting at @c writePointer, handling wrap around
+	void StoreFramesAt(uint32_t writePointer, const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t srcOffset, uint32_t frameCount) noexcept;
+
 	/// The format of the audio
 	CAStreamBasicDescription mFormat;
 
-	/// The channel pointers and buffers allocated in one chunk of memory
+	/// The channel stream pointers and buffers allocated in one chunk of memory
+	/// @note For mirrored buffers the channel pointers are allocated separately from the channel buffers
 	uint8_t * _Nonnull * _Nullable mBuffers;
+	/// The buffer lists describing the read vector, allocated following the channel stream pointers
+	AudioBufferList * _Nullable mReadBufferLists [2];
+	/// The buffer lists describing the write vector, allocated following the channel stream pointers
+	AudioBufferList * _Nullable mWriteBufferLists [2];
 
-	/// The frame capacity per channel
+	/// The frame capacity per channel stream
 	uint32_t mCapacityFrames;
 	/// Mask used to wrap read and write locations
 	/// @note Equal to @c mCapacityFrames-1
 	uint32_t mCapacityFramesMask;
+	/// @c true if the channel buffers are mapped twice in consecutive virtual memory
+	bool mIsMirrored;
+	/// The policy used to allocate the channel buffers
+	AllocationPolicy mAllocationPolicy;
 
 	/// The offset in frames of the write location
 	std::atomic_uint32_t mWritePointer;
 	/// The offset in frames of the read location
 	std::atomic_uint32_t mReadPointer;
 
+	/// Telemetry recorded by the copying reads and writes
+	[[no_unique_address]] Telemetry mTelemetry;
+
 };
 
 } // namespace SFB
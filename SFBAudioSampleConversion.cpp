@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+
+#import "SFBAudioSampleConversion.hpp"
+#import "SFBAudioInterleaving.hpp"
+
+namespace {
+
+using SFB::AudioSampleConversion::Int24;
+
+/// The size in bytes of the scratch buffers used for byte swapping and interleaving
+constexpr size_t sScratchSize = 4096;
+
+/// The supported sample types
+enum class SampleType
+{
+	Int16,
+	Int24,
+	Int32,
+	Float32,
+	Float64
+};
+
+/// The sample type and byte order of a format
+struct SampleFormat
+{
+	/// The sample type
+	SampleType mType;
+	/// The size of a single sample in bytes
+	uint32_t mBytesPerSample;
+	/// @c true if the samples are not in native byte order
+	bool mSwapBytes;
+};
+
+/// Determines the sample type and byte order for @c format
+/// @return @c true if @c format is supported, @c false otherwise
+bool GetSampleFormat(const SFB::CAStreamBasicDescription& format, SampleFormat& sampleFormat) noexcept
+{
+	if(!format.IsPCM() || format.mChannelsPerFrame == 0 || format.mBitsPerChannel % 8)
+		return false;
+
+	const auto bytesPerSample = format.mBitsPerChannel / 8;
+	if(format.mBytesPerFrame != bytesPerSample * format.InterleavedChannelCount())
+		return false;
+
+	if(format.IsFloat()) {
+		if(bytesPerSample == 4)
+			sampleFormat.mType = SampleType::Float32;
+		else if(bytesPerSample == 8)
+			sampleFormat.mType = SampleType::Float64;
+		else
+			return false;
+	}
+	else if(format.IsSignedInteger()) {
+		if(bytesPerSample == 2)
+			sampleFormat.mType = SampleType::Int16;
+		else if(bytesPerSample == 3)
+			sampleFormat.mType = SampleType::Int24;
+		else if(bytesPerSample == 4)
+			sampleFormat.mType = SampleType::Int32;
+		else
+			return false;
+	}
+	else
+		return false;
+
+	sampleFormat.mBytesPerSample = bytesPerSample;
+	sampleFormat.mSwapBytes = bytesPerSample > 1 && !format.IsNativeEndian();
+
+	return true;
+}
+
+/// Calls @c f with a value of the C++ type corresponding to @c type
+template <typename F>
+void WithSampleType(SampleType type, F&& f) noexcept
+{
+	switch(type) {
+		case SampleType::Int16:		f(int16_t{});	break;
+		case SampleType::Int24:		f(Int24{});		break;
+		case SampleType::Int32:		f(int32_t{});	break;
+		case SampleType::Float32:	f(float{});		break;
+		case SampleType::Float64:	f(double{});	break;
+	}
+}
+
+/// Returns @c sample with its bytes reversed
+template <typename T>
+inline T SwapBytes(T sample) noexcept
+{
+	uint8_t bytes[sizeof(T)];
+	std::memcpy(bytes, &sample, sizeof(T));
+	std::reverse(bytes, bytes + sizeof(T));
+	std::memcpy(&sample, bytes, sizeof(T));
+	return sample;
+}
+
+/// Converts a contiguous run of @c count samples
+void ConvertSamples(const uint8_t * const _Nonnull source, const SampleFormat& sourceFormat, uint8_t * const _Nonnull destination, const SampleFormat& destinationFormat, size_t count) noexcept
+{
+	WithSampleType(sourceFormat.mType, [&](auto s) {
+		WithSampleType(destinationFormat.mType, [&](auto d) {
+			using S = decltype(s);
+			using D = decltype(d);
+
+			// Native-endian samples are converted directly by the kernel for S and D
+			if(!sourceFormat.mSwapBytes && !destinationFormat.mSwapBytes) {
+				SFB::AudioSampleConversion::Convert(reinterpret_cast<const S *>(source), reinterpret_cast<D *>(destination), count);
+				return;
+			}
+
+			// Otherwise the samples are swapped to and from native byte order in blocks
+			constexpr size_t blockSize = sScratchSize / std::max(sizeof(S), sizeof(D));
+			S sourceBlock[blockSize];
+			D destinationBlock[blockSize];
+			for(size_t i = 0; i < count; i += blockSize) {
+				const auto n = std::min(blockSize, count - i);
+				std::memcpy(sourceBlock, source + i * sizeof(S), n * sizeof(S));
+				if(sourceFormat.mSwapBytes)
+					std::transform(sourceBlock, sourceBlock + n, sourceBlock, SwapBytes<S>);
+				SFB::AudioSampleConversion::Convert(sourceBlock, destinationBlock, n);
+				if(destinationFormat.mSwapBytes)
+					std::transform(destinationBlock, destinationBlock + n, destinationBlock, SwapBytes<D>);
+				std::memcpy(destination + i * sizeof(D), destinationBlock, n * sizeof(D));
+			}
+		});
+	});
+}
+
+} // namespace
+
+bool SFB::AudioSampleConversion::IsSupportedFormat(const CAStreamBasicDescription& format) noexcept
+{
+	SampleFormat sampleFormat;
+	return GetSampleFormat(format, sampleFormat);
+}
+
+bool SFB::AudioSampleConversion::Convert(const AudioBufferList * const source, const CAStreamBasicDescription& sourceFormat, AudioBufferList * const destination, const CAStreamBasicDescription& destinationFormat, uint32_t frameCount) noexcept
+{
+	SampleFormat sourceSampleFormat, destinationSampleFormat;
+	if(!GetSampleFormat(sourceFormat, sourceSampleFormat) || !GetSampleFormat(destinationFormat, destinationSampleFormat))
+		return false;
+
+	if(sourceFormat.mChannelsPerFrame != destinationFormat.mChannelsPerFrame)
+		return false;
+
+	if(source->mNumberBuffers != sourceFormat.ChannelStreamCount() || destination->mNumberBuffers != destinationFormat.ChannelStreamCount())
+		return false;
+
+	for(UInt32 i = 0; i < source->mNumberBuffers; ++i) {
+		if(source->mBuffers[i].mDataByteSize < frameCount * sourceFormat.mBytesPerFrame)
+			return false;
+	}
+
+	const auto channelCount = sourceFormat.mChannelsPerFrame;
+	const auto sourceBytesPerSample = sourceSampleFormat.mBytesPerSample;
+	const auto destinationBytesPerSample = destinationSampleFormat.mBytesPerSample;
+
+	// Identical layouts convert each buffer as a single run of samples
+	if(channelCount == 1 || sourceFormat.IsInterleaved() == destinationFormat.IsInterleaved()) {
+		const auto sampleCount = static_cast<size_t>(frameCount) * sourceFormat.InterleavedChannelCount();
+		for(UInt32 i = 0; i < source->mNumberBuffers; ++i)
+			ConvertSamples(static_cast<const uint8_t *>(source->mBuffers[i].mData), sourceSampleFormat, static_cast<uint8_t *>(destination->mBuffers[i].mData), destinationSampleFormat, sampleCount);
+	}
+	// Non-interleaved to interleaved converts each channel into scratch space and then interleaves
+	else if(destinationFormat.IsInterleaved()) {
+		alignas(16) uint8_t scratch[sScratchSize];
+		const uint32_t blockFrames = sScratchSize / (channelCount * destinationBytesPerSample);
+		if(blockFrames == 0)
+			return false;
+
+		auto dst = static_cast<uint8_t *>(destination->mBuffers[0].mData);
+		for(uint32_t frame = 0; frame < frameCount; frame += blockFrames) {
+			const auto n = std::min(blockFrames, frameCount - frame);
+			for(uint32_t channel = 0; channel < channelCount; ++channel)
+				ConvertSamples(static_cast<const uint8_t *>(source->mBuffers[channel].mData) + frame * sourceBytesPerSample, sourceSampleFormat, scratch + channel * blockFrames * destinationBytesPerSample, destinationSampleFormat, n);
+			AudioInterleaving::Interleave(dst + frame * destinationFormat.mBytesPerFrame, [&](uint32_t channel) {
+				return scratch + channel * blockFrames * destinationBytesPerSample;
+			}, channelCount, destinationBytesPerSample, n);
+		}
+	}
+	// Interleaved to non-interleaved deinterleaves into scratch space and then converts each channel
+	else {
+		alignas(16) uint8_t scratch[sScratchSize];
+		const uint32_t blockFrames = sScratchSize / (channelCount * sourceBytesPerSample);
+		if(blockFrames == 0)
+			return false;
+
+		auto src = static_cast<const uint8_t *>(source->mBuffers[0].mData);
+		for(uint32_t frame = 0; frame < frameCount; frame += blockFrames) {
+			const auto n = std::min(blockFrames, frameCount - frame);
+			AudioInterleaving::Deinterleave([&](uint32_t channel) {
+				return scratch + channel * blockFrames * sourceBytesPerSample;
+			}, src + frame * sourceFormat.mBytesPerFrame, channelCount, sourceBytesPerSample, n);
+			for(uint32_t channel = 0; channel < channelCount; ++channel)
+				ConvertSamples(scratch + channel * blockFrames * sourceBytesPerSample, sourceSampleFormat, static_cast<uint8_t *>(destination->mBuffers[channel].mData) + frame * destinationBytesPerSample, destinationSampleFormat, n);
+		}
+	}
+
+	for(UInt32 i = 0; i < destination->mNumberBuffers; ++i)
+		destination->mBuffers[i].mDataByteSize = frameCount * destinationFormat.mBytesPerFrame;
+
+	return true;
+}
@@ -0,0 +1,320 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstddef>
+#import <cstdint>
+#import <cstring>
+#import <type_traits>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+namespace AudioSampleConversion {
+
+// Integer samples are scaled so that full scale maps to [-1, 1). Conversion to integer clips to the
+// representable range and rounds to the nearest integer, with ties rounded away from zero.
+
+/// A packed 24-bit signed integer sample in native byte order
+struct Int24
+{
+	/// The bytes of the sample
+	uint8_t mBytes[3];
+};
+
+/// Converts native-endian samples from type @c S to type @c D
+///
+/// @c S and @c D may be @c int16_t, @c Int24, @c int32_t, @c float, or @c double. Conversions between @c float and
+/// @c int16_t, @c int32_t, or @c double use vector kernels selected at compile time.
+/// @param source The samples to convert
+/// @param destination A buffer to receive the converted samples
+/// @param count The number of samples to convert
+template <typename S, typename D>
+void Convert(const S * const _Nonnull source, D * const _Nonnull destination, size_t count) noexcept;
+
+/// Returns @c true if @c format is a linear PCM format supported for conversion
+///
+/// Supported formats are packed 16-, 24-, and 32-bit signed integer and 32- and 64-bit floating point
+/// samples in either byte order, interleaved or non-interleaved.
+bool IsSupportedFormat(const CAStreamBasicDescription& format) noexcept;
+
+/// Converts audio between linear PCM formats
+///
+/// Samples are converted, byte swapped, and interleaved or deinterleaved as required. Sample rates are not converted.
+/// The @c mDataByteSize of each buffer in @c destination is set to the size of @c frameCount frames.
+/// @param source The audio to convert
+/// @param sourceFormat The format of @c source
+/// @param destination A buffer list with space for at least @c frameCount frames
+/// @param destinationFormat The format of @c destination
+/// @param frameCount The number of frames to convert
+/// @return @c true on success, @c false if a format is not supported, the channel counts differ, or @c source contains fewer than @c frameCount frames
+bool Convert(const AudioBufferList * const _Nonnull source, const CAStreamBasicDescription& sourceFormat, AudioBufferList * const _Nonnull destination, const CAStreamBasicDescription& destinationFormat, uint32_t frameCount) noexcept;
+
+// Implementation details follow
+
+namespace detail {
+
+/// Four @c float lanes
+using V4f = float __attribute__((vector_size(16)));
+/// Four @c int32_t lanes
+using V4i32 = int32_t __attribute__((vector_size(16)));
+/// Four @c int16_t lanes
+using V4i16 = int16_t __attribute__((vector_size(8)));
+/// Two @c float lanes
+using V2f = float __attribute__((vector_size(8)));
+/// Two @c double lanes
+using V2d = double __attribute__((vector_size(16)));
+/// Two @c int64_t lanes
+using V2i64 = int64_t __attribute__((vector_size(16)));
+/// Two @c int32_t lanes
+using V2i32 = int32_t __attribute__((vector_size(8)));
+
+/// Returns the lanes of @c a or @c b selected by @c mask
+inline V4f Select(V4i32 mask, V4f a, V4f b) noexcept
+{
+	return (V4f)(((V4i32)a & mask) | ((V4i32)b & ~mask));
+}
+
+/// Returns @c v clamped to [@c lo, @c hi]
+inline V4f Clamp(V4f v, float lo, float hi) noexcept
+{
+	const V4f vlo = { lo, lo, lo, lo };
+	const V4f vhi = { hi, hi, hi, hi };
+	v = Select(v < vlo, vlo, v);
+	return Select(v > vhi, vhi, v);
+}
+
+/// Returns @c v rounded to the nearest integer, with ties rounded away from zero, and converted to @c int32_t
+inline V4i32 Round(V4f v) noexcept
+{
+	const V4f half = { 0.5f, 0.5f, 0.5f, 0.5f };
+	const V4i32 sign = { INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN };
+	return __builtin_convertvector(v + (V4f)(((V4i32)v & sign) | (V4i32)half), V4i32);
+}
+
+/// Returns the lanes of @c a or @c b selected by @c mask
+inline V2d Select(V2i64 mask, V2d a, V2d b) noexcept
+{
+	return (V2d)(((V2i64)a & mask) | ((V2i64)b & ~mask));
+}
+
+/// Returns @c v clamped to [@c lo, @c hi]
+inline V2d Clamp(V2d v, double lo, double hi) noexcept
+{
+	const V2d vlo = { lo, lo };
+	const V2d vhi = { hi, hi };
+	v = Select(v < vlo, vlo, v);
+	return Select(v > vhi, vhi, v);
+}
+
+/// Returns @c v rounded to the nearest integer, with ties rounded away from zero, and converted to @c int32_t
+/// @note The lanes of @c v must be within the range of @c int32_t
+inline V2i32 Round(V2d v) noexcept
+{
+	const V2d half = { 0.5, 0.5 };
+	const V2i64 sign = { INT64_MIN, INT64_MIN };
+	return __builtin_convertvector(v + (V2d)(((V2i64)v & sign) | (V2i64)half), V2i32);
+}
+
+/// Returns @c value multiplied by @c scale, clamped to [@c lo, @c hi], and rounded to the nearest integer with ties rounded away from zero
+inline int64_t ScaleClampRound(double value, double scale, double lo, double hi) noexcept
+{
+	value *= scale;
+	value = value < lo ? lo : (value > hi ? hi : value);
+	return static_cast<int64_t>(value + (value < 0 ? -0.5 : 0.5));
+}
+
+/// Scalar sample conversion through @c double
+template <typename T>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<int16_t>
+{
+	static double ToDouble(int16_t sample) noexcept { return sample * (1.0 / 32768.0); }
+	static int16_t FromDouble(double value) noexcept { return static_cast<int16_t>(ScaleClampRound(value, 32768.0, -32768.0, 32767.0)); }
+};
+
+template <>
+struct SampleTraits<Int24>
+{
+	static double ToDouble(Int24 sample) noexcept
+	{
+		uint32_t word = 0;
+		if constexpr(kAudioFormatFlagsNativeEndian == kAudioFormatFlagIsBigEndian)
+			word = (uint32_t{sample.mBytes[0]} << 24) | (uint32_t{sample.mBytes[1]} << 16) | (uint32_t{sample.mBytes[2]} << 8);
+		else
+			word = (uint32_t{sample.mBytes[2]} << 24) | (uint32_t{sample.mBytes[1]} << 16) | (uint32_t{sample.mBytes[0]} << 8);
+		return (static_cast<int32_t>(word) >> 8) * (1.0 / 8388608.0);
+	}
+
+	static Int24 FromDouble(double value) noexcept
+	{
+		const auto word = static_cast<uint32_t>(static_cast<int32_t>(ScaleClampRound(value, 8388608.0, -8388608.0, 8388607.0)));
+		if constexpr(kAudioFormatFlagsNativeEndian == kAudioFormatFlagIsBigEndian)
+			return { static_cast<uint8_t>(word >> 16), static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word) };
+		else
+			return { static_cast<uint8_t>(word), static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word >> 16) };
+	}
+};
+
+template <>
+struct SampleTraits<int32_t>
+{
+	static double ToDouble(int32_t sample) noexcept { return sample * (1.0 / 2147483648.0); }
+	static int32_t FromDouble(double value) noexcept { return static_cast<int32_t>(ScaleClampRound(value, 2147483648.0, -2147483648.0, 2147483647.0)); }
+};
+
+template <>
+struct SampleTraits<float>
+{
+	static double ToDouble(float sample) noexcept { return sample; }
+	static float FromDouble(double value) noexcept { return static_cast<float>(value); }
+};
+
+template <>
+struct SampleTraits<double>
+{
+	static double ToDouble(double sample) noexcept { return sample; }
+	static double FromDouble(double value) noexcept { return value; }
+};
+
+/// Converts samples one at a time
+template <typename S, typename D>
+void ConvertScalar(const S * const _Nonnull source, D * const _Nonnull destination, size_t count) noexcept
+{
+	for(size_t i = 0; i < count; ++i)
+		destination[i] = SampleTraits<D>::FromDouble(SampleTraits<S>::ToDouble(source[i]));
+}
+
+/// Converts samples of type @c S to type @c D
+template <typename S, typename D>
+struct Kernel
+{
+	static void Convert(const S * const _Nonnull source, D * const _Nonnull destination, size_t count) noexcept
+	{
+		if constexpr(std::is_same_v<S, D>)
+			std::memcpy(destination, source, count * sizeof(S));
+		else
+			ConvertScalar(source, destination, count);
+	}
+};
+
+template <>
+struct Kernel<int16_t, float>
+{
+	static void Convert(const int16_t * const _Nonnull source, float * const _Nonnull destination, size_t count) noexcept
+	{
+		const V4f scale = { 1.f / 32768.f, 1.f / 32768.f, 1.f / 32768.f, 1.f / 32768.f };
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			V4i16 v;
+			std::memcpy(&v, source + i, sizeof v);
+			const V4f f = __builtin_convertvector(v, V4f) * scale;
+			std::memcpy(destination + i, &f, sizeof f);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+template <>
+struct Kernel<float, int16_t>
+{
+	static void Convert(const float * const _Nonnull source, int16_t * const _Nonnull destination, size_t count) noexcept
+	{
+		const V4f scale = { 32768.f, 32768.f, 32768.f, 32768.f };
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			V4f f;
+			std::memcpy(&f, source + i, sizeof f);
+			const V4i16 v = __builtin_convertvector(Round(Clamp(f * scale, -32768.f, 32767.f)), V4i16);
+			std::memcpy(destination + i, &v, sizeof v);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+template <>
+struct Kernel<int32_t, float>
+{
+	static void Convert(const int32_t * const _Nonnull source, float * const _Nonnull destination, size_t count) noexcept
+	{
+		const V4f scale = { 1.f / 2147483648.f, 1.f / 2147483648.f, 1.f / 2147483648.f, 1.f / 2147483648.f };
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			V4i32 v;
+			std::memcpy(&v, source + i, sizeof v);
+			const V4f f = __builtin_convertvector(v, V4f) * scale;
+			std::memcpy(destination + i, &f, sizeof f);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+template <>
+struct Kernel<float, int32_t>
+{
+	static void Convert(const float * const _Nonnull source, int32_t * const _Nonnull destination, size_t count) noexcept
+	{
+		// Scaled samples are rounded in double precision since a float cannot represent every 32-bit value or 2^31 - 1,
+		// which keeps results identical to SampleTraits<int32_t>::FromDouble() used for the remaining samples
+		const V2d scale = { 2147483648.0, 2147483648.0 };
+		size_t i = 0;
+		for(; i + 2 <= count; i += 2) {
+			V2f f;
+			std::memcpy(&f, source + i, sizeof f);
+			const V2i32 v = Round(Clamp(__builtin_convertvector(f, V2d) * scale, -2147483648.0, 2147483647.0));
+			std::memcpy(destination + i, &v, sizeof v);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+template <>
+struct Kernel<float, double>
+{
+	static void Convert(const float * const _Nonnull source, double * const _Nonnull destination, size_t count) noexcept
+	{
+		size_t i = 0;
+		for(; i + 2 <= count; i += 2) {
+			V2f f;
+			std::memcpy(&f, source + i, sizeof f);
+			const V2d d = __builtin_convertvector(f, V2d);
+			std::memcpy(destination + i, &d, sizeof d);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+template <>
+struct Kernel<double, float>
+{
+	static void Convert(const double * const _Nonnull source, float * const _Nonnull destination, size_t count) noexcept
+	{
+		size_t i = 0;
+		for(; i + 2 <= count; i += 2) {
+			V2d d;
+			std::memcpy(&d, source + i, sizeof d);
+			const V2f f = __builtin_convertvector(d, V2f);
+			std::memcpy(destination + i, &f, sizeof f);
+		}
+		ConvertScalar(source + i, destination + i, count - i);
+	}
+};
+
+} // namespace detail
+
+template <typename S, typename D>
+void Convert(const S * const source, D * const destination, size_t count) noexcept
+{
+	detail::Kernel<S, D>::Convert(source, destination, count);
+}
+
+} // namespace AudioSampleConversion
+} // namespace SFB
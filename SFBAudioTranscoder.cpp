@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <chrono>
+#import <cmath>
+#import <deque>
+#import <memory>
+#import <mutex>
+#import <new>
+#import <stdexcept>
+#import <system_error>
+#import <thread>
+
+#import "SFBAudioTranscoder.hpp"
+#import "SFBCABufferList.hpp"
+#import "SFBCAExtAudioFile.hpp"
+#import "SFBUnfairLock.hpp"
+
+namespace {
+
+/// A queue of job indexes owned by one worker
+///
+/// The owner takes jobs from the front and other workers steal jobs from the back.
+struct WorkQueue
+{
+	/// The lock protecting @c mJobs
+	SFB::UnfairLock mLock;
+	/// The indexes of the queued jobs
+	std::deque<size_t> mJobs;
+
+	/// Removes and returns the job at the front of the queue
+	bool PopFront(size_t& job)
+	{
+		std::lock_guard<SFB::UnfairLock> lock(mLock);
+		if(mJobs.empty())
+			return false;
+		job = mJobs.front();
+		mJobs.pop_front();
+		return true;
+	}
+
+	/// Removes and returns the job at the back of the queue
+	bool PopBack(size_t& job)
+	{
+		std::lock_guard<SFB::UnfairLock> lock(mLock);
+		if(mJobs.empty())
+			return false;
+		job = mJobs.back();
+		mJobs.pop_back();
+		return true;
+	}
+};
+
+/// Converts @c job using @c buffer as scratch space
+int64_t TranscodeJob(const SFB::AudioTranscoder::Job& job, SFB::CABufferList& buffer, UInt32 bufferFrames)
+{
+	SFB::CAExtAudioFile source;
+	source.OpenURL(job.mSourceURL);
+
+	const auto sourceFormat = source.FileDataFormat();
+	const auto sampleRate = job.mFormat.mSampleRate > 0 ? job.mFormat.mSampleRate : sourceFormat.mSampleRate;
+	const auto channelCount = job.mFormat.mChannelsPerFrame > 0 ? job.mFormat.mChannelsPerFrame : sourceFormat.mChannelsPerFrame;
+	const auto clientFormat = SFB::CAStreamBasicDescription(SFB::CommonPCMFormat::float32, sampleRate, channelCount, false);
+	const auto clientChannelLayout = job.mChannelLayout ? &job.mChannelLayout : nullptr;
+
+	source.SetClientDataFormat(clientFormat, clientChannelLayout);
+
+	// Frame positions are in the source sample rate but frames are read in the client sample rate
+	int64_t framesRemaining = -1;
+	if(job.mStartFrame > 0)
+		source.Seek(job.mStartFrame);
+	if(job.mFrameCount >= 0)
+		framesRemaining = std::llround(static_cast<double>(job.mFrameCount) * sampleRate / sourceFormat.mSampleRate);
+
+	SFB::CAExtAudioFile destination;
+	destination.CreateWithURL(job.mDestinationURL, job.mFileType, job.mFormat, job.mChannelLayout.ACL(), kAudioFileFlags_EraseFile);
+	destination.SetClientDataFormat(clientFormat, clientChannelLayout);
+
+	// The scratch buffer is reallocated only when the client format or buffer size changes
+	if(!buffer || buffer.Format() != clientFormat || buffer.FrameCapacity() != bufferFrames) {
+		if(!buffer.Allocate(clientFormat, bufferFrames))
+			throw std::bad_alloc();
+	}
+
+	int64_t framesConverted = 0;
+	while(framesRemaining != 0) {
+		source.Read(buffer);
+		auto frameCount = buffer.FrameLength();
+		if(frameCount == 0)
+			break;
+
+		if(framesRemaining > 0 && frameCount > framesRemaining)
+			frameCount = static_cast<UInt32>(framesRemaining);
+
+		destination.Write(frameCount, buffer);
+
+		framesConverted += frameCount;
+		if(framesRemaining > 0)
+			framesRemaining -= frameCount;
+	}
+
+	// Closing the destination flushes the encoder and finalizes the file
+	destination.Close();
+	source.Close();
+
+	return framesConverted;
+}
+
+} // namespace
+
+#pragma mark Creation and Destruction
+
+SFB::AudioTranscoder::AudioTranscoder(size_t workerCount, UInt32 bufferFrames) noexcept
+: mWorkerCount(workerCount), mBufferFrames(std::max(bufferFrames, 1u))
+{
+	if(mWorkerCount == 0)
+		mWorkerCount = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+#pragma mark Transcoding
+
+std::vector<SFB::AudioTranscoder::JobResult> SFB::AudioTranscoder::Transcode(const std::vector<Job>& jobs, const CompletionHandler& completionHandler) const
+{
+	std::vector<JobResult> results(jobs.size());
+	if(jobs.empty())
+		return results;
+
+	const auto workerCount = std::min(mWorkerCount, jobs.size());
+
+	// Deal the jobs to the workers in contiguous runs
+	auto queues = std::make_unique<WorkQueue[]>(workerCount);
+	for(size_t i = 0; i < jobs.size(); ++i)
+		queues[i * workerCount / jobs.size()].mJobs.push_back(i);
+
+	auto worker = [&](size_t workerIndex) {
+		CABufferList buffer;
+		for(;;) {
+			size_t job;
+			// Take the next local job or steal one from the back of another worker's queue
+			auto haveJob = queues[workerIndex].PopFront(job);
+			for(size_t i = 1; !haveJob && i < workerCount; ++i)
+				haveJob = queues[(workerIndex + i) % workerCount].PopBack(job);
+			// No jobs are added after the workers start so all queues are empty
+			if(!haveJob)
+				break;
+
+			auto& result = results[job];
+			result.mJob = job;
+
+			const auto start = std::chrono::steady_clock::now();
+			try {
+				result.mFramesConverted = TranscodeJob(jobs[job], buffer, mBufferFrames);
+			}
+			catch(...) {
+				result.mError = std::current_exception();
+			}
+			result.mElapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			result.mFramesPerSecond = result.mElapsedTime > 0 ? result.mFramesConverted / result.mElapsedTime : 0;
+
+			if(completionHandler)
+				completionHandler(result);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workerCount - 1);
+	for(size_t i = 1; i < workerCount; ++i) {
+		try {
+			threads.emplace_back(worker, i);
+		}
+		catch(const std::system_error&) {
+			// The queues of workers that could not be started are drained by stealing
+			break;
+		}
+	}
+
+	// The calling thread is the first worker
+	worker(0);
+
+	for(auto& thread : threads)
+		thread.join();
+
+	return results;
+}
+
+std::vector<SFB::AudioTranscoder::JobResult> SFB::AudioTranscoder::TranscodeSegments(const Job& job, SInt64 segmentFrames, const SegmentURLProvider& segmentURL, const CompletionHandler& completionHandler) const
+{
+	if(segmentFrames <= 0)
+		throw std::invalid_argument("segmentFrames <= 0");
+
+	SFB::CAExtAudioFile source;
+	source.OpenURL(job.mSourceURL);
+
+	// Seeking in linear PCM is constant-cost so each worker can start anywhere in the file
+	if(!source.FileDataFormat().IsPCM())
+		throw std::invalid_argument("Source file is not linear PCM");
+
+	const auto startFrame = std::max<SInt64>(job.mStartFrame, 0);
+	auto endFrame = source.FrameLength();
+	if(job.mFrameCount >= 0)
+		endFrame = std::min(endFrame, startFrame + job.mFrameCount);
+
+	source.Close();
+
+	std::vector<Job> segments;
+	for(auto frame = startFrame; frame < endFrame; frame += segmentFrames) {
+		auto segment = job;
+		segment.mDestinationURL = segmentURL(segments.size());
+		segment.mStartFrame = frame;
+		segment.mFrameCount = std::min(segmentFrames, endFrame - frame);
+		segments.push_back(std::move(segment));
+	}
+
+	return Transcode(segments, completionHandler);
+}
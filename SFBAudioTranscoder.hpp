@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <exception>
+#import <functional>
+#import <vector>
+
+#import <AudioToolbox/AudioFile.h>
+
+#import "SFBCAChannelLayout.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+#import "SFBCFWrapper.hpp"
+
+CF_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+/// Converts audio files in parallel using @c CAExtAudioFile
+///
+/// Each job is converted by one worker thread, which decodes the source file to deinterleaved @c float at the
+/// destination sample rate and channel count and encodes the result in the destination format. Jobs are distributed
+/// among the workers' queues and idle workers steal jobs from busy workers. Each worker reuses one scratch buffer for
+/// all the jobs it runs.
+class AudioTranscoder
+{
+
+public:
+
+	/// The default number of frames converted at a time
+	static constexpr UInt32 sDefaultBufferFrames = 4096;
+
+	/// An audio file to convert
+	struct Job
+	{
+		/// The URL of the file to convert
+		CFURL mSourceURL;
+		/// The URL of the file to create
+		CFURL mDestinationURL;
+		/// The type of the file to create
+		AudioFileTypeID mFileType;
+		/// The format of the file to create
+		CAStreamBasicDescription mFormat;
+		/// The channel layout of the file to create or an empty layout to use the default
+		CAChannelLayout mChannelLayout;
+		/// The first source frame to convert, in the source file's sample rate
+		SInt64 mStartFrame = 0;
+		/// The number of source frames to convert, in the source file's sample rate, or @c -1 to convert to the end
+		SInt64 mFrameCount = -1;
+	};
+
+	/// The outcome of a job
+	struct JobResult
+	{
+		/// The index of the job
+		size_t mJob;
+		/// The number of frames converted, in the destination sample rate
+		int64_t mFramesConverted;
+		/// The time taken to convert the job, in seconds
+		double mElapsedTime;
+		/// The conversion throughput in frames per second
+		double mFramesPerSecond;
+		/// The exception thrown while converting the job or @c nullptr on success
+		std::exception_ptr mError;
+	};
+
+	/// A function called on a worker thread when a job completes
+	using CompletionHandler = std::function<void(const JobResult&)>;
+
+	/// A function returning the destination URL for a segment
+	using SegmentURLProvider = std::function<CFURL(size_t segment)>;
+
+#pragma mark Creation and Destruction
+
+	/// Creates an @c AudioTranscoder
+	/// @param workerCount The maximum number of worker threads or @c 0 for one per processor core
+	/// @param bufferFrames The number of frames converted at a time
+	explicit AudioTranscoder(size_t workerCount = 0, UInt32 bufferFrames = sDefaultBufferFrames) noexcept;
+
+	// This class is non-copyable
+	AudioTranscoder(const AudioTranscoder& rhs) = delete;
+
+	// This class is non-assignable
+	AudioTranscoder& operator=(const AudioTranscoder& rhs) = delete;
+
+	/// Destroys the @c AudioTranscoder
+	~AudioTranscoder() = default;
+
+	// This class is non-movable
+	AudioTranscoder(AudioTranscoder&& rhs) = delete;
+
+	// This class is non-move assignable
+	AudioTranscoder& operator=(AudioTranscoder&& rhs) = delete;
+
+#pragma mark Transcoding
+
+	/// Converts @c jobs in parallel and waits for all of them to complete
+	/// @note A failed job may leave a partial destination file
+	/// @param jobs The jobs to convert
+	/// @param completionHandler An optional function called on a worker thread as each job completes
+	/// @return The results of the jobs in the same order as @c jobs
+	/// @throw @c std::bad_alloc
+	std::vector<JobResult> Transcode(const std::vector<Job>& jobs, const CompletionHandler& completionHandler = {}) const;
+
+	/// Splits a linear PCM file into consecutive segments and converts the segments in parallel
+	///
+	/// Segment @c n contains source frames @c n*segmentFrames through @c (n+1)*segmentFrames-1 of the range in
+	/// @c job and is written to the URL returned by @c segmentURL. Segments are encoded independently, so with
+	/// compressed destination formats each segment begins with the encoder's priming frames.
+	/// @param job The file to split; @c job.mDestinationURL is ignored
+	/// @param segmentFrames The number of source frames in each segment
+	/// @param segmentURL A function returning the destination URL for each segment
+	/// @param completionHandler An optional function called on a worker thread as each segment completes
+	/// @return The results of the segments in order
+	/// @throw @c std::invalid_argument If the source file is not linear PCM or @c segmentFrames is not positive
+	/// @throw @c std::bad_alloc
+	/// @throw @c std::system_error
+	std::vector<JobResult> TranscodeSegments(const Job& job, SInt64 segmentFrames, const SegmentURLProvider& segmentURL, const CompletionHandler& completionHandler = {}) const;
+
+private:
+
+	/// The maximum number of worker threads
+	size_t mWorkerCount;
+	/// The number of frames converted at a time
+	UInt32 mBufferFrames;
+
+};
+
+} // namespace SFB
+
+CF_ASSUME_NONNULL_END
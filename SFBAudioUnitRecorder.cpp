@@ -0,0 +1,206 @@
+//
+// Copyright (c) 2021 - 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cmath>
+#import <stdexcept>
+
+#import <os/log.h>
+
+#import "SFBAudioUnitRecorder.hpp"
+
+namespace {
+
+/// The number of batches the buffer duration is divided into
+constexpr uint32_t sBatchesPerBuffer = 4;
+
+/// The minimum number of frames written to a file at a time
+constexpr uint32_t sMinimumBatchFrames = 4096;
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::AudioUnitRecorder::AudioUnitRecorder(AudioUnit au, CFURLRef outputFileURL, AudioFileTypeID fileType, const AudioStreamBasicDescription& format, UInt32 busNumber, double bufferDuration)
+: AudioUnitRecorder(au, {{ busNumber, outputFileURL, fileType, format }}, bufferDuration)
+{}
+
+SFB::AudioUnitRecorder::AudioUnitRecorder(AudioUnit au, const std::vector<Bus>& buses, double bufferDuration)
+: mAudioUnit(au), mBufferDuration(bufferDuration), mIsRecording(false), mWriterSemaphore(0), mStopWriting(false)
+{
+	if(!au)
+		throw std::invalid_argument("au == nullptr");
+	if(buses.empty())
+		throw std::invalid_argument("buses.empty()");
+	if(!(bufferDuration > 0))
+		throw std::invalid_argument("bufferDuration <= 0");
+
+	for(const auto& bus : buses) {
+		if(std::any_of(mBuses.cbegin(), mBuses.cend(), [&](const auto& busState) { return busState->mBusNumber == bus.mBusNumber; }))
+			throw std::invalid_argument("Duplicate bus number");
+
+		auto busState = std::make_unique<BusState>();
+		busState->mBusNumber = bus.mBusNumber;
+		busState->mClientFormatIsSet = false;
+		busState->mExtAudioFile.CreateWithURL(bus.mOutputFileURL, bus.mFileType, bus.mFormat, nullptr, kAudioFileFlags_EraseFile);
+		mBuses.push_back(std::move(busState));
+	}
+}
+
+SFB::AudioUnitRecorder::~AudioUnitRecorder()
+{
+	if(mIsRecording) {
+		try {
+			Stop();
+		}
+		catch(const std::exception& e) {
+			os_log_error(OS_LOG_DEFAULT, "Error stopping recording: %{public}s", e.what());
+		}
+	}
+}
+
+#pragma mark Recording
+
+void SFB::AudioUnitRecorder::Start()
+{
+	if(mIsRecording)
+		return;
+
+	for(auto& bus : mBuses) {
+		if(!bus->mClientFormatIsSet) {
+			AudioStreamBasicDescription clientFormat;
+			UInt32 size = sizeof(clientFormat);
+			OSStatus result = AudioUnitGetProperty(mAudioUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, bus->mBusNumber, &clientFormat, &size);
+			ThrowIfCAAudioUnitError(result, "AudioUnitGetProperty");
+			bus->mExtAudioFile.SetClientDataFormat(clientFormat);
+
+			const auto capacityFrames = static_cast<uint32_t>(std::ceil(clientFormat.mSampleRate * mBufferDuration));
+			const auto batchFrames = std::max(capacityFrames / sBatchesPerBuffer, sMinimumBatchFrames);
+			if(!bus->mRingBuffer.Allocate(clientFormat, capacityFrames) || !bus->mWriteBuffer.Allocate(clientFormat, batchFrames))
+				throw std::bad_alloc();
+
+			bus->mClientFormatIsSet = true;
+		}
+		else
+			bus->mRingBuffer.Reset();
+	}
+
+	mStopWriting.store(false, std::memory_order_relaxed);
+	mWriterThread = std::thread(&AudioUnitRecorder::WriterThreadEntry, this);
+
+	auto result = AudioUnitAddRenderNotify(mAudioUnit, RenderCallback, this);
+	if(result != noErr) {
+		mStopWriting.store(true, std::memory_order_release);
+		mWriterSemaphore.Signal();
+		mWriterThread.join();
+		ThrowIfCAAudioUnitError(result, "AudioUnitAddRenderNotify");
+	}
+
+	mIsRecording = true;
+}
+
+void SFB::AudioUnitRecorder::Stop()
+{
+	if(!mIsRecording)
+		return;
+
+	OSStatus result = AudioUnitRemoveRenderNotify(mAudioUnit, RenderCallback, this);
+
+	// The writer thread drains the ring buffers before exiting
+	mStopWriting.store(true, std::memory_order_release);
+	mWriterSemaphore.Signal();
+	mWriterThread.join();
+
+	mIsRecording = false;
+
+	ThrowIfCAAudioUnitError(result, "AudioUnitRemoveRenderNotify");
+}
+
+#pragma mark Statistics
+
+SFB::AudioUnitRecorder::BusStatistics SFB::AudioUnitRecorder::Statistics(size_t index) const noexcept
+{
+	if(index >= mBuses.size())
+		return {};
+
+	const auto& bus = mBuses[index];
+	return {
+		.mOverruns = bus->mOverruns.load(std::memory_order_relaxed),
+		.mOverrunFrames = bus->mOverrunFrames.load(std::memory_order_relaxed),
+		.mFramesWritten = bus->mFramesWritten.load(std::memory_order_relaxed),
+		.mWriteErrors = bus->mWriteErrors.load(std::memory_order_relaxed),
+	};
+}
+
+SFB::TelemetryStatistics SFB::AudioUnitRecorder::SampleTelemetry(size_t index) const noexcept
+{
+	if(index >= mBuses.size())
+		return {};
+	return mBuses[index]->mTelemetry.Statistics();
+}
+
+void SFB::AudioUnitRecorder::ResetTelemetry(size_t index) noexcept
+{
+	if(index < mBuses.size())
+		mBuses[index]->mTelemetry.ResetStatistics();
+}
+
+#pragma mark Rendering and Writing
+
+OSStatus SFB::AudioUnitRecorder::RenderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData)
+{
+	AudioUnitRecorder *THIS = static_cast<AudioUnitRecorder *>(inRefCon);
+	if(*ioActionFlags & kAudioUnitRenderAction_PostRender && !(*ioActionFlags & kAudioUnitRenderAction_PostRenderError) && ioData) {
+		for(auto& bus : THIS->mBuses) {
+			if(bus->mBusNumber == inBusNumber) {
+				const Telemetry::Interval interval(bus->mTelemetry, "AudioUnitRecorder::RenderCallback");
+				const auto framesWritten = bus->mRingBuffer.Write(ioData, inNumberFrames);
+				if(framesWritten < inNumberFrames) {
+					bus->mOverruns.fetch_add(1, std::memory_order_relaxed);
+					bus->mOverrunFrames.fetch_add(inNumberFrames - framesWritten, std::memory_order_relaxed);
+					bus->mTelemetry.RecordOverrun(inNumberFrames - framesWritten);
+				}
+				bus->mTelemetry.RecordFillLevel(bus->mRingBuffer.FramesAvailableToRead());
+				break;
+			}
+		}
+	}
+	return noErr;
+}
+
+void SFB::AudioUnitRecorder::WriterThreadEntry() noexcept
+{
+	// Draining once per batch duration leaves room for several batches of audio if a write stalls
+	const auto interval = static_cast<int64_t>(mBufferDuration / sBatchesPerBuffer * NSEC_PER_SEC);
+
+	while(!mStopWriting.load(std::memory_order_acquire)) {
+		mWriterSemaphore.Wait(dispatch_time(DISPATCH_TIME_NOW, interval));
+		DrainRingBuffers();
+	}
+
+	// Write any audio rendered before the render notify was removed
+	DrainRingBuffers();
+}
+
+void SFB::AudioUnitRecorder::DrainRingBuffers() noexcept
+{
+	for(auto& bus : mBuses) {
+		for(;;) {
+			const auto framesRead = bus->mRingBuffer.Read(bus->mWriteBuffer, bus->mWriteBuffer.FrameCapacity());
+			if(framesRead == 0)
+				break;
+
+			try {
+				bus->mExtAudioFile.Write(framesRead, bus->mWriteBuffer);
+				bus->mFramesWritten.fetch_add(framesRead, std::memory_order_relaxed);
+			}
+			catch(const std::exception& e) {
+				bus->mWriteErrors.fetch_add(1, std::memory_order_relaxed);
+				os_log_error(OS_LOG_DEFAULT, "Error writing frames: %{public}s", e.what());
+			}
+		}
+	}
+}
@@ -6,24 +6,64 @@
 
 #pragma once
 
-#import <stdexcept>
-
-#import <os/log.h>
+#import <atomic>
+#import <memory>
+#import <thread>
+#import <vector>
 
 #import <AudioToolbox/AudioUnit.h>
 
+#import "SFBAudioRingBuffer.hpp"
+#import "SFBCABufferList.hpp"
 #import "SFBCAExtAudioFile.hpp"
+#import "SFBDispatchSemaphore.hpp"
+#import "SFBTelemetry.hpp"
 
 CF_ASSUME_NONNULL_BEGIN
 
 namespace SFB {
 
 /// A class that asynchronously writes the output from an @c AudioUnit to a file
+///
+/// The render notify copies each rendered buffer of a recorded bus into an @c AudioRingBuffer without waiting or
+/// allocating. A writer thread drains the ring buffers into the output files in large batches. If the writer falls
+/// behind by more than the buffer duration the audio that does not fit is dropped and counted as an overrun.
+///
+/// Multiple output buses of the same @c AudioUnit may be recorded, each to its own file.
 class AudioUnitRecorder
 {
 
 public:
 
+	/// The default duration of audio buffered for each bus, in seconds
+	static constexpr double sDefaultBufferDuration = 2;
+
+	/// A bus to record and the file to write it to
+	struct Bus
+	{
+		/// The bus number of the @c AudioUnit to record
+		UInt32 mBusNumber;
+		/// The URL of the output audio file
+		CFURLRef mOutputFileURL;
+		/// The type of the file to create
+		AudioFileTypeID mFileType;
+		/// The format of the audio data to be written to the file
+		AudioStreamBasicDescription mFormat;
+	};
+
+	/// Information on the operation of the recorder for one bus
+	struct BusStatistics
+	{
+		/// The number of render cycles whose audio did not fit in the ring buffer
+		uint64_t mOverruns;
+		/// The number of frames dropped by overruns
+		uint64_t mOverrunFrames;
+		/// The number of frames written to the file
+		uint64_t mFramesWritten;
+		/// The number of errors writing to the file
+		uint64_t mWriteErrors;
+	};
+
 	/// Default constructor
 	AudioUnitRecorder() noexcept = delete;
 
@@ -34,7 +74,8 @@ public:
 	AudioUnitRecorder& operator=(const AudioUnitRecorder& rhs) noexcept = delete;
 
 	/// Destructor
-	~AudioUnitRecorder() = default;
+	/// @note Recording is stopped if it is in progress
+	~AudioUnitRecorder();
 
 	/// Move constructor
 	AudioUnitRecorder(AudioUnitRecorder&& rhs) noexcept = delete;
@@ -48,66 +89,107 @@ public:
 	/// @param fileType The type of the file to create
 	/// @param format The format of the audio data to be written to the file
 	/// @param busNumber The bus number of @c au to record
-	AudioUnitRecorder(AudioUnit au, CFURLRef outputFileURL, AudioFileTypeID fileType, const AudioStreamBasicDescription& format, UInt32 busNumber = 0)
-	: mClientFormatIsSet(false), mAudioUnit(au), mBusNumber(busNumber)
-	{
-		if(!au)
-			throw std::invalid_argument("au == nullptr");
-		mExtAudioFile.CreateWithURL(outputFileURL, fileType, format, nullptr, kAudioFileFlags_EraseFile);
-	}
+	/// @param bufferDuration The duration of audio to buffer, in seconds
+	/// @throw @c std::invalid_argument
+	/// @throw @c std::system_error
+	AudioUnitRecorder(AudioUnit au, CFURLRef outputFileURL, AudioFileTypeID fileType, const AudioStreamBasicDescription& format, UInt32 busNumber = 0, double bufferDuration = sDefaultBufferDuration);
+
+	/// Creates a new @c AudioUnitRecorder that asynchronously writes the output from several buses of an @c AudioUnit to files
+	/// @param au The @c AudioUnit to record
+	/// @param buses The buses to record
+	/// @param bufferDuration The duration of audio to buffer for each bus, in seconds
+	/// @throw @c std::invalid_argument
+	/// @throw @c std::system_error
+	AudioUnitRecorder(AudioUnit au, const std::vector<Bus>& buses, double bufferDuration = sDefaultBufferDuration);
 
 	/// Starts recording
-	void Start() {
-		if(mExtAudioFile.IsValid()) {
-			if(!mClientFormatIsSet) {
-				AudioStreamBasicDescription clientFormat;
-				UInt32 size = sizeof(clientFormat);
-				OSStatus result = AudioUnitGetProperty(mAudioUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, mBusNumber, &clientFormat, &size);
-				ThrowIfCAAudioUnitError(result, "AudioUnitGetProperty");
-				mExtAudioFile.SetClientDataFormat(clientFormat);
-				mClientFormatIsSet = true;
-			}
-			mExtAudioFile.WriteAsync(0, nullptr);
-			auto result = AudioUnitAddRenderNotify(mAudioUnit, RenderCallback, this);
-			ThrowIfCAAudioUnitError(result, "AudioUnitAddRenderNotify");
-		}
+	/// @throw @c std::system_error
+	/// @throw @c std::bad_alloc
+	void Start();
+
+	/// Stops recording and writes all buffered audio to the files
+	/// @throw @c std::system_error
+	void Stop();
+
+	/// Returns @c true if recording is in progress
+	inline bool IsRecording() const noexcept
+	{
+		return mIsRecording;
 	}
 
-	/// Stops recording
-	void Stop() {
-		if(mExtAudioFile.IsValid()) {
-			OSStatus result = AudioUnitRemoveRenderNotify(mAudioUnit, RenderCallback, this);
-			ThrowIfCAAudioUnitError(result, "AudioUnitRemoveRenderNotify");
-		}
+	/// Returns the number of buses being recorded
+	inline size_t BusCount() const noexcept
+	{
+		return mBuses.size();
 	}
 
+	/// Returns the statistics for the bus at @c index
+	/// @note This method is safe to call from any thread
+	BusStatistics Statistics(size_t index = 0) const noexcept;
+
+	/// Returns the telemetry recorded by the render notify for the bus at @c index
+	///
+	/// Durations are those of the copy into the ring buffer and fill levels are the number of buffered frames
+	/// following each copy.
+	/// @note All values are zero unless @c SFB_ENABLE_TELEMETRY is nonzero
+	/// @note This method is safe to call from any thread
+	TelemetryStatistics SampleTelemetry(size_t index = 0) const noexcept;
+
+	/// Resets the telemetry recorded by the render notify for the bus at @c index
+	/// @note This method is safe to call from any thread
+	void ResetTelemetry(size_t index = 0) noexcept;
+
 private:
 
-	/// Asynchronously writes rendered audio to the file
-	static OSStatus RenderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData)
+	/// The state of a recorded bus
+	struct BusState
 	{
-		AudioUnitRecorder *THIS = static_cast<AudioUnitRecorder *>(inRefCon);
-		if(*ioActionFlags & kAudioUnitRenderAction_PostRender) {
-			if(THIS->mBusNumber == inBusNumber && !(*ioActionFlags & kAudioUnitRenderAction_PostRenderError)) {
-				try {
-					THIS->mExtAudioFile.WriteAsync(inNumberFrames, ioData);
-				}
-				catch(const std::exception& e) {
-					os_log_debug(OS_LOG_DEFAULT, "Error writing frames: %{public}s", e.what());
-				}
-			}
-		}
-		return noErr;
-	}
+		/// The bus number of @c mAudioUnit to record
+		UInt32 mBusNumber;
+		/// The output file
+		CAExtAudioFile mExtAudioFile;
+		/// @c true if the @c ExtAudioFile client format is set
+		bool mClientFormatIsSet;
+		/// Rendered audio waiting to be written
+		AudioRingBuffer mRingBuffer;
+		/// Writer thread scratch space
+		CABufferList mWriteBuffer;
+		/// The number of overruns
+		std::atomic_uint64_t mOverruns;
+		/// The number of frames dropped by overruns
+		std::atomic_uint64_t mOverrunFrames;
+		/// The number of frames written to the file
+		std::atomic_uint64_t mFramesWritten;
+		/// The number of write errors
+		std::atomic_uint64_t mWriteErrors;
+		/// Telemetry recorded by the render notify
+		[[no_unique_address]] Telemetry mTelemetry;
+	};
+
+	/// Copies rendered audio to the ring buffer of the bus being recorded
+	static OSStatus RenderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData);
+
+	/// The writer thread's entry point
+	void WriterThreadEntry() noexcept;
+
+	/// Writes the buffered audio of each bus to its file
+	void DrainRingBuffers() noexcept;
 
-	/// The underlying @c ExtAudioFile
-	CAExtAudioFile mExtAudioFile;
-	/// @c true if the @c ExtAudioFile client format is set
-	bool mClientFormatIsSet;
 	/// The @c AudioUnit to record
 	AudioUnit mAudioUnit;
-	/// The bus number of @c mAudioUnit to record
-	UInt32 mBusNumber;
+	/// The duration of audio to buffer for each bus, in seconds
+	double mBufferDuration;
+	/// The buses to record
+	std::vector<std::unique_ptr<BusState>> mBuses;
+	/// @c true if recording is in progress
+	bool mIsRecording;
+
+	/// The semaphore used to wake the writer thread
+	DispatchSemaphore mWriterSemaphore;
+	/// @c true if the writer thread should exit
+	std::atomic_bool mStopWriting;
+	/// The writer thread
+	std::thread mWriterThread;
 
 };
 
@@ -7,17 +7,185 @@
 #pragma once
 
 #import <algorithm>
+#import <array>
+#import <bit>
+#import <cstdint>
+#import <cstring>
+#import <span>
 #import <stdexcept>
 #import <type_traits>
 
 namespace SFB {
 
+namespace detail {
+
+/// The class and member types of a pointer to a data member
+template <typename T>
+struct MemberPointer;
+
+/// The class and member types of a pointer to a data member
+template <typename C, typename M>
+struct MemberPointer<M C::*>
+{
+	/// The class containing the member
+	using Class = C;
+	/// The type of the member
+	using Type = M;
+};
+
+/// Assembles an integral value from @c sizeof(T) bytes in @c Order byte ordering
+template <typename T, std::endian Order>
+constexpr T DecodeInteger(const uint8_t * const _Nonnull bytes) noexcept
+{
+	if constexpr(sizeof(T) == 1)
+		return static_cast<T>(bytes[0]);
+	else {
+		using U = typename std::make_unsigned<T>::type;
+		U value = 0;
+		for(size_t i = 0; i < sizeof(T); ++i) {
+			const auto shift = Order == std::endian::little ? 8 * i : 8 * (sizeof(T) - 1 - i);
+			value |= static_cast<U>(static_cast<U>(bytes[i]) << shift);
+		}
+		return static_cast<T>(value);
+	}
+}
+
+/// Stores an integral value as @c sizeof(T) bytes in @c Order byte ordering
+template <typename T, std::endian Order>
+constexpr void EncodeInteger(T value, uint8_t * const _Nonnull bytes) noexcept
+{
+	if constexpr(sizeof(T) == 1)
+		bytes[0] = static_cast<uint8_t>(value);
+	else {
+		using U = typename std::make_unsigned<T>::type;
+		const auto bits = static_cast<U>(value);
+		for(size_t i = 0; i < sizeof(T); ++i) {
+			const auto shift = Order == std::endian::little ? 8 * i : 8 * (sizeof(T) - 1 - i);
+			bytes[i] = static_cast<uint8_t>(bits >> shift);
+		}
+	}
+}
+
+} // namespace detail
+
 /// A @c ByteStream provides heterogeneous typed access to an untyped buffer.
 class ByteStream
 {
 
 public:
 
+	/// A field of a packed structure stored in a @c ByteStream
+	///
+	/// Integral and enumeration members are decoded from @c sizeof(member) bytes in @c Order byte ordering. Arrays of
+	/// single-byte integral elements, such as four character codes, are copied verbatim.
+	/// @tparam Member A pointer to the structure member receiving the field
+	/// @tparam Order The byte ordering of the field in the stream
+	template <auto Member, std::endian Order = std::endian::native>
+	struct Field
+	{
+		/// The structure containing the member
+		using Class = typename detail::MemberPointer<decltype(Member)>::Class;
+		/// The type of the member
+		using Type = typename detail::MemberPointer<decltype(Member)>::Type;
+
+		static_assert(std::is_integral<Type>::value || std::is_enum<Type>::value || (std::is_array<Type>::value && std::rank<Type>::value == 1 && std::is_integral<typename std::remove_extent<Type>::type>::value && sizeof(typename std::remove_extent<Type>::type) == 1), "Unsupported field type");
+
+		/// The size of the field in bytes
+		static constexpr size_t sSize = sizeof(Type);
+
+		/// Decodes the field from @c bytes into @c value
+		static constexpr void Decode(const uint8_t * const _Nonnull bytes, Class& value) noexcept
+		{
+			if constexpr(std::is_array<Type>::value) {
+				for(size_t i = 0; i < sSize; ++i)
+					(value.*Member)[i] = static_cast<typename std::remove_extent<Type>::type>(bytes[i]);
+			}
+			else if constexpr(std::is_enum<Type>::value)
+				value.*Member = static_cast<Type>(detail::DecodeInteger<typename std::underlying_type<Type>::type, Order>(bytes));
+			else
+				value.*Member = detail::DecodeInteger<Type, Order>(bytes);
+		}
+
+		/// Encodes the field from @c value into @c bytes
+		static constexpr void Encode(const Class& value, uint8_t * const _Nonnull bytes) noexcept
+		{
+			if constexpr(std::is_array<Type>::value) {
+				for(size_t i = 0; i < sSize; ++i)
+					bytes[i] = static_cast<uint8_t>((value.*Member)[i]);
+			}
+			else if constexpr(std::is_enum<Type>::value)
+				detail::EncodeInteger<typename std::underlying_type<Type>::type, Order>(static_cast<typename std::underlying_type<Type>::type>(value.*Member), bytes);
+			else
+				detail::EncodeInteger<Type, Order>(value.*Member, bytes);
+		}
+	};
+
+	/// A little endian field of a packed structure stored in a @c ByteStream
+	template <auto Member>
+	using FieldLE = Field<Member, std::endian::little>;
+
+	/// A big endian field of a packed structure stored in a @c ByteStream
+	template <auto Member>
+	using FieldBE = Field<Member, std::endian::big>;
+
+	/// The layout of a packed structure stored in a @c ByteStream or written by a @c ByteStreamWriter
+	///
+	/// The fields are stored consecutively in the order given, without padding, regardless of the layout of @c T.
+	/// For example a RIFF chunk header could be described as
+	/// @code
+	/// struct ChunkHeader { char mID[4]; uint32_t mSize; };
+	/// using ChunkHeaderLayout = SFB::ByteStream::Layout<ChunkHeader, SFB::ByteStream::Field<&ChunkHeader::mID>, SFB::ByteStream::FieldLE<&ChunkHeader::mSize>>;
+	/// @endcode
+	/// @tparam T The structure type
+	/// @tparam Fields The fields of the structure
+	template <typename T, typename... Fields>
+	struct Layout
+	{
+		static_assert((std::is_same<typename Fields::Class, T>::value && ...), "Field is not a member of the structure");
+
+		/// The structure type
+		using Type = T;
+
+		/// The size of the structure in the stream in bytes
+		static constexpr size_t sSize = (Fields::sSize + ... + 0);
+
+		/// Decodes the structure from @c bytes into @c value
+		/// @param bytes A buffer containing at least @c sSize bytes
+		/// @param value The destination value
+		static constexpr void Decode(const uint8_t * const _Nonnull bytes, T& value) noexcept
+		{
+			size_t offset = 0;
+			((Fields::Decode(bytes + offset, value), offset += Fields::sSize), ...);
+		}
+
+		/// Decodes and returns the structure in @c bytes
+		/// @note This may be used in constant expressions if @c T is a literal type
+		static constexpr T Decode(std::span<const uint8_t, sSize> bytes) noexcept
+		{
+			T value{};
+			Decode(bytes.data(), value);
+			return value;
+		}
+
+		/// Encodes the structure from @c value into @c bytes
+		/// @param value The source value
+		/// @param bytes A buffer with space for at least @c sSize bytes
+		static constexpr void Encode(const T& value, uint8_t * const _Nonnull bytes) noexcept
+		{
+			size_t offset = 0;
+			((Fields::Encode(value, bytes + offset), offset += Fields::sSize), ...);
+		}
+
+		/// Encodes and returns the structure in @c value
+		/// @note This may be used in constant expressions if @c T is a literal type
+		static constexpr std::array<uint8_t, sSize> Encode(const T& value) noexcept
+		{
+			std::array<uint8_t, sSize> bytes{};
+			Encode(value, bytes.data());
+			return bytes;
+		}
+	};
+
 	/// Creates an empty @c ByteStream
 	ByteStream() noexcept
 	: mBuffer(nullptr), mBufferLength(0), mReadPosition(0)
@@ -237,6 +405,99 @@ public:
 		return bytesToCopy;
 	}
 
+	/// Returns a view of bytes in the buffer and advances the read position
+	/// @note No data is copied and the view remains valid only as long as the underlying buffer
+	/// @param count The number of bytes to view
+	/// @return A view of @c count bytes or an empty view if fewer than @c count bytes remain
+	std::span<const uint8_t> ReadSpan(size_t count) noexcept
+	{
+		if(count > Remaining())
+			return {};
+		std::span<const uint8_t> span(static_cast<const uint8_t *>(mBuffer) + mReadPosition, count);
+		mReadPosition += count;
+		return span;
+	}
+
+	/// Reads an array of trivially copyable values and advances the read position
+	/// @note The bounds are checked once for the entire array
+	/// @tparam T The trivially copyable type to read
+	/// @param values The destination buffer
+	/// @param count The number of values to read
+	/// @return @c true on success, @c false if fewer than @c count values remain
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type ReadArray(T * const _Nonnull values, size_t count) noexcept
+	{
+		if(count > Remaining() / sizeof(T))
+			return false;
+		if(count == 0)
+			return true;
+		std::memcpy(values, static_cast<const uint8_t *>(mBuffer) + mReadPosition, count * sizeof(T));
+		mReadPosition += count * sizeof(T);
+		return true;
+	}
+
+	/// Reads an array of unsigned little endian integral values converted to host byte ordering and advances the read position
+	/// @note The bounds are checked once for the entire array
+	/// @tparam T The unsigned integral type to read
+	/// @param values The destination buffer
+	/// @param count The number of values to read
+	/// @return @c true on success, @c false if fewer than @c count values remain
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type ReadArrayLE(T * const _Nonnull values, size_t count) noexcept
+	{
+		if(!ReadArray(values, count))
+			return false;
+		if constexpr(std::endian::native != std::endian::little)
+			SwapArray(values, count);
+		return true;
+	}
+
+	/// Reads an array of unsigned big endian integral values converted to host byte ordering and advances the read position
+	/// @note The bounds are checked once for the entire array
+	/// @tparam T The unsigned integral type to read
+	/// @param values The destination buffer
+	/// @param count The number of values to read
+	/// @return @c true on success, @c false if fewer than @c count values remain
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type ReadArrayBE(T * const _Nonnull values, size_t count) noexcept
+	{
+		if(!ReadArray(values, count))
+			return false;
+		if constexpr(std::endian::native != std::endian::big)
+			SwapArray(values, count);
+		return true;
+	}
+
+	/// Reads an array of unsigned integral values, swaps their byte ordering, and advances the read position
+	/// @note The bounds are checked once for the entire array
+	/// @tparam T The unsigned integral type to read
+	/// @param values The destination buffer
+	/// @param count The number of values to read
+	/// @return @c true on success, @c false if fewer than @c count values remain
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type ReadArraySwapped(T * const _Nonnull values, size_t count) noexcept
+	{
+		if(!ReadArray(values, count))
+			return false;
+		SwapArray(values, count);
+		return true;
+	}
+
+	/// Reads a packed structure described by a @c Layout and advances the read position
+	/// @note The bounds are checked once for the entire structure
+	/// @tparam L The @c Layout describing the structure
+	/// @param value The destination value
+	/// @return @c true on success, @c false if fewer than @c L::sSize bytes remain
+	template <typename L>
+	bool ReadStruct(typename L::Type& value) noexcept
+	{
+		if(L::sSize > Remaining())
+			return false;
+		L::Decode(static_cast<const uint8_t *>(mBuffer) + mReadPosition, value);
+		mReadPosition += L::sSize;
+		return true;
+	}
+
 	/// Advances the read position
 	/// @param count The number of bytes to skip
 	/// @return The number of bytes actually skipped
@@ -288,6 +549,21 @@ public:
 
 private:
 
+	/// Swaps the byte ordering of an array of unsigned integral values in place
+	template <typename T>
+	static void SwapArray(T * const _Nonnull values, size_t count) noexcept
+	{
+		// Selecting the swap at compile time leaves a loop the compiler can vectorize
+		for(size_t i = 0; i < count; ++i) {
+			if constexpr(sizeof(T) == 2)
+				values[i] = static_cast<T>(OSSwapInt16(static_cast<uint16_t>(values[i])));
+			else if constexpr(sizeof(T) == 4)
+				values[i] = static_cast<T>(OSSwapInt32(static_cast<uint32_t>(values[i])));
+			else if constexpr(sizeof(T) == 8)
+				values[i] = static_cast<T>(OSSwapInt64(static_cast<uint64_t>(values[i])));
+		}
+	}
+
 	/// The wrapped buffer
 	const void * _Nullable mBuffer;
 	/// The number of bytes in @c mBuffer
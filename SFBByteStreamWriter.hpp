@@ -0,0 +1,416 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <algorithm>
+#import <bit>
+#import <cstdint>
+#import <cstdlib>
+#import <cstring>
+#import <limits>
+#import <new>
+#import <span>
+#import <stdexcept>
+#import <type_traits>
+
+#import "SFBByteStream.hpp"
+
+namespace SFB {
+
+/// A @c ByteStreamWriter provides heterogeneous typed writing to an untyped buffer.
+///
+/// The buffer is either owned by the writer and grown as needed or provided by the caller and never reallocated.
+/// Owned storage grows geometrically, so reserving the expected size up front avoids reallocation entirely.
+///
+/// The bytes written are available from @c Data() and @c Length() and may be passed directly to functions such as
+/// @c CAAudioFile::WriteBytes() or @c CAAudioFile::SetUserData() without copying.
+class ByteStreamWriter
+{
+
+public:
+
+	/// Creates an empty @c ByteStreamWriter that allocates storage as needed
+	ByteStreamWriter() noexcept
+	: mBuffer(nullptr), mCapacity(0), mLength(0), mWritePosition(0), mOwnsBuffer(true)
+	{}
+
+	/// Creates a @c ByteStreamWriter with owned storage for @c capacity bytes
+	/// @param capacity The initial capacity in bytes
+	/// @throw @c std::bad_alloc
+	explicit ByteStreamWriter(size_t capacity)
+	: ByteStreamWriter()
+	{
+		if(!Reserve(capacity))
+			throw std::bad_alloc();
+	}
+
+	/// Creates a @c ByteStreamWriter writing to a caller-provided buffer
+	/// @note The buffer is never reallocated and writes fail once it is full
+	/// @param buf The buffer receiving the data
+	/// @param capacity The length of @c buf in bytes
+	/// @throw @c std::invalid_argument if @c buf==nullptr and @c capacity>0
+	ByteStreamWriter(void * const _Nullable buf, size_t capacity)
+	: mBuffer(static_cast<uint8_t *>(buf)), mCapacity(capacity), mLength(0), mWritePosition(0), mOwnsBuffer(false)
+	{
+		if(!mBuffer && capacity > 0)
+			throw std::invalid_argument("!mBuffer && capacity > 0");
+	}
+
+	// This class is non-copyable
+	ByteStreamWriter(const ByteStreamWriter& rhs) = delete;
+
+	// This class is non-assignable
+	ByteStreamWriter& operator=(const ByteStreamWriter& rhs) = delete;
+
+	/// Destructor
+	~ByteStreamWriter()
+	{
+		if(mOwnsBuffer)
+			std::free(mBuffer);
+	}
+
+	/// Move constructor
+	ByteStreamWriter(ByteStreamWriter&& rhs) noexcept
+	: mBuffer(rhs.mBuffer), mCapacity(rhs.mCapacity), mLength(rhs.mLength), mWritePosition(rhs.mWritePosition), mOwnsBuffer(rhs.mOwnsBuffer)
+	{
+		rhs.mBuffer = nullptr;
+		rhs.mCapacity = 0;
+		rhs.mLength = 0;
+		rhs.mWritePosition = 0;
+		rhs.mOwnsBuffer = true;
+	}
+
+	/// Move assignment operator
+	ByteStreamWriter& operator=(ByteStreamWriter&& rhs) noexcept
+	{
+		if(this != &rhs) {
+			if(mOwnsBuffer)
+				std::free(mBuffer);
+
+			mBuffer = rhs.mBuffer;
+			mCapacity = rhs.mCapacity;
+			mLength = rhs.mLength;
+			mWritePosition = rhs.mWritePosition;
+			mOwnsBuffer = rhs.mOwnsBuffer;
+
+			rhs.mBuffer = nullptr;
+			rhs.mCapacity = 0;
+			rhs.mLength = 0;
+			rhs.mWritePosition = 0;
+			rhs.mOwnsBuffer = true;
+		}
+		return *this;
+	}
+
+
+	/// Writes an integral type and advances the write position
+	/// @tparam T The integral type to write
+	/// @param value The value to write
+	/// @return @c true on success, @c false otherwise
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, bool>::type Write(T value) noexcept
+	{
+		auto valueSize = sizeof(value);
+		if(!Ensure(valueSize))
+			return false;
+		auto bytesWritten = Write(&value, valueSize);
+		return bytesWritten == valueSize;
+	}
+
+	/// Writes an unsigned integral type in little endian byte ordering and advances the write position
+	/// @tparam T The unsigned integral type to write
+	/// @param value The value to write in host byte ordering
+	/// @return @c true on success, @c false otherwise
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteLE(T value) noexcept
+	{
+		if constexpr(sizeof(T) == 2)
+			value = static_cast<T>(OSSwapHostToLittleInt16(static_cast<uint16_t>(value)));
+		else if constexpr(sizeof(T) == 4)
+			value = static_cast<T>(OSSwapHostToLittleInt32(static_cast<uint32_t>(value)));
+		else if constexpr(sizeof(T) == 8)
+			value = static_cast<T>(OSSwapHostToLittleInt64(static_cast<uint64_t>(value)));
+
+		return Write(value);
+	}
+
+	/// Writes an unsigned integral type in big endian byte ordering and advances the write position
+	/// @tparam T The unsigned integral type to write
+	/// @param value The value to write in host byte ordering
+	/// @return @c true on success, @c false otherwise
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteBE(T value) noexcept
+	{
+		if constexpr(sizeof(T) == 2)
+			value = static_cast<T>(OSSwapHostToBigInt16(static_cast<uint16_t>(value)));
+		else if constexpr(sizeof(T) == 4)
+			value = static_cast<T>(OSSwapHostToBigInt32(static_cast<uint32_t>(value)));
+		else if constexpr(sizeof(T) == 8)
+			value = static_cast<T>(OSSwapHostToBigInt64(static_cast<uint64_t>(value)));
+
+		return Write(value);
+	}
+
+	/// Swaps the byte ordering of an unsigned integral type, writes it, and advances the write position
+	/// @tparam T The unsigned integral type to write
+	/// @param value The value to write
+	/// @return @c true on success, @c false otherwise
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteSwapped(T value) noexcept
+	{
+		if constexpr(sizeof(T) == 2)
+			value = static_cast<T>(OSSwapInt16(static_cast<uint16_t>(value)));
+		else if constexpr(sizeof(T) == 4)
+			value = static_cast<T>(OSSwapInt32(static_cast<uint32_t>(value)));
+		else if constexpr(sizeof(T) == 8)
+			value = static_cast<T>(OSSwapInt64(static_cast<uint64_t>(value)));
+
+		return Write(value);
+	}
+
+	/// Writes bytes and advances the write position
+	/// @note Writes to a caller-provided buffer are truncated when the buffer is full
+	/// @param buf The source buffer or @c nullptr to write zeroes
+	/// @param count The number of bytes to write
+	/// @return The number of bytes actually written
+	size_t Write(const void * const _Nullable buf, size_t count) noexcept
+	{
+		if(mOwnsBuffer && !Ensure(count))
+			return 0;
+		auto bytesToCopy = std::min(count, mCapacity - mWritePosition);
+		if(bytesToCopy > 0) {
+			if(buf)
+				std::memcpy(mBuffer + mWritePosition, buf, bytesToCopy);
+			else
+				std::memset(mBuffer + mWritePosition, 0, bytesToCopy);
+		}
+		Advance(bytesToCopy);
+		return bytesToCopy;
+	}
+
+	/// Returns a writable view of bytes in the buffer and advances the write position
+	///
+	/// This allows data to be generated in place instead of being copied into the buffer.
+	/// @note The view is invalidated if owned storage is later reallocated
+	/// @param count The number of bytes to reserve
+	/// @return A view of @c count bytes or an empty view if the space is not available
+	std::span<uint8_t> WriteSpan(size_t count) noexcept
+	{
+		if(!Ensure(count))
+			return {};
+		std::span<uint8_t> span(mBuffer + mWritePosition, count);
+		Advance(count);
+		return span;
+	}
+
+	/// Writes an array of trivially copyable values and advances the write position
+	/// @note The space is checked once for the entire array
+	/// @tparam T The trivially copyable type to write
+	/// @param values The values to write
+	/// @param count The number of values to write
+	/// @return @c true on success, @c false if the space is not available
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type WriteArray(const T * const _Nonnull values, size_t count) noexcept
+	{
+		if(count > std::numeric_limits<size_t>::max() / sizeof(T) || !Ensure(count * sizeof(T)))
+			return false;
+		if(count > 0)
+			std::memcpy(mBuffer + mWritePosition, values, count * sizeof(T));
+		Advance(count * sizeof(T));
+		return true;
+	}
+
+	/// Writes an array of unsigned integral values in little endian byte ordering and advances the write position
+	/// @note The space is checked once for the entire array
+	/// @tparam T The unsigned integral type to write
+	/// @param values The values to write in host byte ordering
+	/// @param count The number of values to write
+	/// @return @c true on success, @c false if the space is not available
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteArrayLE(const T * const _Nonnull values, size_t count) noexcept
+	{
+		if constexpr(std::endian::native == std::endian::little)
+			return WriteArray(values, count);
+		else
+			return WriteArraySwapped(values, count);
+	}
+
+	/// Writes an array of unsigned integral values in big endian byte ordering and advances the write position
+	/// @note The space is checked once for the entire array
+	/// @tparam T The unsigned integral type to write
+	/// @param values The values to write in host byte ordering
+	/// @param count The number of values to write
+	/// @return @c true on success, @c false if the space is not available
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteArrayBE(const T * const _Nonnull values, size_t count) noexcept
+	{
+		if constexpr(std::endian::native == std::endian::big)
+			return WriteArray(values, count);
+		else
+			return WriteArraySwapped(values, count);
+	}
+
+	/// Swaps the byte ordering of an array of unsigned integral values, writes them, and advances the write position
+	/// @note The space is checked once for the entire array
+	/// @tparam T The unsigned integral type to write
+	/// @param values The values to write
+	/// @param count The number of values to write
+	/// @return @c true on success, @c false if the space is not available
+	template <typename T>
+	typename std::enable_if<std::is_unsigned<T>::value, bool>::type WriteArraySwapped(const T * const _Nonnull values, size_t count) noexcept
+	{
+		if(count > std::numeric_limits<size_t>::max() / sizeof(T) || !Ensure(count * sizeof(T)))
+			return false;
+
+		// Selecting the swap at compile time leaves a loop the compiler can vectorize
+		auto dest = mBuffer + mWritePosition;
+		for(size_t i = 0; i < count; ++i) {
+			T value = values[i];
+			if constexpr(sizeof(T) == 2)
+				value = static_cast<T>(OSSwapInt16(static_cast<uint16_t>(value)));
+			else if constexpr(sizeof(T) == 4)
+				value = static_cast<T>(OSSwapInt32(static_cast<uint32_t>(value)));
+			else if constexpr(sizeof(T) == 8)
+				value = static_cast<T>(OSSwapInt64(static_cast<uint64_t>(value)));
+			std::memcpy(dest + i * sizeof(T), &value, sizeof(T));
+		}
+
+		Advance(count * sizeof(T));
+		return true;
+	}
+
+	/// Writes a packed structure described by a @c ByteStream::Layout and advances the write position
+	/// @note The space is checked once for the entire structure
+	/// @tparam L The @c ByteStream::Layout describing the structure
+	/// @param value The value to write
+	/// @return @c true on success, @c false if the space is not available
+	template <typename L>
+	bool WriteStruct(const typename L::Type& value) noexcept
+	{
+		if(!Ensure(L::sSize))
+			return false;
+		L::Encode(value, mBuffer + mWritePosition);
+		Advance(L::sSize);
+		return true;
+	}
+
+	/// Ensures the buffer can hold at least @c capacity bytes without reallocating
+	/// @param capacity The desired capacity in bytes
+	/// @return @c true on success, @c false if the storage could not be allocated or the buffer was provided by the caller and is too small
+	bool Reserve(size_t capacity) noexcept
+	{
+		if(capacity <= mCapacity)
+			return true;
+		if(!mOwnsBuffer)
+			return false;
+		auto buffer = static_cast<uint8_t *>(std::realloc(mBuffer, capacity));
+		if(!buffer)
+			return false;
+		mBuffer = buffer;
+		mCapacity = capacity;
+		return true;
+	}
+
+	/// Discards the bytes written and sets the write position to @c 0
+	/// @note The storage is retained
+	void Reset() noexcept
+	{
+		mLength = 0;
+		mWritePosition = 0;
+	}
+
+	/// Returns the bytes written
+	inline const void * _Nullable Data() const noexcept
+	{
+		return mBuffer;
+	}
+
+	/// Returns the bytes written
+	inline std::span<const uint8_t> Bytes() const noexcept
+	{
+		return { mBuffer, mLength };
+	}
+
+	/// Returns a @c ByteStream reading the bytes written
+	inline ByteStream Reader() const noexcept
+	{
+		return { mBuffer, mLength };
+	}
+
+	/// Returns the number of bytes written
+	/// @note This is the furthest extent of any write, regardless of the write position
+	inline size_t Length() const noexcept
+	{
+		return mLength;
+	}
+
+	/// Returns the capacity of the buffer in bytes
+	inline size_t Capacity() const noexcept
+	{
+		return mCapacity;
+	}
+
+	/// Returns @c true if the buffer is owned by the writer
+	inline bool OwnsBuffer() const noexcept
+	{
+		return mOwnsBuffer;
+	}
+
+	/// Returns the write position
+	inline size_t Position() const noexcept
+	{
+		return mWritePosition;
+	}
+
+	/// Sets the write position
+	///
+	/// Moving the write position backward allows fields such as chunk sizes to be patched after the data they describe is written.
+	/// @param pos The desired write position
+	/// @return @c true on success, @c false if @c pos is past the number of bytes written
+	inline bool SetPosition(size_t pos) noexcept
+	{
+		if(pos > mLength)
+			return false;
+		mWritePosition = pos;
+		return true;
+	}
+
+private:
+
+	/// Ensures @c count bytes may be written at the write position, growing owned storage geometrically if necessary
+	bool Ensure(size_t count) noexcept
+	{
+		if(count <= mCapacity - mWritePosition)
+			return true;
+		if(!mOwnsBuffer || count > std::numeric_limits<size_t>::max() - mWritePosition)
+			return false;
+		const auto required = mWritePosition + count;
+		const auto grown = mCapacity > std::numeric_limits<size_t>::max() / 2 ? required : mCapacity * 2;
+		return Reserve(std::max(required, grown));
+	}
+
+	/// Advances the write position by @c count bytes and updates the length
+	void Advance(size_t count) noexcept
+	{
+		mWritePosition += count;
+		mLength = std::max(mLength, mWritePosition);
+	}
+
+	/// The buffer receiving the data
+	uint8_t * _Nullable mBuffer;
+	/// The number of bytes in @c mBuffer
+	size_t mCapacity;
+	/// The number of bytes written
+	size_t mLength;
+	/// The current write position
+	size_t mWritePosition;
+	/// Whether @c mBuffer is owned by the writer
+	bool mOwnsBuffer;
+
+};
+
+} // namespace SFB
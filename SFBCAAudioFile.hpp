@@ -264,6 +264,56 @@ public:
 		return fileDataFormat;
 	}
 
+	/// Returns the byte offset of the audio data in the file (@c kAudioFilePropertyDataOffset)
+	/// @throw @c std::system_error
+	SInt64 DataOffset() const
+	{
+		SInt64 dataOffset;
+		UInt32 size = sizeof(dataOffset);
+		GetProperty(kAudioFilePropertyDataOffset, size, &dataOffset);
+		return dataOffset;
+	}
+
+	/// Returns the number of bytes of audio data in the file (@c kAudioFilePropertyAudioDataByteCount)
+	/// @throw @c std::system_error
+	UInt64 AudioDataByteCount() const
+	{
+		UInt64 byteCount;
+		UInt32 size = sizeof(byteCount);
+		GetProperty(kAudioFilePropertyAudioDataByteCount, size, &byteCount);
+		return byteCount;
+	}
+
+	/// Returns the number of packets of audio data in the file (@c kAudioFilePropertyAudioDataPacketCount)
+	/// @throw @c std::system_error
+	UInt64 AudioDataPacketCount() const
+	{
+		UInt64 packetCount;
+		UInt32 size = sizeof(packetCount);
+		GetProperty(kAudioFilePropertyAudioDataPacketCount, size, &packetCount);
+		return packetCount;
+	}
+
+	/// Returns the size of the largest packet of audio data in the file (@c kAudioFilePropertyMaximumPacketSize)
+	/// @throw @c std::system_error
+	UInt32 MaximumPacketSize() const
+	{
+		UInt32 maximumPacketSize;
+		UInt32 size = sizeof(maximumPacketSize);
+		GetProperty(kAudioFilePropertyMaximumPacketSize, size, &maximumPacketSize);
+		return maximumPacketSize;
+	}
+
+	/// Returns the file's priming and remainder frames (@c kAudioFilePropertyPacketTableInfo)
+	/// @throw @c std::system_error
+	AudioFilePacketTableInfo PacketTableInfo() const
+	{
+		AudioFilePacketTableInfo packetTableInfo;
+		UInt32 size = sizeof(packetTableInfo);
+		GetProperty(kAudioFilePropertyPacketTableInfo, size, &packetTableInfo);
+		return packetTableInfo;
+	}
+
 #pragma mark Global Properties
 
 	/// Gets the size of a global audio file property.
@@ -10,6 +10,55 @@
 #import <new>
 
 #import "SFBCABufferList.hpp"
+#import "SFBCABufferListPool.hpp"
+#import "SFBAudioSampleConversion.hpp"
+
+namespace {
+
+/// Returns the size in bytes of the @c AudioBufferList header and channel buffer pointers, rounded up to the alignment of @c policy
+size_t AudioBufferListHeaderSize(const SFB::CAStreamBasicDescription& format, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * format.ChannelStreamCount()), policy);
+}
+
+/// Returns the distance in bytes between consecutive channel buffers
+size_t ChannelBufferStride(const SFB::CAStreamBasicDescription& format, UInt32 frameCapacity, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(format.FrameCountToByteSize(frameCapacity) + policy.mChannelPadding, policy);
+}
+
+/// Returns the size in bytes of an @c AudioBufferList allocated in a single allocation using @c policy
+size_t AudioBufferListAllocationSize(const SFB::CAStreamBasicDescription& format, UInt32 frameCapacity, const SFB::AllocationPolicy& policy) noexcept
+{
+	return AudioBufferListHeaderSize(format, policy) + (ChannelBufferStride(format, frameCapacity, policy) * format.ChannelStreamCount());
+}
+
+/// Allocates and returns a new @c AudioBufferList in a single allocation using @c policy
+AudioBufferList * _Nullable AllocateAudioBufferListWithPolicy(const SFB::CAStreamBasicDescription& format, UInt32 frameCapacity, const SFB::AllocationPolicy& policy) noexcept
+{
+	if(format.mBytesPerFrame == 0 || frameCapacity > (std::numeric_limits<UInt32>::max() / format.mBytesPerFrame))
+		return nullptr;
+
+	// The allocation is zero-filled
+	auto abl = static_cast<AudioBufferList *>(SFB::AllocateMemory(AudioBufferListAllocationSize(format, frameCapacity, policy), policy));
+	if(!abl)
+		return nullptr;
+
+	const auto headerSize = AudioBufferListHeaderSize(format, policy);
+	const auto channelStride = ChannelBufferStride(format, frameCapacity, policy);
+
+	abl->mNumberBuffers = format.ChannelStreamCount();
+
+	for(UInt32 i = 0; i < abl->mNumberBuffers; ++i) {
+		abl->mBuffers[i].mNumberChannels = format.InterleavedChannelCount();
+		abl->mBuffers[i].mData = reinterpret_cast<uint8_t *>(abl) + headerSize + (channelStride * i);
+		abl->mBuffers[i].mDataByteSize = format.FrameCountToByteSize(frameCapacity);
+	}
+
+	return abl;
+}
+
+} // namespace
 
 AudioBufferList * SFB::AllocateAudioBufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity) noexcept
 {
@@ -39,21 +88,24 @@ AudioBufferList * SFB::AllocateAudioBufferList(const CAStreamBasicDescription& f
 }
 
 SFB::CABufferList::CABufferList() noexcept
-: mBufferList(nullptr), mFrameCapacity(0), mFrameLength(0)
+: mBufferList(nullptr), mFrameCapacity(0), mHeadroom(0), mFrameLength(0), mPool(nullptr)
 {}
 
 SFB::CABufferList::~CABufferList()
 {
-	std::free(mBufferList);
+	FreeABL();
 }
 
 SFB::CABufferList::CABufferList(CABufferList&& rhs) noexcept
-: mBufferList(rhs.mBufferList), mFormat(rhs.mFormat), mFrameCapacity(rhs.mFrameCapacity), mFrameLength(rhs.mFrameLength)
+: mBufferList(rhs.mBufferList), mFormat(rhs.mFormat), mFrameCapacity(rhs.mFrameCapacity), mHeadroom(rhs.mHeadroom), mFrameLength(rhs.mFrameLength), mPool(rhs.mPool), mAllocationPolicy(rhs.mAllocationPolicy)
 {
 	rhs.mBufferList = nullptr;
 	rhs.mFormat.Reset();
 	rhs.mFrameCapacity = 0;
+	rhs.mHeadroom = 0;
 	rhs.mFrameLength = 0;
+	rhs.mPool = nullptr;
+	rhs.mAllocationPolicy = {};
 }
 
 SFB::CABufferList& SFB::CABufferList::operator=(CABufferList&& rhs) noexcept
@@ -64,40 +116,48 @@ SFB::CABufferList& SFB::CABufferList::operator=(CABufferList&& rhs) noexcept
 		mBufferList = rhs.mBufferList;
 		mFormat = rhs.mFormat;
 		mFrameCapacity = rhs.mFrameCapacity;
+		mHeadroom = rhs.mHeadroom;
 		mFrameLength = rhs.mFrameLength;
+		mPool = rhs.mPool;
+		mAllocationPolicy = rhs.mAllocationPolicy;
 
 		rhs.mBufferList = nullptr;
 		rhs.mFormat.Reset();
 		rhs.mFrameCapacity = 0;
+		rhs.mHeadroom = 0;
 		rhs.mFrameLength = 0;
+		rhs.mPool = nullptr;
+		rhs.mAllocationPolicy = {};
 	}
 
 	return *this;
 }
 
-SFB::CABufferList::CABufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity)
+SFB::CABufferList::CABufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity, const AllocationPolicy& policy)
 : CABufferList()
 {
 	if(format.mBytesPerFrame == 0)
 		throw std::invalid_argument("format.mBytesPerFrame == 0");
-	if(!Allocate(format, frameCapacity))
+	if(!Allocate(format, frameCapacity, policy))
 		throw std::bad_alloc();
 }
 
 #pragma mark Buffer Management
 
-bool SFB::CABufferList::Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity) noexcept
+bool SFB::CABufferList::Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity, const AllocationPolicy& policy) noexcept
 {
 	if(mBufferList)
 		Deallocate();
 
-	mBufferList = AllocateAudioBufferList(format, frameCapacity);
+	mBufferList = AllocateAudioBufferListWithPolicy(format, frameCapacity, policy);
 	if(!mBufferList)
 		return false;
 
 	mFormat = format;
 	mFrameCapacity = frameCapacity;
+	mHeadroom = 0;
 	mFrameLength = 0;
+	mAllocationPolicy = policy;
 
 	return true;
 }
@@ -105,12 +165,15 @@ bool SFB::CABufferList::Allocate(const CAStreamBasicDescription& format, UInt32
 void SFB::CABufferList::Deallocate() noexcept
 {
 	if(mBufferList) {
-		std::free(mBufferList);
+		FreeABL();
 		mBufferList = nullptr;
+		mPool = nullptr;
+		mAllocationPolicy = {};
 
 		mFormat.Reset();
 
 		mFrameCapacity = 0;
+		mHeadroom = 0;
 		mFrameLength = 0;
 	}
 }
@@ -120,8 +183,16 @@ bool SFB::CABufferList::SetFrameLength(UInt32 frameLength) noexcept
 	if(!mBufferList || frameLength > mFrameCapacity)
 		return false;
 
+	// The headroom is reclaimed only if the frames don't fit following the first valid frame
+	if(frameLength > mFrameCapacity - mHeadroom)
+		Compact();
+
 	mFrameLength = frameLength;
 
+	// An empty buffer needs no headroom
+	if(mFrameLength == 0)
+		SetHeadroom(0);
+
 	for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i)
 		mBufferList->mBuffers[i].mDataByteSize = mFrameLength * mFormat.mBytesPerFrame;
 
@@ -140,14 +211,53 @@ bool SFB::CABufferList::InferFrameLengthFromABL()
 	}
 
 	auto frameLength = buffer0ByteSize / mFormat.mBytesPerFrame;
-	if(frameLength > mFrameCapacity)
-		throw std::logic_error("mBufferList->mBuffers[0].mBytesPerFrame / mFormat.mBytesPerFrame > mFrameCapacity");
+	if(frameLength > mFrameCapacity - mHeadroom)
+		throw std::logic_error("mBufferList->mBuffers[0].mBytesPerFrame / mFormat.mBytesPerFrame > FrameCapacity() - Headroom()");
 
 	mFrameLength = frameLength;
 
+	if(mFrameLength == 0)
+		SetHeadroom(0);
+
+	return true;
+}
+
+bool SFB::CABufferList::ReserveHeadroom(UInt32 frameCount) noexcept
+{
+	if(!mBufferList || frameCount > mFrameCapacity - mFrameLength)
+		return false;
+
+	if(frameCount <= mHeadroom)
+		return true;
+
+	const auto moveBy = frameCount - mHeadroom;
+	if(mFrameLength) {
+		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+			auto data = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData);
+			std::memmove(data + (moveBy * mFormat.mBytesPerFrame), data, mFrameLength * mFormat.mBytesPerFrame);
+		}
+	}
+
+	SetHeadroom(frameCount);
+
 	return true;
 }
 
+void SFB::CABufferList::Compact() noexcept
+{
+	if(!mBufferList || mHeadroom == 0)
+		return;
+
+	if(mFrameLength) {
+		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+			auto data = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData);
+			std::memmove(data - (mHeadroom * mFormat.mBytesPerFrame), data, mFrameLength * mFormat.mBytesPerFrame);
+		}
+	}
+
+	SetHeadroom(0);
+}
+
 #pragma mark Buffer Utilities
 
 UInt32 SFB::CABufferList::InsertFromBuffer(const CABufferList& buffer, UInt32 readOffset, UInt32 frameLength, UInt32 writeOffset) noexcept
@@ -161,24 +271,14 @@ UInt32 SFB::CABufferList::InsertFromBuffer(const CABufferList& buffer, UInt32 re
 
 	auto framesToInsert = std::min(mFrameCapacity - mFrameLength, std::min(frameLength, buffer.mFrameLength - readOffset));
 
-	auto framesToMove = mFrameLength - writeOffset;
-	if(framesToMove) {
-		auto moveToOffset = writeOffset + framesToInsert;
-		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
-			auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (moveToOffset * mFormat.mBytesPerFrame);
-			const auto src = static_cast<const uint8_t *>(mBufferList->mBuffers[i].mData) + (writeOffset * mFormat.mBytesPerFrame);
-			std::memmove(dst, src, framesToMove * mFormat.mBytesPerFrame);
-		}
-	}
-
 	if(framesToInsert) {
+		OpenGap(writeOffset, framesToInsert);
+
 		for(UInt32 i = 0; i < buffer.mBufferList->mNumberBuffers; ++i) {
 			auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (writeOffset * mFormat.mBytesPerFrame);
 			const auto src = static_cast<const uint8_t *>(buffer.mBufferList->mBuffers[i].mData) + (readOffset * mFormat.mBytesPerFrame);
 			std::memcpy(dst, src, framesToInsert * mFormat.mBytesPerFrame);
 		}
-
-		SetFrameLength(mFrameLength + framesToInsert);
 	}
 
 	return framesToInsert;
@@ -190,9 +290,23 @@ UInt32 SFB::CABufferList::TrimAtOffset(UInt32 offset, UInt32 frameLength) noexce
 		return 0;
 
 	auto framesToTrim = std::min(frameLength, mFrameLength - offset);
+	if(framesToTrim == 0)
+		return 0;
 
 	auto framesToMove = mFrameLength - (offset + framesToTrim);
-	if(framesToMove) {
+
+	// Move the frames preceding the trimmed frames forward if there are fewer of them
+	if(offset <= framesToMove) {
+		if(offset) {
+			for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+				auto src = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData);
+				std::memmove(src + (framesToTrim * mFormat.mBytesPerFrame), src, offset * mFormat.mBytesPerFrame);
+			}
+		}
+
+		SetHeadroom(mHeadroom + framesToTrim);
+	}
+	else {
 		auto moveFromOffset = offset + framesToTrim;
 		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
 			auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (offset * mFormat.mBytesPerFrame);
@@ -217,30 +331,41 @@ UInt32 SFB::CABufferList::InsertSilence(UInt32 offset, UInt32 frameLength) noexc
 
 	auto framesToZero = std::min(mFrameCapacity - mFrameLength, frameLength);
 
-	auto framesToMove = mFrameLength - offset;
-	if(framesToMove) {
-		auto moveToOffset = offset + framesToZero;
-		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
-			auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (moveToOffset * mFormat.mBytesPerFrame);
-			const auto src = static_cast<const uint8_t *>(mBufferList->mBuffers[i].mData) + (offset * mFormat.mBytesPerFrame);
-			std::memmove(dst, src, framesToMove * mFormat.mBytesPerFrame);
-		}
-	}
-
 	if(framesToZero) {
+		OpenGap(offset, framesToZero);
+
 		// For floating-point numbers this code is non-portable: the C standard doesn't require IEEE 754 compliance
 		// However, setting all bits to 0 using memset() on macOS results in a floating-point value of 0
 		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
 			auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (offset * mFormat.mBytesPerFrame);
 			std::memset(dst, 0, framesToZero * mFormat.mBytesPerFrame);
 		}
-
-		SetFrameLength(mFrameLength + framesToZero);
 	}
 
 	return framesToZero;
 }
 
+#pragma mark Format Conversion
+
+UInt32 SFB::CABufferList::ConvertFromBuffer(const CABufferList& buffer) noexcept
+{
+	if(!mBufferList || !buffer.mBufferList)
+		return 0;
+
+	const auto framesToConvert = std::min(buffer.mFrameLength, mFrameCapacity);
+
+	// The converted frames replace the valid frames so there is no need to move them to release the headroom
+	if(framesToConvert > mFrameCapacity - mHeadroom)
+		Clear();
+
+	if(!AudioSampleConversion::Convert(buffer.mBufferList, buffer.mFormat, mBufferList, mFormat, framesToConvert))
+		return 0;
+
+	SetFrameLength(framesToConvert);
+
+	return framesToConvert;
+}
+
 bool SFB::CABufferList::AdoptABL(AudioBufferList *bufferList, const AudioStreamBasicDescription& format, UInt32 frameCapacity, UInt32 frameLength) noexcept
 {
 	if(!bufferList || frameLength > frameCapacity)
@@ -258,12 +383,77 @@ bool SFB::CABufferList::AdoptABL(AudioBufferList *bufferList, const AudioStreamB
 
 AudioBufferList * SFB::CABufferList::RelinquishABL() noexcept
 {
+	if(mPool)
+		return nullptr;
+
+	// The caller expects the channel buffers to start at their storage
+	Compact();
+
+	if(mBufferList)
+		UnprepareMemory(mBufferList, AudioBufferListAllocationSize(mFormat, mFrameCapacity, mAllocationPolicy), mAllocationPolicy);
+
 	auto bufferList = mBufferList;
 
 	mBufferList = nullptr;
 	mFormat.Reset();
 	mFrameCapacity = 0;
+	mHeadroom = 0;
 	mFrameLength = 0;
+	mAllocationPolicy = {};
 
 	return bufferList;
 }
+
+void SFB::CABufferList::FreeABL() noexcept
+{
+	if(mPool)
+		mPool->Release(mBufferList);
+	else
+		DeallocateMemory(mBufferList, AudioBufferListAllocationSize(mFormat, mFrameCapacity, mAllocationPolicy), mAllocationPolicy);
+}
+
+void SFB::CABufferList::SetHeadroom(UInt32 headroom) noexcept
+{
+	if(!mBufferList || headroom == mHeadroom)
+		return;
+
+	// The byte sizes are also set since they may describe the entire capacity
+	const auto delta = (static_cast<ptrdiff_t>(headroom) - static_cast<ptrdiff_t>(mHeadroom)) * static_cast<ptrdiff_t>(mFormat.mBytesPerFrame);
+	for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+		mBufferList->mBuffers[i].mData = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + delta;
+		mBufferList->mBuffers[i].mDataByteSize = mFrameLength * mFormat.mBytesPerFrame;
+	}
+
+	mHeadroom = headroom;
+}
+
+void SFB::CABufferList::OpenGap(UInt32 offset, UInt32 frameCount) noexcept
+{
+	const auto framesAfter = mFrameLength - offset;
+	const auto framesFollowingCapacity = mFrameCapacity - mHeadroom - mFrameLength;
+
+	// Move the frames preceding the gap into the headroom if there are fewer of them or if there is insufficient space following the buffer
+	if(frameCount <= mHeadroom && (offset <= framesAfter || frameCount > framesFollowingCapacity)) {
+		SetHeadroom(mHeadroom - frameCount);
+		if(offset) {
+			for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+				auto dst = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData);
+				std::memmove(dst, dst + (frameCount * mFormat.mBytesPerFrame), offset * mFormat.mBytesPerFrame);
+			}
+		}
+	}
+	else {
+		// Neither the headroom nor the space following the buffer alone is sufficient
+		if(frameCount > framesFollowingCapacity)
+			Compact();
+
+		if(framesAfter) {
+			for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i) {
+				auto src = static_cast<uint8_t *>(mBufferList->mBuffers[i].mData) + (offset * mFormat.mBytesPerFrame);
+				std::memmove(src + (frameCount * mFormat.mBytesPerFrame), src, framesAfter * mFormat.mBytesPerFrame);
+			}
+		}
+	}
+
+	SetFrameLength(mFrameLength + frameCount);
+}
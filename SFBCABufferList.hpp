@@ -8,10 +8,14 @@
 
 #import <CoreAudioTypes/CoreAudioTypes.h>
 
+#import "SFBAllocationPolicy.hpp"
+#import "SFBAudioBufferAnalysis.hpp"
 #import "SFBCAStreamBasicDescription.hpp"
 
 namespace SFB {
 
+class CABufferListPool;
+
 /// Allocates and returns a new @c AudioBufferList in a single allocation
 /// @note The allocation is performed using @c std::malloc and should be deallocated using @c std::free
 /// @param format The format of the audio the @c AudioBufferList will hold
@@ -20,6 +24,13 @@ namespace SFB {
 AudioBufferList * _Nullable AllocateAudioBufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity) noexcept;
 
 /// A class wrapping a Core Audio @c AudioBufferList with a specific format, frame capacity, and frame length
+///
+/// The channel buffers may be preceded by headroom, unused storage between the start of each allocated channel buffer
+/// and its first valid frame. Trimming frames from the front of the buffer grows the headroom instead of moving the
+/// remaining frames, and inserting frames near the front consumes it. The internal @c AudioBufferList always describes
+/// the valid frames, and @c FrameCapacity() includes the headroom. Frames are moved to reclaim headroom only when an
+/// insertion or frame length change requires it or @c Compact() is called, and the headroom is released without moving
+/// any frames when the buffer becomes empty.
 class CABufferList
 {
 	
@@ -50,17 +61,21 @@ public:
 	/// Creates a new @c CABufferList
 	/// @param format The format of the audio the @c CABufferList will hold
 	/// @param frameCapacity The desired buffer capacity in audio frames
+	/// @param policy The allocation policy
 	/// @throws @c std::invalid_argument if @c format.mBytesPerFrame==0
 	/// @throws @c std::bad_alloc
-	CABufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity);
+	CABufferList(const CAStreamBasicDescription& format, UInt32 frameCapacity, const AllocationPolicy& policy = {});
 
 #pragma mark Buffer management
 
 	/// Allocates space for audio
+	///
+	/// @c policy controls the alignment and padding of the channel buffers and whether their memory is locked and prefaulted.
 	/// @param format The format of the audio
 	/// @param frameCapacity The desired capacity in audio frames
+	/// @param policy The allocation policy
 	/// @return @c true on sucess, @c false otherwise
-	bool Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity) noexcept;
+	bool Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity, const AllocationPolicy& policy = {}) noexcept;
 
 	/// Deallocates the memory associated with this @c CABufferList
 	void Deallocate() noexcept;
@@ -68,18 +83,20 @@ public:
 
 	/// Resets the @c CABufferList to the default state in preparation for reading
 	///
-	/// This is equivalent to @c SetFrameLength(FrameCapacity())
+	/// The headroom is released without moving any frames, then this is equivalent to @c SetFrameLength(FrameCapacity())
 	inline bool Reset() noexcept
 	{
+		SetHeadroom(0);
 		return SetFrameLength(mFrameCapacity);
 	}
 
 	/// Clears the @c CABufferList
 	///
-	/// This is equivalent to @c SetFrameLength(0)
+	/// The headroom is released, then this is equivalent to @c SetFrameLength(0)
 	/// @return @c true on sucess, @c false otherwise
 	inline bool Clear() noexcept
 	{
+		SetHeadroom(0);
 		return SetFrameLength(0);
 	}
 
@@ -91,6 +108,7 @@ public:
 	}
 
 	/// Set the length in audio frames of the data in this @c CABufferList
+	/// @note The valid frames are moved to release the headroom if @c frameLength frames don't fit following the first valid frame
 	/// @param frameLength The number of valid audio frames
 	/// @return @c true on sucess, @c false otherwise
 	bool SetFrameLength(UInt32 frameLength) noexcept;
@@ -111,11 +129,28 @@ public:
 	}
 
 	/// Returns the audio frame capacity of this @c CABufferList
+	/// @note This includes @c Headroom(), which is reclaimed by moving frames when they would not otherwise fit
 	inline UInt32 FrameCapacity() const noexcept
 	{
 		return mFrameCapacity;
 	}
 
+	/// Returns the number of unused frames preceding the first valid frame
+	inline UInt32 Headroom() const noexcept
+	{
+		return mHeadroom;
+	}
+
+	/// Moves the valid frames so they are preceded by at least @c frameCount frames of headroom
+	///
+	/// Prepending or inserting at most @c frameCount frames near the front of the buffer then moves no frames.
+	/// @param frameCount The desired headroom in frames
+	/// @return @c true on sucess, @c false if the allocated capacity is insufficient
+	bool ReserveHeadroom(UInt32 frameCount) noexcept;
+
+	/// Moves the valid frames to the start of the channel buffers, releasing the headroom
+	void Compact() noexcept;
+
 	/// Returns the format of this @c CABufferList
 	inline const CAStreamBasicDescription& Format() const noexcept
 	{
@@ -199,6 +234,9 @@ public:
 	}
 
 	/// Inserts at most @c readLength frames from @c buffer starting at @c readOffset starting at @c writeOffset
+	///
+	/// The frames before @c writeOffset are moved into the headroom if it is large enough and they are fewer than the
+	/// frames after @c writeOffset, so prepending to a buffer with sufficient headroom moves no frames.
 	/// @note The format of @c buffer must match the format of this @c CABufferList
 	/// @param buffer A buffer of audio data
 	/// @param readOffset The desired starting offset in @c buffer
@@ -227,16 +265,20 @@ public:
 	}
 
 	/// Deletes at most @c frameLength frames from this @c CABufferList starting at @c offset
+	///
+	/// The frames before @c offset are moved into the deleted space, growing the headroom, if they are fewer than the
+	/// frames after the deleted space, so deleting the first frames moves no frames.
 	/// @param offset The desired starting offset
 	/// @param frameLength The desired number of frames
 	/// @return The number of frames deleted
 	UInt32 TrimAtOffset(UInt32 offset, UInt32 frameLength) noexcept;
 
 	/// Fills the remainder of this @c CABufferList with silence
+	/// @note The headroom is not filled
 	/// @return The number of frames of silence appended
 	inline UInt32 FillRemainderWithSilence() noexcept
 	{
-		return InsertSilence(mFrameLength, mFrameCapacity - mFrameLength);
+		return InsertSilence(mFrameLength, FrameCapacity() - mFrameLength);
 	}
 
 	/// Appends at most @c frameLength frames of silence
@@ -253,6 +295,49 @@ public:
 	/// @return The number of frames of silence inserted
 	UInt32 InsertSilence(UInt32 offset, UInt32 frameLength) noexcept;
 
+#pragma mark Format conversion
+
+	/// Replaces the contents of this @c CABufferList with the contents of @c buffer converted to this object's format
+	///
+	/// Linear PCM samples are converted, byte swapped, and interleaved or deinterleaved as required without using an @c AudioConverter.
+	/// @note Both formats must be supported by @c AudioSampleConversion::Convert() and have the same number of channels
+	/// @param buffer A buffer of audio data
+	/// @return The number of frames converted
+	UInt32 ConvertFromBuffer(const CABufferList& buffer) noexcept;
+
+#pragma mark Analysis
+
+	/// Returns @c true if this @c CABufferList contains only digital silence
+	/// @note An empty @c CABufferList is considered silent
+	/// @return @c true if all valid frames are silent, @c false otherwise or if the format is not supported
+	inline bool IsDigitalSilence() const noexcept
+	{
+		return mBufferList && AudioBufferAnalysis::IsDigitalSilence(mBufferList, mFormat, mFrameLength);
+	}
+
+	/// Returns the offset of the first frame containing a non-silent sample in any channel
+	/// @return The offset of the first non-silent frame, @c FrameLength() if all frames are silent, or @c 0 if the format is not supported
+	inline UInt32 FirstNonSilentFrame() const noexcept
+	{
+		return mBufferList ? AudioBufferAnalysis::FirstNonSilentFrame(mBufferList, mFormat, mFrameLength) : 0;
+	}
+
+	/// Returns the peak absolute sample value in @c channel, with integer samples scaled so that full scale is @c 1
+	/// @param channel The channel to examine
+	/// @return The peak value, or @c 0 if @c channel is out of range or the format is not supported
+	inline double Peak(UInt32 channel) const noexcept
+	{
+		return mBufferList ? AudioBufferAnalysis::Peak(mBufferList, mFormat, mFrameLength, channel) : 0;
+	}
+
+	/// Returns the root mean square of the sample values in @c channel, with integer samples scaled so that full scale is @c 1
+	/// @param channel The channel to examine
+	/// @return The RMS value, or @c 0 if @c channel is out of range or the format is not supported
+	inline double RMS(UInt32 channel) const noexcept
+	{
+		return mBufferList ? AudioBufferAnalysis::RMS(mBufferList, mFormat, mFrameLength, channel) : 0;
+	}
+
 #pragma mark AudioBufferList access
 
 	/// Adopts an existing @c AudioBufferList
@@ -266,6 +351,8 @@ public:
 
 	/// Relinquishes ownership of the object's internal @c AudioBufferList and returns it
 	/// @note The caller assumes responsiblity for deallocating the returned @c AudioBufferList using @c std::free
+	/// @note Memory locked by the allocation policy is unlocked
+	/// @note Storage acquired from a @c CABufferListPool cannot be relinquished and @c nullptr is returned
 	AudioBufferList * _Nullable RelinquishABL() noexcept;
 
 	/// Returns a pointer to this object's internal @c AudioBufferList
@@ -281,6 +368,13 @@ public:
 	}
 
 
+	/// Returns @c true if this object's internal @c AudioBufferList was acquired from a @c CABufferListPool
+	inline bool IsPooled() const noexcept
+	{
+		return mPool != nullptr;
+	}
+
+
 	/// Returns @c true if this object's internal @c AudioBufferList is not @c nullptr
 	inline explicit operator bool() const noexcept
 	{
@@ -320,14 +414,32 @@ public:
 
 private:
 
+	friend class CABufferListPool;
+
+	/// Frees @c mBufferList or returns it to @c mPool
+	void FreeABL() noexcept;
+
+	/// Points the channel buffers @c headroom frames past the start of their storage without moving any frames
+	void SetHeadroom(UInt32 headroom) noexcept;
+
+	/// Moves frames so @c frameCount unspecified frames are inserted at @c offset and extends the frame length
+	/// @note @c frameCount must not exceed the allocated capacity less the frame length
+	void OpenGap(UInt32 offset, UInt32 frameCount) noexcept;
+
 	/// The underlying @c AudioChannelLayout struct
 	AudioBufferList * _Nullable mBufferList;
 	/// The format of @c mBufferList
 	CAStreamBasicDescription mFormat;
-	/// The capacity of @c mBufferList in frames
+	/// The allocated capacity of @c mBufferList in frames, including the headroom
 	UInt32 mFrameCapacity;
+	/// The number of unused frames preceding the first valid frame of each channel buffer
+	UInt32 mHeadroom;
 	/// The number of valid frames in @c mBufferList
 	UInt32 mFrameLength;
+	/// The pool owning @c mBufferList or @c nullptr if @c mBufferList was allocated using @c std::malloc
+	CABufferListPool * _Nullable mPool;
+	/// The policy used to allocate @c mBufferList
+	AllocationPolicy mAllocationPolicy;
 
 };
 
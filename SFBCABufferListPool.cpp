@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <cstdlib>
+#import <cstring>
+#import <limits>
+#import <new>
+
+#import "SFBCABufferListPool.hpp"
+
+namespace {
+
+/// Returns @c value rounded up to a multiple of @c alignment, which must be a power of two
+constexpr size_t RoundUp(size_t value, size_t alignment) noexcept
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/// Returns the free list head containing @c index with a modification count of @c count
+constexpr uint64_t MakeHead(uint32_t index, uint32_t count) noexcept
+{
+	return (static_cast<uint64_t>(count) << 32) | index;
+}
+
+/// Returns the index of the first free buffer in @c head
+constexpr uint32_t HeadIndex(uint64_t head) noexcept
+{
+	return static_cast<uint32_t>(head);
+}
+
+/// Returns the modification count of @c head
+constexpr uint32_t HeadCount(uint64_t head) noexcept
+{
+	return static_cast<uint32_t>(head >> 32);
+}
+
+} // namespace
+
+SFB::CABufferListPool::CABufferListPool() noexcept
+: mStorage(nullptr), mBufferStride(0), mDataOffset(0), mChannelStride(0), mFrameCapacity(0), mBufferCount(0), mNext(nullptr), mFreeListHead(MakeHead(sEndOfList, 0)), mInUse(0), mHighWaterMark(0), mAcquisitions(0), mMisses(0)
+{
+	static_assert(std::atomic_uint64_t::is_always_lock_free);
+}
+
+SFB::CABufferListPool::~CABufferListPool()
+{
+	Deallocate();
+}
+
+#pragma mark Pool management
+
+bool SFB::CABufferListPool::Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity, uint32_t bufferCount) noexcept
+{
+	if(format.mBytesPerFrame == 0 || frameCapacity > (std::numeric_limits<UInt32>::max() / format.mBytesPerFrame) || bufferCount == 0 || bufferCount == sEndOfList)
+		return false;
+
+	Deallocate();
+
+	const auto channelStreamCount = format.ChannelStreamCount();
+	const auto dataOffset = RoundUp(offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * channelStreamCount), sAlignment);
+	const auto channelStride = RoundUp(format.FrameCountToByteSize(frameCapacity), sAlignment);
+	const auto bufferStride = dataOffset + (channelStride * channelStreamCount);
+
+	if(bufferStride > std::numeric_limits<size_t>::max() / bufferCount)
+		return false;
+
+	mStorage = static_cast<uint8_t *>(std::aligned_alloc(sAlignment, bufferStride * bufferCount));
+	if(!mStorage)
+		return false;
+
+	mNext = new (std::nothrow) std::atomic_uint32_t [bufferCount];
+	if(!mNext) {
+		std::free(mStorage);
+		mStorage = nullptr;
+		return false;
+	}
+
+	std::memset(mStorage, 0, bufferStride * bufferCount);
+
+	mBufferStride = bufferStride;
+	mDataOffset = dataOffset;
+	mChannelStride = channelStride;
+
+	mFormat = format;
+	mFrameCapacity = frameCapacity;
+	mBufferCount = bufferCount;
+
+	// Initially every buffer is free, in order
+	for(uint32_t i = 0; i < bufferCount; ++i)
+		mNext[i].store(i + 1 < bufferCount ? i + 1 : sEndOfList, std::memory_order_relaxed);
+	mFreeListHead.store(MakeHead(0, 0), std::memory_order_release);
+
+	mInUse.store(0, std::memory_order_relaxed);
+	ResetStatistics();
+
+	return true;
+}
+
+void SFB::CABufferListPool::Deallocate() noexcept
+{
+	if(mStorage) {
+		std::free(mStorage);
+		mStorage = nullptr;
+
+		delete [] mNext;
+		mNext = nullptr;
+
+		mBufferStride = 0;
+		mDataOffset = 0;
+		mChannelStride = 0;
+
+		mFormat.Reset();
+		mFrameCapacity = 0;
+		mBufferCount = 0;
+
+		mFreeListHead.store(MakeHead(sEndOfList, 0), std::memory_order_relaxed);
+	}
+}
+
+#pragma mark Acquiring buffers
+
+SFB::CABufferList SFB::CABufferListPool::Acquire() noexcept
+{
+	CABufferList buffer;
+
+	auto head = mFreeListHead.load(std::memory_order_acquire);
+	for(;;) {
+		const auto index = HeadIndex(head);
+		if(index == sEndOfList) {
+			mMisses.fetch_add(1, std::memory_order_relaxed);
+			return buffer;
+		}
+
+		// If another thread pops this buffer first the modification count will differ and the exchange will fail
+		const auto next = mNext[index].load(std::memory_order_relaxed);
+		if(mFreeListHead.compare_exchange_weak(head, MakeHead(next, HeadCount(head) + 1), std::memory_order_acquire, std::memory_order_acquire)) {
+			auto storage = mStorage + (mBufferStride * index);
+
+			// Restore the buffer list in case the previous user modified it
+			auto bufferList = reinterpret_cast<AudioBufferList *>(storage);
+			bufferList->mNumberBuffers = mFormat.ChannelStreamCount();
+			for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+				bufferList->mBuffers[i].mNumberChannels = mFormat.InterleavedChannelCount();
+				bufferList->mBuffers[i].mData = storage + mDataOffset + (mChannelStride * i);
+				bufferList->mBuffers[i].mDataByteSize = 0;
+			}
+
+			buffer.mBufferList = bufferList;
+			buffer.mFormat = mFormat;
+			buffer.mFrameCapacity = mFrameCapacity;
+			buffer.mFrameLength = 0;
+			buffer.mPool = this;
+
+			mAcquisitions.fetch_add(1, std::memory_order_relaxed);
+
+			const auto inUse = mInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+			auto highWaterMark = mHighWaterMark.load(std::memory_order_relaxed);
+			while(inUse > highWaterMark && !mHighWaterMark.compare_exchange_weak(highWaterMark, inUse, std::memory_order_relaxed))
+				;
+
+			return buffer;
+		}
+	}
+}
+
+void SFB::CABufferListPool::Release(AudioBufferList *bufferList) noexcept
+{
+	const auto index = static_cast<uint32_t>((reinterpret_cast<uint8_t *>(bufferList) - mStorage) / mBufferStride);
+
+	auto head = mFreeListHead.load(std::memory_order_relaxed);
+	do {
+		mNext[index].store(HeadIndex(head), std::memory_order_relaxed);
+	} while(!mFreeListHead.compare_exchange_weak(head, MakeHead(index, HeadCount(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+
+	mInUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+#pragma mark Statistics
+
+SFB::CABufferListPool::PoolStatistics SFB::CABufferListPool::Statistics() const noexcept
+{
+	return {
+		.mInUse = mInUse.load(std::memory_order_relaxed),
+		.mHighWaterMark = mHighWaterMark.load(std::memory_order_relaxed),
+		.mAcquisitions = mAcquisitions.load(std::memory_order_relaxed),
+		.mMisses = mMisses.load(std::memory_order_relaxed),
+	};
+}
+
+void SFB::CABufferListPool::ResetStatistics() noexcept
+{
+	mHighWaterMark.store(mInUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	mAcquisitions.store(0, std::memory_order_relaxed);
+	mMisses.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+#import <cstdint>
+
+#import "SFBCABufferList.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+
+/// A pool of preallocated @c CABufferList storage for a single format and frame capacity.
+///
+/// All storage is allocated up front by @c Allocate(). @c Acquire() returns a @c CABufferList backed by a free
+/// block of storage, and the storage returns to the pool when the @c CABufferList is destroyed, deallocated, or
+/// replaced by move assignment. Moving a pooled @c CABufferList transfers the storage without returning it.
+///
+/// Free blocks are kept in a lock-free list so buffers may be acquired and released on a real-time thread.
+/// Each channel buffer begins on a 64-byte boundary.
+///
+/// This class is thread safe when @c Acquire() and @c CABufferList destruction are called from any number of threads.
+/// @note The pool must outlive every @c CABufferList acquired from it.
+class CABufferListPool
+{
+
+public:
+
+	/// The alignment of each channel buffer, in bytes
+	static constexpr size_t sAlignment = 64;
+
+	/// Usage statistics for a @c CABufferListPool
+	struct PoolStatistics
+	{
+		/// The number of buffers currently acquired
+		uint32_t mInUse;
+		/// The largest number of buffers acquired at once
+		uint32_t mHighWaterMark;
+		/// The number of successful calls to @c Acquire()
+		uint64_t mAcquisitions;
+		/// The number of calls to @c Acquire() that failed because no storage was free
+		uint64_t mMisses;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c CABufferListPool
+	/// @note @c Allocate() must be called before the object may be used.
+	CABufferListPool() noexcept;
+
+	// This class is non-copyable
+	CABufferListPool(const CABufferListPool& rhs) = delete;
+
+	// This class is non-assignable
+	CABufferListPool& operator=(const CABufferListPool& rhs) = delete;
+
+	/// Destroys the @c CABufferListPool and release all associated resources.
+	~CABufferListPool();
+
+	// This class is non-movable
+	CABufferListPool(CABufferListPool&& rhs) = delete;
+
+	// This class is non-move assignable
+	CABufferListPool& operator=(CABufferListPool&& rhs) = delete;
+
+#pragma mark Pool management
+
+	/// Allocates storage for @c bufferCount buffers
+	/// @note This method is not thread safe.
+	/// @param format The format of the audio the buffers will hold
+	/// @param frameCapacity The buffer capacity in audio frames
+	/// @param bufferCount The number of buffers
+	/// @return @c true on success, @c false on error
+	bool Allocate(const CAStreamBasicDescription& format, UInt32 frameCapacity, uint32_t bufferCount) noexcept;
+
+	/// Frees the storage used by this @c CABufferListPool
+	/// @note This method is not thread safe.
+	/// @note All acquired buffers must have been released
+	void Deallocate() noexcept;
+
+
+	/// Returns the format of the buffers in this @c CABufferListPool
+	inline const CAStreamBasicDescription& Format() const noexcept
+	{
+		return mFormat;
+	}
+
+	/// Returns the frame capacity of the buffers in this @c CABufferListPool
+	inline UInt32 FrameCapacity() const noexcept
+	{
+		return mFrameCapacity;
+	}
+
+	/// Returns the number of buffers in this @c CABufferListPool
+	inline uint32_t BufferCount() const noexcept
+	{
+		return mBufferCount;
+	}
+
+#pragma mark Acquiring buffers
+
+	/// Returns an empty @c CABufferList backed by storage from this pool
+	/// @note The audio data is not cleared
+	/// @return A @c CABufferList with a frame length of @c 0, or a @c CABufferList for which @c operator bool() returns @c false if no storage is free
+	CABufferList Acquire() noexcept;
+
+#pragma mark Statistics
+
+	/// Returns the usage statistics for this @c CABufferListPool
+	PoolStatistics Statistics() const noexcept;
+
+	/// Resets the high-water mark to the current number of acquired buffers and clears the counters
+	void ResetStatistics() noexcept;
+
+private:
+
+	friend class CABufferList;
+
+	/// Returns the storage for @c bufferList to the free list
+	void Release(AudioBufferList * _Nonnull bufferList) noexcept;
+
+	/// The assumed size of a cache line, in bytes
+	/// @note 128 bytes matches the cache line size of Apple silicon and covers adjacent-line prefetching on x86-64
+	static constexpr size_t sCacheLineSize = 128;
+
+	/// Marks the end of the free list
+	static constexpr uint32_t sEndOfList = UINT32_MAX;
+
+	/// The storage for all buffers
+	uint8_t * _Nullable mStorage;
+	/// The size in bytes of the storage for a single buffer
+	size_t mBufferStride;
+	/// The offset in bytes from the start of a buffer's storage to its first channel buffer
+	size_t mDataOffset;
+	/// The size in bytes of a single channel buffer, including padding
+	size_t mChannelStride;
+
+	/// The format of the buffers
+	CAStreamBasicDescription mFormat;
+	/// The capacity of each buffer in frames
+	UInt32 mFrameCapacity;
+	/// The number of buffers
+	uint32_t mBufferCount;
+
+	/// The index of the next free buffer following each free buffer
+	std::atomic_uint32_t * _Nullable mNext;
+	/// The index of the first free buffer in the low 32 bits and a modification count in the high 32 bits
+	/// @note The modification count prevents a stale head from being restored (the ABA problem)
+	alignas(sCacheLineSize) std::atomic_uint64_t mFreeListHead;
+
+	/// The number of buffers currently acquired
+	alignas(sCacheLineSize) std::atomic_uint32_t mInUse;
+	/// The largest value of @c mInUse
+	std::atomic_uint32_t mHighWaterMark;
+	/// The number of successful acquisitions
+	std::atomic_uint64_t mAcquisitions;
+	/// The number of failed acquisitions
+	std::atomic_uint64_t mMisses;
+
+};
+
+} // namespace SFB
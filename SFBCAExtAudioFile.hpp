@@ -6,12 +6,15 @@
 
 #pragma once
 
+#import <algorithm>
+
 #import <AudioToolbox/ExtendedAudioFile.h>
 
 #import "SFBCAException.hpp"
 #import "SFBCABufferList.hpp"
 #import "SFBCAChannelLayout.hpp"
 #import "SFBCAStreamBasicDescription.hpp"
+#import "SFBDeferredClosure.hpp"
 
 CF_ASSUME_NONNULL_BEGIN
 
@@ -31,6 +34,20 @@ private:
 	};
 
 public:
+
+	/// Options for bulk reads
+	struct ReadOptions
+	{
+		/// The size in bytes of the buffer used for file reads (@c kExtAudioFileProperty_IOBufferSizeBytes) or @c 0 for the default
+		UInt32 mIOBufferSizeBytes = 0;
+		/// The settings of the internal @c AudioConverter (@c kExtAudioFileProperty_ConverterConfig) or @c nullptr for the defaults
+		CFPropertyListRef _Nullable mConverterConfig = nullptr;
+		/// The client channel layout or @c nullptr for the default
+		const CAChannelLayout * _Nullable mClientChannelLayout = nullptr;
+		/// The manufacturer of the codec to use (@c kExtAudioFileProperty_CodecManufacturer) or @c 0 for the default
+		UInt32 mCodecManufacturer = 0;
+	};
+
 	/// Creates a @c CAExtAudioFile
 	inline CAExtAudioFile() noexcept
 	: mExtAudioFile(nullptr)
@@ -188,6 +205,92 @@ public:
 		buffer.SetFrameLength(frameCount);
 	}
 
+	/// Configures the file for bulk reads into buffers with the same format as @c buffer
+	///
+	/// The client data format is set to the format of @c buffer if it differs from the current client data format,
+	/// in which case the internal @c AudioConverter is recreated. The options are then applied to the converter and
+	/// file so they need only be set once rather than before each read.
+	/// @param buffer A buffer whose format is used as the client data format
+	/// @param options The options to apply
+	/// @throw @c std::system_error
+	void PrepareForBulkReads(const SFB::CABufferList& buffer, const ReadOptions& options)
+	{
+		if(options.mCodecManufacturer)
+			SetProperty(kExtAudioFileProperty_CodecManufacturer, sizeof(options.mCodecManufacturer), &options.mCodecManufacturer);
+		if(options.mCodecManufacturer || ClientDataFormat() != buffer.Format())
+			SetProperty(kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &buffer.Format());
+		if(options.mClientChannelLayout)
+			SetClientChannelLayout(*options.mClientChannelLayout);
+		// The converter configuration must be set after the client data format since that recreates the converter
+		if(options.mConverterConfig)
+			SetProperty(kExtAudioFileProperty_ConverterConfig, sizeof(options.mConverterConfig), &options.mConverterConfig);
+		if(options.mIOBufferSizeBytes)
+			SetProperty(kExtAudioFileProperty_IOBufferSizeBytes, sizeof(options.mIOBufferSizeBytes), &options.mIOBufferSizeBytes);
+	}
+
+	/// Configures the file for bulk reads into buffers with the same format as @c buffer using the default options
+	/// @param buffer A buffer whose format is used as the client data format
+	/// @throw @c std::system_error
+	void PrepareForBulkReads(const SFB::CABufferList& buffer)
+	{
+		PrepareForBulkReads(buffer, ReadOptions{});
+	}
+
+	/// Performs a synchronous sequential read into part of a buffer.
+	///
+	/// Audio is decoded directly into @c buffer starting at @c offset without resetting it, and reads are repeated
+	/// until @c frameCount frames have been read or the end of the file is reached. The frame length of @c buffer
+	/// is extended to include the frames read if necessary.
+	/// @note The format of @c buffer must be the client data format, for example as set by @c PrepareForBulkReads()
+	/// @param buffer Buffer into which the audio data is read.
+	/// @param offset The frame offset in @c buffer to begin writing
+	/// @param frameCount The desired number of frames to read, limited by the frame capacity of @c buffer
+	/// @return The number of frames read, which is less than the number requested only at the end of the file
+	/// @throw @c std::system_error
+	UInt32 Read(SFB::CABufferList& buffer, UInt32 offset, UInt32 frameCount)
+	{
+		if(!buffer || offset >= buffer.FrameCapacity())
+			return 0;
+
+		frameCount = std::min(frameCount, buffer.FrameCapacity() - offset);
+
+		// Extending the frame length first moves the valid frames out of the headroom if the frames read wouldn't fit
+		const auto frameLength = buffer.FrameLength();
+		if(offset + frameCount > frameLength)
+			buffer.SetFrameLength(offset + frameCount);
+
+		auto bufferList = buffer.ABL();
+		const auto bytesPerFrame = buffer.Format().mBytesPerFrame;
+		UInt32 framesRead = 0;
+
+		// Restore the buffer's data pointers and set its frame length even if a read fails
+		auto lambda = [&]() {
+			for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+				bufferList->mBuffers[i].mData = static_cast<uint8_t *>(bufferList->mBuffers[i].mData) - ((offset + framesRead) * bytesPerFrame);
+			buffer.SetFrameLength(std::max(frameLength, offset + framesRead));
+		};
+		SFB::DeferredClosure<decltype(lambda)> restore(lambda);
+
+		for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+			bufferList->mBuffers[i].mData = static_cast<uint8_t *>(bufferList->mBuffers[i].mData) + (offset * bytesPerFrame);
+
+		while(framesRead < frameCount) {
+			UInt32 framesToRead = frameCount - framesRead;
+			for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+				bufferList->mBuffers[i].mDataByteSize = framesToRead * bytesPerFrame;
+
+			Read(framesToRead, bufferList);
+			if(framesToRead == 0)
+				break;
+
+			for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+				bufferList->mBuffers[i].mData = static_cast<uint8_t *>(bufferList->mBuffers[i].mData) + (framesToRead * bytesPerFrame);
+			framesRead += framesToRead;
+		}
+
+		return framesRead;
+	}
+
 	/// Performs a synchronous sequential write.
 	///
 	///	If the file has a client data format, then the audio data in ioData is
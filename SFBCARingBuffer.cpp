@@ -5,11 +5,15 @@
 //
 
 #import <algorithm>
+#import <cstddef>
 #import <cstdlib>
 #import <cstring>
 #import <limits>
+#import <new>
 
 #import "SFBCARingBuffer.hpp"
+#import "SFBAudioInterleaving.hpp"
+#import "SFBMirroredMemory.hpp"
 
 namespace {
 
@@ -37,12 +41,12 @@ inline void ZeroABL(AudioBufferList * const _Nonnull bufferList, uint32_t byteOf
 	}
 }
 
-/// Copies non-interleaved audio from @c bufferList to @c buffers
+/// Copies audio from @c bufferList to @c buffers
 /// @param buffers The destination buffers
 /// @param dstOffset The byte offset in @c buffers to begin writing
 /// @param bufferList The source buffers
 /// @param srcOffset The byte offset in @c bufferList to begin reading
-/// @param byteCount The maximum number of bytes per non-interleaved buffer to read and write
+/// @param byteCount The maximum number of bytes per buffer to read and write
 inline void StoreABL(uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t dstOffset, const AudioBufferList * const _Nonnull bufferList, uint32_t srcOffset, uint32_t byteCount) noexcept
 {
 	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
@@ -52,12 +56,12 @@ inline void StoreABL(uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t
 	}
 }
 
-/// Copies non-interleaved audio from @c buffers to @c bufferList
+/// Copies audio from @c buffers to @c bufferList
 /// @param bufferList The destination buffers
 /// @param dstOffset The byte offset in @c bufferList to begin writing
 /// @param buffers The source buffers
 /// @param srcOffset The byte offset in @c bufferList to begin reading
-/// @param byteCount The maximum number of bytes per non-interleaved buffer to read and write
+/// @param byteCount The maximum number of bytes per buffer to read and write
 inline void FetchABL(AudioBufferList * const _Nonnull bufferList, uint32_t dstOffset, const uint8_t * const _Nonnull * const _Nonnull buffers, uint32_t srcOffset, uint32_t byteCount) noexcept
 {
 	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
@@ -67,6 +71,78 @@ inline void FetchABL(AudioBufferList * const _Nonnull bufferList, uint32_t dstOf
 	}
 }
 
+/// Returns @c true if @c lhs and @c rhs differ at most in interleaving
+inline bool IsInterleavingEquivalent(const SFB::CAStreamBasicDescription& lhs, const SFB::CAStreamBasicDescription& rhs) noexcept
+{
+	SFB::CAStreamBasicDescription lhsNonInterleaved, rhsNonInterleaved;
+	if(!lhs.GetNonInterleavedEquivalent(lhsNonInterleaved) || !rhs.GetNonInterleavedEquivalent(rhsNonInterleaved))
+		return false;
+	return lhsNonInterleaved == rhsNonInterleaved;
+}
+
+/// Returns @c true if audio in @c format may be copied to or from a buffer in @c ringBufferFormat
+inline bool IsCompatibleFormat(const SFB::CAStreamBasicDescription& format, const SFB::CAStreamBasicDescription& ringBufferFormat) noexcept
+{
+	return format == ringBufferFormat || (format.IsInterleaved() != ringBufferFormat.IsInterleaved() && IsInterleavingEquivalent(format, ringBufferFormat));
+}
+
+/// Returns the number of frames that fit in every buffer in @c bufferList
+/// @param bufferList The buffers
+/// @param format The format of @c bufferList
+inline uint32_t FrameCapacity(const AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& format) noexcept
+{
+	uint32_t frameCapacity = std::numeric_limits<uint32_t>::max();
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+		frameCapacity = std::min(frameCapacity, bufferList->mBuffers[i].mDataByteSize / format.mBytesPerFrame);
+	return frameCapacity;
+}
+
+/// Copies audio from @c bufferList to @c buffers, interleaving or deinterleaving if the layouts differ
+/// @param buffers The destination buffers
+/// @param format The format of @c buffers
+/// @param dstOffset The frame offset in @c buffers to begin writing
+/// @param bufferList The source buffers
+/// @param bufferListFormat The format of @c bufferList
+/// @param srcOffset The frame offset in @c bufferList to begin reading
+/// @param frameCount The number of frames to read and write
+inline void StoreFrames(uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t dstOffset, const AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& bufferListFormat, uint32_t srcOffset, uint32_t frameCount) noexcept
+{
+	const auto wordSize = format.SampleWordSize();
+	if(format.IsInterleaved() == bufferListFormat.IsInterleaved())
+		StoreABL(buffers, dstOffset * format.mBytesPerFrame, bufferList, srcOffset * format.mBytesPerFrame, frameCount * format.mBytesPerFrame);
+	else if(format.IsInterleaved())
+		SFB::AudioInterleaving::Interleave(buffers[0] + dstOffset * format.mBytesPerFrame, [&](uint32_t channel) {
+			return static_cast<const uint8_t *>(bufferList->mBuffers[channel].mData) + srcOffset * wordSize;
+		}, format.mChannelsPerFrame, wordSize, frameCount);
+	else
+		SFB::AudioInterleaving::Deinterleave([&](uint32_t channel) {
+			return buffers[channel] + dstOffset * wordSize;
+		}, static_cast<const uint8_t *>(bufferList->mBuffers[0].mData) + srcOffset * bufferListFormat.mBytesPerFrame, format.mChannelsPerFrame, wordSize, frameCount);
+}
+
+/// Copies audio from @c buffers to @c bufferList, interleaving or deinterleaving if the layouts differ
+/// @param bufferList The destination buffers
+/// @param bufferListFormat The format of @c bufferList
+/// @param dstOffset The frame offset in @c bufferList to begin writing
+/// @param buffers The source buffers
+/// @param format The format of @c buffers
+/// @param srcOffset The frame offset in @c buffers to begin reading
+/// @param frameCount The number of frames to read and write
+inline void FetchFrames(AudioBufferList * const _Nonnull bufferList, const SFB::CAStreamBasicDescription& bufferListFormat, uint32_t dstOffset, const uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t srcOffset, uint32_t frameCount) noexcept
+{
+	const auto wordSize = format.SampleWordSize();
+	if(format.IsInterleaved() == bufferListFormat.IsInterleaved())
+		FetchABL(bufferList, dstOffset * format.mBytesPerFrame, buffers, srcOffset * format.mBytesPerFrame, frameCount * format.mBytesPerFrame);
+	else if(format.IsInterleaved())
+		SFB::AudioInterleaving::Deinterleave([&](uint32_t channel) {
+			return static_cast<uint8_t *>(bufferList->mBuffers[channel].mData) + dstOffset * wordSize;
+		}, buffers[0] + srcOffset * format.mBytesPerFrame, format.mChannelsPerFrame, wordSize, frameCount);
+	else
+		SFB::AudioInterleaving::Interleave(static_cast<uint8_t *>(bufferList->mBuffers[0].mData) + dstOffset * bufferListFormat.mBytesPerFrame, [&](uint32_t channel) {
+			return buffers[channel] + srcOffset * wordSize;
+		}, format.mChannelsPerFrame, wordSize, frameCount);
+}
+
 /// Returns the smallest power of two value greater than @c x
 /// @param x A value in the range [2..2147483648]
 /// @return The smallest power of two greater than @c x
@@ -77,27 +153,69 @@ inline constexpr uint32_t NextPowerOfTwo(uint32_t x) noexcept
 	return static_cast<uint32_t>(1 << (32 - __builtin_clz(x - 1)));
 }
 
+/// Returns the size in bytes of an @c AudioBufferList with @c streamCount buffers
+inline constexpr size_t BufferListSize(uint32_t streamCount) noexcept
+{
+	return offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * streamCount);
+}
+
+/// Returns the size in bytes of the @c streamCount channel pointers followed by the two buffer lists describing the write vector
+inline constexpr size_t HeaderSize(uint32_t streamCount) noexcept
+{
+	return (streamCount * sizeof(uint8_t *)) + (2 * BufferListSize(streamCount));
+}
+
+/// Sets @c bufferList to describe @c frameCount frames of @c buffers starting at @c frameOffset
+/// @param bufferList The buffer list to set
+/// @param buffers The channel buffers
+/// @param format The format of @c buffers
+/// @param frameOffset The frame offset in @c buffers of the first frame
+/// @param frameCount The number of frames
+inline void SetBufferList(AudioBufferList * const _Nonnull bufferList, uint8_t * const _Nonnull * const _Nonnull buffers, const SFB::CAStreamBasicDescription& format, uint32_t frameOffset, uint32_t frameCount) noexcept
+{
+	bufferList->mNumberBuffers = format.ChannelStreamCount();
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		bufferList->mBuffers[i].mNumberChannels = format.InterleavedChannelCount();
+		bufferList->mBuffers[i].mDataByteSize = frameCount * format.mBytesPerFrame;
+		bufferList->mBuffers[i].mData = buffers[i] + (frameOffset * format.mBytesPerFrame);
+	}
+}
+
+/// Returns the distance in bytes between consecutive channel buffers in a single allocation
+inline size_t ChannelBufferStride(uint32_t capacityBytes, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(capacityBytes + policy.mChannelPadding, policy);
+}
+
+/// Returns the size in bytes of a single allocation holding the header followed by the channel buffers
+inline size_t SingleAllocationSize(uint32_t capacityBytes, uint32_t streamCount, const SFB::AllocationPolicy& policy) noexcept
+{
+	return SFB::AlignedSize(HeaderSize(streamCount), policy) + (ChannelBufferStride(capacityBytes, policy) * streamCount);
+}
+
 }
 
 #pragma mark Creation and Destruction
 
-SFB::CARingBuffer::CARingBuffer() noexcept
-: mBuffers(nullptr), mCapacityFrames(0), mCapacityFramesMask(0)
+SFB::CARingBuffer::CARingBuffer(uint32_t timeBoundsQueueSize) noexcept
+: mBuffers(nullptr), mWriteBufferLists{nullptr, nullptr}, mWriteVectorStartTime(0), mWriteVectorFrameCount(0), mCapacityFrames(0), mCapacityFramesMask(0), mIsMirrored(false), mTimeBoundsQueue(nullptr), mTimeBoundsQueueCounter(0), mContendedReads(0), mRetries(0), mFailedReads(0)
 {
 	assert(mTimeBoundsQueueCounter.is_lock_free());
+
+	// Round up to the next power of two
+	mTimeBoundsQueueMask = NextPowerOfTwo(std::clamp(timeBoundsQueueSize, 2u, 0x80000000u)) - 1;
 }
 
 SFB::CARingBuffer::~CARingBuffer()
 {
-	std::free(mBuffers);
+	Deallocate();
 }
 
 #pragma mark Buffer Management
 
-bool SFB::CARingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept
+bool SFB::CARingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, bool mirrored, const AllocationPolicy& policy) noexcept
 {
-	// Only non-interleaved formats are supported
-	if(format.IsInterleaved() || capacityFrames < 2 || capacityFrames > 0x80000000)
+	if(capacityFrames < 2 || capacityFrames > 0x80000000)
 		return false;
 
 	Deallocate();
@@ -105,37 +223,85 @@ bool SFB::CARingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_
 	// Round up to the next power of two
 	capacityFrames = NextPowerOfTwo(static_cast<uint32_t>(capacityFrames));
 
-	mFormat = format;
-
-	mCapacityFrames = capacityFrames;
-	mCapacityFramesMask = capacityFrames - 1;
+	// The page size is a power of two so a capacity in frames of at least one page
+	// is always a multiple of the page size in bytes
+	if(mirrored)
+		capacityFrames = std::max(capacityFrames, static_cast<uint32_t>(VirtualMemoryPageSize()));
 
 	uint32_t capacityBytes = capacityFrames * format.mBytesPerFrame;
+	auto streamCount = format.ChannelStreamCount();
 
-	// One memory allocation holds everything- first the pointers followed by the deinterleaved channels
-	uint32_t allocationSize = (capacityBytes + sizeof(uint8_t *)) * format.mChannelsPerFrame;
-	uint8_t *memoryChunk = static_cast<uint8_t *>(std::malloc(allocationSize));
-	if(!memoryChunk)
+	auto timeBoundsQueue = new (std::nothrow) TimeBounds [TimeBoundsQueueSize()];
+	if(!timeBoundsQueue)
 		return false;
 
-	// Zero the entire allocation
-	std::memset(memoryChunk, 0, allocationSize);
+	// Before C++20 the default constructor of std::atomic leaves the value uninitialized
+	for(uint32_t i = 0; i < TimeBoundsQueueSize(); ++i) {
+		timeBoundsQueue[i].mStartTime.store(0, std::memory_order_relaxed);
+		timeBoundsQueue[i].mEndTime.store(0, std::memory_order_relaxed);
+		timeBoundsQueue[i].mSequence.store(0, std::memory_order_relaxed);
+	}
+
+	if(mirrored) {
+		// Each channel buffer is mapped separately
+		auto buffers = static_cast<uint8_t **>(std::calloc(1, HeaderSize(streamCount)));
+		if(!buffers) {
+			delete [] timeBoundsQueue;
+			return false;
+		}
+
+		for(UInt32 i = 0; i < streamCount; ++i) {
+			buffers[i] = static_cast<uint8_t *>(AllocateMirroredMemory(capacityBytes));
+			if(buffers[i] && !PrepareMemory(buffers[i], capacityBytes * 2, policy)) {
+				DeallocateMirroredMemory(buffers[i], capacityBytes);
+				buffers[i] = nullptr;
+			}
+			if(!buffers[i]) {
+				for(UInt32 j = 0; j < i; ++j) {
+					UnprepareMemory(buffers[j], capacityBytes * 2, policy);
+					DeallocateMirroredMemory(buffers[j], capacityBytes);
+				}
+				std::free(buffers);
+				delete [] timeBoundsQueue;
+				return false;
+			}
+		}
 
-	// Assign the pointers and channel buffers
-	mBuffers = reinterpret_cast<uint8_t **>(memoryChunk);
-	memoryChunk += format.mChannelsPerFrame * sizeof(uint8_t *);
-	for(UInt32 i = 0; i < format.mChannelsPerFrame; ++i) {
-		mBuffers[i] = memoryChunk;
-		memoryChunk += capacityBytes;
+		mBuffers = buffers;
 	}
+	else {
+		// One memory allocation holds everything- first the pointers followed by the channel buffers
+		// The allocation is zero-filled
+		uint8_t *memoryChunk = static_cast<uint8_t *>(AllocateMemory(SingleAllocationSize(capacityBytes, streamCount, policy), policy));
+		if(!memoryChunk) {
+			delete [] timeBoundsQueue;
+			return false;
+		}
 
-	// Zero the time bounds queue
-	for(uint32_t i = 0; i < sTimeBoundsQueueSize; ++i) {
-		mTimeBoundsQueue[i].mStartTime = 0;
-		mTimeBoundsQueue[i].mEndTime = 0;
-		mTimeBoundsQueue[i].mUpdateCounter = 0;
+		// Assign the pointers and channel buffers
+		mBuffers = reinterpret_cast<uint8_t **>(memoryChunk);
+		memoryChunk += AlignedSize(HeaderSize(streamCount), policy);
+		for(UInt32 i = 0; i < streamCount; ++i) {
+			mBuffers[i] = memoryChunk;
+			memoryChunk += ChannelBufferStride(capacityBytes, policy);
+		}
 	}
 
+	// The buffer lists describing the write vector follow the channel stream pointers
+	auto bufferLists = reinterpret_cast<uint8_t *>(mBuffers + streamCount);
+	mWriteBufferLists[0] = reinterpret_cast<AudioBufferList *>(bufferLists);
+	mWriteBufferLists[1] = reinterpret_cast<AudioBufferList *>(bufferLists + BufferListSize(streamCount));
+	mWriteVectorStartTime = 0;
+	mWriteVectorFrameCount = 0;
+
+	mFormat = format;
+
+	mCapacityFrames = capacityFrames;
+	mCapacityFramesMask = capacityFrames - 1;
+	mIsMirrored = mirrored;
+	mAllocationPolicy = policy;
+
+	mTimeBoundsQueue = timeBoundsQueue;
 	mTimeBoundsQueueCounter = 0;
 
 	return true;
@@ -144,46 +310,103 @@ bool SFB::CARingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_
 void SFB::CARingBuffer::Deallocate() noexcept
 {
 	if(mBuffers) {
-		std::free(mBuffers);
+		const uint32_t capacityBytes = mCapacityFrames * mFormat.mBytesPerFrame;
+		const auto streamCount = mFormat.ChannelStreamCount();
+		if(mIsMirrored) {
+			for(UInt32 i = 0; i < streamCount; ++i) {
+				UnprepareMemory(mBuffers[i], capacityBytes * 2, mAllocationPolicy);
+				DeallocateMirroredMemory(mBuffers[i], capacityBytes);
+			}
+			std::free(mBuffers);
+		}
+		else
+			DeallocateMemory(mBuffers, SingleAllocationSize(capacityBytes, streamCount, mAllocationPolicy), mAllocationPolicy);
 		mBuffers = nullptr;
+		mWriteBufferLists[0] = mWriteBufferLists[1] = nullptr;
+		mWriteVectorStartTime = 0;
+		mWriteVectorFrameCount = 0;
 
 		mFormat.Reset();
 
 		mCapacityFrames = 0;
 		mCapacityFramesMask = 0;
+		mIsMirrored = false;
+		mAllocationPolicy = {};
 
-		for(uint32_t i = 0; i < sTimeBoundsQueueSize; ++i) {
-			mTimeBoundsQueue[i].mStartTime = 0;
-			mTimeBoundsQueue[i].mEndTime = 0;
-			mTimeBoundsQueue[i].mUpdateCounter = 0;
-		}
-
+		delete [] mTimeBoundsQueue;
+		mTimeBoundsQueue = nullptr;
 		mTimeBoundsQueueCounter = 0;
 	}
 }
 
 bool SFB::CARingBuffer::GetTimeBounds(int64_t& startTime, int64_t& endTime) const noexcept
 {
-	for(auto i = 0; i < 8; ++i) {
-		auto currentCounter = mTimeBoundsQueueCounter.load(std::memory_order_acquire);
-		auto currentIndex = currentCounter & sTimeBoundsQueueMask;
+	if(!mTimeBoundsQueue)
+		return false;
 
-		const SFB::CARingBuffer::TimeBounds * const bounds = mTimeBoundsQueue + currentIndex;
+	for(uint32_t attempt = 0; attempt < sMaxTimeBoundsReadAttempts; ++attempt) {
+		const auto currentCounter = mTimeBoundsQueueCounter.load(std::memory_order_acquire);
+		const auto& bounds = mTimeBoundsQueue[currentCounter & mTimeBoundsQueueMask];
 
-		startTime = bounds->mStartTime;
-		endTime = bounds->mEndTime;
+		// An odd sequence number indicates the writer is modifying the slot
+		const auto sequence = bounds.mSequence.load(std::memory_order_acquire);
+		if(sequence & 1)
+			continue;
 
-		auto counter = bounds->mUpdateCounter.load(std::memory_order_acquire);
-		if(counter == currentCounter)
+		startTime = bounds.mStartTime.load(std::memory_order_relaxed);
+		endTime = bounds.mEndTime.load(std::memory_order_relaxed);
+
+		// If the sequence number is unchanged the slot was not modified while it was read.
+		// The slot may have been reused for newer time bounds than those at currentCounter, which are equally valid.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(bounds.mSequence.load(std::memory_order_relaxed) == sequence) {
+			if(attempt > 0) {
+				mContendedReads.fetch_add(1, std::memory_order_relaxed);
+				mRetries.fetch_add(attempt, std::memory_order_relaxed);
+			}
 			return true;
+		}
 	}
 
+	mContendedReads.fetch_add(1, std::memory_order_relaxed);
+	mRetries.fetch_add(sMaxTimeBoundsReadAttempts - 1, std::memory_order_relaxed);
+	mFailedReads.fetch_add(1, std::memory_order_relaxed);
+
 	return false;
 }
 
+#pragma mark Time Bounds Statistics
+
+SFB::CARingBuffer::TimeBoundsStatistics SFB::CARingBuffer::Statistics() const noexcept
+{
+	return {
+		.mContendedReads = mContendedReads.load(std::memory_order_relaxed),
+		.mRetries = mRetries.load(std::memory_order_relaxed),
+		.mFailedReads = mFailedReads.load(std::memory_order_relaxed),
+	};
+}
+
+void SFB::CARingBuffer::ResetStatistics() noexcept
+{
+	mContendedReads.store(0, std::memory_order_relaxed);
+	mRetries.store(0, std::memory_order_relaxed);
+	mFailedReads.store(0, std::memory_order_relaxed);
+}
+
 #pragma mark Reading and Writing Audio
 
 bool SFB::CARingBuffer::Read(AudioBufferList * const bufferList, uint32_t frameCount, int64_t startRead) noexcept
+{
+	return Read(bufferList, mFormat, frameCount, startRead);
+}
+
+bool SFB::CARingBuffer::Read(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t startRead) noexcept
+{
+	int64_t startTime, endTime;
+	return Read(bufferList, format, frameCount, startRead, startTime, endTime);
+}
+
+bool SFB::CARingBuffer::Read(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t startRead, int64_t& startTime, int64_t& endTime) noexcept
 {
 	if(frameCount == 0)
 		return true;
@@ -191,51 +414,83 @@ bool SFB::CARingBuffer::Read(AudioBufferList * const bufferList, uint32_t frameC
 	if(!bufferList || frameCount > mCapacityFrames || startRead < 0)
 		return false;
 
+	if(!IsCompatibleFormat(format, mFormat))
+		return false;
+
+	// Interleaving or deinterleaving requires the buffer list to match its format
+	if(format.IsInterleaved() != mFormat.IsInterleaved()) {
+		if(bufferList->mNumberBuffers != format.ChannelStreamCount() || FrameCapacity(bufferList, format) < frameCount)
+			return false;
+	}
+
+	const Telemetry::Interval interval(mTelemetry, "CARingBuffer::Read");
+
 	auto endRead = startRead + static_cast<int64_t>(frameCount);
 
 	auto startRead0 = startRead;
 	auto endRead0 = endRead;
 
-	if(!ClampTimesToBounds(startRead, endRead))
+	if(!ClampTimesToBounds(startRead, endRead, startTime, endTime))
 		return false;
 
+	mTelemetry.RecordFillLevel(static_cast<uint32_t>(endTime - startTime));
+
+	// Frames preceding the start of the audio in the ring buffer were overwritten before they could be read
+	const auto overrunFrames = std::min(endRead0, startTime) - startRead0;
+	if(overrunFrames > 0)
+		mTelemetry.RecordOverrun(static_cast<uint64_t>(overrunFrames));
+
+	// Frames following the end of the audio in the ring buffer have not yet been written
+	const auto underrunFrames = endRead0 - std::max(startRead0, endTime);
+	if(underrunFrames > 0)
+		mTelemetry.RecordUnderrun(static_cast<uint64_t>(underrunFrames));
+
 	if(startRead == endRead) {
-		ZeroABL(bufferList, 0, frameCount * mFormat.mBytesPerFrame);
+		ZeroABL(bufferList, 0, frameCount * format.mBytesPerFrame);
 		return true;
 	}
 
-	auto byteSize = static_cast<uint32_t>(endRead - startRead) * mFormat.mBytesPerFrame;
+	auto framesToRead = static_cast<uint32_t>(endRead - startRead);
 
-	auto destStartByteOffset = static_cast<uint32_t>(std::max(static_cast<int64_t>(0), (startRead - startRead0) * mFormat.mBytesPerFrame));
-	if(destStartByteOffset > 0)
-		ZeroABL(bufferList, 0, std::min(frameCount * mFormat.mBytesPerFrame, destStartByteOffset));
+	auto destStartFrameOffset = static_cast<uint32_t>(std::max(static_cast<int64_t>(0), startRead - startRead0));
+	if(destStartFrameOffset > 0)
+		ZeroABL(bufferList, 0, std::min(frameCount, destStartFrameOffset) * format.mBytesPerFrame);
 
 	auto destEndSize = static_cast<uint32_t>(std::max(static_cast<int64_t>(0), endRead0 - endRead));
 	if(destEndSize > 0)
-		ZeroABL(bufferList, destStartByteOffset + byteSize, destEndSize * mFormat.mBytesPerFrame);
+		ZeroABL(bufferList, (destStartFrameOffset + framesToRead) * format.mBytesPerFrame, destEndSize * format.mBytesPerFrame);
 
-	auto offset0 = FrameByteOffset(startRead);
-	auto offset1 = FrameByteOffset(endRead);
-	uint32_t byteCount;
+	auto offset0 = FrameOffset(startRead);
+	auto offset1 = FrameOffset(endRead);
+	uint32_t framesRead;
 
-	if(offset0 < offset1) {
-		byteCount = offset1 - offset0;
-		FetchABL(bufferList, destStartByteOffset, mBuffers, offset0, byteCount);
+	if(mIsMirrored) {
+		framesRead = framesToRead;
+		FetchFrames(bufferList, format, destStartFrameOffset, mBuffers, mFormat, offset0, framesRead);
+	}
+	else if(offset0 < offset1) {
+		framesRead = offset1 - offset0;
+		FetchFrames(bufferList, format, destStartFrameOffset, mBuffers, mFormat, offset0, framesRead);
 	}
 	else {
-		byteCount = static_cast<UInt32>((mCapacityFrames * mFormat.mBytesPerFrame) - offset0);
-		FetchABL(bufferList, destStartByteOffset, mBuffers, offset0, byteCount);
-		FetchABL(bufferList, destStartByteOffset + byteCount, mBuffers, 0, offset1);
-		byteCount += offset1;
+		framesRead = mCapacityFrames - offset0;
+		FetchFrames(bufferList, format, destStartFrameOffset, mBuffers, mFormat, offset0, framesRead);
+		FetchFrames(bufferList, format, destStartFrameOffset + framesRead, mBuffers, mFormat, 0, offset1);
+		framesRead += offset1;
 	}
 
 	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
-		bufferList->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCount);
+		bufferList->mBuffers[i].mDataByteSize = framesRead * format.mBytesPerFrame;
 
 	return true;
 }
 
 bool SFB::CARingBuffer::Write(const AudioBufferList * const bufferList, uint32_t frameCount, int64_t startWrite) noexcept
+{
+	return Write(bufferList, mFormat, frameCount, startWrite);
+}
+
+bool SFB::CARingBuffer::Write(const AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t startWrite) noexcept
 {
 	if(frameCount == 0)
 		return true;
@@ -243,8 +498,111 @@ bool SFB::CARingBuffer::Write(const AudioBufferList * const bufferList, uint32_t
 	if(!bufferList || frameCount > mCapacityFrames || startWrite < 0)
 		return false;
 
+	if(!IsCompatibleFormat(format, mFormat))
+		return false;
+
+	// Interleaving or deinterleaving requires the buffer list to match its format
+	if(format.IsInterleaved() != mFormat.IsInterleaved()) {
+		if(bufferList->mNumberBuffers != format.ChannelStreamCount() || FrameCapacity(bufferList, format) < frameCount)
+			return false;
+	}
+
+	const Telemetry::Interval interval(mTelemetry, "CARingBuffer::Write");
+
+	auto endWrite = startWrite + static_cast<int64_t>(frameCount);
+
+	PrepareWrite(startWrite, endWrite);
+
+	auto offset0 = FrameOffset(startWrite);
+	auto offset1 = FrameOffset(endWrite);
+	if(mIsMirrored)
+		StoreFrames(mBuffers, mFormat, offset0, bufferList, format, 0, frameCount);
+	else if(offset0 < offset1)
+		StoreFrames(mBuffers, mFormat, offset0, bufferList, format, 0, offset1 - offset0);
+	else {
+		auto framesAfterOffset = mCapacityFrames - offset0;
+		StoreFrames(mBuffers, mFormat, offset0, bufferList, format, 0, framesAfterOffset);
+		StoreFrames(mBuffers, mFormat, 0, bufferList, format, framesAfterOffset, offset1);
+	}
+
+	// Update the end time
+	SetTimeBounds(StartTime(), endWrite);
+
+	return true;
+}
+
+#pragma mark In-place Access
+
+const SFB::CARingBuffer::WriteBufferListPair SFB::CARingBuffer::WriteVector(uint32_t frameCount, int64_t startWrite) noexcept
+{
+	mWriteVectorFrameCount = 0;
+
+	if(!mBuffers || frameCount == 0 || frameCount > mCapacityFrames || startWrite < 0)
+		return {};
+
 	auto endWrite = startWrite + static_cast<int64_t>(frameCount);
 
+	PrepareWrite(startWrite, endWrite);
+
+	mWriteVectorStartTime = startWrite;
+	mWriteVectorFrameCount = frameCount;
+
+	auto offset0 = FrameOffset(startWrite);
+	if(!mIsMirrored && offset0 + frameCount > mCapacityFrames) {
+		auto framesAfterOffset = mCapacityFrames - offset0;
+		SetBufferList(mWriteBufferLists[0], mBuffers, mFormat, offset0, framesAfterOffset);
+		SetBufferList(mWriteBufferLists[1], mBuffers, mFormat, 0, frameCount - framesAfterOffset);
+		return { { mWriteBufferLists[0], framesAfterOffset }, { mWriteBufferLists[1], frameCount - framesAfterOffset } };
+	}
+
+	SetBufferList(mWriteBufferLists[0], mBuffers, mFormat, offset0, frameCount);
+	return { { mWriteBufferLists[0], frameCount }, {} };
+}
+
+bool SFB::CARingBuffer::CommitWrite(uint32_t frameCount) noexcept
+{
+	if(mWriteVectorFrameCount == 0)
+		return false;
+
+	// The time bounds were adjusted by WriteVector() so only the end time changes
+	SetTimeBounds(StartTime(), mWriteVectorStartTime + std::min(frameCount, mWriteVectorFrameCount));
+	mWriteVectorFrameCount = 0;
+
+	return true;
+}
+
+uint32_t SFB::CARingBuffer::ReadVector(AudioBufferList * const first, AudioBufferList * const second, uint32_t frameCount, int64_t& startRead) const noexcept
+{
+	const auto streamCount = mFormat.ChannelStreamCount();
+	if(!mBuffers || !first || !second || first->mNumberBuffers < streamCount || second->mNumberBuffers < streamCount || frameCount == 0 || frameCount > mCapacityFrames || startRead < 0)
+		return 0;
+
+	auto endRead = startRead + static_cast<int64_t>(frameCount);
+
+	int64_t startTime, endTime;
+	if(!ClampTimesToBounds(startRead, endRead, startTime, endTime) || startRead == endRead)
+		return 0;
+
+	auto framesToRead = static_cast<uint32_t>(endRead - startRead);
+
+	auto offset0 = FrameOffset(startRead);
+	if(!mIsMirrored && offset0 + framesToRead > mCapacityFrames) {
+		auto framesAfterOffset = mCapacityFrames - offset0;
+		SetBufferList(first, mBuffers, mFormat, offset0, framesAfterOffset);
+		SetBufferList(second, mBuffers, mFormat, 0, framesToRead - framesAfterOffset);
+	}
+	else {
+		SetBufferList(first, mBuffers, mFormat, offset0, framesToRead);
+		SetBufferList(second, mBuffers, mFormat, 0, 0);
+	}
+
+	return framesToRead;
+}
+
+#pragma mark Internals
+
+void SFB::CARingBuffer::PrepareWrite(int64_t startWrite, int64_t endWrite) noexcept
+{
 	// Going backwards, throw everything out
 	if(startWrite < EndTime())
 		SetTimeBounds(startWrite, startWrite);
@@ -258,57 +616,41 @@ bool SFB::CARingBuffer::Write(const AudioBufferList * const bufferList, uint32_t
 		SetTimeBounds(newStart, newEnd);
 	}
 
-	uint32_t offset0, offset1;
 	auto curEnd = EndTime();
 
 	if(startWrite > curEnd) {
 		// Zero the range of samples being skipped
-		offset0 = FrameByteOffset(curEnd);
-		offset1 = FrameByteOffset(startWrite);
+		auto offset0 = FrameByteOffset(curEnd);
+		auto offset1 = FrameByteOffset(startWrite);
 		if(offset0 < offset1)
 			ZeroRange(mBuffers, mFormat.ChannelStreamCount(), offset0, offset1 - offset0);
 		else {
 			ZeroRange(mBuffers, mFormat.ChannelStreamCount(), offset0, (mCapacityFrames * mFormat.mBytesPerFrame) - offset0);
 			ZeroRange(mBuffers, mFormat.ChannelStreamCount(), 0, offset1);
 		}
-
-		offset0 = offset1;
 	}
-	else
-		offset0 = FrameByteOffset(startWrite);
-
-	offset1 = FrameByteOffset(endWrite);
-	if(offset0 < offset1)
-		StoreABL(mBuffers, offset0, bufferList, 0, offset1 - offset0);
-	else {
-		auto byteCount = (mCapacityFrames * mFormat.mBytesPerFrame) - offset0;
-		StoreABL(mBuffers, offset0, bufferList, 0, byteCount);
-		StoreABL(mBuffers, 0, bufferList, byteCount, offset1);
-	}
-
-	// Update the end time
-	SetTimeBounds(StartTime(), endWrite);
-
-	return true;
 }
 
-#pragma mark Internals
-
 void SFB::CARingBuffer::SetTimeBounds(int64_t startTime, int64_t endTime) noexcept
 {
-	auto nextCounter = mTimeBoundsQueueCounter.load(std::memory_order_acquire) + 1;
-	auto nextIndex = nextCounter & sTimeBoundsQueueMask;
+	auto nextCounter = mTimeBoundsQueueCounter.load(std::memory_order_relaxed) + 1;
+	auto& bounds = mTimeBoundsQueue[nextCounter & mTimeBoundsQueueMask];
+
+	// Readers of this slot retry while the sequence number is odd or if it changes during their read
+	const auto sequence = bounds.mSequence.load(std::memory_order_relaxed);
+	bounds.mSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
 
-	mTimeBoundsQueue[nextIndex].mStartTime = startTime;
-	mTimeBoundsQueue[nextIndex].mEndTime = endTime;
-	mTimeBoundsQueue[nextIndex].mUpdateCounter.store(nextCounter, std::memory_order_release);
+	bounds.mStartTime.store(startTime, std::memory_order_relaxed);
+	bounds.mEndTime.store(endTime, std::memory_order_relaxed);
+
+	bounds.mSequence.store(sequence + 2, std::memory_order_release);
 
 	mTimeBoundsQueueCounter.store(nextCounter, std::memory_order_release);
 }
 
-bool SFB::CARingBuffer::ClampTimesToBounds(int64_t& startRead, int64_t& endRead) const noexcept
+bool SFB::CARingBuffer::ClampTimesToBounds(int64_t& startRead, int64_t& endRead, int64_t& startTime, int64_t& endTime) const noexcept
 {
-	int64_t startTime, endTime;
 	if(!GetTimeBounds(startTime, endTime))
 		return false;
 
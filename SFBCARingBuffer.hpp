@@ -7,16 +7,21 @@
 #pragma once
 
 #import <atomic>
+#import <utility>
 
 #import <CoreAudioTypes/CoreAudioTypes.h>
 
+#import "SFBAllocationPolicy.hpp"
 #import "SFBCAStreamBasicDescription.hpp"
+#import "SFBTelemetry.hpp"
 
 namespace SFB {
 
-/// A ring buffer supporting timestamped non-interleaved audio based on Apple's @c CARingBuffer.
+/// A ring buffer supporting timestamped interleaved and non-interleaved audio based on Apple's @c CARingBuffer.
 ///
-/// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer model).
+/// This class is thread safe when used from one writer thread and any number of reader threads. Reading does not modify
+/// the buffer so the audio is stored once regardless of the number of readers. @c CARingBufferReader provides
+/// each reader with its own position and underrun and overrun statistics.
 class CARingBuffer
 {
 
@@ -24,9 +29,17 @@ public:
 
 #pragma mark Creation and Destruction
 
+	/// The default number of time bounds retained for readers
+	static constexpr uint32_t sDefaultTimeBoundsQueueSize = 32;
+
 	/// Creates a new @c CARingBuffer
+	///
+	/// Each write publishes the buffer's new time bounds to the next of @c timeBoundsQueueSize slots. A reader only has to
+	/// retry if the writer publishes to the slot it is reading, so deeper queues tolerate readers that are preempted for
+	/// longer while reading the time bounds.
 	/// @note @c Allocate() must be called before the object may be used.
-	CARingBuffer() noexcept;
+	/// @param timeBoundsQueueSize The number of time bounds retained for readers, rounded up to a power of two
+	explicit CARingBuffer(uint32_t timeBoundsQueueSize = sDefaultTimeBoundsQueueSize) noexcept;
 
 	// This class is non-copyable
 	CARingBuffer(const CARingBuffer& rhs) = delete;
@@ -46,13 +59,21 @@ public:
 #pragma mark Buffer management
 
 	/// Allocates space for audio data.
-	/// @note Only interleaved formats are supported.
+	///
+	/// If @c mirrored is @c true each channel buffer is mapped twice in consecutive virtual memory so
+	/// transfers that wrap around the end of the buffer are performed with a single copy per channel.
+	/// A mirrored buffer's capacity is at least one virtual memory page in frames.
+	///
+	/// @c policy controls the alignment and padding of the channel buffers and whether their memory is locked
+	/// and prefaulted. Mirrored channel buffers are always page aligned and are not padded.
 	/// @note This method is not thread safe.
 	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) frames are supported
 	/// @param format The format of the audio that will be written to and read from this buffer.
 	/// @param capacityFrames The desired capacity, in frames
+	/// @param mirrored Whether the channel buffers should be mapped twice in consecutive virtual memory
+	/// @param policy The allocation policy
 	/// @return @c true on success, @c false on error
-	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept;
+	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, bool mirrored = false, const AllocationPolicy& policy = {}) noexcept;
 
 	/// Frees the resources used by this @c CARingBuffer
 	/// @note This method is not thread safe.
@@ -71,12 +92,71 @@ public:
 		return mFormat;
 	}
 
+	/// Returns @c true if the channel buffers of this @c CARingBuffer are mapped twice in consecutive virtual memory
+	inline bool IsMirrored() const noexcept
+	{
+		return mIsMirrored;
+	}
+
+	/// Returns the number of time bounds retained for readers
+	inline uint32_t TimeBoundsQueueSize() const noexcept
+	{
+		return mTimeBoundsQueueMask + 1;
+	}
+
 	/// Gets the time bounds of the audio contained in this @c CARingBuffer
+	///
+	/// The time bounds are read without locking. If the writer modifies the time bounds while they are being read the
+	/// read is retried, at most @c sMaxTimeBoundsReadAttempts times in total.
 	/// @param startTime The starting sample time of audio contained in the buffer
 	/// @param endTime The end sample time of audio contained in the buffer
 	/// @return @c true on success, @c false on error
 	bool GetTimeBounds(int64_t& startTime, int64_t& endTime) const noexcept;
 
+#pragma mark Time bounds statistics
+
+	/// The maximum number of attempts made to read a consistent set of time bounds
+	static constexpr uint32_t sMaxTimeBoundsReadAttempts = 16;
+
+	/// Counts of contention between readers of the time bounds and the writer
+	struct TimeBoundsStatistics
+	{
+		/// The number of reads of the time bounds that were retried at least once
+		uint64_t mContendedReads;
+		/// The total number of retries
+		uint64_t mRetries;
+		/// The number of reads of the time bounds that failed after @c sMaxTimeBoundsReadAttempts attempts
+		uint64_t mFailedReads;
+	};
+
+	/// Returns the time bounds statistics
+	/// @note This method is safe to call from any thread
+	TimeBoundsStatistics Statistics() const noexcept;
+
+	/// Resets the time bounds statistics
+	/// @note This method is safe to call from any thread
+	void ResetStatistics() noexcept;
+
+#pragma mark Telemetry
+
+	/// Returns the telemetry recorded by @c Read() and @c Write()
+	///
+	/// Reads of audio that has not yet been written are counted as underruns and reads of audio that has already been
+	/// overwritten are counted as overruns. Fill levels are the number of frames in the time bounds observed by readers.
+	/// @note All values are zero unless @c SFB_ENABLE_TELEMETRY is nonzero
+	/// @note This method is safe to call from any thread
+	inline TelemetryStatistics SampleTelemetry() const noexcept
+	{
+		return mTelemetry.Statistics();
+	}
+
+	/// Resets the telemetry recorded by @c Read() and @c Write()
+	/// @note This method is safe to call from any thread
+	inline void ResetTelemetry() noexcept
+	{
+		mTelemetry.ResetStatistics();
+	}
+
 #pragma mark Reading and writing audio
 
 	/// Reads audio from the @c CARingBuffer
@@ -91,6 +171,14 @@ public:
 	/// @return @c true on success, @c false on error
 	bool Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, int64_t timeStamp) noexcept;
 
+	/// Reads audio from the @c CARingBuffer, interleaving or deinterleaving as needed
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param format The format of @c bufferList, which must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to read
+	/// @param timeStamp The starting sample time
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t timeStamp) noexcept;
+
 	/// Writes audio to the @c CARingBuffer
 	/// @note Negative time stamps are not supported
 	/// @param bufferList An @c AudioBufferList containing the audio to copy
@@ -99,69 +187,187 @@ public:
 	/// @return @c true on success, @c false on error
 	bool Write(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, int64_t timeStamp) noexcept;
 
+	/// Writes audio to the @c CARingBuffer, interleaving or deinterleaving as needed
+	/// @note Negative time stamps are not supported
+	/// @param bufferList An @c AudioBufferList containing the audio to copy
+	/// @param format The format of @c bufferList, which must be @c Format() or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to write
+	/// @param timeStamp The starting sample time
+	/// @return @c true on success, @c false on error
+	bool Write(const AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t timeStamp) noexcept;
+
+#pragma mark In-place access
+
+	/// A write-only region of the channel buffers
+	struct WriteBufferList {
+		/// The channel buffers in @c Format() or @c nullptr if the region is empty
+		AudioBufferList * const _Nullable mBufferList;
+		/// The capacity of @c mBufferList in frames
+		const uint32_t mFrameCapacity;
+
+		/// Construct an empty @c WriteBufferList
+		WriteBufferList() noexcept
+		: WriteBufferList(nullptr, 0)
+		{}
+
+		/// Construct a @c WriteBufferList for the specified channel buffers and capacity
+		/// @param bufferList The channel buffers
+		/// @param frameCapacity The capacity of @c bufferList in frames
+		WriteBufferList(AudioBufferList * const _Nullable bufferList, uint32_t frameCapacity) noexcept
+		: mBufferList(bufferList), mFrameCapacity(frameCapacity)
+		{}
+	};
+
+	/// A pair of @c WriteBufferList objects
+	using WriteBufferListPair = std::pair<const WriteBufferList, const WriteBufferList>;
+
+	/// Returns the write vector for @c frameCount frames starting at @c timeStamp
+	///
+	/// The regions point directly into the channel buffers so an @c AudioConverter or decoder may render into them.
+	/// The audio is not visible to readers until @c CommitWrite() is called. The time bounds are adjusted as for
+	/// @c Write() when the write vector is returned so readers never see a region while it is being overwritten.
+	/// The second region is used only when the frames wrap around the end of a buffer that is not mirrored.
+	/// @note This method must only be called from the writer thread
+	/// @note Negative time stamps are not supported
+	/// @note The buffer lists are owned by the @c CARingBuffer and remain valid until the next call to @c WriteVector()
+	/// @param frameCount The desired number of frames to write
+	/// @param timeStamp The starting sample time
+	/// @return The write vector, which is empty on error
+	const WriteBufferListPair WriteVector(uint32_t frameCount, int64_t timeStamp) noexcept;
+
+	/// Publishes audio rendered into the regions returned by @c WriteVector()
+	/// @note This method must only be called from the writer thread
+	/// @param frameCount The number of frames written, which is limited to the number of frames requested from @c WriteVector()
+	/// @return @c true on success, @c false if there is no write vector to commit
+	bool CommitWrite(uint32_t frameCount) noexcept;
+
+	/// Describes the regions of the channel buffers containing audio starting at @c timeStamp
+	///
+	/// The regions point directly into the channel buffers so the audio may be processed in place. Frames outside the
+	/// buffer's time bounds are excluded rather than filled with silence. A sufficiently slow reader may be lapped by
+	/// the writer while processing the audio; if the starting sample time returned by @c GetTimeBounds() afterwards
+	/// exceeds @c timeStamp some of the audio was overwritten.
+	/// @note Negative time stamps are not supported
+	/// @param first An @c AudioBufferList with at least @c Format().ChannelStreamCount() buffers set to the first region on return
+	/// @param second An @c AudioBufferList with at least @c Format().ChannelStreamCount() buffers set to the region following the wrap, if any, on return
+	/// @param frameCount The desired number of frames
+	/// @param timeStamp The desired starting sample time, set to the sample time of the first frame in @c first on return
+	/// @return The number of frames in both regions or @c 0 on error
+	uint32_t ReadVector(AudioBufferList * const _Nonnull first, AudioBufferList * const _Nonnull second, uint32_t frameCount, int64_t& timeStamp) const noexcept;
+
 protected:
 
+	/// Returns the frame offset of @c frameNumber
+	inline uint32_t FrameOffset(int64_t frameNumber) const noexcept
+	{
+		return static_cast<uint32_t>(static_cast<uint64_t>(frameNumber) & mCapacityFramesMask);
+	}
+
 	/// Returns the byte offset of @c frameNumber
 	inline uint32_t FrameByteOffset(int64_t frameNumber) const noexcept
 	{
-		return (static_cast<uint64_t>(frameNumber) & mCapacityFramesMask) * mFormat.mBytesPerFrame;
+		return FrameOffset(frameNumber) * mFormat.mBytesPerFrame;
 	}
 
 	/// Constrains @c startRead and @c endRead to valid timestamps in the buffer
-	bool ClampTimesToBounds(int64_t& startRead, int64_t& endRead) const noexcept;
+	/// @param startRead The starting sample time to constrain
+	/// @param endRead The ending sample time to constrain
+	/// @param startTime The starting sample time of audio contained in the buffer used to constrain the times
+	/// @param endTime The end sample time of audio contained in the buffer used to constrain the times
+	/// @return @c true on success, @c false if the time bounds could not be read
+	bool ClampTimesToBounds(int64_t& startRead, int64_t& endRead, int64_t& startTime, int64_t& endTime) const noexcept;
+
+	/// Reads audio from the @c CARingBuffer and returns the time bounds used for the read
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param format The format of @c bufferList
+	/// @param frameCount The desired number of frames to read
+	/// @param timeStamp The starting sample time
+	/// @param startTime The starting sample time of audio contained in the buffer when it was read
+	/// @param endTime The end sample time of audio contained in the buffer when it was read
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t timeStamp, int64_t& startTime, int64_t& endTime) noexcept;
 
 	/// Returns the buffer's starting sample time
 	/// @note This should only be called from @c Write()
 	inline int64_t StartTime() const noexcept
 	{
-		return mTimeBoundsQueue[mTimeBoundsQueueCounter.load(std::memory_order_acquire) & sTimeBoundsQueueMask].mStartTime;
+		return mTimeBoundsQueue[mTimeBoundsQueueCounter.load(std::memory_order_relaxed) & mTimeBoundsQueueMask].mStartTime.load(std::memory_order_relaxed);
 	}
 
 	/// Returns the buffer's ending sample time
 	/// @note This should only be called from @c Write()
 	inline int64_t EndTime() const noexcept
 	{
-		return mTimeBoundsQueue[mTimeBoundsQueueCounter.load(std::memory_order_acquire) & sTimeBoundsQueueMask].mEndTime;
+		return mTimeBoundsQueue[mTimeBoundsQueueCounter.load(std::memory_order_relaxed) & mTimeBoundsQueueMask].mEndTime.load(std::memory_order_relaxed);
 	}
 
 	/// Sets the buffer's start and end sample times
 	/// @note This should only be called from @c Write()
 	void SetTimeBounds(int64_t startTime, int64_t endTime) noexcept;
 
+	/// Adjusts the time bounds and zeroes any gap before storing frames from @c startWrite to @c endWrite
+	/// @note This should only be called from @c Write() and @c WriteVector()
+	void PrepareWrite(int64_t startWrite, int64_t endWrite) noexcept;
+
 private:
 
+	// CARingBufferReader needs the time bounds used for each read
+	friend class CARingBufferReader;
+
 	/// The format of the audio
 	CAStreamBasicDescription mFormat;
 
-	/// The channel pointers and buffers allocated in one chunk of memory
+	/// The channel stream pointers and buffers allocated in one chunk of memory
+	/// @note For mirrored buffers the channel pointers are allocated separately from the channel buffers
 	uint8_t * _Nonnull * _Nullable mBuffers;
-
-	/// The frame capacity per channel
+	/// The buffer lists describing the write vector, allocated following the channel stream pointers
+	AudioBufferList * _Nullable mWriteBufferLists [2];
+	/// The starting sample time of the write vector
+	int64_t mWriteVectorStartTime;
+	/// The number of frames in the write vector or @c 0 if there is no write vector to commit
+	uint32_t mWriteVectorFrameCount;
+
+	/// The frame capacity per channel stream
 	uint32_t mCapacityFrames;
 	/// Mask used to wrap read and write locations
 	/// @note Equal to @c mCapacityFrames-1
 	uint32_t mCapacityFramesMask;
+	/// @c true if the channel buffers are mapped twice in consecutive virtual memory
+	bool mIsMirrored;
+	/// The policy used to allocate the channel buffers
+	AllocationPolicy mAllocationPolicy;
 
-	/// A range of valid sample times in the buffer
+	/// A range of valid sample times in the buffer protected by a sequence lock
 	struct TimeBounds {
 		/// The starting sample time
-		int64_t mStartTime;
+		std::atomic_int64_t mStartTime;
 		/// The ending sample time
-		int64_t mEndTime;
-		/// The value of @c mTimeBoundsQueueCounter when the struct was modified
-		std::atomic_uint64_t mUpdateCounter;
+		std::atomic_int64_t mEndTime;
+		/// Sequence number incremented before and after the struct is modified
+		/// @note The sequence number is odd while a modification is in progress
+		std::atomic_uint64_t mSequence;
 	};
 
-	/// The number of elements in @c mTimeBoundsQueue
-	static const uint32_t sTimeBoundsQueueSize = 32;
-	/// Mask value used to wrap time bounds counters
-	/// @note Equal to @c sTimeBoundsQueueSize-1
-	static const uint32_t sTimeBoundsQueueMask = sTimeBoundsQueueSize - 1;
+	/// Destructive interference size for atomic variables
+	static constexpr size_t sCacheLineSize = 128;
 
 	/// Array of @c TimeBounds structs
-	TimeBounds mTimeBoundsQueue[sTimeBoundsQueueSize];
+	TimeBounds * _Nullable mTimeBoundsQueue;
+	/// Mask value used to wrap time bounds counters
+	/// @note Equal to the number of elements in @c mTimeBoundsQueue minus one
+	uint32_t mTimeBoundsQueueMask;
 	/// Monotonically increasing counter incremented when the buffer's time bounds changes
-	std::atomic_uint64_t mTimeBoundsQueueCounter;
+	alignas(sCacheLineSize) std::atomic_uint64_t mTimeBoundsQueueCounter;
+
+	/// The number of reads of the time bounds that were retried
+	alignas(sCacheLineSize) mutable std::atomic_uint64_t mContendedReads;
+	/// The total number of retried reads of the time bounds
+	mutable std::atomic_uint64_t mRetries;
+	/// The number of failed reads of the time bounds
+	mutable std::atomic_uint64_t mFailedReads;
+
+	/// Telemetry recorded by @c Read() and @c Write()
+	[[no_unique_address]] Telemetry mTelemetry;
 
 };
 
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+
+#import "SFBCARingBufferReader.hpp"
+
+SFB::CARingBufferReader::CARingBufferReader(CARingBuffer& ringBuffer) noexcept
+: mRingBuffer(ringBuffer), mPosition(0), mFramesRequested(0), mUnderruns(0), mUnderrunFrames(0), mOverruns(0), mOverrunFrames(0)
+{}
+
+#pragma mark Position
+
+bool SFB::CARingBufferReader::SeekToLatency(uint32_t latency) noexcept
+{
+	int64_t startTime, endTime;
+	if(!mRingBuffer.GetTimeBounds(startTime, endTime))
+		return false;
+
+	mPosition = std::max(endTime - static_cast<int64_t>(latency), static_cast<int64_t>(0));
+
+	return true;
+}
+
+bool SFB::CARingBufferReader::GetLatency(int64_t& latency) const noexcept
+{
+	int64_t startTime, endTime;
+	if(!mRingBuffer.GetTimeBounds(startTime, endTime))
+		return false;
+
+	latency = endTime - mPosition;
+
+	return true;
+}
+
+#pragma mark Reading Audio
+
+bool SFB::CARingBufferReader::Read(AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	return Read(bufferList, mRingBuffer.Format(), frameCount, mPosition);
+}
+
+bool SFB::CARingBufferReader::Read(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept
+{
+	return Read(bufferList, format, frameCount, mPosition);
+}
+
+bool SFB::CARingBufferReader::Read(AudioBufferList * const bufferList, uint32_t frameCount, int64_t timeStamp) noexcept
+{
+	return Read(bufferList, mRingBuffer.Format(), frameCount, timeStamp);
+}
+
+bool SFB::CARingBufferReader::Read(AudioBufferList * const bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t timeStamp) noexcept
+{
+	if(frameCount == 0) {
+		mPosition = timeStamp;
+		return true;
+	}
+
+	int64_t startTime, endTime;
+	if(!mRingBuffer.Read(bufferList, format, frameCount, timeStamp, startTime, endTime))
+		return false;
+
+	const auto endRead = timeStamp + static_cast<int64_t>(frameCount);
+	mPosition = endRead;
+
+	mFramesRequested.fetch_add(frameCount, std::memory_order_relaxed);
+
+	// Frames preceding the start of the audio in the ring buffer were overwritten before they could be read
+	const auto overrunFrames = std::min(endRead, startTime) - timeStamp;
+	if(overrunFrames > 0) {
+		mOverruns.fetch_add(1, std::memory_order_relaxed);
+		mOverrunFrames.fetch_add(static_cast<uint64_t>(overrunFrames), std::memory_order_relaxed);
+	}
+
+	// Frames following the end of the audio in the ring buffer have not yet been written
+	const auto underrunFrames = endRead - std::max(timeStamp, endTime);
+	if(underrunFrames > 0) {
+		mUnderruns.fetch_add(1, std::memory_order_relaxed);
+		mUnderrunFrames.fetch_add(static_cast<uint64_t>(underrunFrames), std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+#pragma mark Statistics
+
+SFB::CARingBufferReader::ReaderStatistics SFB::CARingBufferReader::Statistics() const noexcept
+{
+	return {
+		.mFramesRequested = mFramesRequested.load(std::memory_order_relaxed),
+		.mUnderruns = mUnderruns.load(std::memory_order_relaxed),
+		.mUnderrunFrames = mUnderrunFrames.load(std::memory_order_relaxed),
+		.mOverruns = mOverruns.load(std::memory_order_relaxed),
+		.mOverrunFrames = mOverrunFrames.load(std::memory_order_relaxed),
+	};
+}
+
+void SFB::CARingBufferReader::ResetStatistics() noexcept
+{
+	mFramesRequested.store(0, std::memory_order_relaxed);
+	mUnderruns.store(0, std::memory_order_relaxed);
+	mUnderrunFrames.store(0, std::memory_order_relaxed);
+	mOverruns.store(0, std::memory_order_relaxed);
+	mOverrunFrames.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCARingBuffer.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+
+/// An independent reader of a @c CARingBuffer
+///
+/// A @c CARingBuffer may be shared by one writer and any number of readers, for example to feed a single capture stream
+/// to several output devices with independent clocks. Each @c CARingBufferReader maintains its own read position
+/// and records the underruns and overruns it encounters.
+///
+/// An underrun occurs when a read requests audio that has not yet been written and an overrun occurs when a read requests
+/// audio that has already been overwritten. In both cases the missing frames are filled with silence.
+///
+/// This class is thread safe when each reader is used from a single thread. The statistics may be read from any thread.
+/// @note The @c CARingBuffer must outlive its readers
+class CARingBufferReader
+{
+
+public:
+
+	/// Counts of the frames read by a @c CARingBufferReader
+	struct ReaderStatistics
+	{
+		/// The number of frames requested by reads
+		uint64_t mFramesRequested;
+		/// The number of reads that encountered an underrun
+		uint64_t mUnderruns;
+		/// The number of frames requested that had not yet been written
+		uint64_t mUnderrunFrames;
+		/// The number of reads that encountered an overrun
+		uint64_t mOverruns;
+		/// The number of frames requested that had already been overwritten
+		uint64_t mOverrunFrames;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c CARingBufferReader for @c ringBuffer with a read position of @c 0
+	/// @param ringBuffer The ring buffer to read
+	explicit CARingBufferReader(CARingBuffer& ringBuffer) noexcept;
+
+	// This class is non-copyable
+	CARingBufferReader(const CARingBufferReader& rhs) = delete;
+
+	// This class is non-assignable
+	CARingBufferReader& operator=(const CARingBufferReader& rhs) = delete;
+
+	/// Destroys the @c CARingBufferReader
+	~CARingBufferReader() = default;
+
+	// This class is non-movable
+	CARingBufferReader(CARingBufferReader&& rhs) = delete;
+
+	// This class is non-move assignable
+	CARingBufferReader& operator=(CARingBufferReader&& rhs) = delete;
+
+#pragma mark Position
+
+	/// Returns the sample time of the next read
+	inline int64_t Position() const noexcept
+	{
+		return mPosition;
+	}
+
+	/// Sets the sample time of the next read
+	/// @note Negative time stamps are not supported
+	inline void Seek(int64_t timeStamp) noexcept
+	{
+		mPosition = timeStamp;
+	}
+
+	/// Sets the sample time of the next read to @c latency frames before the end of the audio in the ring buffer
+	/// @param latency The desired number of frames between the writer and this reader
+	/// @return @c true on success, @c false if the time bounds could not be read
+	bool SeekToLatency(uint32_t latency) noexcept;
+
+	/// Returns the number of frames between the read position and the end of the audio in the ring buffer
+	/// @note A negative value indicates the read position is past the end of the audio
+	/// @param latency The number of frames between the writer and this reader
+	/// @return @c true on success, @c false if the time bounds could not be read
+	bool GetLatency(int64_t& latency) const noexcept;
+
+#pragma mark Reading audio
+
+	/// Reads audio from the read position and advances the read position by @c frameCount
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param frameCount The desired number of frames to read
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
+
+	/// Reads audio from the read position, interleaving or deinterleaving as needed, and advances the read position by @c frameCount
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param format The format of @c bufferList, which must be the ring buffer's format or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to read
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount) noexcept;
+
+	/// Reads audio starting at @c timeStamp and sets the read position to the sample time following the audio read
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param frameCount The desired number of frames to read
+	/// @param timeStamp The starting sample time
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, int64_t timeStamp) noexcept;
+
+	/// Reads audio starting at @c timeStamp, interleaving or deinterleaving as needed, and sets the read position to the sample time following the audio read
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param format The format of @c bufferList, which must be the ring buffer's format or its interleaved or non-interleaved equivalent
+	/// @param frameCount The desired number of frames to read
+	/// @param timeStamp The starting sample time
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, const CAStreamBasicDescription& format, uint32_t frameCount, int64_t timeStamp) noexcept;
+
+#pragma mark Statistics
+
+	/// Returns this reader's statistics
+	/// @note This method is safe to call from any thread
+	ReaderStatistics Statistics() const noexcept;
+
+	/// Resets this reader's statistics
+	/// @note This method is safe to call from any thread
+	void ResetStatistics() noexcept;
+
+private:
+
+	/// The ring buffer
+	CARingBuffer& mRingBuffer;
+	/// The sample time of the next read
+	int64_t mPosition;
+
+	/// The number of frames requested by reads
+	std::atomic_uint64_t mFramesRequested;
+	/// The number of reads that encountered an underrun
+	std::atomic_uint64_t mUnderruns;
+	/// The number of frames requested that had not yet been written
+	std::atomic_uint64_t mUnderrunFrames;
+	/// The number of reads that encountered an overrun
+	std::atomic_uint64_t mOverruns;
+	/// The number of frames requested that had already been overwritten
+	std::atomic_uint64_t mOverrunFrames;
+
+};
+
+} // namespace SFB
@@ -54,34 +54,64 @@ public:
 
 
 	/// Creates a new @c CAStreamBasicDescription for the speciifed @c CommonPCMFormat
-	CAStreamBasicDescription(CommonPCMFormat commonPCMFormat, Float64 sampleRate, UInt32 channelsPerFrame, bool isInterleaved) noexcept
+	/// @note This may be used in constant expressions
+	constexpr CAStreamBasicDescription(CommonPCMFormat commonPCMFormat, Float64 sampleRate, UInt32 channelsPerFrame, bool isInterleaved) noexcept
 	: AudioStreamBasicDescription{}
 	{
+		constexpr auto isBigEndian = kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian;
 		switch(commonPCMFormat) {
 			case CommonPCMFormat::float32:
-				FillOutASBDForLPCM(*this, sampleRate, channelsPerFrame, 32, 32, true, kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian, !isInterleaved);
+				*this = LinearPCM(sampleRate, channelsPerFrame, 32, 32, true, isBigEndian, !isInterleaved);
 				break;
 			case CommonPCMFormat::float64:
-				FillOutASBDForLPCM(*this, sampleRate, channelsPerFrame, 64, 64, true, kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian, !isInterleaved);
+				*this = LinearPCM(sampleRate, channelsPerFrame, 64, 64, true, isBigEndian, !isInterleaved);
 				break;
 			case CommonPCMFormat::int16:
-				FillOutASBDForLPCM(*this, sampleRate, channelsPerFrame, 16, 16, false, kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian, !isInterleaved);
+				*this = LinearPCM(sampleRate, channelsPerFrame, 16, 16, false, isBigEndian, !isInterleaved);
 				break;
 			case CommonPCMFormat::int32:
-				FillOutASBDForLPCM(*this, sampleRate, channelsPerFrame, 32, 32, false, kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian, !isInterleaved);
+				*this = LinearPCM(sampleRate, channelsPerFrame, 32, 32, false, isBigEndian, !isInterleaved);
 				break;
 		}
 	}
 
+	/// Returns a linear PCM @c CAStreamBasicDescription
+	///
+	/// This is equivalent to @c FillOutASBDForLPCM but may be used in constant expressions.
+	/// @param sampleRate The sample rate
+	/// @param channelsPerFrame The number of channels
+	/// @param validBitsPerChannel The number of valid bits in each sample
+	/// @param totalBitsPerChannel The number of bits occupied by each sample
+	/// @param isFloat Whether the samples are floating point
+	/// @param isBigEndian Whether the samples are big-endian
+	/// @param isNonInterleaved Whether the channels are non-interleaved
+	static constexpr CAStreamBasicDescription LinearPCM(Float64 sampleRate, UInt32 channelsPerFrame, UInt32 validBitsPerChannel, UInt32 totalBitsPerChannel, bool isFloat, bool isBigEndian, bool isNonInterleaved = false) noexcept
+	{
+		const auto bytesPerFrame = (isNonInterleaved ? 1 : channelsPerFrame) * (totalBitsPerChannel / 8);
+		AudioStreamBasicDescription format{};
+		format.mSampleRate = sampleRate;
+		format.mFormatID = kAudioFormatLinearPCM;
+		format.mFormatFlags = (isFloat ? kAudioFormatFlagIsFloat : kAudioFormatFlagIsSignedInteger)
+			| (isBigEndian ? kAudioFormatFlagIsBigEndian : 0)
+			| (validBitsPerChannel == totalBitsPerChannel ? kAudioFormatFlagIsPacked : kAudioFormatFlagIsAlignedHigh)
+			| (isNonInterleaved ? kAudioFormatFlagIsNonInterleaved : 0);
+		format.mBytesPerPacket = bytesPerFrame;
+		format.mFramesPerPacket = 1;
+		format.mBytesPerFrame = bytesPerFrame;
+		format.mChannelsPerFrame = channelsPerFrame;
+		format.mBitsPerChannel = validBitsPerChannel;
+		return format;
+	}
+
 	// Native overloads
 
 	/// Creates a new @c CAStreamBasicDescription for the specified @c AudioStreamBasicDescription
-	inline CAStreamBasicDescription(const AudioStreamBasicDescription& rhs) noexcept
+	constexpr CAStreamBasicDescription(const AudioStreamBasicDescription& rhs) noexcept
 	: AudioStreamBasicDescription{rhs}
 	{}
 
 	/// Assignment operator
-	CAStreamBasicDescription& operator=(const AudioStreamBasicDescription& rhs) noexcept
+	constexpr CAStreamBasicDescription& operator=(const AudioStreamBasicDescription& rhs) noexcept
 	{
 		AudioStreamBasicDescription::operator=(rhs);
 		return *this;
@@ -104,105 +134,105 @@ public:
 #pragma mark Format information
 
 	/// Returns @c true if this format is non-interleaved
-	inline bool IsNonInterleaved() const noexcept
+	constexpr bool IsNonInterleaved() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsNonInterleaved) == kAudioFormatFlagIsNonInterleaved;
 	}
 
 	/// Returns @c true if this format is interleaved
-	inline bool IsInterleaved() const noexcept
+	constexpr bool IsInterleaved() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsNonInterleaved) == 0;
 	}
 
 	/// Returns the number of interleaved channels
-	inline UInt32 InterleavedChannelCount() const noexcept
+	constexpr UInt32 InterleavedChannelCount() const noexcept
 	{
 		return IsInterleaved() ? mChannelsPerFrame : 1;
 	}
 
 	/// Returns the number of channel streams
-	inline UInt32 ChannelStreamCount() const noexcept
+	constexpr UInt32 ChannelStreamCount() const noexcept
 	{
 		return IsInterleaved() ? 1 : mChannelsPerFrame;
 	}
 
 	/// Returns the number of channels
-	inline UInt32 ChannelCount() const noexcept
+	constexpr UInt32 ChannelCount() const noexcept
 	{
 		return mChannelsPerFrame;
 	}
 
 	/// Returns @c true if this format is PCM
-	inline bool IsPCM() const noexcept
+	constexpr bool IsPCM() const noexcept
 	{
 		return kAudioFormatLinearPCM == mFormatID;
 	}
 
 	/// Returns @c true if this format is big-endian
-	inline bool IsBigEndian() const noexcept
+	constexpr bool IsBigEndian() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsBigEndian) == kAudioFormatFlagIsBigEndian;
 	}
 
 	/// Returns @c true if this format is little-endian
-	inline bool IsLittleEndian() const noexcept
+	constexpr bool IsLittleEndian() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsBigEndian) == 0;
 	}
 
 	/// Returns @c true if this format is native-endian
-	inline bool IsNativeEndian() const noexcept
+	constexpr bool IsNativeEndian() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsBigEndian) == kAudioFormatFlagsNativeEndian;
 	}
 
 	/// Returns @c true if this format is floating-point linear PCM
-	inline bool IsFloat() const noexcept
+	constexpr bool IsFloat() const noexcept
 	{
 		return IsPCM() && (mFormatFlags & kAudioFormatFlagIsFloat) == kAudioFormatFlagIsFloat;
 	}
 
 	/// Returns @c true if this format is integer linear PCM
-	inline bool IsInteger() const noexcept
+	constexpr bool IsInteger() const noexcept
 	{
 		return IsPCM() && (mFormatFlags & kAudioFormatFlagIsFloat) == 0;
 	}
 
 	/// Returns @c true if this format is signed integer linear PCM
-	inline bool IsSignedInteger() const noexcept
+	constexpr bool IsSignedInteger() const noexcept
 	{
 		return IsPCM() && (mFormatFlags & kAudioFormatFlagIsSignedInteger) == kAudioFormatFlagIsSignedInteger;
 	}
 
 	/// Returns @c true if this format is packed
-	inline bool IsPacked() const noexcept
+	constexpr bool IsPacked() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsPacked) == kAudioFormatFlagIsPacked;
 	}
 
 	/// Returns @c true if this format is high-aligned
-	inline bool IsAlignedHigh() const noexcept
+	constexpr bool IsAlignedHigh() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsAlignedHigh) == kAudioFormatFlagIsAlignedHigh;
 	}
 
 	/// Returns @c true if this format is non-mixable
 	/// @note This flag is only used when interacting with HAL stream formats
-	inline bool IsNonMixable() const noexcept
+	constexpr bool IsNonMixable() const noexcept
 	{
 		return (mFormatFlags & kAudioFormatFlagIsNonMixable) == kAudioFormatFlagIsNonMixable;
 	}
 
 	/// Returns @c true if this format is mixable
 	/// @note This flag is only used when interacting with HAL stream formats
-	inline bool IsMixable() const noexcept
+	constexpr bool IsMixable() const noexcept
 	{
 		return IsPCM() && (mFormatFlags & kAudioFormatFlagIsNonMixable) == 0;
 	}
 
 	/// Returns the sample word size in bytes
-	inline UInt32 SampleWordSize() const noexcept
+	constexpr UInt32 SampleWordSize() const noexcept
 	{
 		auto interleavedChannelCount = InterleavedChannelCount();
 		if(!interleavedChannelCount)
@@ -212,14 +242,14 @@ public:
 
 	/// Returns the byte size of @c frameCount audio frames
 	/// @note This is equivalent to @c frameCount*mBytesPerFrame
-	inline UInt32 FrameCountToByteSize(UInt32 frameCount) const noexcept
+	constexpr UInt32 FrameCountToByteSize(UInt32 frameCount) const noexcept
 	{
 		return frameCount * mBytesPerFrame;
 	}
 
 	/// Returns the frame count of @c byteSize bytes
 	/// @note This is equivalent to @c byteSize/mBytesPerFrame
-	inline UInt32 ByteSizeToFrameCount(UInt32 byteSize) const
+	constexpr UInt32 ByteSizeToFrameCount(UInt32 byteSize) const
 	{
 		if(!mBytesPerFrame)
 			return 0;
@@ -0,0 +1,236 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cstring>
+#import <mutex>
+#import <stdexcept>
+#import <unordered_map>
+
+#import <Accelerate/Accelerate.h>
+
+#import "SFBChannelMixer.hpp"
+#import "SFBCAAudioFormat.hpp"
+#import "SFBInterned.hpp"
+#import "SFBUnfairLock.hpp"
+
+namespace {
+
+/// A pair of channel layouts identifying a shared mixer
+struct LayoutPair
+{
+	/// The channel layout of the input
+	SFB::InternedChannelLayout mInput;
+	/// The channel layout of the output
+	SFB::InternedChannelLayout mOutput;
+
+	bool operator==(const LayoutPair& rhs) const noexcept
+	{
+		return mInput == rhs.mInput && mOutput == rhs.mOutput;
+	}
+};
+
+/// Hashes a @c LayoutPair
+struct LayoutPairHash
+{
+	size_t operator()(const LayoutPair& pair) const noexcept
+	{
+		return pair.mInput.Hash() ^ (pair.mOutput.Hash() + 0x9e3779b97f4a7c15 + (pair.mInput.Hash() << 6) + (pair.mInput.Hash() >> 2));
+	}
+};
+
+/// The shared mixers
+struct MixerCache
+{
+	/// The lock protecting @c mMixers
+	SFB::UnfairLock mLock;
+	/// The shared mixers keyed by channel layouts
+	std::unordered_map<LayoutPair, std::shared_ptr<const SFB::ChannelMixer>, LayoutPairHash> mMixers;
+};
+
+/// Returns @c true if @c format is native-endian 32-bit floating point linear PCM
+bool IsNativeFloat32(const SFB::CAStreamBasicDescription& format) noexcept
+{
+	return format.IsFloat() && format.IsNativeEndian() && format.mBitsPerChannel == 32 && format.SampleWordSize() == 4;
+}
+
+/// Returns the first sample of @c channel in @c bufferList and the distance between its samples or @c nullptr on error
+float * _Nullable ChannelData(const AudioBufferList * const _Nullable bufferList, const SFB::CAStreamBasicDescription& format, UInt32 channel, vDSP_Stride& stride) noexcept
+{
+	if(!bufferList)
+		return nullptr;
+
+	const auto interleavedChannelCount = format.InterleavedChannelCount();
+	const auto bufferIndex = channel / interleavedChannelCount;
+	if(bufferIndex >= bufferList->mNumberBuffers || !bufferList->mBuffers[bufferIndex].mData)
+		return nullptr;
+
+	stride = static_cast<vDSP_Stride>(interleavedChannelCount);
+	return static_cast<float *>(bufferList->mBuffers[bufferIndex].mData) + channel % interleavedChannelCount;
+}
+
+/// Copies @c frameCount samples
+void Copy(const float * _Nonnull input, vDSP_Stride inputStride, float * _Nonnull output, vDSP_Stride outputStride, UInt32 frameCount) noexcept
+{
+	if(inputStride == 1 && outputStride == 1)
+		std::memcpy(output, input, frameCount * sizeof(float));
+	else {
+		for(UInt32 i = 0; i < frameCount; ++i)
+			output[i * outputStride] = input[i * inputStride];
+	}
+}
+
+} // namespace
+
+#pragma mark Factory Methods
+
+SFB::ChannelMixer SFB::ChannelMixer::MixerForLayouts(const CAChannelLayout& inputLayout, const CAChannelLayout& outputLayout)
+{
+	if(!inputLayout || !outputLayout)
+		throw std::invalid_argument("Empty channel layout");
+
+	const auto inputChannelCount = static_cast<UInt32>(inputLayout.ChannelCount());
+	const auto outputChannelCount = static_cast<UInt32>(outputLayout.ChannelCount());
+	if(inputChannelCount == 0 || outputChannelCount == 0)
+		throw std::invalid_argument("Channel layout without channels");
+
+	const AudioChannelLayout *layouts [] = {
+		inputLayout.ACL(),
+		outputLayout.ACL()
+	};
+
+	std::vector<float> matrix(inputChannelCount * outputChannelCount);
+	auto propertySize = static_cast<UInt32>(matrix.size() * sizeof(float));
+	CAAudioFormat::GetProperty(kAudioFormatProperty_MatrixMixMap, sizeof(layouts), static_cast<const void *>(layouts), propertySize, matrix.data());
+
+	return ChannelMixer(inputChannelCount, outputChannelCount, matrix);
+}
+
+std::shared_ptr<const SFB::ChannelMixer> SFB::ChannelMixer::SharedMixerForLayouts(const CAChannelLayout& inputLayout, const CAChannelLayout& outputLayout)
+{
+	// The cache is never destroyed so mixers may be requested during program termination
+	static auto cache = new MixerCache;
+
+	LayoutPair key{ InternedChannelLayout(inputLayout), InternedChannelLayout(outputLayout) };
+
+	{
+		std::lock_guard<SFB::UnfairLock> lock(cache->mLock);
+		if(auto iter = cache->mMixers.find(key); iter != cache->mMixers.end())
+			return iter->second;
+	}
+
+	// Compute the matrix without holding the lock; if another thread wins the race its mixer is used
+	auto mixer = std::make_shared<const ChannelMixer>(MixerForLayouts(inputLayout, outputLayout));
+
+	std::lock_guard<SFB::UnfairLock> lock(cache->mLock);
+	return cache->mMixers.emplace(std::move(key), std::move(mixer)).first->second;
+}
+
+#pragma mark Creation and Destruction
+
+SFB::ChannelMixer::ChannelMixer() noexcept
+: mInputChannelCount(0), mOutputChannelCount(0), mMethod(Method::permutation)
+{}
+
+SFB::ChannelMixer::ChannelMixer(UInt32 inputChannelCount, UInt32 outputChannelCount, const std::vector<float>& matrix)
+: mInputChannelCount(inputChannelCount), mOutputChannelCount(outputChannelCount), mMethod(Method::permutation)
+{
+	if(matrix.size() != static_cast<size_t>(inputChannelCount) * outputChannelCount)
+		throw std::invalid_argument("matrix.size() != inputChannelCount * outputChannelCount");
+
+	mTermOffsets.reserve(outputChannelCount + 1);
+	for(UInt32 output = 0; output < outputChannelCount; ++output) {
+		const auto first = mTerms.size();
+		mTermOffsets.push_back(static_cast<UInt32>(first));
+		for(UInt32 input = 0; input < inputChannelCount; ++input) {
+			const auto gain = matrix[input * outputChannelCount + output];
+			if(gain != 0)
+				mTerms.push_back({ input, gain });
+		}
+
+		const auto termCount = mTerms.size() - first;
+		if(termCount > 1 || (termCount == 1 && mTerms.back().mGain != 1))
+			mMethod = Method::matrix;
+	}
+	mTermOffsets.push_back(static_cast<UInt32>(mTerms.size()));
+}
+
+#pragma mark Mixer information
+
+float SFB::ChannelMixer::Gain(UInt32 inputChannel, UInt32 outputChannel) const noexcept
+{
+	if(inputChannel >= mInputChannelCount || outputChannel >= mOutputChannelCount)
+		return 0;
+
+	for(auto i = mTermOffsets[outputChannel]; i < mTermOffsets[outputChannel + 1]; ++i) {
+		if(mTerms[i].mInputChannel == inputChannel)
+			return mTerms[i].mGain;
+	}
+
+	return 0;
+}
+
+#pragma mark Mixing
+
+bool SFB::ChannelMixer::Mix(const CABufferList& input, CABufferList& output) const noexcept
+{
+	if(IsEmpty() || !input || !output)
+		return false;
+
+	const auto& inputFormat = input.Format();
+	const auto& outputFormat = output.Format();
+	if(!IsNativeFloat32(inputFormat) || !IsNativeFloat32(outputFormat))
+		return false;
+	if(inputFormat.ChannelCount() != mInputChannelCount || outputFormat.ChannelCount() != mOutputChannelCount)
+		return false;
+
+	const auto frameCount = std::min(input.FrameLength(), output.FrameCapacity());
+
+	// The mixed frames replace the contents of output so its headroom is released without moving any frames
+	output.Clear();
+
+	for(UInt32 channel = 0; channel < mOutputChannelCount; ++channel) {
+		vDSP_Stride outputStride;
+		auto outputData = ChannelData(output.ABL(), outputFormat, channel, outputStride);
+		if(!outputData)
+			return false;
+
+		const auto first = mTermOffsets[channel];
+		const auto last = mTermOffsets[channel + 1];
+
+		// Output channels without contributing inputs are silent
+		if(first == last) {
+			vDSP_vclr(outputData, outputStride, frameCount);
+			continue;
+		}
+
+		for(auto i = first; i < last; ++i) {
+			const auto& term = mTerms[i];
+
+			vDSP_Stride inputStride;
+			const auto inputData = ChannelData(input.ABL(), inputFormat, term.mInputChannel, inputStride);
+			if(!inputData)
+				return false;
+
+			// The first term initializes the output and subsequent terms accumulate into it
+			if(i == first) {
+				if(term.mGain == 1)
+					Copy(inputData, inputStride, outputData, outputStride, frameCount);
+				else
+					vDSP_vsmul(inputData, inputStride, &term.mGain, outputData, outputStride, frameCount);
+			}
+			else {
+				if(term.mGain == 1)
+					vDSP_vadd(inputData, inputStride, outputData, outputStride, outputData, outputStride, frameCount);
+				else
+					vDSP_vsma(inputData, inputStride, &term.mGain, outputData, outputStride, outputData, outputStride, frameCount);
+			}
+		}
+	}
+
+	output.SetFrameLength(frameCount);
+	return true;
+}
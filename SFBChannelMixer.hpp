@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <memory>
+#import <vector>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCABufferList.hpp"
+#import "SFBCAChannelLayout.hpp"
+
+CF_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+/// A precomputed mapping from one set of channels to another
+///
+/// A @c ChannelMixer applies a matrix of gains to audio, where each output channel is the sum of the input channels
+/// scaled by their gains. The matrix is computed once, for example from a pair of channel layouts using @c AudioFormat,
+/// and applied to any number of buffers without further calls into Core Audio.
+///
+/// When every output channel is a copy of at most one input channel the matrix is applied as a permutation of the
+/// channels. Otherwise only the nonzero gains are applied so upmixes and downmixes, which are mostly zero, cost
+/// time proportional to the number of contributing channel pairs.
+///
+/// Mixing supports native-endian 32-bit floating point linear PCM, interleaved or non-interleaved, uses Accelerate,
+/// does not allocate memory, and is safe to call from a real-time context.
+class ChannelMixer
+{
+
+public:
+
+	/// The method used to apply the matrix
+	enum class Method {
+		/// Each output channel is a copy of at most one input channel
+		permutation,
+		/// Each output channel is the sum of the input channels with nonzero gains
+		matrix,
+	};
+
+#pragma mark Factory Methods
+
+	/// Creates a @c ChannelMixer converting between two channel layouts
+	/// @note This calls @c AudioFormat to compute the mixing matrix
+	/// @param inputLayout The channel layout of the input
+	/// @param outputLayout The channel layout of the output
+	/// @return A @c ChannelMixer
+	/// @throw @c std::invalid_argument if either channel layout is empty
+	/// @throw @c std::system_error
+	/// @throw @c std::bad_alloc
+	static ChannelMixer MixerForLayouts(const CAChannelLayout& inputLayout, const CAChannelLayout& outputLayout);
+
+	/// Returns a shared @c ChannelMixer converting between two channel layouts
+	///
+	/// Mixers are created once per distinct pair of channel layouts and retained for the lifetime of the process.
+	/// @note This method is thread safe
+	/// @param inputLayout The channel layout of the input
+	/// @param outputLayout The channel layout of the output
+	/// @return A shared @c ChannelMixer
+	/// @throw @c std::invalid_argument if either channel layout is empty
+	/// @throw @c std::system_error
+	/// @throw @c std::bad_alloc
+	static std::shared_ptr<const ChannelMixer> SharedMixerForLayouts(const CAChannelLayout& inputLayout, const CAChannelLayout& outputLayout);
+
+#pragma mark Creation and Destruction
+
+	/// Creates an empty @c ChannelMixer
+	ChannelMixer() noexcept;
+
+	/// Creates a @c ChannelMixer with the specified mixing matrix
+	/// @param inputChannelCount The number of input channels
+	/// @param outputChannelCount The number of output channels
+	/// @param matrix The gains with the gain from input channel @c i to output channel @c o at <tt>matrix[i * outputChannelCount + o]</tt>
+	/// @throw @c std::invalid_argument if @c matrix does not contain <tt>inputChannelCount * outputChannelCount</tt> gains
+	/// @throw @c std::bad_alloc
+	ChannelMixer(UInt32 inputChannelCount, UInt32 outputChannelCount, const std::vector<float>& matrix);
+
+	/// Copy constructor
+	ChannelMixer(const ChannelMixer& rhs) = default;
+
+	/// Assignment operator
+	ChannelMixer& operator=(const ChannelMixer& rhs) = default;
+
+	/// Destructor
+	~ChannelMixer() = default;
+
+	/// Move constructor
+	ChannelMixer(ChannelMixer&& rhs) noexcept = default;
+
+	/// Move assignment operator
+	ChannelMixer& operator=(ChannelMixer&& rhs) noexcept = default;
+
+#pragma mark Mixer information
+
+	/// Returns @c true if the mixer is empty
+	inline bool IsEmpty() const noexcept
+	{
+		return mOutputChannelCount == 0;
+	}
+
+	/// Returns the number of input channels
+	inline UInt32 InputChannelCount() const noexcept
+	{
+		return mInputChannelCount;
+	}
+
+	/// Returns the number of output channels
+	inline UInt32 OutputChannelCount() const noexcept
+	{
+		return mOutputChannelCount;
+	}
+
+	/// Returns the method used to apply the matrix
+	inline Method MixingMethod() const noexcept
+	{
+		return mMethod;
+	}
+
+	/// Returns the gain from an input channel to an output channel or @c 0 if either channel is out of range
+	float Gain(UInt32 inputChannel, UInt32 outputChannel) const noexcept;
+
+#pragma mark Mixing
+
+	/// Mixes the contents of @c input into @c output
+	///
+	/// The number of frames mixed is the smaller of the frame length of @c input and the frame capacity of @c output,
+	/// and the frame length of @c output is set to the number of frames mixed.
+	/// @note @c input and @c output must not share storage
+	/// @param input A buffer containing @c InputChannelCount() channels of native-endian @c float samples
+	/// @param output A buffer containing @c OutputChannelCount() channels of native-endian @c float samples
+	/// @return @c true on success, @c false if a format is not supported or the channel counts do not match
+	bool Mix(const CABufferList& input, CABufferList& output) const noexcept;
+
+private:
+
+	/// The contribution of an input channel to an output channel
+	struct Term
+	{
+		/// The input channel
+		UInt32 mInputChannel;
+		/// The gain applied to the input channel
+		float mGain;
+	};
+
+	/// The number of input channels
+	UInt32 mInputChannelCount;
+	/// The number of output channels
+	UInt32 mOutputChannelCount;
+	/// The method used to apply the matrix
+	Method mMethod;
+	/// The nonzero terms of the matrix grouped by output channel
+	std::vector<Term> mTerms;
+	/// The index of the first term for each output channel followed by the number of terms
+	std::vector<UInt32> mTermOffsets;
+
+};
+
+} // namespace SFB
+
+CF_ASSUME_NONNULL_END
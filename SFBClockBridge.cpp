@@ -0,0 +1,323 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cmath>
+#import <cstring>
+#import <limits>
+
+#import <CoreAudio/HostTime.h>
+
+#import "SFBClockBridge.hpp"
+
+namespace {
+
+/// The time in seconds over which a difference between the measured and target latency is corrected
+constexpr double sLatencyCorrectionTime = 2;
+
+/// The timing error in periods beyond which a delay-locked loop is restarted
+constexpr double sMaximumTimingError = 4;
+
+/// The maximum number of attempts made to read a consistent producer clock
+constexpr uint32_t sMaxProducerClockReadAttempts = 16;
+
+/// Returns @c true if @c format is supported by @c ClockBridge
+inline bool IsSupportedFormat(const SFB::CAStreamBasicDescription& format) noexcept
+{
+	return format.IsPCM() && format.IsFloat() && format.IsNativeEndian() && format.mBitsPerChannel == 32 && format.mBytesPerFrame == sizeof(float) && format.ChannelStreamCount() == format.ChannelCount();
+}
+
+/// Starts or updates @c loop with the host time in @c timeStamp
+/// @param loop The delay-locked loop
+/// @param timeStamp The time stamp of the first frame of a period
+/// @param frameCount The number of frames in the period
+/// @param sampleRate The nominal sample rate
+void UpdateLoop(SFB::DelayLockedLoop& loop, const AudioTimeStamp& timeStamp, uint32_t frameCount, double sampleRate) noexcept
+{
+	const auto hostTime = static_cast<double>(timeStamp.mHostTime);
+
+	// A loop that is far from the reported time, for example after a device restarts, is restarted
+	if(loop.IsRunning() && std::abs(loop.Error(hostTime)) > sMaximumTimingError * frameCount / loop.FramesPerTime())
+		loop.Reset();
+
+	if(loop.IsRunning())
+		loop.Update(hostTime, frameCount);
+	else {
+		auto ticksPerFrame = static_cast<double>(AudioGetHostClockFrequency()) / sampleRate;
+		if(timeStamp.mFlags & kAudioTimeStampRateScalarValid)
+			ticksPerFrame *= timeStamp.mRateScalar;
+		loop.Start(hostTime, frameCount, ticksPerFrame);
+	}
+}
+
+/// Zeroes @c frameCount frames in @c bufferList and sets the data size of each buffer
+inline void ZeroABL(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept
+{
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		std::memset(bufferList->mBuffers[i].mData, 0, frameCount * sizeof(float));
+		bufferList->mBuffers[i].mDataByteSize = static_cast<UInt32>(frameCount * sizeof(float));
+	}
+}
+
+/// Resamples a single channel using cubic Hermite interpolation
+/// @param input The input samples
+/// @param output A buffer to receive the output samples
+/// @param frameCount The number of output samples to generate
+/// @param position The fractional position in @c input of the first output sample, which must be at least @c 1
+/// @param step The distance in @c input between consecutive output samples
+void Interpolate(const float * const _Nonnull input, float * const _Nonnull output, uint32_t frameCount, double position, double step) noexcept
+{
+	using V4f = float __attribute__((vector_size(16)));
+
+	uint32_t i = 0;
+	for(; i + 4 <= frameCount; i += 4) {
+		V4f y0, y1, y2, y3, t;
+		for(uint32_t j = 0; j < 4; ++j) {
+			const auto x = position + ((i + j) * step);
+			const auto index = static_cast<size_t>(x);
+			t[j] = static_cast<float>(x - index);
+			y0[j] = input[index - 1];
+			y1[j] = input[index];
+			y2[j] = input[index + 1];
+			y3[j] = input[index + 2];
+		}
+
+		const V4f c1 = 0.5f * (y2 - y0);
+		const V4f c2 = y0 - (2.5f * y1) + (2.f * y2) - (0.5f * y3);
+		const V4f c3 = (0.5f * (y3 - y0)) + (1.5f * (y1 - y2));
+		const V4f y = (((((c3 * t) + c2) * t) + c1) * t) + y1;
+
+		std::memcpy(output + i, &y, sizeof y);
+	}
+
+	for(; i < frameCount; ++i) {
+		const auto x = position + (i * step);
+		const auto index = static_cast<size_t>(x);
+		const auto t = static_cast<float>(x - index);
+		const auto y0 = input[index - 1], y1 = input[index], y2 = input[index + 1], y3 = input[index + 2];
+
+		const auto c1 = 0.5f * (y2 - y0);
+		const auto c2 = y0 - (2.5f * y1) + (2.f * y2) - (0.5f * y3);
+		const auto c3 = (0.5f * (y3 - y0)) + (1.5f * (y1 - y2));
+		output[i] = (((((c3 * t) + c2) * t) + c1) * t) + y1;
+	}
+}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::ClockBridge::ClockBridge() noexcept
+: mBandwidth(sDefaultBandwidth), mTargetLatency(0), mFramesWritten(0), mProducerFrameCount(0), mProducerTime(0), mProducerFramesPerTick(0), mReadPosition(std::numeric_limits<double>::quiet_NaN()), mRatio(1), mLatency(0), mResynchronizations(0)
+{
+	mProducerClock.mFrameCount = 0;
+	mProducerClock.mTime = 0;
+	mProducerClock.mFramesPerTick = 0;
+	mProducerClock.mSequence = 0;
+}
+
+#pragma mark Bridge Management
+
+bool SFB::ClockBridge::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, uint32_t maximumFramesPerRead, uint32_t targetLatency, double bandwidth) noexcept
+{
+	if(!IsSupportedFormat(format) || maximumFramesPerRead == 0 || targetLatency >= capacityFrames || bandwidth <= 0)
+		return false;
+
+	Deallocate();
+
+	if(!mRingBuffer.Allocate(format, capacityFrames))
+		return false;
+
+	// Interpolation requires one frame preceding and two frames following the frames being read
+	const auto inputFrameCapacity = static_cast<UInt32>(std::ceil(maximumFramesPerRead * (1 + sMaximumRateDeviation))) + 4;
+	if(!mInputBuffer.Allocate(format, inputFrameCapacity)) {
+		mRingBuffer.Deallocate();
+		return false;
+	}
+
+	mBandwidth = bandwidth;
+	mTargetLatency.store(targetLatency, std::memory_order_relaxed);
+
+	Reset();
+
+	return true;
+}
+
+void SFB::ClockBridge::Deallocate() noexcept
+{
+	mRingBuffer.Deallocate();
+	mInputBuffer.Deallocate();
+}
+
+void SFB::ClockBridge::Reset() noexcept
+{
+	const auto sampleRate = mRingBuffer.Format().mSampleRate;
+
+	mProducerLoop.Configure(sampleRate, mBandwidth);
+	mFramesWritten = 0;
+
+	mProducerClock.mFrameCount.store(0, std::memory_order_relaxed);
+	mProducerClock.mTime.store(0, std::memory_order_relaxed);
+	mProducerClock.mFramesPerTick.store(0, std::memory_order_relaxed);
+	mProducerClock.mSequence.store(0, std::memory_order_relaxed);
+
+	mConsumerLoop.Configure(sampleRate, mBandwidth);
+	mProducerFrameCount = 0;
+	mProducerTime = 0;
+	mProducerFramesPerTick = 0;
+	mReadPosition = std::numeric_limits<double>::quiet_NaN();
+
+	mRatio.store(1, std::memory_order_relaxed);
+	mLatency.store(0, std::memory_order_relaxed);
+	mResynchronizations.store(0, std::memory_order_relaxed);
+}
+
+#pragma mark Producing and Consuming Audio
+
+bool SFB::ClockBridge::Write(const AudioBufferList * const bufferList, uint32_t frameCount, const AudioTimeStamp& timeStamp) noexcept
+{
+	if(frameCount == 0)
+		return true;
+
+	if(!bufferList || !(timeStamp.mFlags & kAudioTimeStampHostTimeValid))
+		return false;
+
+	if(!mRingBuffer.Write(bufferList, frameCount, mFramesWritten))
+		return false;
+
+	UpdateLoop(mProducerLoop, timeStamp, frameCount, mRingBuffer.Format().mSampleRate);
+
+	// The audio is published before the clock so the consumer never reads past the end of the ring buffer
+	PublishProducerClock();
+	mFramesWritten += frameCount;
+
+	return true;
+}
+
+bool SFB::ClockBridge::Read(AudioBufferList * const bufferList, uint32_t frameCount, const AudioTimeStamp& timeStamp) noexcept
+{
+	if(frameCount == 0)
+		return true;
+
+	if(!bufferList || !(timeStamp.mFlags & kAudioTimeStampHostTimeValid) || bufferList->mNumberBuffers != Format().ChannelStreamCount())
+		return false;
+
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		if(bufferList->mBuffers[i].mDataByteSize < frameCount * sizeof(float))
+			return false;
+	}
+
+	const auto sampleRate = Format().mSampleRate;
+	UpdateLoop(mConsumerLoop, timeStamp, frameCount, sampleRate);
+
+	// Output silence until the producer has written audio
+	if(!ReadProducerClock()) {
+		ZeroABL(bufferList, frameCount);
+		return true;
+	}
+
+	// The producer's position at the start of this period, measured on the filtered clocks
+	const auto producerPosition = mProducerFrameCount + ((mConsumerLoop.Time() - mProducerTime) * mProducerFramesPerTick);
+	const auto targetLatency = static_cast<double>(mTargetLatency.load(std::memory_order_relaxed));
+
+	if(std::isnan(mReadPosition)) {
+		// Wait for the target latency to accumulate
+		if(producerPosition - targetLatency < 1) {
+			ZeroABL(bufferList, frameCount);
+			return true;
+		}
+		mReadPosition = producerPosition - targetLatency;
+	}
+
+	const auto latency = producerPosition - mReadPosition;
+
+	// The rate ratio compensates for drift and the correction gradually removes any latency error
+	const auto rateRatio = mProducerFramesPerTick / mConsumerLoop.FramesPerTime();
+	const auto correction = (latency - targetLatency) / (sampleRate * sLatencyCorrectionTime);
+	const auto ratio = std::clamp(rateRatio * (1 + correction), 1 - sMaximumRateDeviation, 1 + sMaximumRateDeviation);
+
+	// The interpolator needs the frames from one before the read position to two after the final position
+	const auto windowStart = static_cast<int64_t>(std::floor(mReadPosition)) - 1;
+	const auto windowEnd = static_cast<int64_t>(std::floor(mReadPosition + ((frameCount - 1) * ratio))) + 3;
+	const auto windowFrames = static_cast<uint32_t>(windowEnd - windowStart);
+
+	int64_t startTime, endTime;
+	if(windowFrames > mInputBuffer.FrameCapacity() || !mRingBuffer.GetTimeBounds(startTime, endTime) || windowStart < startTime || windowEnd > endTime) {
+		// The consumer has underrun or overrun the producer and will resynchronize on the next read
+		mReadPosition = std::numeric_limits<double>::quiet_NaN();
+		mResynchronizations.fetch_add(1, std::memory_order_relaxed);
+		ZeroABL(bufferList, frameCount);
+		return true;
+	}
+
+	mInputBuffer.SetFrameLength(windowFrames);
+	if(!mRingBuffer.Read(mInputBuffer, windowFrames, windowStart))
+		return false;
+
+	const auto position = mReadPosition - static_cast<double>(windowStart);
+	const auto input = mInputBuffer.ABL();
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		Interpolate(static_cast<const float *>(input->mBuffers[i].mData), static_cast<float *>(bufferList->mBuffers[i].mData), frameCount, position, ratio);
+		bufferList->mBuffers[i].mDataByteSize = static_cast<UInt32>(frameCount * sizeof(float));
+	}
+
+	mReadPosition += frameCount * ratio;
+
+	mRatio.store(ratio, std::memory_order_relaxed);
+	mLatency.store(latency, std::memory_order_relaxed);
+
+	return true;
+}
+
+#pragma mark Statistics
+
+SFB::ClockBridge::BridgeStatistics SFB::ClockBridge::Statistics() const noexcept
+{
+	return {
+		.mRatio = mRatio.load(std::memory_order_relaxed),
+		.mLatency = mLatency.load(std::memory_order_relaxed),
+		.mResynchronizations = mResynchronizations.load(std::memory_order_relaxed),
+	};
+}
+
+#pragma mark Internals
+
+void SFB::ClockBridge::PublishProducerClock() noexcept
+{
+	const auto sequence = mProducerClock.mSequence.load(std::memory_order_relaxed);
+	mProducerClock.mSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	mProducerClock.mFrameCount.store(mFramesWritten, std::memory_order_relaxed);
+	mProducerClock.mTime.store(mProducerLoop.Time(), std::memory_order_relaxed);
+	mProducerClock.mFramesPerTick.store(mProducerLoop.FramesPerTime(), std::memory_order_relaxed);
+
+	mProducerClock.mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool SFB::ClockBridge::ReadProducerClock() noexcept
+{
+	for(uint32_t attempt = 0; attempt < sMaxProducerClockReadAttempts; ++attempt) {
+		const auto sequence = mProducerClock.mSequence.load(std::memory_order_acquire);
+		if(sequence & 1)
+			continue;
+
+		const auto frameCount = mProducerClock.mFrameCount.load(std::memory_order_relaxed);
+		const auto time = mProducerClock.mTime.load(std::memory_order_relaxed);
+		const auto framesPerTick = mProducerClock.mFramesPerTick.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(mProducerClock.mSequence.load(std::memory_order_relaxed) == sequence) {
+			mProducerFrameCount = frameCount;
+			mProducerTime = time;
+			mProducerFramesPerTick = framesPerTick;
+			break;
+		}
+	}
+
+	// If the clock could not be read the previous values are used
+	return mProducerFramesPerTick > 0;
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCABufferList.hpp"
+#import "SFBCARingBuffer.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+#import "SFBDelayLockedLoop.hpp"
+
+namespace SFB {
+
+/// Transfers audio between two devices with independent clocks while holding a target latency
+///
+/// The producer writes audio timed by its clock and the consumer reads audio timed by its clock. A @c DelayLockedLoop
+/// filters the host times of each side's IO cycles to estimate each clock's rate. The ratio of the rates, corrected by
+/// the difference between the measured and target latency, drives a variable-ratio cubic interpolator that converts
+/// the producer's audio to the consumer's clock. Because the latency is measured between the filtered clocks instead
+/// of the raw buffer fill level, the target latency can be close to the consumer's IO buffer size.
+///
+/// The producer and consumer must have the same nominal sample rate; the bridge compensates for drift of up to
+/// @c sMaximumRateDeviation between them.
+///
+/// This class is thread safe when used from one producer thread and one consumer thread.
+/// @note Only non-interleaved 32-bit native-endian floating point audio is supported
+class ClockBridge
+{
+
+public:
+
+	/// The maximum supported relative difference in rate between the producer and consumer clocks
+	static constexpr double sMaximumRateDeviation = 0.01;
+
+	/// The default delay-locked loop bandwidth in Hz
+	static constexpr double sDefaultBandwidth = 0.5;
+
+	/// Information on the operation of the bridge
+	struct BridgeStatistics
+	{
+		/// The most recent ratio of producer frames consumed per consumer frame
+		double mRatio;
+		/// The most recent latency between the producer and consumer, in frames
+		double mLatency;
+		/// The number of times the consumer lost synchronization with the producer and restarted
+		uint64_t mResynchronizations;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c ClockBridge
+	/// @note @c Allocate() must be called before the object may be used.
+	ClockBridge() noexcept;
+
+	// This class is non-copyable
+	ClockBridge(const ClockBridge& rhs) = delete;
+
+	// This class is non-assignable
+	ClockBridge& operator=(const ClockBridge& rhs) = delete;
+
+	/// Destroys the @c ClockBridge and releases all associated resources.
+	~ClockBridge() = default;
+
+	// This class is non-movable
+	ClockBridge(ClockBridge&& rhs) = delete;
+
+	// This class is non-move assignable
+	ClockBridge& operator=(ClockBridge&& rhs) = delete;
+
+#pragma mark Bridge management
+
+	/// Allocates space for audio data
+	/// @note This method is not thread safe.
+	/// @param format The format of the audio that will be written and read
+	/// @param capacityFrames The capacity of the underlying ring buffer, in frames
+	/// @param maximumFramesPerRead The largest number of frames that will be requested by a single call to @c Read()
+	/// @param targetLatency The desired latency between the producer and consumer, in frames
+	/// @param bandwidth The delay-locked loop bandwidth in Hz
+	/// @return @c true on success, @c false on error
+	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames, uint32_t maximumFramesPerRead, uint32_t targetLatency, double bandwidth = sDefaultBandwidth) noexcept;
+
+	/// Frees the resources used by this @c ClockBridge
+	/// @note This method is not thread safe.
+	void Deallocate() noexcept;
+
+	/// Stops the bridge, discarding all audio and clock information
+	/// @note This method is not thread safe.
+	void Reset() noexcept;
+
+
+	/// Returns the format of this @c ClockBridge
+	inline const CAStreamBasicDescription& Format() const noexcept
+	{
+		return mRingBuffer.Format();
+	}
+
+	/// Returns the target latency in frames
+	inline uint32_t TargetLatency() const noexcept
+	{
+		return mTargetLatency.load(std::memory_order_relaxed);
+	}
+
+	/// Sets the target latency in frames
+	/// @note This method is safe to call from any thread
+	inline void SetTargetLatency(uint32_t targetLatency) noexcept
+	{
+		mTargetLatency.store(targetLatency, std::memory_order_relaxed);
+	}
+
+#pragma mark Producing and consuming audio
+
+	/// Writes audio received from the producer
+	/// @note This method should only be called from the producer's thread
+	/// @param bufferList An @c AudioBufferList containing the audio to write
+	/// @param frameCount The number of frames to write
+	/// @param timeStamp The time stamp of the first frame, which must have a valid host time
+	/// @return @c true on success, @c false on error
+	bool Write(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, const AudioTimeStamp& timeStamp) noexcept;
+
+	/// Reads audio for the consumer
+	///
+	/// Silence is returned until the producer has written enough audio to satisfy the target latency.
+	/// @note This method should only be called from the consumer's thread
+	/// @param bufferList An @c AudioBufferList to receive the audio
+	/// @param frameCount The number of frames to read, which must not exceed the @c maximumFramesPerRead passed to @c Allocate()
+	/// @param timeStamp The time stamp of the first frame, which must have a valid host time
+	/// @return @c true on success, @c false on error
+	bool Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, const AudioTimeStamp& timeStamp) noexcept;
+
+#pragma mark Statistics
+
+	/// Returns the bridge statistics
+	/// @note This method is safe to call from any thread
+	BridgeStatistics Statistics() const noexcept;
+
+private:
+
+	/// The producer's clock as seen by the consumer, protected by a sequence lock
+	struct ProducerClock {
+		/// The number of frames written before @c mTime
+		std::atomic_int64_t mFrameCount;
+		/// The filtered host time at which the most recent write began
+		std::atomic<double> mTime;
+		/// The filtered rate of the producer in frames per host tick
+		std::atomic<double> mFramesPerTick;
+		/// Sequence number incremented before and after the struct is modified
+		/// @note The sequence number is odd while a modification is in progress
+		std::atomic_uint64_t mSequence;
+	};
+
+	/// Publishes the state of the producer's delay-locked loop to the consumer
+	void PublishProducerClock() noexcept;
+
+	/// Reads the producer's clock into the @c mProducer variables
+	/// @return @c true if the producer has written audio
+	bool ReadProducerClock() noexcept;
+
+	/// Destructive interference size for atomic variables
+	static constexpr size_t sCacheLineSize = 128;
+
+	/// The audio being transferred, timed by the producer's clock
+	CARingBuffer mRingBuffer;
+	/// Consumer scratch space for audio being resampled
+	CABufferList mInputBuffer;
+	/// The delay-locked loop bandwidth in Hz
+	double mBandwidth;
+
+	/// The target latency in frames
+	std::atomic_uint32_t mTargetLatency;
+
+	/// The producer's delay-locked loop
+	/// @note This is only accessed from the producer's thread
+	alignas(sCacheLineSize) DelayLockedLoop mProducerLoop;
+	/// The number of frames written
+	/// @note This is only accessed from the producer's thread
+	int64_t mFramesWritten;
+
+	/// The producer's published clock
+	alignas(sCacheLineSize) ProducerClock mProducerClock;
+
+	/// The consumer's delay-locked loop
+	/// @note This is only accessed from the consumer's thread
+	alignas(sCacheLineSize) DelayLockedLoop mConsumerLoop;
+	/// The most recently read producer frame count
+	int64_t mProducerFrameCount;
+	/// The most recently read producer time
+	double mProducerTime;
+	/// The most recently read producer rate
+	double mProducerFramesPerTick;
+	/// The fractional producer frame at which the next read begins or @c NaN if the consumer is not synchronized
+	double mReadPosition;
+
+	/// The most recent resampling ratio
+	alignas(sCacheLineSize) std::atomic<double> mRatio;
+	/// The most recent latency
+	std::atomic<double> mLatency;
+	/// The number of resynchronizations
+	std::atomic_uint64_t mResynchronizations;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cmath>
+#import <cstdint>
+
+namespace SFB {
+
+/// A second-order delay-locked loop estimating the rate of an audio clock
+///
+/// A @c DelayLockedLoop models a device clock whose periods of audio are reported at jittery times, such as the host times
+/// of successive HAL IO cycles. The loop filters the reported times to produce a smooth mapping between time and frames.
+/// Time may be measured in any unit, for example host ticks.
+///
+/// The loop is based on F. Adriaensen, "Using a DLL to filter time" (2005), generalized to periods of varying length.
+class DelayLockedLoop
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c DelayLockedLoop
+	/// @param sampleRate The nominal sample rate of the clock
+	/// @param bandwidth The loop bandwidth in Hz. Lower bandwidths reject more jitter but track rate changes more slowly
+	inline DelayLockedLoop(double sampleRate = 44100, double bandwidth = 0.5) noexcept
+	: mSampleRate(sampleRate), mBandwidth(bandwidth), mIsRunning(false), mFrameCount(0), mPeriodFrames(0), mTime(0), mNextTime(0), mTimePerFrame(0)
+	{}
+
+	/// Sets the nominal sample rate and loop bandwidth and stops the loop
+	inline void Configure(double sampleRate, double bandwidth) noexcept
+	{
+		mSampleRate = sampleRate;
+		mBandwidth = bandwidth;
+		Reset();
+	}
+
+	/// Stops the loop
+	inline void Reset() noexcept
+	{
+		mIsRunning = false;
+		mFrameCount = 0;
+		mPeriodFrames = 0;
+		mTime = 0;
+		mNextTime = 0;
+		mTimePerFrame = 0;
+	}
+
+#pragma mark Updating
+
+	/// Starts the loop
+	/// @param time The time at which the first period began
+	/// @param frameCount The number of frames in the first period
+	/// @param timePerFrame The expected duration of one frame
+	inline void Start(double time, uint32_t frameCount, double timePerFrame) noexcept
+	{
+		mFrameCount = 0;
+		mPeriodFrames = frameCount;
+		mTimePerFrame = timePerFrame;
+		mTime = time;
+		mNextTime = time + frameCount * timePerFrame;
+		mIsRunning = true;
+	}
+
+	/// Updates the loop with the time at which a period began
+	/// @note The loop must be started before it is updated
+	/// @param time The time at which the period began
+	/// @param frameCount The number of frames in the period
+	inline void Update(double time, uint32_t frameCount) noexcept
+	{
+		if(frameCount == 0)
+			return;
+
+		// The coefficients are computed for a critically damped loop using the length of the period that just ended
+		const auto omega = 2 * M_PI * mBandwidth * mPeriodFrames / mSampleRate;
+		const auto b = M_SQRT2 * omega;
+		const auto c = omega * omega;
+
+		const auto error = time - mNextTime;
+
+		mFrameCount += mPeriodFrames;
+		mTime = mNextTime;
+		mNextTime += (b * error) + (frameCount * mTimePerFrame);
+		mTimePerFrame += (c * error) / frameCount;
+		mPeriodFrames = frameCount;
+	}
+
+#pragma mark Clock information
+
+	/// Returns @c true if the loop is running
+	inline bool IsRunning() const noexcept
+	{
+		return mIsRunning;
+	}
+
+	/// Returns the filtered time at which the current period began
+	inline double Time() const noexcept
+	{
+		return mTime;
+	}
+
+	/// Returns the number of frames preceding the current period
+	inline int64_t FrameCount() const noexcept
+	{
+		return mFrameCount;
+	}
+
+	/// Returns the filtered rate of the clock in frames per unit of time
+	inline double FramesPerTime() const noexcept
+	{
+		return mPeriodFrames / (mNextTime - mTime);
+	}
+
+	/// Returns the fractional frame position of the clock at @c time
+	inline double FramePosition(double time) const noexcept
+	{
+		return mFrameCount + ((time - mTime) * FramesPerTime());
+	}
+
+	/// Returns the difference between @c time and the predicted start of the next period
+	inline double Error(double time) const noexcept
+	{
+		return time - mNextTime;
+	}
+
+private:
+
+	/// The nominal sample rate
+	double mSampleRate;
+	/// The loop bandwidth in Hz
+	double mBandwidth;
+	/// @c true if the loop is running
+	bool mIsRunning;
+
+	/// The number of frames preceding the current period
+	int64_t mFrameCount;
+	/// The number of frames in the current period
+	uint32_t mPeriodFrames;
+	/// The filtered time at which the current period began
+	double mTime;
+	/// The predicted time at which the next period begins
+	double mNextTime;
+	/// The filtered duration of one frame
+	double mTimePerFrame;
+
+};
+
+} // namespace SFB
@@ -8,6 +8,7 @@
 
 #import "SFBHALAudioObject.hpp"
 #import "SFBHALAudioStream.hpp"
+#import "SFBCAChannelLayout.hpp"
 
 namespace SFB {
 
@@ -36,8 +37,10 @@ public:
 
 
 	/// Creates a @c HALAudioDevice with the specified objectID
-	inline constexpr HALAudioDevice(AudioObjectID objectID) noexcept
-	: HALAudioObject(objectID)
+	/// @param objectID The audio object ID
+	/// @param propertyCache An optional cache for property values, which must outlive the object
+	inline constexpr HALAudioDevice(AudioObjectID objectID, HALPropertyCache * _Nullable propertyCache = nullptr) noexcept
+	: HALAudioObject(objectID, propertyCache)
 	{}
 
 
@@ -71,11 +74,21 @@ public:
 		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioDevicePropertyStreams, scope == HALAudioObjectDirectionalScope::input ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput));
 	}
 
+	inline size_t StreamIDs(HALAudioObjectDirectionalScope scope, std::span<AudioObjectID> buffer) const
+	{
+		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioDevicePropertyStreams, scope == HALAudioObjectDirectionalScope::input ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput), buffer);
+	}
+
+	inline void StreamIDs(HALAudioObjectDirectionalScope scope, std::vector<AudioObjectID>& buffer) const
+	{
+		ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioDevicePropertyStreams, scope == HALAudioObjectDirectionalScope::input ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput), buffer);
+	}
+
 	std::vector<HALAudioStream> Streams(HALAudioObjectDirectionalScope scope) const
 	{
 		auto vec = StreamIDs(scope);
 		std::vector<HALAudioStream> result(vec.size());
-		std::transform(vec.cbegin(), vec.cend(), result.begin(), [](AudioObjectID objectID) { return HALAudioStream(objectID); });
+		std::transform(vec.cbegin(), vec.cend(), result.begin(), [this](AudioObjectID objectID) { return HALAudioStream(objectID, mPropertyCache); });
 		return result;
 	}
 
@@ -91,11 +104,34 @@ public:
 		return ArithmeticProperty<Float64>(CAPropertyAddress(kAudioDevicePropertyNominalSampleRate));
 	}
 
-	//	kAudioDevicePropertyAvailableNominalSampleRates     = 'nsr#',
+
+	inline std::vector<AudioValueRange> AvailableNominalSampleRates() const
+	{
+		return ArrayProperty<AudioValueRange>(CAPropertyAddress(kAudioDevicePropertyAvailableNominalSampleRates));
+	}
+
+	inline size_t AvailableNominalSampleRates(std::span<AudioValueRange> buffer) const
+	{
+		return ArrayProperty<AudioValueRange>(CAPropertyAddress(kAudioDevicePropertyAvailableNominalSampleRates), buffer);
+	}
+
+	inline void AvailableNominalSampleRates(std::vector<AudioValueRange>& buffer) const
+	{
+		ArrayProperty<AudioValueRange>(CAPropertyAddress(kAudioDevicePropertyAvailableNominalSampleRates), buffer);
+	}
+
 	//	kAudioDevicePropertyIcon                            = 'icon',
 	//	kAudioDevicePropertyIsHidden                        = 'hidn',
 	//	kAudioDevicePropertyPreferredChannelsForStereo      = 'dch2',
-	//	kAudioDevicePropertyPreferredChannelLayout          = 'srnd'
+
+	inline CAChannelLayout PreferredChannelLayout(HALAudioObjectDirectionalScope scope) const
+	{
+		// The property data is a variable-length AudioChannelLayout
+		auto data = ArrayProperty<uint8_t>(CAPropertyAddress(kAudioDevicePropertyPreferredChannelLayout, scope == HALAudioObjectDirectionalScope::input ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput));
+		if(data.size() < offsetof(AudioChannelLayout, mChannelDescriptions))
+			return {};
+		return CAChannelLayout(reinterpret_cast<const AudioChannelLayout *>(data.data()));
+	}
 
 	//	kAudioDevicePropertyPlugIn                          = 'plug',
 	//	kAudioDevicePropertyDeviceHasChanged                = 'diff',
@@ -6,6 +6,9 @@
 
 #pragma once
 
+#import <algorithm>
+#import <cstring>
+#import <span>
 #import <vector>
 
 #import <CoreAudio/CoreAudio.h>
@@ -13,6 +16,7 @@
 #import "SFBCAException.hpp"
 #import "SFBCAPropertyAddress.hpp"
 #import "SFBCFWrapper.hpp"
+#import "SFBHALPropertyCache.hpp"
 
 namespace SFB {
 
@@ -30,7 +34,7 @@ public:
 
 	/// Creates an unknown @c HALAudioObject
 	inline constexpr HALAudioObject() noexcept
-	: mObjectID(kAudioObjectUnknown)
+	: mObjectID(kAudioObjectUnknown), mPropertyCache(nullptr)
 	{}
 
 	/// Copy constructor
@@ -50,8 +54,10 @@ public:
 
 
 	/// Creates a @c HALAudioObject with the specified objectID
-	inline constexpr HALAudioObject(AudioObjectID objectID) noexcept
-	: mObjectID(objectID)
+	/// @param objectID The audio object ID
+	/// @param propertyCache An optional cache for property values, which must outlive the object
+	inline constexpr HALAudioObject(AudioObjectID objectID, HALPropertyCache * _Nullable propertyCache = nullptr) noexcept
+	: mObjectID(objectID), mPropertyCache(propertyCache)
 	{}
 
 #pragma mark Comparison
@@ -90,6 +96,21 @@ public:
 		return mObjectID;
 	}
 
+#pragma mark Property Cache
+
+	/// Returns the property cache used by this object or @c nullptr if property values are not cached
+	inline HALPropertyCache * _Nullable PropertyCache() const noexcept
+	{
+		return mPropertyCache;
+	}
+
+	/// Sets the property cache used by this object
+	/// @param propertyCache A cache for property values, which must outlive the object, or @c nullptr to disable caching
+	inline void SetPropertyCache(HALPropertyCache * _Nullable propertyCache) noexcept
+	{
+		mPropertyCache = propertyCache;
+	}
+
 #pragma mark Property Operations
 
 	inline bool HasProperty(const AudioObjectPropertyAddress& inAddress) const noexcept
@@ -130,7 +151,11 @@ public:
 	template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, bool>::type = true>
 	T ArithmeticProperty(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
 	{
-		T value;
+		T value{};
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, false)) {
+			std::memcpy(&value, cachedValue->Data(), std::min<size_t>(sizeof(T), cachedValue->Size()));
+			return value;
+		}
 		UInt32 size = sizeof(T);
 		GetPropertyData(inAddress, inQualifierDataSize, inQualifierData, size, &value);
 		return value;
@@ -139,7 +164,11 @@ public:
 	template <typename T, typename std::enable_if<std::is_trivial<T>::value, bool>::type = true>
 	T StructProperty(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
 	{
-		T value;
+		T value{};
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, false)) {
+			std::memcpy(&value, cachedValue->Data(), std::min<size_t>(sizeof(T), cachedValue->Size()));
+			return value;
+		}
 		UInt32 size = sizeof(T);
 		GetPropertyData(inAddress, inQualifierDataSize, inQualifierData, size, &value);
 		return value;
@@ -148,6 +177,11 @@ public:
 	template <typename T, typename std::enable_if<std::is_trivial<T>::value, bool>::type = true>
 	std::vector<T> ArrayProperty(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
 	{
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, false)) {
+			auto vec = std::vector<T>(cachedValue->Size() / sizeof(T));
+			std::memcpy(vec.data(), cachedValue->Data(), vec.size() * sizeof(T));
+			return vec;
+		}
 		auto size = GetPropertyDataSize(inAddress, inQualifierDataSize, inQualifierData);
 		auto count = size / sizeof(T);
 		auto vec = std::vector<T>(count);
@@ -155,9 +189,52 @@ public:
 		return vec;
 	}
 
+	/// Copies the elements of an array property to @c buffer
+	/// @return The number of elements in the property. If this is greater than @c buffer.size() no elements were copied
+	/// @throw @c std::system_error
+	template <typename T, typename std::enable_if<std::is_trivial<T>::value, bool>::type = true>
+	size_t ArrayProperty(const AudioObjectPropertyAddress& inAddress, std::span<T> buffer, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
+	{
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, false)) {
+			auto count = cachedValue->Size() / sizeof(T);
+			if(count <= buffer.size())
+				std::memcpy(buffer.data(), cachedValue->Data(), count * sizeof(T));
+			return count;
+		}
+		auto size = GetPropertyDataSize(inAddress, inQualifierDataSize, inQualifierData);
+		auto count = size / sizeof(T);
+		if(count == 0 || count > buffer.size())
+			return count;
+		GetPropertyData(inAddress, inQualifierDataSize, inQualifierData, size, buffer.data());
+		return size / sizeof(T);
+	}
+
+	/// Replaces the contents of @c buffer with the elements of an array property
+	/// @note Memory is only allocated if @c buffer lacks the capacity for the elements
+	/// @throw @c std::system_error
+	template <typename T, typename std::enable_if<std::is_trivial<T>::value, bool>::type = true>
+	void ArrayProperty(const AudioObjectPropertyAddress& inAddress, std::vector<T>& buffer, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
+	{
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, false)) {
+			auto data = static_cast<const T *>(cachedValue->Data());
+			buffer.assign(data, data + cachedValue->Size() / sizeof(T));
+			return;
+		}
+		auto size = GetPropertyDataSize(inAddress, inQualifierDataSize, inQualifierData);
+		buffer.resize(size / sizeof(T));
+		if(buffer.empty())
+			return;
+		GetPropertyData(inAddress, inQualifierDataSize, inQualifierData, size, buffer.data());
+		buffer.resize(size / sizeof(T));
+	}
+
 	template <typename T, typename std::enable_if</*std::is_class<T>::value &&*/ std::is_pointer<T>::value, bool>::type = true>
 	CFWrapper<T> CFTypeProperty(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize = 0, const void * _Nullable inQualifierData = nullptr) const
 	{
+		if(auto cachedValue = CachedPropertyValue(inAddress, inQualifierData, true)) {
+			auto object = cachedValue->CFObject();
+			return CFWrapper<T>(static_cast<T>(object ? CFRetain(object) : nullptr));
+		}
 		T value;
 		UInt32 size = sizeof(T);
 		GetPropertyData(inAddress, inQualifierDataSize, inQualifierData, size, &value);
@@ -246,11 +323,21 @@ public:
 		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioObjectPropertyOwnedObjects));
 	}
 
+	inline size_t OwnedObjectIDs(std::span<AudioObjectID> buffer) const
+	{
+		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioObjectPropertyOwnedObjects), buffer);
+	}
+
+	inline void OwnedObjectIDs(std::vector<AudioObjectID>& buffer) const
+	{
+		ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioObjectPropertyOwnedObjects), buffer);
+	}
+
 	std::vector<HALAudioObject> OwnedObjects() const
 	{
 		auto vec = OwnedObjectIDs();
 		std::vector<HALAudioObject> result(vec.size());
-		std::transform(vec.cbegin(), vec.cend(), result.begin(), [](AudioObjectID objectID) { return HALAudioObject(objectID); });
+		std::transform(vec.cbegin(), vec.cend(), result.begin(), [this](AudioObjectID objectID) { return HALAudioObject(objectID, mPropertyCache); });
 		return result;
 	}
 
@@ -268,8 +355,20 @@ public:
 
 protected:
 
+	/// Returns the cached value of a property or @c nullptr if the property should not be cached
+	/// @throw @c std::system_error
+	inline std::shared_ptr<const HALPropertyCache::PropertyValue> CachedPropertyValue(const AudioObjectPropertyAddress& inAddress, const void * _Nullable inQualifierData, bool isCFType) const
+	{
+		// Values that depend on qualifier data are not cached
+		if(!mPropertyCache || inQualifierData)
+			return nullptr;
+		return mPropertyCache->Value(mObjectID, inAddress, isCFType);
+	}
+
 	// The underlying object ID
 	AudioObjectID mObjectID;
+	/// The cache for property values or @c nullptr if values are not cached
+	HALPropertyCache * _Nullable mPropertyCache;
 
 };
 
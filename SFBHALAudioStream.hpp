@@ -36,8 +36,10 @@ public:
 
 
 	/// Creates a @c HALAudioStream with the specified objectID
-	inline constexpr HALAudioStream(AudioObjectID objectID) noexcept
-	: HALAudioObject(objectID)
+	/// @param objectID The audio object ID
+	/// @param propertyCache An optional cache for property values, which must outlive the object
+	inline constexpr HALAudioStream(AudioObjectID objectID, HALPropertyCache * _Nullable propertyCache = nullptr) noexcept
+	: HALAudioObject(objectID, propertyCache)
 	{}
 
 	inline bool IsActive() const
@@ -75,6 +77,16 @@ public:
 		return ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailableVirtualFormats));
 	}
 
+	inline size_t AvailableVirtualFormats(std::span<AudioStreamRangedDescription> buffer) const
+	{
+		return ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailableVirtualFormats), buffer);
+	}
+
+	inline void AvailableVirtualFormats(std::vector<AudioStreamRangedDescription>& buffer) const
+	{
+		ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailableVirtualFormats), buffer);
+	}
+
 	inline CAStreamBasicDescription PhysicalFormat() const
 	{
 		return StructProperty<AudioStreamBasicDescription>(CAPropertyAddress(kAudioStreamPropertyPhysicalFormat));
@@ -85,6 +97,16 @@ public:
 		return ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailablePhysicalFormats));
 	}
 
+	inline size_t AvailablePhysicalFormats(std::span<AudioStreamRangedDescription> buffer) const
+	{
+		return ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailablePhysicalFormats), buffer);
+	}
+
+	inline void AvailablePhysicalFormats(std::vector<AudioStreamRangedDescription>& buffer) const
+	{
+		ArrayProperty<AudioStreamRangedDescription>(CAPropertyAddress(kAudioStreamPropertyAvailablePhysicalFormats), buffer);
+	}
+
 };
 
 } // namespace SFB
@@ -8,6 +8,7 @@
 
 #import "SFBHALAudioObject.hpp"
 #import "SFBHALAudioDevice.hpp"
+#import "SFBHALAudioSystemSnapshot.hpp"
 
 namespace SFB {
 
@@ -21,6 +22,12 @@ public:
 	: HALAudioObject(kAudioObjectSystemObject)
 	{}
 
+	/// Creates an @c HALAudioSystemObject using @c propertyCache to cache property values
+	/// @note Objects returned by this object use the same cache, which must outlive them
+	inline constexpr explicit HALAudioSystemObject(HALPropertyCache * _Nullable propertyCache) noexcept
+	: HALAudioObject(kAudioObjectSystemObject, propertyCache)
+	{}
+
 	/// Copy constructor
 	constexpr HALAudioSystemObject(const HALAudioSystemObject& rhs) = default;
 
@@ -42,14 +49,39 @@ public:
 		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioHardwarePropertyDevices));
 	}
 
+	inline size_t DeviceIDs(std::span<AudioObjectID> buffer) const
+	{
+		return ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioHardwarePropertyDevices), buffer);
+	}
+
+	inline void DeviceIDs(std::vector<AudioObjectID>& buffer) const
+	{
+		ArrayProperty<AudioObjectID>(CAPropertyAddress(kAudioHardwarePropertyDevices), buffer);
+	}
+
 	std::vector<HALAudioDevice> Devices() const
 	{
 		auto vec = DeviceIDs();
 		std::vector<HALAudioDevice> result(vec.size());
-		std::transform(vec.cbegin(), vec.cend(), result.begin(), [](AudioObjectID objectID) { return HALAudioDevice(objectID); });
+		std::transform(vec.cbegin(), vec.cend(), result.begin(), [this](AudioObjectID objectID) { return HALAudioDevice(objectID, mPropertyCache); });
 		return result;
 	}
 
+	/// Collects a snapshot of the audio devices and their streams
+	/// @throw @c std::system_error
+	inline HALAudioSystemSnapshot Snapshot() const
+	{
+		return HALAudioSystemSnapshot::Collect(mPropertyCache);
+	}
+
+	/// Collects a snapshot of the audio devices and their streams asynchronously
+	/// @param completion A block called with the snapshot on @c completionQueue
+	/// @param completionQueue The dispatch queue on which @c completion is called or @c nullptr to call it on the queue that collected the snapshot
+	inline void SnapshotAsync(HALAudioSystemSnapshot::Completion completion, dispatch_queue_t _Nullable completionQueue = nullptr) const
+	{
+		HALAudioSystemSnapshot::CollectAsync(std::move(completion), completionQueue, mPropertyCache);
+	}
+
 	inline AudioObjectID DefaultInputDeviceID() const
 	{
 		return ArithmeticProperty<AudioObjectID>(CAPropertyAddress(kAudioHardwarePropertyDefaultInputDevice));
@@ -57,7 +89,7 @@ public:
 
 	inline HALAudioObject DefaultInputDevice() const
 	{
-		return HALAudioObject(DefaultInputDeviceID());
+		return HALAudioObject(DefaultInputDeviceID(), mPropertyCache);
 	}
 
 	inline AudioObjectID DefaultOutputDeviceID() const
@@ -67,7 +99,7 @@ public:
 
 	inline HALAudioObject DefaultOutputDevice() const
 	{
-		return HALAudioObject(DefaultOutputDeviceID());
+		return HALAudioObject(DefaultOutputDeviceID(), mPropertyCache);
 	}
 
 	inline AudioObjectID DefaultSystemOutputDeviceID() const
@@ -77,7 +109,7 @@ public:
 
 	inline HALAudioObject DefaultSystemOutputDevice() const
 	{
-		return HALAudioObject(DefaultSystemOutputDeviceID());
+		return HALAudioObject(DefaultSystemOutputDeviceID(), mPropertyCache);
 	}
 
 	AudioObjectID AudioDeviceIDForUID(CFStringRef _Nonnull inUID) const
@@ -92,7 +124,7 @@ public:
 
 	inline HALAudioDevice AudioDeviceForUID(CFStringRef _Nonnull inUID) const
 	{
-		return HALAudioDevice(AudioDeviceIDForUID(inUID));
+		return HALAudioDevice(AudioDeviceIDForUID(inUID), mPropertyCache);
 	}
 
 	//	kAudioHardwarePropertyMixStereoToMono                       = 'stmo',
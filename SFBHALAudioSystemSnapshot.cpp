@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <optional>
+#import <system_error>
+#import <type_traits>
+
+#import "SFBHALAudioSystemSnapshot.hpp"
+#import "SFBHALAudioSystemObject.hpp"
+#import "SFBCAException.hpp"
+
+namespace {
+
+/// Returns the value of @c f or @c fallback if the property is not available
+template <typename F, typename T = std::invoke_result_t<F>>
+T OptionalProperty(F&& f, T fallback = T())
+{
+	try {
+		return f();
+	}
+	catch(const std::system_error&) {
+		return fallback;
+	}
+}
+
+/// Returns @c true if @c e indicates that the object being queried no longer exists
+bool IsObjectRemovedError(const std::system_error& e) noexcept
+{
+	return e.code() == SFB::CAAudioObjectErrorCode::hardwareBadObjectError || e.code() == SFB::CAAudioObjectErrorCode::hardwareBadDeviceError;
+}
+
+/// Collects the properties of a stream
+/// @throw @c std::system_error
+SFB::HALAudioStreamSnapshot StreamSnapshot(const SFB::HALAudioStream& stream)
+{
+	return {
+		.mStreamID = stream.ObjectID(),
+		.mIsActive = stream.IsActive(),
+		.mDirection = stream.Direction(),
+		.mTerminalType = stream.TerminalType(),
+		.mStartingChannel = stream.StartingChannel(),
+		.mLatency = stream.Latency(),
+		.mVirtualFormat = stream.VirtualFormat(),
+		.mAvailableVirtualFormats = stream.AvailableVirtualFormats(),
+		.mPhysicalFormat = stream.PhysicalFormat(),
+		.mAvailablePhysicalFormats = stream.AvailablePhysicalFormats(),
+	};
+}
+
+/// Collects the properties of one direction of a device
+/// @throw @c std::system_error
+SFB::HALAudioDeviceScopeSnapshot ScopeSnapshot(const SFB::HALAudioDevice& device, SFB::HALAudioObjectDirectionalScope scope)
+{
+	SFB::HALAudioDeviceScopeSnapshot snapshot{
+		.mLatency = device.Latency(scope),
+		.mSafetyOffset = device.SafetyOffset(scope),
+		.mPreferredChannelLayout = OptionalProperty([&] { return device.PreferredChannelLayout(scope); }),
+	};
+
+	const auto streams = device.Streams(scope);
+	snapshot.mStreams.reserve(streams.size());
+	for(const auto& stream : streams)
+		snapshot.mStreams.push_back(StreamSnapshot(stream));
+
+	return snapshot;
+}
+
+/// Collects the properties of a device
+/// @throw @c std::system_error
+SFB::HALAudioDeviceSnapshot DeviceSnapshot(const SFB::HALAudioDevice& device)
+{
+	return {
+		.mDeviceID = device.ObjectID(),
+		.mName = device.Name(),
+		.mManufacturer = OptionalProperty([&] { return device.Manufacturer(); }),
+		.mUID = device.UID(),
+		.mModelUID = OptionalProperty([&] { return device.ModelUID(); }),
+		.mNominalSampleRate = device.NominalSampleRate(),
+		.mBufferFrameSize = device.BufferFrameSize(),
+		.mInput = ScopeSnapshot(device, SFB::HALAudioObjectDirectionalScope::input),
+		.mOutput = ScopeSnapshot(device, SFB::HALAudioObjectDirectionalScope::output),
+	};
+}
+
+/// The result of collecting the properties of a device
+struct DeviceResult
+{
+	/// The device snapshot or @c std::nullopt if the device disappeared
+	std::optional<SFB::HALAudioDeviceSnapshot> mSnapshot;
+	/// The exception thrown while collecting the snapshot, unless it indicated the device disappeared
+	std::exception_ptr mError;
+};
+
+/// The state for a snapshot collected with @c CollectAsync()
+struct AsyncContext
+{
+	/// The completion block
+	SFB::HALAudioSystemSnapshot::Completion mCompletion;
+	/// The queue on which the completion block is called
+	dispatch_queue_t _Nullable mCompletionQueue;
+	/// The property cache used to collect the snapshot
+	SFB::HALPropertyCache * _Nullable mPropertyCache;
+	/// The collected snapshot
+	std::shared_ptr<const SFB::HALAudioSystemSnapshot> mSnapshot;
+	/// The exception that prevented the snapshot from being collected
+	std::exception_ptr mError;
+};
+
+/// Calls the completion of an @c AsyncContext and deletes it
+void CompleteAsync(void * _Nullable context) noexcept
+{
+	std::unique_ptr<AsyncContext> asyncContext(static_cast<AsyncContext *>(context));
+	asyncContext->mCompletion(std::move(asyncContext->mSnapshot), asyncContext->mError);
+#if !__has_feature(objc_arc)
+	if(asyncContext->mCompletionQueue)
+		dispatch_release(asyncContext->mCompletionQueue);
+#endif
+}
+
+/// Collects the snapshot for an @c AsyncContext
+void CollectSnapshotAsync(void * _Nullable context) noexcept
+{
+	auto asyncContext = static_cast<AsyncContext *>(context);
+	try {
+		asyncContext->mSnapshot = std::make_shared<const SFB::HALAudioSystemSnapshot>(SFB::HALAudioSystemSnapshot::Collect(asyncContext->mPropertyCache));
+	}
+	catch(...) {
+		asyncContext->mError = std::current_exception();
+	}
+
+	if(asyncContext->mCompletionQueue)
+		dispatch_async_f(asyncContext->mCompletionQueue, asyncContext, CompleteAsync);
+	else
+		CompleteAsync(asyncContext);
+}
+
+} // namespace
+
+#pragma mark Collection
+
+SFB::HALAudioSystemSnapshot SFB::HALAudioSystemSnapshot::Collect(HALPropertyCache *propertyCache)
+{
+	HALAudioSystemObject systemObject(propertyCache);
+
+	HALAudioSystemSnapshot snapshot{
+		.mDefaultInputDeviceID = systemObject.DefaultInputDeviceID(),
+		.mDefaultOutputDeviceID = systemObject.DefaultOutputDeviceID(),
+		.mDefaultSystemOutputDeviceID = systemObject.DefaultSystemOutputDeviceID(),
+	};
+
+	const auto devices = systemObject.Devices();
+	std::vector<DeviceResult> results(devices.size());
+
+	// Each HAL query is a round trip to coreaudiod so the devices are queried concurrently
+	struct ApplyContext
+	{
+		const std::vector<HALAudioDevice>& mDevices;
+		std::vector<DeviceResult>& mResults;
+	} applyContext{ devices, results };
+
+	dispatch_apply_f(devices.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), &applyContext, [](void *context, size_t i) {
+		auto applyContext = static_cast<ApplyContext *>(context);
+		auto& result = applyContext->mResults[i];
+		try {
+			result.mSnapshot = DeviceSnapshot(applyContext->mDevices[i]);
+		}
+		catch(const std::system_error& e) {
+			// A device removed while the snapshot was being collected is omitted; any other HAL error is reported
+			if(!IsObjectRemovedError(e))
+				result.mError = std::current_exception();
+		}
+		catch(...) {
+			result.mError = std::current_exception();
+		}
+	});
+
+	snapshot.mDevices.reserve(results.size());
+	for(auto& result : results) {
+		if(result.mError)
+			std::rethrow_exception(result.mError);
+		if(result.mSnapshot)
+			snapshot.mDevices.push_back(std::move(*result.mSnapshot));
+	}
+
+	return snapshot;
+}
+
+void SFB::HALAudioSystemSnapshot::CollectAsync(Completion completion, dispatch_queue_t completionQueue, HALPropertyCache *propertyCache)
+{
+	auto context = new AsyncContext{ std::move(completion), completionQueue, propertyCache, nullptr, nullptr };
+#if !__has_feature(objc_arc)
+	if(completionQueue)
+		dispatch_retain(completionQueue);
+#endif
+	dispatch_async_f(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), context, CollectSnapshotAsync);
+}
+
+#pragma mark Device Lookup
+
+const SFB::HALAudioDeviceSnapshot * SFB::HALAudioSystemSnapshot::Device(AudioObjectID deviceID) const noexcept
+{
+	auto iter = std::find_if(mDevices.cbegin(), mDevices.cend(), [deviceID](const HALAudioDeviceSnapshot& device) { return device.mDeviceID == deviceID; });
+	return iter != mDevices.cend() ? &*iter : nullptr;
+}
+
+const SFB::HALAudioDeviceSnapshot * SFB::HALAudioSystemSnapshot::DeviceForUID(CFStringRef uid) const noexcept
+{
+	auto iter = std::find_if(mDevices.cbegin(), mDevices.cend(), [uid](const HALAudioDeviceSnapshot& device) { return device.mUID && CFEqual(device.mUID, uid); });
+	return iter != mDevices.cend() ? &*iter : nullptr;
+}
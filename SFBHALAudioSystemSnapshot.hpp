@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <exception>
+#import <functional>
+#import <memory>
+#import <vector>
+
+#import <CoreAudio/CoreAudio.h>
+#import <dispatch/dispatch.h>
+
+#import "SFBCAChannelLayout.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+#import "SFBCFWrapper.hpp"
+
+namespace SFB {
+
+class HALPropertyCache;
+
+/// The properties of a HAL audio stream at the time a snapshot was taken
+struct HALAudioStreamSnapshot
+{
+	/// The stream's object ID
+	AudioObjectID mStreamID;
+	/// @c true if the stream is active
+	bool mIsActive;
+	/// The stream's direction
+	UInt32 mDirection;
+	/// The stream's terminal type
+	UInt32 mTerminalType;
+	/// The first device channel of the stream
+	UInt32 mStartingChannel;
+	/// The stream's latency in frames
+	UInt32 mLatency;
+	/// The stream's virtual format
+	CAStreamBasicDescription mVirtualFormat;
+	/// The stream's available virtual formats
+	std::vector<AudioStreamRangedDescription> mAvailableVirtualFormats;
+	/// The stream's physical format
+	CAStreamBasicDescription mPhysicalFormat;
+	/// The stream's available physical formats
+	std::vector<AudioStreamRangedDescription> mAvailablePhysicalFormats;
+};
+
+/// The properties of one direction of a HAL audio device at the time a snapshot was taken
+struct HALAudioDeviceScopeSnapshot
+{
+	/// The device's latency in frames
+	UInt32 mLatency;
+	/// The device's safety offset in frames
+	UInt32 mSafetyOffset;
+	/// The device's preferred channel layout, which is empty if the device has none
+	CAChannelLayout mPreferredChannelLayout;
+	/// The device's streams
+	std::vector<HALAudioStreamSnapshot> mStreams;
+};
+
+/// The properties of a HAL audio device at the time a snapshot was taken
+struct HALAudioDeviceSnapshot
+{
+	/// The device's object ID
+	AudioObjectID mDeviceID;
+	/// The device's name
+	CFString mName;
+	/// The device's manufacturer
+	CFString mManufacturer;
+	/// The device's UID
+	CFString mUID;
+	/// The device's model UID, which is null if the device has none
+	CFString mModelUID;
+	/// The device's nominal sample rate
+	Float64 mNominalSampleRate;
+	/// The device's IO buffer size in frames
+	UInt32 mBufferFrameSize;
+	/// The device's input properties
+	HALAudioDeviceScopeSnapshot mInput;
+	/// The device's output properties
+	HALAudioDeviceScopeSnapshot mOutput;
+};
+
+/// The HAL audio devices and their streams at the time a snapshot was taken
+///
+/// A snapshot is collected in one pass with the devices queried concurrently. Devices that disappear while the snapshot
+/// is being collected are omitted.
+struct HALAudioSystemSnapshot
+{
+	/// A block called with a completed snapshot or the exception that prevented it from being collected
+	using Completion = std::function<void(std::shared_ptr<const HALAudioSystemSnapshot> snapshot, std::exception_ptr error)>;
+
+	/// Collects a snapshot of the HAL audio devices
+	/// @param propertyCache An optional cache for property values
+	/// @return A snapshot of the HAL audio devices
+	/// @throw @c std::system_error
+	/// @throw @c std::bad_alloc
+	static HALAudioSystemSnapshot Collect(HALPropertyCache * _Nullable propertyCache = nullptr);
+
+	/// Collects a snapshot of the HAL audio devices asynchronously
+	/// @param completion A block called with the snapshot on @c completionQueue
+	/// @param completionQueue The dispatch queue on which @c completion is called or @c nullptr to call it on the queue that collected the snapshot
+	/// @param propertyCache An optional cache for property values, which must remain valid until @c completion is called
+	static void CollectAsync(Completion completion, dispatch_queue_t _Nullable completionQueue = nullptr, HALPropertyCache * _Nullable propertyCache = nullptr);
+
+	/// Returns the snapshot of the device with @c deviceID or @c nullptr if no such device exists
+	const HALAudioDeviceSnapshot * _Nullable Device(AudioObjectID deviceID) const noexcept;
+
+	/// Returns the snapshot of the device with @c uid or @c nullptr if no such device exists
+	const HALAudioDeviceSnapshot * _Nullable DeviceForUID(CFStringRef _Nonnull uid) const noexcept;
+
+	/// The audio devices
+	std::vector<HALAudioDeviceSnapshot> mDevices;
+	/// The default input device
+	AudioObjectID mDefaultInputDeviceID;
+	/// The default output device
+	AudioObjectID mDefaultOutputDeviceID;
+	/// The default system output device
+	AudioObjectID mDefaultSystemOutputDeviceID;
+};
+
+} // namespace SFB
@@ -0,0 +1,310 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <atomic>
+#import <map>
+#import <mutex>
+#import <tuple>
+
+#import <Block.h>
+
+#import "SFBHALPropertyCache.hpp"
+#import "SFBCAException.hpp"
+#import "SFBUnfairLock.hpp"
+
+namespace {
+
+/// Returns @c true if @c address matches @c pattern, which may contain wildcards
+inline bool AddressMatches(const AudioObjectPropertyAddress& address, const AudioObjectPropertyAddress& pattern) noexcept
+{
+	return (pattern.mSelector == kAudioObjectPropertySelectorWildcard || pattern.mSelector == address.mSelector)
+		&& (pattern.mScope == kAudioObjectPropertyScopeWildcard || pattern.mScope == address.mScope)
+		&& (pattern.mElement == kAudioObjectPropertyElementWildcard || pattern.mElement == address.mElement);
+}
+
+/// Returns @c true if @c lhs and @c rhs are identical
+inline bool AddressesAreEqual(const AudioObjectPropertyAddress& lhs, const AudioObjectPropertyAddress& rhs) noexcept
+{
+	return lhs.mSelector == rhs.mSelector && lhs.mScope == rhs.mScope && lhs.mElement == rhs.mElement;
+}
+
+/// Fetches the value of a property from the HAL
+/// @throw @c std::system_error
+std::shared_ptr<const SFB::HALPropertyCache::PropertyValue> FetchValue(AudioObjectID objectID, const AudioObjectPropertyAddress& address, bool isCFType)
+{
+	if(isCFType) {
+		CFTypeRef object = nullptr;
+		UInt32 size = sizeof(object);
+		auto result = AudioObjectGetPropertyData(objectID, &address, 0, nullptr, &size, &object);
+		SFB::ThrowIfCAAudioObjectError(result, "AudioObjectGetPropertyData");
+		return std::make_shared<const SFB::HALPropertyCache::PropertyValue>(object);
+	}
+
+	UInt32 size = 0;
+	auto result = AudioObjectGetPropertyDataSize(objectID, &address, 0, nullptr, &size);
+	SFB::ThrowIfCAAudioObjectError(result, "AudioObjectGetPropertyDataSize");
+
+	std::vector<uint8_t> data(size);
+	result = AudioObjectGetPropertyData(objectID, &address, 0, nullptr, &size, data.data());
+	SFB::ThrowIfCAAudioObjectError(result, "AudioObjectGetPropertyData");
+	data.resize(size);
+
+	return std::make_shared<const SFB::HALPropertyCache::PropertyValue>(std::move(data));
+}
+
+}
+
+#pragma mark PropertyValue
+
+SFB::HALPropertyCache::PropertyValue::PropertyValue(std::vector<uint8_t>&& data) noexcept
+: mData(std::move(data)), mCFObject(nullptr), mIsCFType(false)
+{}
+
+SFB::HALPropertyCache::PropertyValue::PropertyValue(CFTypeRef object) noexcept
+: mCFObject(object), mIsCFType(true)
+{}
+
+SFB::HALPropertyCache::PropertyValue::~PropertyValue()
+{
+	if(mCFObject)
+		CFRelease(mCFObject);
+}
+
+#pragma mark State
+
+struct SFB::HALPropertyCache::State
+{
+	/// A cache key
+	struct Key
+	{
+		/// The audio object
+		AudioObjectID mObjectID;
+		/// The property address
+		AudioObjectPropertyAddress mAddress;
+
+		bool operator<(const Key& rhs) const noexcept
+		{
+			return std::tie(mObjectID, mAddress.mSelector, mAddress.mScope, mAddress.mElement) < std::tie(rhs.mObjectID, rhs.mAddress.mSelector, rhs.mAddress.mScope, rhs.mAddress.mElement);
+		}
+	};
+
+	/// An immutable set of cached values
+	using Snapshot = std::map<Key, std::shared_ptr<const PropertyValue>>;
+
+	/// A property listener added by the cache
+	struct Listener
+	{
+		/// The audio object
+		AudioObjectID mObjectID;
+		/// The property address
+		AudioObjectPropertyAddress mAddress;
+		/// The listener block
+		AudioObjectPropertyListenerBlock _Nonnull mBlock;
+	};
+
+	explicit State(dispatch_queue_t _Nullable queue)
+	: mQueue(queue), mSnapshot(new Snapshot), mReaders(0), mInvalidations(0)
+	{
+		if(mQueue)
+			dispatch_retain(mQueue);
+	}
+
+	~State()
+	{
+		delete mSnapshot.load();
+		for(auto snapshot : mRetiredSnapshots)
+			delete snapshot;
+		if(mQueue)
+			dispatch_release(mQueue);
+	}
+
+	/// Returns the cached value for @c key or @c nullptr
+	std::shared_ptr<const PropertyValue> Find(const Key& key) const noexcept
+	{
+		// The reader count prevents the snapshot from being deleted while it is in use
+		mReaders.fetch_add(1);
+		const auto snapshot = mSnapshot.load();
+		const auto iter = snapshot->find(key);
+		auto value = iter != snapshot->end() ? iter->second : nullptr;
+		mReaders.fetch_sub(1);
+		return value;
+	}
+
+	/// Replaces the snapshot with a copy modified by @c f
+	/// @note This must be called with @c mLock held
+	template <typename F>
+	void Modify(F&& f)
+	{
+		auto snapshot = new Snapshot(*mSnapshot.load(std::memory_order_relaxed));
+		f(*snapshot);
+
+		mRetiredSnapshots.push_back(mSnapshot.exchange(snapshot));
+
+		// Readers that start after the exchange see the new snapshot so retired snapshots may be deleted if no readers remain
+		if(mReaders.load() == 0) {
+			for(auto retiredSnapshot : mRetiredSnapshots)
+				delete retiredSnapshot;
+			mRetiredSnapshots.clear();
+		}
+	}
+
+	/// Removes cached values of @c objectID for which @c predicate returns @c true
+	template <typename P>
+	void Remove(AudioObjectID objectID, P&& predicate)
+	{
+		std::lock_guard<UnfairLock> lock(mLock);
+		mInvalidations.fetch_add(1, std::memory_order_release);
+		Modify([&](Snapshot& snapshot) {
+			for(auto iter = snapshot.begin(); iter != snapshot.end();) {
+				if(iter->first.mObjectID == objectID && predicate(iter->first.mAddress))
+					iter = snapshot.erase(iter);
+				else
+					++iter;
+			}
+		});
+	}
+
+	/// Returns @c true if a listener exists for the property
+	/// @note This must be called with @c mLock held
+	bool HasListener(AudioObjectID objectID, const AudioObjectPropertyAddress& address) const noexcept
+	{
+		return std::any_of(mListeners.cbegin(), mListeners.cend(), [&](const Listener& listener) {
+			return listener.mObjectID == objectID && AddressesAreEqual(listener.mAddress, address);
+		});
+	}
+
+	/// Adds a listener invalidating the cached value of a property when it changes
+	/// @return @c true if a listener exists for the property
+	static bool AddListener(const std::shared_ptr<State>& state, AudioObjectID objectID, const AudioObjectPropertyAddress& address)
+	{
+		{
+			std::lock_guard<UnfairLock> lock(state->mLock);
+			if(state->HasListener(objectID, address))
+				return true;
+		}
+
+		// The HAL is not called with the lock held because listeners acquire the lock
+		std::weak_ptr<State> weakState = state;
+		AudioObjectPropertyListenerBlock block = Block_copy(^(UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses) {
+			if(auto state = weakState.lock()) {
+				for(UInt32 i = 0; i < inNumberAddresses; ++i) {
+					const auto changedAddress = inAddresses[i];
+					state->Remove(objectID, [&](const AudioObjectPropertyAddress& cachedAddress) { return AddressMatches(cachedAddress, changedAddress); });
+				}
+			}
+		});
+
+		if(AudioObjectAddPropertyListenerBlock(objectID, &address, state->mQueue, block) != kAudioHardwareNoError) {
+			Block_release(block);
+			return false;
+		}
+
+		bool added = false;
+		{
+			std::lock_guard<UnfairLock> lock(state->mLock);
+			if(!state->HasListener(objectID, address)) {
+				state->mListeners.push_back({ objectID, address, block });
+				added = true;
+			}
+		}
+
+		// Another thread added a listener for the property first
+		if(!added) {
+			AudioObjectRemovePropertyListenerBlock(objectID, &address, state->mQueue, block);
+			Block_release(block);
+		}
+
+		return true;
+	}
+
+	/// The dispatch queue for listener blocks
+	dispatch_queue_t _Nullable mQueue;
+	/// The current snapshot
+	std::atomic<const Snapshot *> mSnapshot;
+	/// The number of threads reading the current snapshot
+	mutable std::atomic_uint32_t mReaders;
+	/// The number of invalidations
+	std::atomic_uint64_t mInvalidations;
+
+	/// The lock protecting modifications
+	UnfairLock mLock;
+	/// Snapshots replaced while they may have been in use
+	std::vector<const Snapshot *> mRetiredSnapshots;
+	/// The property listeners
+	std::vector<Listener> mListeners;
+};
+
+#pragma mark Creation and Destruction
+
+SFB::HALPropertyCache::HALPropertyCache(dispatch_queue_t queue)
+: mState(std::make_shared<State>(queue))
+{}
+
+SFB::HALPropertyCache::~HALPropertyCache()
+{
+	std::vector<State::Listener> listeners;
+	{
+		std::lock_guard<UnfairLock> lock(mState->mLock);
+		listeners.swap(mState->mListeners);
+	}
+
+	for(const auto& listener : listeners) {
+		AudioObjectRemovePropertyListenerBlock(listener.mObjectID, &listener.mAddress, mState->mQueue, listener.mBlock);
+		Block_release(listener.mBlock);
+	}
+}
+
+#pragma mark Property Values
+
+std::shared_ptr<const SFB::HALPropertyCache::PropertyValue> SFB::HALPropertyCache::Value(AudioObjectID objectID, const AudioObjectPropertyAddress& address, bool isCFType)
+{
+	const State::Key key{ objectID, address };
+	if(auto value = mState->Find(key); value && value->IsCFType() == isCFType)
+		return value;
+
+	// Without a listener the value could not be invalidated so it is not cached
+	if(!State::AddListener(mState, objectID, address))
+		return FetchValue(objectID, address, isCFType);
+
+	// The listener exists before the value is fetched, so a change while fetching increments the invalidation count
+	const auto invalidations = mState->mInvalidations.load(std::memory_order_acquire);
+	auto value = FetchValue(objectID, address, isCFType);
+
+	std::lock_guard<UnfairLock> lock(mState->mLock);
+	if(mState->mInvalidations.load(std::memory_order_relaxed) == invalidations)
+		mState->Modify([&](State::Snapshot& snapshot) {
+			snapshot[key] = value;
+		});
+
+	return value;
+}
+
+std::shared_ptr<const SFB::HALPropertyCache::PropertyValue> SFB::HALPropertyCache::CachedValue(AudioObjectID objectID, const AudioObjectPropertyAddress& address) const noexcept
+{
+	return mState->Find({ objectID, address });
+}
+
+#pragma mark Invalidation
+
+void SFB::HALPropertyCache::Invalidate(AudioObjectID objectID, const AudioObjectPropertyAddress& address)
+{
+	mState->Remove(objectID, [&](const AudioObjectPropertyAddress& cachedAddress) { return AddressMatches(cachedAddress, address); });
+}
+
+void SFB::HALPropertyCache::Invalidate(AudioObjectID objectID)
+{
+	mState->Remove(objectID, [](const AudioObjectPropertyAddress&) { return true; });
+}
+
+void SFB::HALPropertyCache::InvalidateAll()
+{
+	std::lock_guard<UnfairLock> lock(mState->mLock);
+	mState->mInvalidations.fetch_add(1, std::memory_order_release);
+	mState->Modify([](State::Snapshot& snapshot) {
+		snapshot.clear();
+	});
+}
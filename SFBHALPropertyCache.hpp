@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <memory>
+#import <vector>
+
+#import <CoreAudio/CoreAudio.h>
+
+namespace SFB {
+
+/// A cache of HAL audio object property values
+///
+/// A property's value is fetched from the HAL the first time it is requested and a property listener is added
+/// for the property. The cached value is returned for subsequent requests until the listener reports that the
+/// property has changed, so repeated queries of unchanged properties do not communicate with @c coreaudiod.
+///
+/// Cached values are immutable and are read without locking from a snapshot of the cache. Filling or invalidating
+/// an entry copies the snapshot under a lock.
+///
+/// Only properties requested without qualifier data are cached.
+///
+/// A @c HALAudioObject uses a @c HALPropertyCache when one is passed to its constructor:
+///
+/// @code
+/// SFB::HALPropertyCache cache;
+/// SFB::HALAudioSystemObject systemObject(&cache);
+/// for(const auto& device : systemObject.Devices())
+///     auto name = device.Name(); // Cached after the first call
+/// @endcode
+///
+/// This class is thread safe.
+class HALPropertyCache
+{
+
+public:
+
+	/// An immutable cached property value
+	class PropertyValue
+	{
+
+	public:
+
+		/// Creates a value holding @c data
+		explicit PropertyValue(std::vector<uint8_t>&& data) noexcept;
+
+		/// Creates a value holding @c object and takes ownership of it
+		explicit PropertyValue(CFTypeRef _Nullable object) noexcept;
+
+		// This class is non-copyable
+		PropertyValue(const PropertyValue& rhs) = delete;
+
+		// This class is non-assignable
+		PropertyValue& operator=(const PropertyValue& rhs) = delete;
+
+		/// Destroys the value and releases its Core Foundation object if present
+		~PropertyValue();
+
+		/// Returns @c true if the value holds a Core Foundation object
+		inline bool IsCFType() const noexcept
+		{
+			return mIsCFType;
+		}
+
+		/// Returns the property data
+		inline const void * _Nullable Data() const noexcept
+		{
+			return mData.data();
+		}
+
+		/// Returns the size of the property data in bytes
+		inline UInt32 Size() const noexcept
+		{
+			return static_cast<UInt32>(mData.size());
+		}
+
+		/// Returns the Core Foundation object
+		inline CFTypeRef _Nullable CFObject() const noexcept
+		{
+			return mCFObject;
+		}
+
+	private:
+
+		/// The property data
+		const std::vector<uint8_t> mData;
+		/// The Core Foundation object
+		const CFTypeRef _Nullable mCFObject;
+		/// @c true if the value holds a Core Foundation object
+		const bool mIsCFType;
+
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c HALPropertyCache
+	/// @param queue The dispatch queue on which property listeners are invoked or @c nullptr to invoke them on a HAL thread
+	explicit HALPropertyCache(dispatch_queue_t _Nullable queue = nullptr);
+
+	// This class is non-copyable
+	HALPropertyCache(const HALPropertyCache& rhs) = delete;
+
+	// This class is non-assignable
+	HALPropertyCache& operator=(const HALPropertyCache& rhs) = delete;
+
+	/// Destroys the @c HALPropertyCache and removes its property listeners
+	~HALPropertyCache();
+
+	// This class is non-movable
+	HALPropertyCache(HALPropertyCache&& rhs) = delete;
+
+	// This class is non-move assignable
+	HALPropertyCache& operator=(HALPropertyCache&& rhs) = delete;
+
+#pragma mark Property values
+
+	/// Returns the value of a property, fetching it from the HAL if it is not cached
+	/// @param objectID The audio object
+	/// @param address The property address
+	/// @param isCFType @c true if the property's value is a Core Foundation object
+	/// @return The property value
+	/// @throw @c std::system_error
+	std::shared_ptr<const PropertyValue> Value(AudioObjectID objectID, const AudioObjectPropertyAddress& address, bool isCFType);
+
+	/// Returns the cached value of a property or @c nullptr if the property is not cached
+	/// @note This method does not communicate with the HAL
+	std::shared_ptr<const PropertyValue> CachedValue(AudioObjectID objectID, const AudioObjectPropertyAddress& address) const noexcept;
+
+#pragma mark Invalidation
+
+	/// Removes the cached values of properties of @c objectID matching @c address, which may contain wildcards
+	void Invalidate(AudioObjectID objectID, const AudioObjectPropertyAddress& address);
+
+	/// Removes the cached values of all properties of @c objectID
+	void Invalidate(AudioObjectID objectID);
+
+	/// Removes all cached values
+	void InvalidateAll();
+
+private:
+
+	/// The shared state of the cache and its property listeners
+	struct State;
+
+	/// The shared state
+	/// @note Property listeners hold weak references to the state so they may safely outlive the cache
+	std::shared_ptr<State> mState;
+
+};
+
+} // namespace SFB
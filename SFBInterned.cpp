@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <cstdint>
+#import <cstring>
+#import <memory>
+#import <mutex>
+#import <type_traits>
+#import <unordered_map>
+
+#import "SFBInterned.hpp"
+#import "SFBUnfairLock.hpp"
+
+namespace {
+
+/// The shared instances of one value type keyed by hash
+template <typename Entry>
+struct InternTable
+{
+	/// The lock protecting @c mEntries
+	SFB::UnfairLock mLock;
+	/// The shared instances
+	std::unordered_multimap<size_t, Entry *> mEntries;
+};
+
+/// Returns the table for @c Entry
+/// @note The table is never destroyed so objects with static storage duration may be released during program termination
+template <typename Entry>
+InternTable<Entry>& Table() noexcept
+{
+	static auto table = new InternTable<Entry>;
+	return *table;
+}
+
+/// Returns the 64-bit FNV-1a hash of @c len bytes in @c buf
+size_t HashBytes(const void * _Nullable buf, size_t len) noexcept
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	const auto bytes = static_cast<const uint8_t *>(buf);
+	for(size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
+	}
+	return static_cast<size_t>(hash);
+}
+
+size_t HashValue(const SFB::CAChannelLayout& value) noexcept
+{
+	return HashBytes(value.ACL(), value.Size());
+}
+
+bool IsIdentical(const SFB::CAChannelLayout& lhs, const SFB::CAChannelLayout& rhs) noexcept
+{
+	return lhs.Size() == rhs.Size() && !std::memcmp(lhs.ACL(), rhs.ACL(), lhs.Size());
+}
+
+size_t HashValue(const SFB::CAStreamBasicDescription& value) noexcept
+{
+	return HashBytes(&value, sizeof(AudioStreamBasicDescription));
+}
+
+bool IsIdentical(const SFB::CAStreamBasicDescription& lhs, const SFB::CAStreamBasicDescription& rhs) noexcept
+{
+	return lhs == rhs;
+}
+
+} // namespace
+
+template <typename T>
+SFB::Interned<T>::Interned(const T& value)
+: mEntry(nullptr)
+{
+	if constexpr(std::is_same<T, CAChannelLayout>::value) {
+		if(!value)
+			return;
+	}
+
+	const auto hash = HashValue(value);
+
+	auto& table = Table<Entry>();
+	std::lock_guard<SFB::UnfairLock> lock(table.mLock);
+
+	auto range = table.mEntries.equal_range(hash);
+	for(auto iter = range.first; iter != range.second; ++iter) {
+		if(IsIdentical(iter->second->mValue, value)) {
+			mEntry = iter->second;
+			mEntry->mRefCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	auto entry = std::unique_ptr<Entry>(new Entry{1, hash, value});
+	table.mEntries.emplace(hash, entry.get());
+	mEntry = entry.release();
+}
+
+template <typename T>
+size_t SFB::Interned<T>::InternedCount() noexcept
+{
+	auto& table = Table<Entry>();
+	std::lock_guard<SFB::UnfairLock> lock(table.mLock);
+	return table.mEntries.size();
+}
+
+template <typename T>
+void SFB::Interned<T>::Release(Entry *entry) noexcept
+{
+	if(!entry)
+		return;
+
+	// Drop references other than the last without locking the table
+	auto refCount = entry->mRefCount.load(std::memory_order_relaxed);
+	while(refCount > 1) {
+		if(entry->mRefCount.compare_exchange_weak(refCount, refCount - 1, std::memory_order_release, std::memory_order_relaxed))
+			return;
+	}
+
+	// The last reference is dropped with the table locked so a concurrent lookup can't revive a dying entry
+	auto& table = Table<Entry>();
+	std::lock_guard<SFB::UnfairLock> lock(table.mLock);
+
+	if(entry->mRefCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	auto range = table.mEntries.equal_range(entry->mHash);
+	for(auto iter = range.first; iter != range.second; ++iter) {
+		if(iter->second == entry) {
+			table.mEntries.erase(iter);
+			break;
+		}
+	}
+
+	delete entry;
+}
+
+template class SFB::Interned<SFB::CAChannelLayout>;
+template class SFB::Interned<SFB::CAStreamBasicDescription>;
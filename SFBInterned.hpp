@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+#import <cstddef>
+#import <functional>
+
+#import "SFBCAChannelLayout.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+
+/// An immutable, reference-counted value shared by all equal values
+///
+/// Each distinct value is stored once in a process-wide table. Copying an @c Interned object copies a pointer and
+/// two @c Interned objects are equal if and only if they refer to the same instance, so comparison and hashing
+/// are constant-cost and @c Interned objects are suitable as keys in associative containers. A value is removed
+/// from the table when the last @c Interned object referring to it is destroyed.
+///
+/// Values are interned by exact representation. Two channel layouts that are equivalent but represented
+/// differently, such as a layout tag and the equivalent channel descriptions, are interned separately.
+/// @note Creating an @c Interned object from a value locks the table; copying and destroying one usually does not
+/// @tparam T The value type, either @c CAChannelLayout or @c CAStreamBasicDescription
+template <typename T>
+class Interned
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates an empty @c Interned object
+	inline Interned() noexcept
+	: mEntry(nullptr)
+	{}
+
+	/// Creates an @c Interned object referring to the shared instance equal to @c value
+	/// @note An empty @c CAChannelLayout creates an empty @c Interned object
+	/// @param value The value to intern
+	/// @throw @c std::bad_alloc
+	explicit Interned(const T& value);
+
+	/// Copy constructor
+	inline Interned(const Interned& rhs) noexcept
+	: mEntry(rhs.mEntry)
+	{
+		if(mEntry)
+			mEntry->mRefCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// Assignment operator
+	Interned& operator=(const Interned& rhs) noexcept
+	{
+		if(mEntry != rhs.mEntry) {
+			if(rhs.mEntry)
+				rhs.mEntry->mRefCount.fetch_add(1, std::memory_order_relaxed);
+			Release(mEntry);
+			mEntry = rhs.mEntry;
+		}
+		return *this;
+	}
+
+	/// Destroys the @c Interned object and releases its reference to the shared instance
+	inline ~Interned()
+	{
+		Release(mEntry);
+	}
+
+	/// Move constructor
+	inline Interned(Interned&& rhs) noexcept
+	: mEntry(rhs.mEntry)
+	{
+		rhs.mEntry = nullptr;
+	}
+
+	/// Move assignment operator
+	Interned& operator=(Interned&& rhs) noexcept
+	{
+		if(this != &rhs) {
+			Release(mEntry);
+			mEntry = rhs.mEntry;
+			rhs.mEntry = nullptr;
+		}
+		return *this;
+	}
+
+#pragma mark Comparison
+
+	/// Returns @c true if @c rhs refers to the same instance as @c this
+	inline bool operator==(const Interned& rhs) const noexcept
+	{
+		return mEntry == rhs.mEntry;
+	}
+
+	/// Returns @c true if @c rhs does not refer to the same instance as @c this
+	inline bool operator!=(const Interned& rhs) const noexcept
+	{
+		return mEntry != rhs.mEntry;
+	}
+
+	/// Returns a hash of the value or @c 0 if empty
+	inline size_t Hash() const noexcept
+	{
+		return mEntry ? mEntry->mHash : 0;
+	}
+
+#pragma mark Value access
+
+	/// Returns @c true if this object refers to a value
+	inline explicit operator bool() const noexcept
+	{
+		return mEntry != nullptr;
+	}
+
+	/// Returns @c true if this object is empty
+	inline bool operator!() const noexcept
+	{
+		return !operator bool();
+	}
+
+	/// Returns a pointer to the shared value or @c nullptr if empty
+	inline const T * _Nullable Get() const noexcept
+	{
+		return mEntry ? &mEntry->mValue : nullptr;
+	}
+
+	/// Returns the shared value
+	/// @note The behavior is undefined if this object is empty
+	inline const T& operator*() const noexcept
+	{
+		return mEntry->mValue;
+	}
+
+	/// Returns a pointer to the shared value
+	/// @note The behavior is undefined if this object is empty
+	inline const T * _Nonnull operator->() const noexcept
+	{
+		return &mEntry->mValue;
+	}
+
+	/// Returns the number of distinct values currently interned
+	static size_t InternedCount() noexcept;
+
+private:
+
+	/// A shared instance
+	struct Entry
+	{
+		/// The number of @c Interned objects referring to this instance
+		std::atomic_size_t mRefCount;
+		/// The hash of @c mValue
+		size_t mHash;
+		/// The value
+		const T mValue;
+	};
+
+	/// Releases a reference to @c entry and destroys it if it was the last reference
+	static void Release(Entry * _Nullable entry) noexcept;
+
+	/// The shared instance or @c nullptr if empty
+	Entry * _Nullable mEntry;
+
+};
+
+/// An interned @c CAChannelLayout
+using InternedChannelLayout = Interned<CAChannelLayout>;
+
+/// An interned @c CAStreamBasicDescription
+using InternedStreamBasicDescription = Interned<CAStreamBasicDescription>;
+
+extern template class Interned<CAChannelLayout>;
+extern template class Interned<CAStreamBasicDescription>;
+
+} // namespace SFB
+
+/// Hashes an @c SFB::Interned object for use in unordered associative containers
+template <typename T>
+struct std::hash<SFB::Interned<T>>
+{
+	size_t operator()(const SFB::Interned<T>& value) const noexcept
+	{
+		return value.Hash();
+	}
+};
@@ -0,0 +1,236 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cstddef>
+#import <cstdlib>
+#import <cstring>
+#import <limits>
+#import <new>
+
+#import "SFBMPMCRingBuffer.hpp"
+
+namespace {
+
+/// Returns the smallest power of two value greater than @c x
+/// @param x A value in the range [2..2147483648]
+/// @return The smallest power of two greater than @c x
+inline constexpr uint32_t NextPowerOfTwo(uint32_t x) noexcept
+{
+	assert(x > 1);
+	assert(x <= ((std::numeric_limits<uint32_t>::max() / 2) + 1));
+	return static_cast<uint32_t>(1 << (32 - __builtin_clz(x - 1)));
+}
+
+/// Returns the signed distance from @c position to @c sequence
+inline constexpr int64_t SequenceDistance(uint64_t sequence, uint64_t position) noexcept
+{
+	return static_cast<int64_t>(sequence - position);
+}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::MPMCRingBuffer::MPMCRingBuffer() noexcept
+: mSlots(nullptr), mElementSize(0), mSlotStride(0), mCapacity(0), mCapacityMask(0), mWritePosition(0), mReadPosition(0)
+{
+	assert(mWritePosition.is_lock_free());
+}
+
+SFB::MPMCRingBuffer::~MPMCRingBuffer()
+{
+	Deallocate();
+}
+
+#pragma mark Buffer Management
+
+bool SFB::MPMCRingBuffer::Allocate(uint32_t elementSize, uint32_t capacity) noexcept
+{
+	if(elementSize == 0 || capacity < 2 || capacity > 0x80000000)
+		return false;
+
+	Deallocate();
+
+	// Round up to the next power of two
+	capacity = NextPowerOfTwo(capacity);
+
+	// Keep each slot header suitably aligned
+	constexpr size_t alignment = alignof(std::max_align_t);
+	const size_t slotStride = ((sizeof(SlotHeader) + elementSize + alignment - 1) / alignment) * alignment;
+	if(slotStride > std::numeric_limits<uint32_t>::max() || slotStride > std::numeric_limits<size_t>::max() / capacity)
+		return false;
+
+	mSlots = static_cast<uint8_t *>(std::malloc(slotStride * capacity));
+	if(!mSlots)
+		return false;
+
+	mElementSize = elementSize;
+	mSlotStride = static_cast<uint32_t>(slotStride);
+	mCapacity = capacity;
+	mCapacityMask = capacity - 1;
+
+	for(uint32_t i = 0; i < mCapacity; ++i)
+		new (mSlots + (i * mSlotStride)) SlotHeader{};
+
+	Reset();
+
+	return true;
+}
+
+void SFB::MPMCRingBuffer::Deallocate() noexcept
+{
+	if(mSlots) {
+		std::free(mSlots);
+		mSlots = nullptr;
+
+		mElementSize = 0;
+		mSlotStride = 0;
+		mCapacity = 0;
+		mCapacityMask = 0;
+
+		mWritePosition = 0;
+		mReadPosition = 0;
+	}
+}
+
+void SFB::MPMCRingBuffer::Reset() noexcept
+{
+	for(uint32_t i = 0; i < mCapacity; ++i)
+		Slot(i)->mSequence.store(i, std::memory_order_relaxed);
+
+	mWritePosition.store(0, std::memory_order_relaxed);
+	mReadPosition.store(0, std::memory_order_release);
+}
+
+uint32_t SFB::MPMCRingBuffer::ApproximateElementsAvailableToRead() const noexcept
+{
+	const auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	const auto writePosition = mWritePosition.load(std::memory_order_acquire);
+
+	if(writePosition <= readPosition)
+		return 0;
+	return static_cast<uint32_t>(std::min(writePosition - readPosition, static_cast<uint64_t>(mCapacity)));
+}
+
+#pragma mark Reading and writing elements
+
+bool SFB::MPMCRingBuffer::TryWrite(const void * const sourceBuffer) noexcept
+{
+	SlotRange range;
+	if(!sourceBuffer || ClaimWrite(1, range) == 0)
+		return false;
+
+	std::memcpy(WriteSlot(range, 0), sourceBuffer, mElementSize);
+	CommitWrite(range);
+
+	return true;
+}
+
+bool SFB::MPMCRingBuffer::TryRead(void * const destinationBuffer) noexcept
+{
+	SlotRange range;
+	if(!destinationBuffer || ClaimRead(1, range) == 0)
+		return false;
+
+	std::memcpy(destinationBuffer, ReadSlot(range, 0), mElementSize);
+	CommitRead(range);
+
+	return true;
+}
+
+#pragma mark Claiming and committing slots
+
+uint32_t SFB::MPMCRingBuffer::ClaimWrite(uint32_t count, SlotRange& range) noexcept
+{
+	if(count == 0 || mCapacity == 0)
+		return 0;
+
+	count = std::min(count, mCapacity);
+
+	auto position = mWritePosition.load(std::memory_order_relaxed);
+	for(;;) {
+		const auto distance = SequenceDistance(Slot(position)->mSequence.load(std::memory_order_acquire), position);
+		// The slot still holds an element from the previous lap
+		if(distance < 0)
+			return 0;
+		// Another writer claimed the slot
+		else if(distance > 0) {
+			position = mWritePosition.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		// A slot is free for this lap only if its sequence matches its position exactly.
+		// Free slots can't be taken without first advancing the write position, so the
+		// compare-exchange below validates all the slots examined here.
+		uint32_t claimed = 1;
+		while(claimed < count && Slot(position + claimed)->mSequence.load(std::memory_order_acquire) == position + claimed)
+			++claimed;
+
+		if(mWritePosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed, std::memory_order_relaxed)) {
+			range = SlotRange(position, claimed);
+			return claimed;
+		}
+	}
+}
+
+uint8_t * SFB::MPMCRingBuffer::WriteSlot(const SlotRange& range, uint32_t index) noexcept
+{
+	assert(index < range.mCount);
+	return SlotData(range.mPosition + index);
+}
+
+void SFB::MPMCRingBuffer::CommitWrite(const SlotRange& range) noexcept
+{
+	for(uint32_t i = 0; i < range.mCount; ++i) {
+		const auto position = range.mPosition + i;
+		Slot(position)->mSequence.store(position + 1, std::memory_order_release);
+	}
+}
+
+uint32_t SFB::MPMCRingBuffer::ClaimRead(uint32_t count, SlotRange& range) noexcept
+{
+	if(count == 0 || mCapacity == 0)
+		return 0;
+
+	count = std::min(count, mCapacity);
+
+	auto position = mReadPosition.load(std::memory_order_relaxed);
+	for(;;) {
+		const auto distance = SequenceDistance(Slot(position)->mSequence.load(std::memory_order_acquire), position + 1);
+		// The slot hasn't been committed by a writer
+		if(distance < 0)
+			return 0;
+		// Another reader claimed the slot
+		else if(distance > 0) {
+			position = mReadPosition.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		uint32_t claimed = 1;
+		while(claimed < count && Slot(position + claimed)->mSequence.load(std::memory_order_acquire) == position + claimed + 1)
+			++claimed;
+
+		if(mReadPosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed, std::memory_order_relaxed)) {
+			range = SlotRange(position, claimed);
+			return claimed;
+		}
+	}
+}
+
+const uint8_t * SFB::MPMCRingBuffer::ReadSlot(const SlotRange& range, uint32_t index) const noexcept
+{
+	assert(index < range.mCount);
+	return SlotData(range.mPosition + index);
+}
+
+void SFB::MPMCRingBuffer::CommitRead(const SlotRange& range) noexcept
+{
+	for(uint32_t i = 0; i < range.mCount; ++i) {
+		const auto position = range.mPosition + i;
+		Slot(position)->mSequence.store(position + mCapacity, std::memory_order_release);
+	}
+}
@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+
+namespace SFB {
+
+/// A bounded ring buffer of fixed-size elements supporting multiple producers and multiple consumers.
+///
+/// Each element is stored in a slot with a sequence number used to coordinate access without locks, based on
+/// Dmitry Vyukov's bounded MPMC queue. All reading and writing methods are non-blocking and lock-free.
+///
+/// Several consecutive slots may be claimed at once using @c ClaimWrite() or @c ClaimRead(). The claimed slots
+/// are accessed in place using @c WriteSlot() or @c ReadSlot() and released with @c CommitWrite() or @c CommitRead().
+/// Slots following an uncommitted claim do not become visible to the other side until the claim is committed.
+///
+/// This class is thread safe when used from any number of reader and writer threads.
+class MPMCRingBuffer
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c MPMCRingBuffer
+	/// @note @c Allocate() must be called before the object may be used.
+	MPMCRingBuffer() noexcept;
+
+	// This class is non-copyable
+	MPMCRingBuffer(const MPMCRingBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	MPMCRingBuffer& operator=(const MPMCRingBuffer& rhs) = delete;
+
+	/// Destroys the @c MPMCRingBuffer and release all associated resources.
+	~MPMCRingBuffer();
+
+	// This class is non-movable
+	MPMCRingBuffer(MPMCRingBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	MPMCRingBuffer& operator=(MPMCRingBuffer&& rhs) = delete;
+
+#pragma mark Buffer management
+
+	/// Allocates space for elements.
+	/// @note This method is not thread safe.
+	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) elements are supported
+	/// @param elementSize The size of a single element, in bytes
+	/// @param capacity The desired capacity, in elements
+	/// @return @c true on success, @c false on error
+	bool Allocate(uint32_t elementSize, uint32_t capacity) noexcept;
+
+	/// Frees the resources used by this @c MPMCRingBuffer
+	/// @note This method is not thread safe.
+	void Deallocate() noexcept;
+
+
+	/// Resets this @c MPMCRingBuffer to its default state.
+	/// @note This method is not thread safe.
+	void Reset() noexcept;
+
+
+	/// Returns the capacity of this @c MPMCRingBuffer in elements
+	inline uint32_t Capacity() const noexcept
+	{
+		return mCapacity;
+	}
+
+	/// Returns the size of an element in bytes
+	inline uint32_t ElementSize() const noexcept
+	{
+		return mElementSize;
+	}
+
+	/// Returns the approximate number of elements available for reading
+	/// @note The returned value may be out of date by the time it is used
+	uint32_t ApproximateElementsAvailableToRead() const noexcept;
+
+#pragma mark Reading and writing elements
+
+	/// Writes a single element to the @c MPMCRingBuffer
+	/// @param sourceBuffer An address containing @c ElementSize() bytes to copy
+	/// @return @c true if the element was written, @c false if the buffer is full
+	bool TryWrite(const void * const _Nonnull sourceBuffer) noexcept;
+
+	/// Reads a single element from the @c MPMCRingBuffer
+	/// @param destinationBuffer An address to receive @c ElementSize() bytes
+	/// @return @c true if an element was read, @c false if the buffer is empty
+	bool TryRead(void * const _Nonnull destinationBuffer) noexcept;
+
+#pragma mark Claiming and committing slots
+
+	/// A range of consecutive claimed slots
+	struct SlotRange {
+		/// The position of the first slot
+		uint64_t mPosition;
+		/// The number of slots in the range
+		uint32_t mCount;
+
+		/// Construct an empty @c SlotRange
+		SlotRange() noexcept
+		: SlotRange(0, 0)
+		{}
+
+		/// Construct a @c SlotRange for the specified position and count
+		/// @param position The position of the first slot
+		/// @param count The number of slots in the range
+		SlotRange(uint64_t position, uint32_t count) noexcept
+		: mPosition(position), mCount(count)
+		{}
+	};
+
+	/// Claims at most @c count consecutive slots for writing
+	/// @note The claimed slots must be committed using @c CommitWrite()
+	/// @param count The desired number of slots
+	/// @param range A @c SlotRange to receive the claimed slots
+	/// @return The number of slots actually claimed
+	uint32_t ClaimWrite(uint32_t count, SlotRange& range) noexcept;
+
+	/// Returns the storage for slot @c index of a write claim
+	/// @param range A range returned by @c ClaimWrite()
+	/// @param index The index of the slot in @c range
+	/// @return An address that may receive @c ElementSize() bytes
+	uint8_t * _Nonnull WriteSlot(const SlotRange& range, uint32_t index) noexcept;
+
+	/// Publishes the slots in a write claim to readers
+	/// @param range A range returned by @c ClaimWrite()
+	void CommitWrite(const SlotRange& range) noexcept;
+
+	/// Claims at most @c count consecutive slots for reading
+	/// @note The claimed slots must be committed using @c CommitRead()
+	/// @param count The desired number of slots
+	/// @param range A @c SlotRange to receive the claimed slots
+	/// @return The number of slots actually claimed
+	uint32_t ClaimRead(uint32_t count, SlotRange& range) noexcept;
+
+	/// Returns the storage for slot @c index of a read claim
+	/// @param range A range returned by @c ClaimRead()
+	/// @param index The index of the slot in @c range
+	/// @return An address containing @c ElementSize() bytes
+	const uint8_t * _Nonnull ReadSlot(const SlotRange& range, uint32_t index) const noexcept;
+
+	/// Returns the slots in a read claim to writers
+	/// @param range A range returned by @c ClaimRead()
+	void CommitRead(const SlotRange& range) noexcept;
+
+private:
+
+	/// The assumed size of a cache line, in bytes
+	/// @note 128 bytes matches the cache line size of Apple silicon and covers adjacent-line prefetching on x86-64
+	static constexpr size_t sCacheLineSize = 128;
+
+	/// The header preceding the data in each slot
+	struct SlotHeader {
+		/// The position at which the slot may next be written (if equal to the write position) or read (if one greater than the read position)
+		std::atomic_uint64_t mSequence;
+	};
+
+	/// Returns the header of the slot for @c position
+	inline SlotHeader * _Nonnull Slot(uint64_t position) const noexcept
+	{
+		return reinterpret_cast<SlotHeader *>(mSlots + ((position & mCapacityMask) * mSlotStride));
+	}
+
+	/// Returns the data of the slot for @c position
+	inline uint8_t * _Nonnull SlotData(uint64_t position) const noexcept
+	{
+		return mSlots + ((position & mCapacityMask) * mSlotStride) + sizeof(SlotHeader);
+	}
+
+	/// The memory holding the slots
+	uint8_t * _Nullable mSlots;
+
+	/// The size of an element in bytes
+	uint32_t mElementSize;
+	/// The distance between consecutive slots in bytes
+	uint32_t mSlotStride;
+
+	/// The capacity in elements
+	uint32_t mCapacity;
+	/// The capacity in elements minus one
+	uint32_t mCapacityMask;
+
+	/// The position of the next slot to be claimed for writing
+	alignas(sCacheLineSize) std::atomic_uint64_t mWritePosition;
+	/// The position of the next slot to be claimed for reading
+	alignas(sCacheLineSize) std::atomic_uint64_t mReadPosition;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cerrno>
+#import <cstddef>
+#import <cstdlib>
+#import <stdexcept>
+#import <system_error>
+
+#import <fcntl.h>
+#import <sys/mman.h>
+#import <sys/param.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+#import "SFBMappedAudioFile.hpp"
+#import "SFBCAAudioFile.hpp"
+#import "SFBDeferredClosure.hpp"
+#import "SFBMirroredMemory.hpp"
+
+namespace {
+
+/// Returns the @c madvise advice corresponding to @c access
+int AdviceForAccess(SFB::MappedAudioFile::Access access) noexcept
+{
+	switch(access) {
+		case SFB::MappedAudioFile::Access::normal:		return MADV_NORMAL;
+		case SFB::MappedAudioFile::Access::random:		return MADV_RANDOM;
+		case SFB::MappedAudioFile::Access::sequential:	return MADV_SEQUENTIAL;
+		case SFB::MappedAudioFile::Access::willNeed:	return MADV_WILLNEED;
+		case SFB::MappedAudioFile::Access::dontNeed:	return MADV_DONTNEED;
+	}
+	return MADV_NORMAL;
+}
+
+} // namespace
+
+#pragma mark Creation and Destruction
+
+SFB::MappedAudioFile::MappedAudioFile() noexcept
+: mMapping(nullptr), mMappingSize(0), mAudioData(nullptr), mFrameLength(0)
+{}
+
+SFB::MappedAudioFile::MappedAudioFile(CFURLRef url, AudioFileTypeID fileTypeHint)
+: MappedAudioFile()
+{
+	OpenURL(url, fileTypeHint);
+}
+
+SFB::MappedAudioFile::~MappedAudioFile()
+{
+	Close();
+}
+
+SFB::MappedAudioFile::MappedAudioFile(MappedAudioFile&& rhs) noexcept
+: mMapping(rhs.mMapping), mMappingSize(rhs.mMappingSize), mAudioData(rhs.mAudioData), mFormat(rhs.mFormat), mFrameLength(rhs.mFrameLength)
+{
+	rhs.mMapping = nullptr;
+	rhs.mMappingSize = 0;
+	rhs.mAudioData = nullptr;
+	rhs.mFormat.Reset();
+	rhs.mFrameLength = 0;
+}
+
+SFB::MappedAudioFile& SFB::MappedAudioFile::operator=(MappedAudioFile&& rhs) noexcept
+{
+	if(this != &rhs) {
+		Close();
+
+		mMapping = rhs.mMapping;
+		mMappingSize = rhs.mMappingSize;
+		mAudioData = rhs.mAudioData;
+		mFormat = rhs.mFormat;
+		mFrameLength = rhs.mFrameLength;
+
+		rhs.mMapping = nullptr;
+		rhs.mMappingSize = 0;
+		rhs.mAudioData = nullptr;
+		rhs.mFormat.Reset();
+		rhs.mFrameLength = 0;
+	}
+	return *this;
+}
+
+#pragma mark Opening and Closing
+
+void SFB::MappedAudioFile::OpenURL(CFURLRef url, AudioFileTypeID fileTypeHint)
+{
+	Close();
+
+	// Use AudioFile to parse the container
+	CAAudioFile audioFile;
+	audioFile.OpenURL(url, kAudioFileReadPermission, fileTypeHint);
+
+	const auto format = audioFile.FileDataFormat();
+	if(!format.IsPCM() || format.mFramesPerPacket != 1 || format.mBytesPerFrame == 0 || !format.IsInterleaved())
+		throw std::invalid_argument("Unsupported audio data format");
+
+	const auto dataOffset = audioFile.DataOffset();
+	auto dataByteCount = audioFile.AudioDataByteCount();
+
+	audioFile.Close();
+
+	char path [PATH_MAX];
+	if(!CFURLGetFileSystemRepresentation(url, true, reinterpret_cast<UInt8 *>(path), PATH_MAX))
+		throw std::invalid_argument("url is not a file URL");
+
+	auto fd = open(path, O_RDONLY);
+	if(fd == -1)
+		throw std::system_error(errno, std::generic_category(), "open");
+	// The mapping remains valid after the descriptor is closed
+	auto lambda = [fd]() {
+		close(fd);
+	};
+	SFB::DeferredClosure<decltype(lambda)> cleanup(lambda);
+
+	struct stat s;
+	if(fstat(fd, &s) == -1)
+		throw std::system_error(errno, std::generic_category(), "fstat");
+
+	// Guard against truncated files and containers reporting an unknown data size
+	if(dataOffset < 0 || dataOffset > s.st_size)
+		throw std::invalid_argument("Invalid audio data offset");
+	dataByteCount = std::min(dataByteCount, static_cast<UInt64>(s.st_size - dataOffset));
+
+	const auto frameLength = static_cast<int64_t>(dataByteCount / format.mBytesPerFrame);
+	if(frameLength == 0) {
+		mFormat = format;
+		return;
+	}
+
+	// mmap offsets must be page-aligned
+	const auto pageSize = static_cast<SInt64>(VirtualMemoryPageSize());
+	const auto mappingOffset = dataOffset - (dataOffset % pageSize);
+	const auto mappingSize = static_cast<size_t>(dataOffset - mappingOffset) + static_cast<size_t>(frameLength * format.mBytesPerFrame);
+
+	auto mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FILE, fd, mappingOffset);
+	if(mapping == MAP_FAILED)
+		throw std::system_error(errno, std::generic_category(), "mmap");
+
+	mMapping = mapping;
+	mMappingSize = mappingSize;
+	mAudioData = static_cast<const uint8_t *>(mapping) + (dataOffset - mappingOffset);
+	mFormat = format;
+	mFrameLength = frameLength;
+}
+
+void SFB::MappedAudioFile::Close() noexcept
+{
+	if(mMapping)
+		munmap(mMapping, mMappingSize);
+
+	mMapping = nullptr;
+	mMappingSize = 0;
+	mAudioData = nullptr;
+	mFormat.Reset();
+	mFrameLength = 0;
+}
+
+#pragma mark Frame Access
+
+const void * SFB::MappedAudioFile::FrameData(int64_t frame) const noexcept
+{
+	if(!mAudioData || frame < 0 || frame >= mFrameLength)
+		return nullptr;
+	return mAudioData + (frame * mFormat.mBytesPerFrame);
+}
+
+bool SFB::MappedAudioFile::MapFrames(CABufferList& view, int64_t frame, UInt32 frameCount) const noexcept
+{
+	auto data = FrameData(frame);
+	if(!data)
+		return false;
+
+	const auto viewFrames = static_cast<UInt32>(std::min<int64_t>(frameCount, FramesAvailable(frame)));
+
+	// Only the AudioBufferList header is allocated; the adopting CABufferList frees it but not the mapped audio data
+	auto bufferList = static_cast<AudioBufferList *>(std::malloc(offsetof(AudioBufferList, mBuffers) + sizeof(AudioBuffer)));
+	if(!bufferList)
+		return false;
+
+	bufferList->mNumberBuffers = 1;
+	bufferList->mBuffers[0].mNumberChannels = mFormat.mChannelsPerFrame;
+	bufferList->mBuffers[0].mData = const_cast<void *>(data);
+	bufferList->mBuffers[0].mDataByteSize = viewFrames * mFormat.mBytesPerFrame;
+
+	if(!view.AdoptABL(bufferList, mFormat, viewFrames, viewFrames)) {
+		std::free(bufferList);
+		return false;
+	}
+
+	return true;
+}
+
+bool SFB::MappedAudioFile::Advise(int64_t frame, int64_t frameCount, Access access) const noexcept
+{
+	if(!mAudioData || frame < 0 || frame >= mFrameLength || frameCount <= 0)
+		return false;
+
+	frameCount = std::min(frameCount, mFrameLength - frame);
+
+	// madvise addresses must be page-aligned
+	const auto pageSize = static_cast<uintptr_t>(VirtualMemoryPageSize());
+	const auto start = reinterpret_cast<uintptr_t>(mAudioData + (frame * mFormat.mBytesPerFrame));
+	const auto end = start + static_cast<uintptr_t>(frameCount * mFormat.mBytesPerFrame);
+	const auto alignedStart = start - (start % pageSize);
+
+	return madvise(reinterpret_cast<void *>(alignedStart), end - alignedStart, AdviceForAccess(access)) == 0;
+}
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <AudioToolbox/AudioFile.h>
+
+#import "SFBCABufferList.hpp"
+#import "SFBCAStreamBasicDescription.hpp"
+
+CF_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+/// A read-only, memory-mapped view of the audio data in an uncompressed audio file
+///
+/// The file is opened with @c AudioFile to locate the audio data and determine its format, and then the audio data is
+/// mapped into memory. Frames are accessed in place without copying through the @c AudioFile cache or making a
+/// system call per read.
+///
+/// Only linear PCM with one frame per packet is supported, such as WAVE, AIFF, and CAF files. Frames are in the
+/// file's data format, which may be big-endian.
+///
+/// The mapping is private: writes to mapped frames are not visible in the file.
+class MappedAudioFile
+{
+
+public:
+
+	/// Expected access patterns for @c Advise()
+	enum class Access {
+		/// No special treatment
+		normal,
+		/// Frames will be accessed in random order
+		random,
+		/// Frames will be accessed in sequential order
+		sequential,
+		/// Frames will be accessed soon and should be read ahead
+		willNeed,
+		/// Frames will not be accessed soon
+		dontNeed,
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a closed @c MappedAudioFile
+	MappedAudioFile() noexcept;
+
+	/// Creates a @c MappedAudioFile and maps the audio data in the file at @c url
+	/// @param url The URL of the file to open
+	/// @param fileTypeHint A hint for the file type or @c 0
+	/// @throw @c std::system_error
+	/// @throw @c std::invalid_argument If the file's data format is not supported
+	explicit MappedAudioFile(CFURLRef url, AudioFileTypeID fileTypeHint = 0);
+
+	// This class is non-copyable
+	MappedAudioFile(const MappedAudioFile& rhs) = delete;
+
+	// This class is non-assignable
+	MappedAudioFile& operator=(const MappedAudioFile& rhs) = delete;
+
+	/// Unmaps the audio data and destroys the @c MappedAudioFile
+	~MappedAudioFile();
+
+	/// Move constructor
+	MappedAudioFile(MappedAudioFile&& rhs) noexcept;
+
+	/// Move assignment operator
+	MappedAudioFile& operator=(MappedAudioFile&& rhs) noexcept;
+
+#pragma mark Opening and closing
+
+	/// Maps the audio data in the file at @c url
+	/// @note Any mapped audio data is unmapped first
+	/// @param url The URL of the file to open
+	/// @param fileTypeHint A hint for the file type or @c 0
+	/// @throw @c std::system_error
+	/// @throw @c std::invalid_argument If the file's data format is not supported
+	void OpenURL(CFURLRef url, AudioFileTypeID fileTypeHint = 0);
+
+	/// Unmaps the audio data
+	/// @note Views returned by @c MapFrames() are invalid after this call
+	void Close() noexcept;
+
+	/// Returns @c true if audio data is mapped
+	inline bool IsOpen() const noexcept
+	{
+		return mMapping != nullptr;
+	}
+
+	/// Returns @c true if audio data is mapped
+	inline explicit operator bool() const noexcept
+	{
+		return IsOpen();
+	}
+
+	/// Returns @c true if no audio data is mapped
+	inline bool operator!() const noexcept
+	{
+		return !IsOpen();
+	}
+
+#pragma mark File information
+
+	/// Returns the format of the mapped audio data
+	inline const CAStreamBasicDescription& Format() const noexcept
+	{
+		return mFormat;
+	}
+
+	/// Returns the number of audio frames in the file
+	inline int64_t FrameLength() const noexcept
+	{
+		return mFrameLength;
+	}
+
+#pragma mark Frame access
+
+	/// Returns a pointer to the interleaved audio data for @c frame or @c nullptr if @c frame is out of range
+	const void * _Nullable FrameData(int64_t frame) const noexcept;
+
+	/// Returns the number of frames available starting at @c frame
+	inline int64_t FramesAvailable(int64_t frame) const noexcept
+	{
+		return frame < 0 || frame >= mFrameLength ? 0 : mFrameLength - frame;
+	}
+
+	/// Sets @c view to refer to mapped audio data without copying it
+	///
+	/// @c view adopts an @c AudioBufferList whose buffer points into the mapping. The view remains valid only while the
+	/// audio data is mapped.
+	/// @note If fewer than @c frameCount frames are available starting at @c frame the view is shortened
+	/// @param view The @c CABufferList to receive the view
+	/// @param frame The first frame of the view
+	/// @param frameCount The desired number of frames in the view
+	/// @return @c true on success, @c false if @c frame is out of range or an error occurred
+	bool MapFrames(CABufferList& view, int64_t frame, UInt32 frameCount) const noexcept;
+
+	/// Advises the system how frames will be accessed
+	/// @param frame The first frame of the range
+	/// @param frameCount The number of frames in the range
+	/// @param access The expected access pattern
+	/// @return @c true on success, @c false otherwise
+	bool Advise(int64_t frame, int64_t frameCount, Access access) const noexcept;
+
+	/// Advises the system how all frames will be accessed
+	/// @param access The expected access pattern
+	/// @return @c true on success, @c false otherwise
+	inline bool Advise(Access access) const noexcept
+	{
+		return Advise(0, mFrameLength, access);
+	}
+
+private:
+
+	/// The start of the mapping, which is page-aligned and may precede the audio data
+	void * _Nullable mMapping;
+	/// The size of the mapping in bytes
+	size_t mMappingSize;
+	/// The first byte of audio data
+	const uint8_t * _Nullable mAudioData;
+	/// The format of the audio data
+	CAStreamBasicDescription mFormat;
+	/// The number of audio frames
+	int64_t mFrameLength;
+
+};
+
+} // namespace SFB
+
+CF_ASSUME_NONNULL_END
@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <mach/mach.h>
+
+#import "SFBMirroredMemory.hpp"
+
+size_t SFB::VirtualMemoryPageSize() noexcept
+{
+	return vm_page_size;
+}
+
+void * SFB::AllocateMirroredMemory(size_t byteCount) noexcept
+{
+	if(byteCount == 0 || byteCount % vm_page_size != 0)
+		return nullptr;
+
+	// Another thread may map memory in the upper half of the region between the deallocation and the remap
+	// so make several attempts
+	for(auto attempt = 0; attempt < 4; ++attempt) {
+		vm_address_t address = 0;
+		auto result = vm_allocate(mach_task_self(), &address, byteCount * 2, VM_FLAGS_ANYWHERE);
+		if(result != KERN_SUCCESS)
+			return nullptr;
+
+		// Release the upper half so it may be replaced with a second mapping of the lower half
+		result = vm_deallocate(mach_task_self(), address + byteCount, byteCount);
+		if(result != KERN_SUCCESS) {
+			vm_deallocate(mach_task_self(), address, byteCount * 2);
+			return nullptr;
+		}
+
+		vm_address_t mirrorAddress = address + byteCount;
+		vm_prot_t currentProtection, maximumProtection;
+		result = vm_remap(mach_task_self(), &mirrorAddress, byteCount, 0, VM_FLAGS_FIXED, mach_task_self(), address, FALSE, &currentProtection, &maximumProtection, VM_INHERIT_DEFAULT);
+		if(result != KERN_SUCCESS) {
+			vm_deallocate(mach_task_self(), address, byteCount);
+			continue;
+		}
+
+		if(mirrorAddress != address + byteCount) {
+			vm_deallocate(mach_task_self(), mirrorAddress, byteCount);
+			vm_deallocate(mach_task_self(), address, byteCount);
+			continue;
+		}
+
+		return reinterpret_cast<void *>(address);
+	}
+
+	return nullptr;
+}
+
+void SFB::DeallocateMirroredMemory(void *buffer, size_t byteCount) noexcept
+{
+	if(buffer)
+		vm_deallocate(mach_task_self(), reinterpret_cast<vm_address_t>(buffer), byteCount * 2);
+}
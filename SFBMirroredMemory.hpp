@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstddef>
+
+namespace SFB {
+
+/// Returns the size of a virtual memory page in bytes
+size_t VirtualMemoryPageSize() noexcept;
+
+/// Allocates a region of virtual memory that is mapped twice, back to back
+///
+/// The returned region is @c 2*byteCount bytes long. The bytes at offset @c n and @c n+byteCount refer to the same
+/// physical memory so any sequence of at most @c byteCount bytes starting in the first half is contiguous, even if it
+/// wraps around the end of the buffer.
+/// @note The memory is zero-filled
+/// @param byteCount The size of the buffer in bytes. This must be a non-zero multiple of @c VirtualMemoryPageSize()
+/// @return The address of the first byte of the mapping or @c nullptr on error
+void * _Nullable AllocateMirroredMemory(size_t byteCount) noexcept;
+
+/// Deallocates memory allocated by @c AllocateMirroredMemory
+/// @param buffer The address returned by @c AllocateMirroredMemory or @c nullptr
+/// @param byteCount The @c byteCount value passed to @c AllocateMirroredMemory
+void DeallocateMirroredMemory(void * _Nullable buffer, size_t byteCount) noexcept;
+
+} // namespace SFB
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdint>
+#import <type_traits>
+#import <utility>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+
+/// The arrangement of channels in an audio buffer list
+enum class ChannelInterleaving {
+	/// All channels are stored in one buffer
+	interleaved,
+	/// Each channel is stored in a separate buffer
+	nonInterleaved,
+};
+
+/// A @c PCMFormat channel count indicating the number of channels is known only at run time
+constexpr UInt32 sDynamicChannelCount = 0;
+
+/// A native-endian, packed linear PCM format described at compile time
+///
+/// Kernels templated on a @c PCMFormat know the sample type, channel arrangement, and optionally the channel count at
+/// compile time, so they can be specialized without testing format flags for each buffer. @c WithPCMFormat() maps a
+/// @c CAStreamBasicDescription to the matching @c PCMFormat at run time.
+///
+/// @code
+/// template <typename Format>
+/// void Silence(AudioBufferList *bufferList, UInt32 channelCount, UInt32 frameCount) {
+///     for(UInt32 channel = 0; channel < channelCount; ++channel) {
+///         auto samples = Format::ChannelData(bufferList, channel);
+///         for(UInt32 frame = 0; frame < frameCount; ++frame)
+///             samples[frame * Format::sStride] = 0;
+///     }
+/// }
+///
+/// SFB::WithPCMFormat(format, [&](auto pcmFormat) {
+///     Silence<decltype(pcmFormat)>(bufferList, format.mChannelsPerFrame, frameCount);
+/// });
+/// @endcode
+/// @tparam T The sample type: @c float, @c double, @c int16_t, or @c int32_t
+/// @tparam ChannelCount The number of channels or @c sDynamicChannelCount
+/// @tparam Interleaving The arrangement of the channels
+template <typename T, UInt32 ChannelCount, ChannelInterleaving Interleaving>
+struct PCMFormat
+{
+	static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, int16_t>::value || std::is_same<T, int32_t>::value, "Unsupported sample type");
+	static_assert(Interleaving == ChannelInterleaving::nonInterleaved || ChannelCount != sDynamicChannelCount, "Interleaved formats require a channel count");
+
+	/// The sample type
+	using SampleType = T;
+
+	/// The number of channels or @c sDynamicChannelCount
+	static constexpr UInt32 sChannelCount = ChannelCount;
+	/// @c true if the number of channels is known at compile time
+	static constexpr bool sHasStaticChannelCount = ChannelCount != sDynamicChannelCount;
+	/// @c true if the channels are interleaved
+	static constexpr bool sIsInterleaved = Interleaving == ChannelInterleaving::interleaved;
+	/// @c true if the samples are floating point
+	static constexpr bool sIsFloat = std::is_floating_point<T>::value;
+	/// The size of a sample in bytes
+	static constexpr UInt32 sSampleWordSize = sizeof(T);
+	/// The distance between consecutive samples of one channel in @c SampleType units
+	static constexpr UInt32 sStride = sIsInterleaved ? ChannelCount : 1;
+	/// Linear PCM format flags
+	static constexpr AudioFormatFlags sFormatFlags = CAStreamBasicDescription::LinearPCM(0, 1, 8 * sizeof(T), 8 * sizeof(T), sIsFloat, kAudioFormatFlagIsBigEndian == kAudioFormatFlagsNativeEndian, !sIsInterleaved).mFormatFlags;
+
+	/// The equivalent @c CommonPCMFormat
+	static constexpr CommonPCMFormat sCommonPCMFormat = std::is_same<T, float>::value ? CommonPCMFormat::float32 : std::is_same<T, double>::value ? CommonPCMFormat::float64 : std::is_same<T, int16_t>::value ? CommonPCMFormat::int16 : CommonPCMFormat::int32;
+
+	/// Returns a @c CAStreamBasicDescription for this format
+	/// @param sampleRate The sample rate
+	/// @param channelCount The number of channels, ignored if the channel count is known at compile time
+	static constexpr CAStreamBasicDescription Description(Float64 sampleRate, UInt32 channelCount = ChannelCount) noexcept
+	{
+		return CAStreamBasicDescription(sCommonPCMFormat, sampleRate, sHasStaticChannelCount ? ChannelCount : channelCount, sIsInterleaved);
+	}
+
+	/// Returns @c true if @c format is described by this type
+	/// @note The sample rate is not compared
+	static constexpr bool Matches(const AudioStreamBasicDescription& format) noexcept
+	{
+		constexpr AudioFormatFlags mask = kAudioFormatFlagIsFloat | kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsBigEndian | kAudioFormatFlagIsNonInterleaved;
+		if(format.mFormatID != kAudioFormatLinearPCM || (format.mFormatFlags & mask) != (sFormatFlags & mask))
+			return false;
+		if(format.mBitsPerChannel != 8 * sizeof(T) || format.mBytesPerFrame != (sIsInterleaved ? format.mChannelsPerFrame : 1) * sizeof(T))
+			return false;
+		return !sHasStaticChannelCount || format.mChannelsPerFrame == ChannelCount;
+	}
+
+	/// Returns the first sample of @c channel in @c bufferList
+	/// @note No bounds checking is performed
+	static SampleType * _Nonnull ChannelData(AudioBufferList * const _Nonnull bufferList, UInt32 channel) noexcept
+	{
+		if constexpr(sIsInterleaved)
+			return static_cast<SampleType *>(bufferList->mBuffers[0].mData) + channel;
+		else
+			return static_cast<SampleType *>(bufferList->mBuffers[channel].mData);
+	}
+
+	/// Returns the first sample of @c channel in @c bufferList
+	/// @note No bounds checking is performed
+	static const SampleType * _Nonnull ChannelData(const AudioBufferList * const _Nonnull bufferList, UInt32 channel) noexcept
+	{
+		if constexpr(sIsInterleaved)
+			return static_cast<const SampleType *>(bufferList->mBuffers[0].mData) + channel;
+		else
+			return static_cast<const SampleType *>(bufferList->mBuffers[channel].mData);
+	}
+};
+
+/// A native-endian @c float format with @c ChannelCount interleaved channels
+template <UInt32 ChannelCount>
+using InterleavedFloat32Format = PCMFormat<float, ChannelCount, ChannelInterleaving::interleaved>;
+
+/// A native-endian @c float format with non-interleaved channels
+using NonInterleavedFloat32Format = PCMFormat<float, sDynamicChannelCount, ChannelInterleaving::nonInterleaved>;
+
+/// Calls @c f with a default-constructed @c PCMFormat matching @c format
+///
+/// Non-interleaved formats map to a @c PCMFormat with a dynamic channel count. Interleaved formats with one to eight
+/// channels map to a @c PCMFormat with a static channel count.
+/// @param format The format to map
+/// @param f A callable object accepting any @c PCMFormat
+/// @return @c true if @c f was called, @c false if @c format has no matching @c PCMFormat
+template <typename F>
+bool WithPCMFormat(const AudioStreamBasicDescription& format, F&& f)
+{
+	auto dispatch = [&]<typename T>(T) -> bool {
+		using NonInterleaved = PCMFormat<T, sDynamicChannelCount, ChannelInterleaving::nonInterleaved>;
+		if(NonInterleaved::Matches(format)) {
+			f(NonInterleaved{});
+			return true;
+		}
+
+		auto interleaved = [&]<UInt32... Channels>(std::integer_sequence<UInt32, Channels...>) -> bool {
+			return ((PCMFormat<T, Channels + 1, ChannelInterleaving::interleaved>::Matches(format) && (f(PCMFormat<T, Channels + 1, ChannelInterleaving::interleaved>{}), true)) || ...);
+		};
+		return interleaved(std::make_integer_sequence<UInt32, 8>{});
+	};
+
+	return dispatch(float{}) || dispatch(double{}) || dispatch(int16_t{}) || dispatch(int32_t{});
+}
+
+} // namespace SFB
@@ -10,6 +10,7 @@
 #import <limits>
 
 #import "SFBRingBuffer.hpp"
+#import "SFBMirroredMemory.hpp"
 
 namespace {
 
@@ -23,24 +24,54 @@ inline constexpr uint32_t NextPowerOfTwo(uint32_t x) noexcept
 	return static_cast<uint32_t>(1 << (32 - __builtin_clz(x - 1)));
 }
 
+/// Returns the number of bytes available for reading
+/// @param writePosition The write position
+/// @param readPosition The read position
+/// @param capacityBytes The buffer capacity in bytes
+/// @param capacityBytesMask The buffer capacity in bytes minus one
+/// @return The number of bytes available for reading
+inline constexpr uint32_t ReadableByteCount(uint32_t writePosition, uint32_t readPosition, uint32_t capacityBytes, uint32_t capacityBytesMask) noexcept
+{
+	if(writePosition > readPosition)
+		return writePosition - readPosition;
+	else
+		return (writePosition - readPosition + capacityBytes) & capacityBytesMask;
+}
+
+/// Returns the number of bytes available for writing
+/// @param writePosition The write position
+/// @param readPosition The read position
+/// @param capacityBytes The buffer capacity in bytes
+/// @param capacityBytesMask The buffer capacity in bytes minus one
+/// @return The number of bytes available for writing
+inline constexpr uint32_t WritableByteCount(uint32_t writePosition, uint32_t readPosition, uint32_t capacityBytes, uint32_t capacityBytesMask) noexcept
+{
+	if(writePosition > readPosition)
+		return ((readPosition - writePosition + capacityBytes) & capacityBytesMask) - 1;
+	else if(writePosition < readPosition)
+		return (readPosition - writePosition) - 1;
+	else
+		return capacityBytes - 1;
+}
+
 }
 
 #pragma mark Creation and Destruction
 
 SFB::RingBuffer::RingBuffer() noexcept
-: mBuffer(nullptr), mCapacityBytes(0), mCapacityBytesMask(0), mWritePosition(0), mReadPosition(0)
+: mBuffer(nullptr), mCapacityBytes(0), mCapacityBytesMask(0), mIsMirrored(false), mWritePosition(0), mCachedReadPosition(0), mReadPosition(0), mCachedWritePosition(0)
 {
 	assert(mWritePosition.is_lock_free());
 }
 
 SFB::RingBuffer::~RingBuffer()
 {
-	std::free(mBuffer);
+	Deallocate();
 }
 
 #pragma mark Buffer Management
 
-bool SFB::RingBuffer::Allocate(uint32_t capacityBytes) noexcept
+bool SFB::RingBuffer::Allocate(uint32_t capacityBytes, bool mirrored, const AllocationPolicy& policy) noexcept
 {
 	if(capacityBytes < 2 || capacityBytes > 0x80000000)
 		return false;
@@ -50,27 +81,48 @@ bool SFB::RingBuffer::Allocate(uint32_t capacityBytes) noexcept
 	// Round up to the next power of two
 	capacityBytes = NextPowerOfTwo(static_cast<uint32_t>(capacityBytes));
 
-	mBuffer = static_cast<uint8_t *>(std::malloc(capacityBytes));
+	if(mirrored) {
+		// The page size is a power of two so the capacity remains a power of two
+		capacityBytes = std::max(capacityBytes, static_cast<uint32_t>(VirtualMemoryPageSize()));
+		mBuffer = static_cast<uint8_t *>(AllocateMirroredMemory(capacityBytes));
+		if(mBuffer && !PrepareMemory(mBuffer, capacityBytes * 2, policy)) {
+			DeallocateMirroredMemory(mBuffer, capacityBytes);
+			mBuffer = nullptr;
+		}
+	}
+	else
+		mBuffer = static_cast<uint8_t *>(AllocateMemory(capacityBytes, policy));
+
 	if(!mBuffer)
 		return false;
 
 	mCapacityBytes = capacityBytes;
+	mIsMirrored = mirrored;
+	mAllocationPolicy = policy;
 	mCapacityBytesMask = capacityBytes - 1;
 
+	Reset();
+
 	return true;
 }
 
 void SFB::RingBuffer::Deallocate() noexcept
 {
 	if(mBuffer) {
-		std::free(mBuffer);
+		if(mIsMirrored) {
+			UnprepareMemory(mBuffer, mCapacityBytes * 2, mAllocationPolicy);
+			DeallocateMirroredMemory(mBuffer, mCapacityBytes);
+		}
+		else
+			DeallocateMemory(mBuffer, mCapacityBytes, mAllocationPolicy);
 		mBuffer = nullptr;
 
 		mCapacityBytes = 0;
 		mCapacityBytesMask = 0;
+		mIsMirrored = false;
+		mAllocationPolicy = {};
 
-		mReadPosition = 0;
-		mWritePosition = 0;
+		Reset();
 	}
 }
 
@@ -78,30 +130,23 @@ void SFB::RingBuffer::Reset() noexcept
 {
 	mReadPosition = 0;
 	mWritePosition = 0;
+
+	mCachedReadPosition = 0;
+	mCachedWritePosition = 0;
 }
 
 uint32_t SFB::RingBuffer::BytesAvailableToRead() const noexcept
 {
 	auto writePosition = mWritePosition.load(std::memory_order_acquire);
 	auto readPosition = mReadPosition.load(std::memory_order_acquire);
-
-	if(writePosition > readPosition)
-		return writePosition - readPosition;
-	else
-		return (writePosition - readPosition + mCapacityBytes) & mCapacityBytesMask;
+	return ReadableByteCount(writePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
 }
 
 uint32_t SFB::RingBuffer::BytesAvailableToWrite() const noexcept
 {
 	auto writePosition = mWritePosition.load(std::memory_order_acquire);
 	auto readPosition = mReadPosition.load(std::memory_order_acquire);
-
-	if(writePosition > readPosition)
-		return ((readPosition - writePosition + mCapacityBytes) & mCapacityBytesMask) - 1;
-	else if(writePosition < readPosition)
-		return (readPosition - writePosition) - 1;
-	else
-		return mCapacityBytes - 1;
+	return WritableByteCount(writePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
 }
 
 #pragma mark Reading and Writing Data
@@ -111,20 +156,28 @@ uint32_t SFB::RingBuffer::Read(void * const destinationBuffer, uint32_t byteCoun
 	if(!destinationBuffer || byteCount == 0)
 		return 0;
 
-	auto writePosition = mWritePosition.load(std::memory_order_acquire);
-	auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	const Telemetry::Interval interval(mTelemetry, "RingBuffer::Read");
 
-	uint32_t bytesAvailable;
-	if(writePosition > readPosition)
-		bytesAvailable = writePosition - readPosition;
-	else
-		bytesAvailable = (writePosition - readPosition + mCapacityBytes) & mCapacityBytesMask;
+	// Only the reader modifies the read position so a relaxed load is sufficient
+	auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+
+	// Avoid touching the writer's cache line unless the cached write position shows insufficient data
+	auto bytesAvailable = ReadableByteCount(mCachedWritePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
+	if(bytesAvailable < byteCount) {
+		mCachedWritePosition = mWritePosition.load(std::memory_order_acquire);
+		bytesAvailable = ReadableByteCount(mCachedWritePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
+	}
+
+	// Reloading the write position only for telemetry would touch the writer's cache line on every read
+	mTelemetry.RecordFillLevel(bytesAvailable);
+	if(bytesAvailable < byteCount)
+		mTelemetry.RecordUnderrun(byteCount - bytesAvailable);
 
 	if(bytesAvailable == 0)
 		return 0;
 
 	auto bytesToRead = std::min(bytesAvailable, byteCount);
-	if(readPosition + bytesToRead > mCapacityBytes) {
+	if(!mIsMirrored && readPosition + bytesToRead > mCapacityBytes) {
 		auto bytesAfterReadPointer = mCapacityBytes - readPosition;
 		std::memcpy(destinationBuffer, mBuffer + readPosition, bytesAfterReadPointer);
 		std::memcpy(static_cast<uint8_t *>(destinationBuffer) + bytesAfterReadPointer, mBuffer, bytesToRead - bytesAfterReadPointer);
@@ -142,20 +195,21 @@ uint32_t SFB::RingBuffer::Peek(void * const destinationBuffer, uint32_t byteCoun
 	if(!destinationBuffer || byteCount == 0)
 		return 0;
 
-	auto writePosition = mWritePosition.load(std::memory_order_acquire);
-	auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	// Only the reader modifies the read position so a relaxed load is sufficient
+	auto readPosition = mReadPosition.load(std::memory_order_relaxed);
 
-	uint32_t bytesAvailable;
-	if(writePosition > readPosition)
-		bytesAvailable = writePosition - readPosition;
-	else
-		bytesAvailable = (writePosition - readPosition + mCapacityBytes) & mCapacityBytesMask;
+	// Avoid touching the writer's cache line unless the cached write position shows insufficient data
+	auto bytesAvailable = ReadableByteCount(mCachedWritePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
+	if(bytesAvailable < byteCount) {
+		mCachedWritePosition = mWritePosition.load(std::memory_order_acquire);
+		bytesAvailable = ReadableByteCount(mCachedWritePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
+	}
 
 	if(bytesAvailable == 0)
 		return 0;
 
 	auto bytesToRead = std::min(bytesAvailable, byteCount);
-	if(readPosition + bytesToRead > mCapacityBytes) {
+	if(!mIsMirrored && readPosition + bytesToRead > mCapacityBytes) {
 		auto bytesAfterReadPointer = mCapacityBytes - readPosition;
 		std::memcpy(destinationBuffer, mBuffer + readPosition, bytesAfterReadPointer);
 		std::memcpy(static_cast<uint8_t *>(destinationBuffer) + bytesAfterReadPointer, mBuffer, bytesToRead - bytesAfterReadPointer);
@@ -171,22 +225,28 @@ uint32_t SFB::RingBuffer::Write(const void * const sourceBuffer, uint32_t byteCo
 	if(!sourceBuffer || byteCount == 0)
 		return 0;
 
-	auto writePosition = mWritePosition.load(std::memory_order_acquire);
-	auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	const Telemetry::Interval interval(mTelemetry, "RingBuffer::Write");
 
-	uint32_t bytesAvailable;
-	if(writePosition > readPosition)
-		bytesAvailable = ((readPosition - writePosition + mCapacityBytes) & mCapacityBytesMask) - 1;
-	else if(writePosition < readPosition)
-		bytesAvailable = (readPosition - writePosition) - 1;
-	else
-		bytesAvailable = mCapacityBytes - 1;
+	// Only the writer modifies the write position so a relaxed load is sufficient
+	auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+
+	// Avoid touching the reader's cache line unless the cached read position shows insufficient space
+	auto bytesAvailable = WritableByteCount(writePosition, mCachedReadPosition, mCapacityBytes, mCapacityBytesMask);
+	if(bytesAvailable < byteCount) {
+		mCachedReadPosition = mReadPosition.load(std::memory_order_acquire);
+		bytesAvailable = WritableByteCount(writePosition, mCachedReadPosition, mCapacityBytes, mCapacityBytesMask);
+	}
+
+	// The fill level is that following the write, computed without reloading the read position
+	mTelemetry.RecordFillLevel(mCapacityBytes - 1 - bytesAvailable + std::min(bytesAvailable, byteCount));
+	if(bytesAvailable < byteCount)
+		mTelemetry.RecordOverrun(byteCount - bytesAvailable);
 
 	if(bytesAvailable == 0)
 		return 0;
 
 	auto bytesToWrite = std::min(bytesAvailable, byteCount);
-	if(writePosition + bytesToWrite > mCapacityBytes) {
+	if(!mIsMirrored && writePosition + bytesToWrite > mCapacityBytes) {
 		auto bytesAfterWritePointer = mCapacityBytes - writePosition;
 		std::memcpy(mBuffer + writePosition, sourceBuffer, bytesAfterWritePointer);
 		std::memcpy(mBuffer, static_cast<const uint8_t *>(sourceBuffer) + bytesAfterWritePointer, bytesToWrite - bytesAfterWritePointer);
@@ -201,50 +261,40 @@ uint32_t SFB::RingBuffer::Write(const void * const sourceBuffer, uint32_t byteCo
 
 void SFB::RingBuffer::AdvanceReadPosition(uint32_t byteCount) noexcept
 {
-	mReadPosition.store((mReadPosition.load(std::memory_order_acquire) + byteCount) & mCapacityBytesMask, std::memory_order_release);
+	mReadPosition.store((mReadPosition.load(std::memory_order_relaxed) + byteCount) & mCapacityBytesMask, std::memory_order_release);
 }
 
 void SFB::RingBuffer::AdvanceWritePosition(uint32_t byteCount) noexcept
 {
-	mWritePosition.store((mWritePosition.load(std::memory_order_acquire) + byteCount) & mCapacityBytesMask, std::memory_order_release);
+	mWritePosition.store((mWritePosition.load(std::memory_order_relaxed) + byteCount) & mCapacityBytesMask, std::memory_order_release);
 }
 
 const SFB::RingBuffer::ReadBufferPair SFB::RingBuffer::ReadVector() const noexcept
 {
-	auto writePosition = mWritePosition.load(std::memory_order_acquire);
-	auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+	mCachedWritePosition = mWritePosition.load(std::memory_order_acquire);
 
-	uint32_t bytesAvailable;
-	if(writePosition > readPosition)
-		bytesAvailable = writePosition - readPosition;
-	else
-		bytesAvailable = (writePosition - readPosition + mCapacityBytes) & mCapacityBytesMask;
+	auto bytesAvailable = ReadableByteCount(mCachedWritePosition, readPosition, mCapacityBytes, mCapacityBytesMask);
 
 	auto endOfRead = readPosition + bytesAvailable;
 
-	if(endOfRead > mCapacityBytes)
-		return { { mBuffer + readPosition, mCapacityBytes - readPosition }, { mBuffer, endOfRead & mCapacityBytes } };
+	if(!mIsMirrored && endOfRead > mCapacityBytes)
+		return { { mBuffer + readPosition, mCapacityBytes - readPosition }, { mBuffer, endOfRead & mCapacityBytesMask } };
 	else
 		return { { mBuffer + readPosition, bytesAvailable }, {} };
 }
 
 const SFB::RingBuffer::WriteBufferPair SFB::RingBuffer::WriteVector() const noexcept
 {
-	auto writePosition = mWritePosition.load(std::memory_order_acquire);
-	auto readPosition = mReadPosition.load(std::memory_order_acquire);
+	auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+	mCachedReadPosition = mReadPosition.load(std::memory_order_acquire);
 
-	uint32_t bytesAvailable;
-	if(writePosition > readPosition)
-		bytesAvailable = ((readPosition - writePosition + mCapacityBytes) & mCapacityBytesMask) - 1;
-	else if(writePosition < readPosition)
-		bytesAvailable = (readPosition - writePosition) - 1;
-	else
-		bytesAvailable = mCapacityBytes - 1;
+	auto bytesAvailable = WritableByteCount(writePosition, mCachedReadPosition, mCapacityBytes, mCapacityBytesMask);
 
 	auto endOfWrite = writePosition + bytesAvailable;
 
-	if(endOfWrite > mCapacityBytes)
-		return { { mBuffer + writePosition, mCapacityBytes - writePosition }, { mBuffer, endOfWrite & mCapacityBytes } };
+	if(!mIsMirrored && endOfWrite > mCapacityBytes)
+		return { { mBuffer + writePosition, mCapacityBytes - writePosition }, { mBuffer, endOfWrite & mCapacityBytesMask } };
 	else
 		return { { mBuffer + writePosition, bytesAvailable }, {} };
 }
@@ -8,11 +8,16 @@
 
 #import <atomic>
 
+#import "SFBAllocationPolicy.hpp"
+#import "SFBTelemetry.hpp"
+
 namespace SFB {
 
 /// A generic ring buffer.
 ///
 /// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer model).
+/// @c Read(), @c Peek(), @c ReadVector(), and @c AdvanceReadPosition() must only be called from the reader thread, and
+/// @c Write(), @c WriteVector(), and @c AdvanceWritePosition() must only be called from the writer thread.
 class RingBuffer
 {
 
@@ -42,11 +47,21 @@ public:
 #pragma mark Buffer management
 
 	/// Allocates space for data.
+	///
+	/// If @c mirrored is @c true the buffer is mapped twice in consecutive virtual memory. In this mode
+	/// all readable and writable regions are contiguous: the second element of the pairs returned by
+	/// @c ReadVector() and @c WriteVector() is always empty and reads and writes never need to be split.
+	/// A mirrored buffer's capacity is at least one virtual memory page.
+	///
+	/// @c policy controls the alignment of the buffer and whether its memory is locked and prefaulted.
+	/// Mirrored buffers are always page aligned.
 	/// @note This method is not thread safe.
 	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) bytes are supported
 	/// @param byteCount The desired capacity, in bytes
+	/// @param mirrored Whether the buffer should be mapped twice in consecutive virtual memory
+	/// @param policy The allocation policy
 	/// @return @c true on success, @c false on error
-	bool Allocate(uint32_t byteCount) noexcept;
+	bool Allocate(uint32_t byteCount, bool mirrored = false, const AllocationPolicy& policy = {}) noexcept;
 
 	/// Frees the resources used by this @c RingBuffer
 	/// @note This method is not thread safe.
@@ -64,6 +79,12 @@ public:
 		return mCapacityBytes;
 	}
 
+	/// Returns @c true if this @c RingBuffer is mapped twice in consecutive virtual memory
+	inline bool IsMirrored() const noexcept
+	{
+		return mIsMirrored;
+	}
+
 	/// Returns the number of bytes available for reading
 	uint32_t BytesAvailableToRead() const noexcept;
 
@@ -151,8 +172,32 @@ public:
 	/// Returns the write vector containing the current writable space
 	const WriteBufferPair WriteVector() const noexcept;
 
+#pragma mark Telemetry
+
+	/// Returns the telemetry recorded by @c Read() and @c Write()
+	///
+	/// Fill levels are computed from each side's cached copy of the other side's position, so a fill level recorded by
+	/// @c Read() may be lower and one recorded by @c Write() higher than the actual fill level.
+	/// @note All values are zero unless @c SFB_ENABLE_TELEMETRY is nonzero
+	/// @note This method is safe to call from any thread
+	inline TelemetryStatistics SampleTelemetry() const noexcept
+	{
+		return mTelemetry.Statistics();
+	}
+
+	/// Resets the telemetry recorded by @c Read() and @c Write()
+	/// @note This method is safe to call from any thread
+	inline void ResetTelemetry() noexcept
+	{
+		mTelemetry.ResetStatistics();
+	}
+
 private:
 
+	/// The assumed size of a cache line, in bytes
+	/// @note 128 bytes matches the cache line size of Apple silicon and covers adjacent-line prefetching on x86-64
+	static constexpr size_t sCacheLineSize = 128;
+
 	/// The memory buffer holding the data
 	uint8_t * _Nullable mBuffer;
 
@@ -160,11 +205,28 @@ private:
 	uint32_t mCapacityBytes;
 	/// The capacity of @c mBuffer in bytes minus one
 	uint32_t mCapacityBytesMask;
+	/// @c true if @c mBuffer is mapped twice in consecutive virtual memory
+	bool mIsMirrored;
+	/// The policy used to allocate @c mBuffer
+	AllocationPolicy mAllocationPolicy;
+
+	// The write and read positions are placed on separate cache lines so the producer and consumer
+	// don't contend for the same line. Each side also keeps a local copy of the other side's position
+	// which is only refreshed when it indicates insufficient space or data.
 
-	/// The offset into @c mBuffer of the read location
-	std::atomic_uint32_t mWritePosition;
 	/// The offset into @c mBuffer of the write location
-	std::atomic_uint32_t mReadPosition;
+	alignas(sCacheLineSize) std::atomic_uint32_t mWritePosition;
+	/// The writer's most recently observed value of @c mReadPosition
+	mutable uint32_t mCachedReadPosition;
+
+	/// The offset into @c mBuffer of the read location
+	alignas(sCacheLineSize) std::atomic_uint32_t mReadPosition;
+	/// The reader's most recently observed value of @c mWritePosition
+	mutable uint32_t mCachedWritePosition;
+
+	/// Telemetry recorded by @c Read() and @c Write()
+	/// @note The counters are placed on their own cache line so recording them from either side doesn't contend for the reader's line
+	alignas(sCacheLineSize) [[no_unique_address]] Telemetry mTelemetry;
 
 };
 
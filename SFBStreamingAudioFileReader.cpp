@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cmath>
+#import <cstring>
+#import <limits>
+#import <stdexcept>
+
+#import "SFBStreamingAudioFileReader.hpp"
+
+namespace {
+
+/// The longest the decode thread waits before checking for seek and stop requests
+constexpr int64_t sDecodeThreadPollInterval = 10 * NSEC_PER_MSEC;
+
+/// A seek generation that is never used
+constexpr uint64_t sInvalidGeneration = std::numeric_limits<uint64_t>::max();
+
+/// Fills frames @c frameOffset through @c frameCount of each buffer in @c bufferList with silence
+void FillWithSilence(AudioBufferList * const bufferList, const SFB::CAStreamBasicDescription& format, uint32_t frameOffset, uint32_t frameCount) noexcept
+{
+	const auto byteOffset = frameOffset * format.mBytesPerFrame;
+	const auto byteSize = frameCount * format.mBytesPerFrame;
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		if(byteSize > byteOffset)
+			std::memset(static_cast<uint8_t *>(bufferList->mBuffers[i].mData) + byteOffset, 0, byteSize - byteOffset);
+		bufferList->mBuffers[i].mDataByteSize = byteSize;
+	}
+}
+
+} // namespace
+
+#pragma mark Creation and Destruction
+
+SFB::StreamingAudioFileReader::StreamingAudioFileReader(CAExtAudioFile&& file, uint32_t targetLeadFrames, uint32_t chunkFrames)
+: mFile(std::move(file)), mTargetLeadFrames(targetLeadFrames), mFileFramesPerFrame(1), mDecodeSemaphore(0), mStopDecoding(false), mSeekFrame(0), mSeekGeneration(0), mFlushGeneration(0), mFlushFrame(0), mEndOfFileGeneration(sInvalidGeneration), mReadGeneration(0), mPosition(0), mUnderruns(0), mUnderrunFrames(0), mDecodeErrors(0)
+{
+	if(targetLeadFrames == 0 || chunkFrames == 0)
+		throw std::invalid_argument("targetLeadFrames == 0 || chunkFrames == 0");
+
+	const auto format = mFile.ClientDataFormat();
+	// Silence is written as zeroes
+	if(!(format.IsFloat() || format.IsSignedInteger()))
+		throw std::invalid_argument("Unsupported client data format");
+
+	const auto fileFormat = mFile.FileDataFormat();
+	if(format.mSampleRate > 0 && fileFormat.mSampleRate > 0)
+		mFileFramesPerFrame = fileFormat.mSampleRate / format.mSampleRate;
+
+	// The ring buffer has room for the lead plus one chunk
+	if(!mRingBuffer.Allocate(format, targetLeadFrames + chunkFrames + 1) || !mDecodeBuffer.Allocate(format, chunkFrames))
+		throw std::bad_alloc();
+
+	mDecodeThread = std::thread(&StreamingAudioFileReader::DecodeThreadEntry, this);
+}
+
+SFB::StreamingAudioFileReader::~StreamingAudioFileReader()
+{
+	mStopDecoding.store(true, std::memory_order_release);
+	mDecodeSemaphore.Signal();
+	mDecodeThread.join();
+}
+
+#pragma mark Reader Information
+
+bool SFB::StreamingAudioFileReader::IsAtEnd() const noexcept
+{
+	const auto readGeneration = mReadGeneration.load(std::memory_order_acquire);
+	return mSeekGeneration.load(std::memory_order_acquire) == readGeneration && mEndOfFileGeneration.load(std::memory_order_acquire) == readGeneration && mRingBuffer.AvailableToRead() == 0;
+}
+
+#pragma mark Reading and Seeking
+
+uint32_t SFB::StreamingAudioFileReader::Read(AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	if(!bufferList || frameCount == 0)
+		return 0;
+
+	const auto& format = Format();
+
+	auto readGeneration = mReadGeneration.load(std::memory_order_relaxed);
+	const auto seekGeneration = mSeekGeneration.load(std::memory_order_acquire);
+	if(readGeneration != seekGeneration) {
+		// Until the decode thread stops writing audio from before the seek the ring buffer can't be flushed
+		if(mFlushGeneration.load(std::memory_order_acquire) != seekGeneration) {
+			FillWithSilence(bufferList, format, 0, frameCount);
+			return 0;
+		}
+
+		auto& ringBuffer = mRingBuffer.Buffer();
+		mRingBuffer.DidRead(ringBuffer.Skip(ringBuffer.FramesAvailableToRead()));
+
+		mPosition.store(mFlushFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		readGeneration = seekGeneration;
+		mReadGeneration.store(readGeneration, std::memory_order_release);
+		mDecodeSemaphore.Signal();
+	}
+
+	const auto framesRead = mRingBuffer.Read(bufferList, frameCount);
+	mPosition.store(mPosition.load(std::memory_order_relaxed) + framesRead, std::memory_order_relaxed);
+
+	if(framesRead < frameCount) {
+		FillWithSilence(bufferList, format, framesRead, frameCount);
+		// Running out of audio at the end of the file isn't an underrun
+		if(mEndOfFileGeneration.load(std::memory_order_acquire) != readGeneration || mRingBuffer.AvailableToRead() != 0) {
+			mUnderruns.fetch_add(1, std::memory_order_relaxed);
+			mUnderrunFrames.fetch_add(frameCount - framesRead, std::memory_order_relaxed);
+		}
+	}
+
+	return framesRead;
+}
+
+void SFB::StreamingAudioFileReader::Seek(int64_t frame) noexcept
+{
+	mSeekFrame.store(std::max<int64_t>(frame, 0), std::memory_order_relaxed);
+	mSeekGeneration.fetch_add(1, std::memory_order_release);
+	mDecodeSemaphore.Signal();
+}
+
+#pragma mark Statistics
+
+SFB::StreamingAudioFileReader::ReaderStatistics SFB::StreamingAudioFileReader::Statistics() const noexcept
+{
+	return {
+		.mUnderruns = mUnderruns.load(std::memory_order_relaxed),
+		.mUnderrunFrames = mUnderrunFrames.load(std::memory_order_relaxed),
+		.mDecodeErrors = mDecodeErrors.load(std::memory_order_relaxed),
+	};
+}
+
+void SFB::StreamingAudioFileReader::ResetStatistics() noexcept
+{
+	mUnderruns.store(0, std::memory_order_relaxed);
+	mUnderrunFrames.store(0, std::memory_order_relaxed);
+	mDecodeErrors.store(0, std::memory_order_relaxed);
+}
+
+#pragma mark Decoding
+
+void SFB::StreamingAudioFileReader::DecodeThreadEntry() noexcept
+{
+	const auto capacityFrames = mRingBuffer.Buffer().CapacityFrames();
+
+	// Audio is decoded whenever fewer than mTargetLeadFrames frames are buffered, which leaves room for at least one chunk
+	// because the ring buffer holds at least mTargetLeadFrames + chunkFrames frames
+	const auto writeThreshold = capacityFrames - mTargetLeadFrames;
+
+	uint64_t generation = 0;
+	bool atEnd = false;
+
+	while(!mStopDecoding.load(std::memory_order_acquire)) {
+		const auto seekGeneration = mSeekGeneration.load(std::memory_order_acquire);
+		if(seekGeneration != generation) {
+			// Reposition the file, then wait for the reader to discard the audio written before the seek
+			if(mFlushGeneration.load(std::memory_order_relaxed) != seekGeneration) {
+				const auto frame = mSeekFrame.load(std::memory_order_relaxed);
+				try {
+					mFile.Seek(static_cast<SInt64>(std::llround(frame * mFileFramesPerFrame)));
+					atEnd = false;
+				}
+				catch(...) {
+					mDecodeErrors.fetch_add(1, std::memory_order_relaxed);
+					atEnd = true;
+				}
+				mFlushFrame.store(frame, std::memory_order_relaxed);
+				mFlushGeneration.store(seekGeneration, std::memory_order_release);
+			}
+
+			if(mReadGeneration.load(std::memory_order_acquire) != seekGeneration) {
+				mDecodeSemaphore.Wait(dispatch_time(DISPATCH_TIME_NOW, sDecodeThreadPollInterval));
+				continue;
+			}
+
+			generation = seekGeneration;
+			if(atEnd)
+				mEndOfFileGeneration.store(generation, std::memory_order_release);
+		}
+
+		if(atEnd) {
+			mDecodeSemaphore.Wait(dispatch_time(DISPATCH_TIME_NOW, sDecodeThreadPollInterval));
+			continue;
+		}
+
+		if(mRingBuffer.AvailableToWrite() < writeThreshold) {
+			mRingBuffer.WaitForWritable(writeThreshold, dispatch_time(DISPATCH_TIME_NOW, sDecodeThreadPollInterval));
+			continue;
+		}
+
+		try {
+			mFile.Read(mDecodeBuffer);
+		}
+		catch(...) {
+			mDecodeErrors.fetch_add(1, std::memory_order_relaxed);
+			mDecodeBuffer.SetFrameLength(0);
+		}
+
+		const auto framesDecoded = mDecodeBuffer.FrameLength();
+		if(framesDecoded == 0) {
+			atEnd = true;
+			mEndOfFileGeneration.store(generation, std::memory_order_release);
+			continue;
+		}
+
+		mRingBuffer.Write(mDecodeBuffer, framesDecoded);
+	}
+}
@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+#import <thread>
+
+#import <CoreAudioTypes/CoreAudioTypes.h>
+
+#import "SFBAudioRingBuffer.hpp"
+#import "SFBCABufferList.hpp"
+#import "SFBCAExtAudioFile.hpp"
+#import "SFBDispatchSemaphore.hpp"
+#import "SFBWaitableRingBuffer.hpp"
+
+namespace SFB {
+
+/// Reads an audio file from a real-time thread by decoding ahead on a background thread
+///
+/// A decode thread reads audio from a @c CAExtAudioFile in the file's client format and keeps an @c AudioRingBuffer
+/// filled to a target lead. @c Read() copies audio from the ring buffer and is real-time safe.
+///
+/// @c Seek() does not block. The decode thread stops writing, repositions the file, and waits for the next @c Read()
+/// to discard the audio buffered before the seek, after which it refills the ring buffer from the new position.
+/// @c Read() returns silence until audio from the new position is available.
+///
+/// Frame positions are measured in the client format's sample rate.
+///
+/// This class is thread safe when @c Read() is called from one thread.
+class StreamingAudioFileReader
+{
+
+public:
+
+	/// The default number of frames decoded at a time
+	static constexpr uint32_t sDefaultChunkFrames = 4096;
+
+	/// Information on the operation of the reader
+	struct ReaderStatistics
+	{
+		/// The number of reads that could not be fully satisfied before the end of the file
+		uint64_t mUnderruns;
+		/// The number of frames of silence returned by underruns
+		uint64_t mUnderrunFrames;
+		/// The number of errors reading or seeking the file
+		uint64_t mDecodeErrors;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c StreamingAudioFileReader and starts its decode thread
+	/// @param file An open @c CAExtAudioFile whose client data format is the format returned by @c Read()
+	/// @param targetLeadFrames The number of frames to keep decoded ahead of the read position
+	/// @param chunkFrames The number of frames to decode at a time
+	/// @throw @c std::system_error
+	/// @throw @c std::invalid_argument If @c targetLeadFrames or @c chunkFrames is zero
+	/// @throw @c std::bad_alloc
+	StreamingAudioFileReader(CAExtAudioFile&& file, uint32_t targetLeadFrames, uint32_t chunkFrames = sDefaultChunkFrames);
+
+	// This class is non-copyable
+	StreamingAudioFileReader(const StreamingAudioFileReader& rhs) = delete;
+
+	// This class is non-assignable
+	StreamingAudioFileReader& operator=(const StreamingAudioFileReader& rhs) = delete;
+
+	/// Stops the decode thread and destroys the @c StreamingAudioFileReader
+	~StreamingAudioFileReader();
+
+	// This class is non-movable
+	StreamingAudioFileReader(StreamingAudioFileReader&& rhs) = delete;
+
+	// This class is non-move assignable
+	StreamingAudioFileReader& operator=(StreamingAudioFileReader&& rhs) = delete;
+
+#pragma mark Reader information
+
+	/// Returns the format of the audio returned by @c Read()
+	inline const CAStreamBasicDescription& Format() const noexcept
+	{
+		return mRingBuffer.Buffer().Format();
+	}
+
+	/// Returns the number of frames kept decoded ahead of the read position
+	inline uint32_t TargetLeadFrames() const noexcept
+	{
+		return mTargetLeadFrames;
+	}
+
+	/// Returns the number of decoded frames available to @c Read()
+	inline uint32_t FramesBuffered() const noexcept
+	{
+		return mRingBuffer.AvailableToRead();
+	}
+
+	/// Returns the frame position of the next @c Read()
+	/// @note While a seek is in progress this is the position before the seek
+	inline int64_t Position() const noexcept
+	{
+		return mPosition.load(std::memory_order_relaxed);
+	}
+
+	/// Returns @c true if all audio up to the end of the file has been read
+	bool IsAtEnd() const noexcept;
+
+#pragma mark Reading and seeking
+
+	/// Reads decoded audio and fills the remainder of @c bufferList with silence
+	/// @note This method is real-time safe and should only be called from one thread
+	/// @param bufferList An @c AudioBufferList in @c Format() with space for @c frameCount frames
+	/// @param frameCount The number of frames to read
+	/// @return The number of frames of audio read
+	uint32_t Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
+
+	/// Requests that reading continue from @c frame
+	/// @note This method does not block and is safe to call from any thread
+	/// @param frame The desired frame position
+	void Seek(int64_t frame) noexcept;
+
+#pragma mark Statistics
+
+	/// Returns the reader statistics
+	/// @note This method is safe to call from any thread
+	ReaderStatistics Statistics() const noexcept;
+
+	/// Resets the reader statistics
+	/// @note This method is safe to call from any thread
+	void ResetStatistics() noexcept;
+
+private:
+
+	/// The decode thread's entry point
+	void DecodeThreadEntry() noexcept;
+
+	/// Destructive interference size for atomic variables
+	static constexpr size_t sCacheLineSize = 128;
+
+	/// The file being read
+	/// @note This is only accessed from the decode thread after construction
+	CAExtAudioFile mFile;
+	/// Decoded audio waiting to be read
+	WaitableRingBuffer<AudioRingBuffer> mRingBuffer;
+	/// Decode thread scratch space
+	CABufferList mDecodeBuffer;
+	/// The number of frames kept decoded ahead of the read position
+	const uint32_t mTargetLeadFrames;
+	/// The ratio of the file's sample rate to the client sample rate
+	double mFileFramesPerFrame;
+
+	/// The semaphore used to wake the decode thread
+	DispatchSemaphore mDecodeSemaphore;
+	/// @c true if the decode thread should exit
+	std::atomic_bool mStopDecoding;
+
+	/// The frame position of the most recent seek request
+	alignas(sCacheLineSize) std::atomic_int64_t mSeekFrame;
+	/// Incremented by each seek request
+	std::atomic_uint64_t mSeekGeneration;
+
+	/// The seek generation for which the decode thread has stopped writing and repositioned the file
+	alignas(sCacheLineSize) std::atomic_uint64_t mFlushGeneration;
+	/// The frame position the decode thread repositioned the file to
+	std::atomic_int64_t mFlushFrame;
+	/// The seek generation in which the decode thread reached the end of the file
+	std::atomic_uint64_t mEndOfFileGeneration;
+
+	/// The seek generation whose audio is being read
+	alignas(sCacheLineSize) std::atomic_uint64_t mReadGeneration;
+	/// The frame position of the next read
+	std::atomic_int64_t mPosition;
+
+	/// The number of underruns
+	alignas(sCacheLineSize) std::atomic_uint64_t mUnderruns;
+	/// The number of frames of silence returned by underruns
+	std::atomic_uint64_t mUnderrunFrames;
+	/// The number of decode errors
+	std::atomic_uint64_t mDecodeErrors;
+
+	/// The decode thread
+	/// @note This is declared last so the thread starts after the other members are initialized
+	std::thread mDecodeThread;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <array>
+#import <cstdint>
+
+/// Set to a nonzero value to compile telemetry into ring buffers and recorders
+///
+/// When zero, the default, @c SFB::Telemetry has no members and all of its methods are empty so
+/// instrumented objects are the same size and speed as if they were not instrumented.
+#ifndef SFB_ENABLE_TELEMETRY
+#define SFB_ENABLE_TELEMETRY 0
+#endif
+
+#if SFB_ENABLE_TELEMETRY
+#import <algorithm>
+#import <atomic>
+#import <bit>
+#import <chrono>
+#import <limits>
+
+#import <os/signpost.h>
+#endif
+
+namespace SFB {
+
+/// A snapshot of the telemetry recorded for an object
+///
+/// Amounts and fill levels are in frames for audio buffers and in bytes for @c RingBuffer.
+struct TelemetryStatistics
+{
+	/// The number of histogram buckets for operation durations
+	static constexpr size_t sDurationBucketCount = 16;
+
+	/// The number of timed operations
+	uint64_t mOperations;
+	/// The number of operations that requested more than was available to read
+	uint64_t mUnderruns;
+	/// The total amount requested beyond what was available to read
+	uint64_t mUnderrunAmount;
+	/// The number of operations that requested more than there was space to write
+	uint64_t mOverruns;
+	/// The total amount requested beyond the space available to write
+	uint64_t mOverrunAmount;
+	/// The smallest fill level observed or @c 0 if none was observed
+	uint32_t mMinimumFillLevel;
+	/// The largest fill level observed
+	uint32_t mMaximumFillLevel;
+	/// Counts of operation durations
+	///
+	/// Bucket @c 0 counts operations shorter than 1 µs, bucket @c i counts operations lasting at least
+	/// 2<sup>i-1</sup> µs and less than 2<sup>i</sup> µs, and the last bucket also counts all longer operations.
+	std::array<uint64_t, sDurationBucketCount> mDurationHistogram;
+};
+
+#if SFB_ENABLE_TELEMETRY
+
+/// Lock-free counters describing the operation of a buffer or callback
+///
+/// Recording uses only relaxed atomic operations and never locks or allocates so it is safe from a real-time context.
+/// @c Statistics() and @c ResetStatistics() may be called from any thread. Each timed operation is also reported as an
+/// @c os_signpost interval for Instruments.
+///
+/// Telemetry is compiled in only if @c SFB_ENABLE_TELEMETRY is nonzero. Otherwise this class is empty, recording does
+/// nothing, and @c Statistics() returns zeroes.
+class Telemetry
+{
+
+public:
+
+	/// A scoped timed operation
+	///
+	/// The duration of the interval from construction to destruction is added to the histogram.
+	class Interval
+	{
+
+	public:
+
+		/// Begins timing an operation
+		/// @param telemetry The telemetry to record the duration
+		/// @param name The name of the operation reported with the signpost interval, which must have static storage duration
+		inline Interval(Telemetry& telemetry, const char * _Nonnull name) noexcept
+		: mTelemetry(telemetry), mSignpostID(os_signpost_id_make_with_pointer(telemetry.mLog, this)), mStart(std::chrono::steady_clock::now())
+		{
+			os_signpost_interval_begin(mTelemetry.mLog, mSignpostID, "Operation", "%{public}s", name);
+		}
+
+		// This class is non-copyable
+		Interval(const Interval& rhs) = delete;
+
+		// This class is non-assignable
+		Interval& operator=(const Interval& rhs) = delete;
+
+		/// Records the duration of the operation
+		inline ~Interval()
+		{
+			const auto duration = std::chrono::steady_clock::now() - mStart;
+			os_signpost_interval_end(mTelemetry.mLog, mSignpostID, "Operation");
+			mTelemetry.RecordDuration(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+		}
+
+	private:
+
+		/// The telemetry recording the duration
+		Telemetry& mTelemetry;
+		/// The signpost identifier of the interval
+		os_signpost_id_t mSignpostID;
+		/// The start of the interval
+		std::chrono::steady_clock::time_point mStart;
+
+	};
+
+	/// Creates a new @c Telemetry object with zeroed counters
+	/// @note This method is not safe to call from a real-time context
+	inline Telemetry() noexcept
+	: mLog(os_log_create("org.sbooth.AudioUtilities", "Telemetry"))
+	{
+		ResetStatistics();
+	}
+
+	// This class is non-copyable
+	Telemetry(const Telemetry& rhs) = delete;
+
+	// This class is non-assignable
+	Telemetry& operator=(const Telemetry& rhs) = delete;
+
+	/// Records an operation that requested more than was available to read
+	inline void RecordUnderrun(uint64_t amount) noexcept
+	{
+		mUnderruns.fetch_add(1, std::memory_order_relaxed);
+		mUnderrunAmount.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/// Records an operation that requested more than there was space to write
+	inline void RecordOverrun(uint64_t amount) noexcept
+	{
+		mOverruns.fetch_add(1, std::memory_order_relaxed);
+		mOverrunAmount.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/// Records an observed fill level
+	inline void RecordFillLevel(uint32_t fillLevel) noexcept
+	{
+		auto minimum = mMinimumFillLevel.load(std::memory_order_relaxed);
+		while(fillLevel < minimum && !mMinimumFillLevel.compare_exchange_weak(minimum, fillLevel, std::memory_order_relaxed))
+			;
+		auto maximum = mMaximumFillLevel.load(std::memory_order_relaxed);
+		while(fillLevel > maximum && !mMaximumFillLevel.compare_exchange_weak(maximum, fillLevel, std::memory_order_relaxed))
+			;
+	}
+
+	/// Records the duration of an operation
+	inline void RecordDuration(uint64_t nanoseconds) noexcept
+	{
+		const auto bucket = std::min(static_cast<size_t>(std::bit_width(nanoseconds / 1000)), TelemetryStatistics::sDurationBucketCount - 1);
+		mDurationHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+		mOperations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// Returns the recorded statistics
+	/// @note The counters are sampled individually so a snapshot taken during an operation may be partially updated
+	inline TelemetryStatistics Statistics() const noexcept
+	{
+		TelemetryStatistics statistics{
+			.mOperations = mOperations.load(std::memory_order_relaxed),
+			.mUnderruns = mUnderruns.load(std::memory_order_relaxed),
+			.mUnderrunAmount = mUnderrunAmount.load(std::memory_order_relaxed),
+			.mOverruns = mOverruns.load(std::memory_order_relaxed),
+			.mOverrunAmount = mOverrunAmount.load(std::memory_order_relaxed),
+			.mMinimumFillLevel = mMinimumFillLevel.load(std::memory_order_relaxed),
+			.mMaximumFillLevel = mMaximumFillLevel.load(std::memory_order_relaxed),
+			.mDurationHistogram = {},
+		};
+		if(statistics.mMinimumFillLevel == std::numeric_limits<uint32_t>::max())
+			statistics.mMinimumFillLevel = 0;
+		for(size_t i = 0; i < TelemetryStatistics::sDurationBucketCount; ++i)
+			statistics.mDurationHistogram[i] = mDurationHistogram[i].load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+	/// Resets the recorded statistics
+	inline void ResetStatistics() noexcept
+	{
+		mOperations.store(0, std::memory_order_relaxed);
+		mUnderruns.store(0, std::memory_order_relaxed);
+		mUnderrunAmount.store(0, std::memory_order_relaxed);
+		mOverruns.store(0, std::memory_order_relaxed);
+		mOverrunAmount.store(0, std::memory_order_relaxed);
+		mMinimumFillLevel.store(std::numeric_limits<uint32_t>::max(), std::memory_order_relaxed);
+		mMaximumFillLevel.store(0, std::memory_order_relaxed);
+		for(auto& bucket : mDurationHistogram)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+
+private:
+
+	/// The log used for signposts
+	os_log_t _Nonnull mLog;
+
+	/// The number of timed operations
+	std::atomic_uint64_t mOperations;
+	/// The number of underruns
+	std::atomic_uint64_t mUnderruns;
+	/// The total amount requested beyond what was available to read
+	std::atomic_uint64_t mUnderrunAmount;
+	/// The number of overruns
+	std::atomic_uint64_t mOverruns;
+	/// The total amount requested beyond the space available to write
+	std::atomic_uint64_t mOverrunAmount;
+	/// The smallest fill level observed
+	std::atomic_uint32_t mMinimumFillLevel;
+	/// The largest fill level observed
+	std::atomic_uint32_t mMaximumFillLevel;
+	/// Counts of operation durations
+	std::array<std::atomic_uint64_t, TelemetryStatistics::sDurationBucketCount> mDurationHistogram;
+
+};
+
+#else
+
+/// Lock-free counters describing the operation of a buffer or callback
+///
+/// Telemetry is compiled in only if @c SFB_ENABLE_TELEMETRY is nonzero. Otherwise this class is empty, recording does
+/// nothing, and @c Statistics() returns zeroes.
+class Telemetry
+{
+
+public:
+
+	/// A scoped timed operation
+	class Interval
+	{
+
+	public:
+
+		/// Does nothing
+		inline Interval(Telemetry&, const char * _Nonnull) noexcept
+		{}
+
+		// This class is non-copyable
+		Interval(const Interval& rhs) = delete;
+
+		// This class is non-assignable
+		Interval& operator=(const Interval& rhs) = delete;
+
+	};
+
+	/// Creates a new @c Telemetry object
+	inline Telemetry() noexcept = default;
+
+	// This class is non-copyable
+	Telemetry(const Telemetry& rhs) = delete;
+
+	// This class is non-assignable
+	Telemetry& operator=(const Telemetry& rhs) = delete;
+
+	/// Does nothing
+	inline void RecordUnderrun(uint64_t) noexcept
+	{}
+
+	/// Does nothing
+	inline void RecordOverrun(uint64_t) noexcept
+	{}
+
+	/// Does nothing
+	inline void RecordFillLevel(uint32_t) noexcept
+	{}
+
+	/// Does nothing
+	inline void RecordDuration(uint64_t) noexcept
+	{}
+
+	/// Returns zeroed statistics
+	inline TelemetryStatistics Statistics() const noexcept
+	{
+		return {};
+	}
+
+	/// Does nothing
+	inline void ResetStatistics() noexcept
+	{}
+
+};
+
+#endif
+
+} // namespace SFB
@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <algorithm>
+#import <atomic>
+#import <cstdint>
+#import <span>
+#import <type_traits>
+#import <utility>
+
+namespace SFB {
+
+/// A ring buffer of @c T with a compile-time capacity and inline storage.
+///
+/// Because the capacity is a constant no allocation is performed and the object may be embedded in real-time objects.
+/// One element of capacity is reserved to distinguish a full buffer from an empty one, so at most @c Capacity-1
+/// elements may be stored at once.
+///
+/// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer model).
+///
+/// The read and write routines are split into two groups:
+///   - Reader-only methods: @c Read, @c Peek, @c ReadVector, @c AdvanceReadPosition
+///   - Writer-only methods: @c Write, @c WriteVector, @c AdvanceWritePosition
+/// @tparam T The element type, which must be trivially copyable
+/// @tparam Capacity The capacity in elements, which must be a power of two from 2 to 2,147,483,648 (0x80000000)
+template <typename T, uint32_t Capacity>
+class TypedRingBuffer
+{
+
+	static_assert(std::is_trivially_copyable_v<T>, "TypedRingBuffer elements must be trivially copyable");
+	static_assert(Capacity >= 2 && Capacity <= 0x80000000, "TypedRingBuffer capacity must be from 2 to 0x80000000");
+	static_assert((Capacity & (Capacity - 1)) == 0, "TypedRingBuffer capacity must be a power of two");
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new, empty @c TypedRingBuffer
+	TypedRingBuffer() noexcept
+	: mWritePosition(0), mCachedReadPosition(0), mReadPosition(0), mCachedWritePosition(0)
+	{
+		static_assert(std::atomic_uint32_t::is_always_lock_free);
+	}
+
+	// This class is non-copyable
+	TypedRingBuffer(const TypedRingBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	TypedRingBuffer& operator=(const TypedRingBuffer& rhs) = delete;
+
+	/// Destroys the @c TypedRingBuffer
+	~TypedRingBuffer() = default;
+
+	// This class is non-movable
+	TypedRingBuffer(TypedRingBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	TypedRingBuffer& operator=(TypedRingBuffer&& rhs) = delete;
+
+#pragma mark Buffer management
+
+	/// Resets this @c TypedRingBuffer to its default state.
+	/// @note This method is not thread safe.
+	void Reset() noexcept
+	{
+		mWritePosition.store(0, std::memory_order_relaxed);
+		mCachedReadPosition = 0;
+		mReadPosition.store(0, std::memory_order_relaxed);
+		mCachedWritePosition = 0;
+	}
+
+	/// Returns the capacity of this @c TypedRingBuffer in elements
+	static constexpr uint32_t CapacityElements() noexcept
+	{
+		return Capacity;
+	}
+
+	/// Returns the number of elements available for reading
+	uint32_t ElementsAvailableToRead() const noexcept
+	{
+		return (mWritePosition.load(std::memory_order_acquire) - mReadPosition.load(std::memory_order_acquire)) & sCapacityMask;
+	}
+
+	/// Returns the free space available for writing in elements
+	uint32_t ElementsAvailableToWrite() const noexcept
+	{
+		return (mReadPosition.load(std::memory_order_acquire) - mWritePosition.load(std::memory_order_acquire) - 1) & sCapacityMask;
+	}
+
+#pragma mark Reading and writing elements
+
+	/// Read elements from the @c TypedRingBuffer, advancing the read pointer.
+	/// @param destination A span to receive the elements
+	/// @return The number of elements actually read
+	uint32_t Read(std::span<T> destination) noexcept
+	{
+		const auto count = Peek(destination);
+		if(count > 0)
+			mReadPosition.store((mReadPosition.load(std::memory_order_relaxed) + count) & sCapacityMask, std::memory_order_release);
+		return count;
+	}
+
+	/// Read a single element from the @c TypedRingBuffer, advancing the read pointer.
+	/// @param element The destination element
+	/// @return @c true if an element was read, @c false if the buffer is empty
+	bool Read(T& element) noexcept
+	{
+		return Read(std::span<T>(&element, 1)) == 1;
+	}
+
+	/// Read elements from the @c TypedRingBuffer without advancing the read pointer.
+	/// @param destination A span to receive the elements
+	/// @return The number of elements actually read
+	uint32_t Peek(std::span<T> destination) const noexcept
+	{
+		const auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+		const auto wanted = static_cast<uint32_t>(std::min(destination.size(), static_cast<size_t>(Capacity)));
+		const auto count = std::min(wanted, ReadableCount(readPosition, wanted));
+		if(count == 0)
+			return 0;
+
+		const auto firstCount = std::min(count, Capacity - readPosition);
+		std::copy_n(mBuffer + readPosition, firstCount, destination.data());
+		std::copy_n(mBuffer, count - firstCount, destination.data() + firstCount);
+
+		return count;
+	}
+
+	/// Write elements to the @c TypedRingBuffer, advancing the write pointer.
+	/// @param source A span containing the elements to copy
+	/// @return The number of elements actually written
+	uint32_t Write(std::span<const T> source) noexcept
+	{
+		const auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+		const auto wanted = static_cast<uint32_t>(std::min(source.size(), static_cast<size_t>(Capacity)));
+		const auto count = std::min(wanted, WritableCount(writePosition, wanted));
+		if(count == 0)
+			return 0;
+
+		const auto firstCount = std::min(count, Capacity - writePosition);
+		std::copy_n(source.data(), firstCount, mBuffer + writePosition);
+		std::copy_n(source.data() + firstCount, count - firstCount, mBuffer);
+
+		mWritePosition.store((writePosition + count) & sCapacityMask, std::memory_order_release);
+
+		return count;
+	}
+
+	/// Write a single element to the @c TypedRingBuffer, advancing the write pointer.
+	/// @param element The element to copy
+	/// @return @c true if the element was written, @c false if the buffer is full
+	bool Write(const T& element) noexcept
+	{
+		return Write(std::span<const T>(&element, 1)) == 1;
+	}
+
+
+	/// Advance the read position by the specified number of elements
+	void AdvanceReadPosition(uint32_t count) noexcept
+	{
+		mReadPosition.store((mReadPosition.load(std::memory_order_relaxed) + count) & sCapacityMask, std::memory_order_release);
+	}
+
+	/// Advance the write position by the specified number of elements
+	void AdvanceWritePosition(uint32_t count) noexcept
+	{
+		mWritePosition.store((mWritePosition.load(std::memory_order_relaxed) + count) & sCapacityMask, std::memory_order_release);
+	}
+
+
+	/// A pair of read-only spans
+	using ReadVectorPair = std::pair<std::span<const T>, std::span<const T>>;
+
+	/// Returns the read vector containing the current readable elements
+	const ReadVectorPair ReadVector() const noexcept
+	{
+		const auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+		mCachedWritePosition = mWritePosition.load(std::memory_order_acquire);
+		const auto count = (mCachedWritePosition - readPosition) & sCapacityMask;
+
+		const auto firstCount = std::min(count, Capacity - readPosition);
+		return { std::span<const T>(mBuffer + readPosition, firstCount), std::span<const T>(mBuffer, count - firstCount) };
+	}
+
+	/// A pair of writable spans
+	using WriteVectorPair = std::pair<std::span<T>, std::span<T>>;
+
+	/// Returns the write vector containing the current writable space
+	const WriteVectorPair WriteVector() noexcept
+	{
+		const auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+		mCachedReadPosition = mReadPosition.load(std::memory_order_acquire);
+		const auto count = (mCachedReadPosition - writePosition - 1) & sCapacityMask;
+
+		const auto firstCount = std::min(count, Capacity - writePosition);
+		return { std::span<T>(mBuffer + writePosition, firstCount), std::span<T>(mBuffer, count - firstCount) };
+	}
+
+private:
+
+	/// The assumed size of a cache line, in bytes
+	/// @note 128 bytes matches the cache line size of Apple silicon and covers adjacent-line prefetching on x86-64
+	static constexpr size_t sCacheLineSize = 128;
+
+	/// Mask used to wrap read and write positions
+	static constexpr uint32_t sCapacityMask = Capacity - 1;
+
+	/// Returns the number of elements available for reading, refreshing the cached write position if fewer than @c wanted are known to be available
+	uint32_t ReadableCount(uint32_t readPosition, uint32_t wanted) const noexcept
+	{
+		auto count = (mCachedWritePosition - readPosition) & sCapacityMask;
+		if(count < wanted) {
+			mCachedWritePosition = mWritePosition.load(std::memory_order_acquire);
+			count = (mCachedWritePosition - readPosition) & sCapacityMask;
+		}
+		return count;
+	}
+
+	/// Returns the number of elements available for writing, refreshing the cached read position if fewer than @c wanted are known to be available
+	uint32_t WritableCount(uint32_t writePosition, uint32_t wanted) const noexcept
+	{
+		auto count = (mCachedReadPosition - writePosition - 1) & sCapacityMask;
+		if(count < wanted) {
+			mCachedReadPosition = mReadPosition.load(std::memory_order_acquire);
+			count = (mCachedReadPosition - writePosition - 1) & sCapacityMask;
+		}
+		return count;
+	}
+
+	// The write and read positions are placed on separate cache lines so the producer and consumer
+	// don't contend for the same line. Each side also keeps a local copy of the other side's position
+	// which is only refreshed when it indicates insufficient space or data.
+
+	/// The index into @c mBuffer of the write location
+	alignas(sCacheLineSize) std::atomic_uint32_t mWritePosition;
+	/// The writer's most recently observed value of @c mReadPosition
+	mutable uint32_t mCachedReadPosition;
+
+	/// The index into @c mBuffer of the read location
+	alignas(sCacheLineSize) std::atomic_uint32_t mReadPosition;
+	/// The reader's most recently observed value of @c mWritePosition
+	mutable uint32_t mCachedWritePosition;
+
+	/// The elements
+	alignas(sCacheLineSize) T mBuffer[Capacity];
+
+};
+
+} // namespace SFB
@@ -0,0 +1,330 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <atomic>
+#import <functional>
+#import <utility>
+
+#import <dispatch/dispatch.h>
+
+#import "SFBAudioRingBuffer.hpp"
+#import "SFBDispatchSemaphore.hpp"
+#import "SFBRingBuffer.hpp"
+
+namespace SFB {
+
+/// Describes how a @c WaitableRingBuffer measures the contents of its underlying ring buffer
+template <typename T>
+struct WaitableRingBufferTraits;
+
+/// @c WaitableRingBuffer traits for @c RingBuffer, measured in bytes
+template <>
+struct WaitableRingBufferTraits<RingBuffer> {
+	/// Returns the number of bytes available for reading
+	static inline uint32_t AvailableToRead(const RingBuffer& ringBuffer) noexcept { return ringBuffer.BytesAvailableToRead(); }
+	/// Returns the number of bytes available for writing
+	static inline uint32_t AvailableToWrite(const RingBuffer& ringBuffer) noexcept { return ringBuffer.BytesAvailableToWrite(); }
+	/// Returns the capacity in bytes
+	static inline uint32_t Capacity(const RingBuffer& ringBuffer) noexcept { return ringBuffer.CapacityBytes(); }
+};
+
+/// @c WaitableRingBuffer traits for @c AudioRingBuffer, measured in frames
+template <>
+struct WaitableRingBufferTraits<AudioRingBuffer> {
+	/// Returns the number of frames available for reading
+	static inline uint32_t AvailableToRead(const AudioRingBuffer& ringBuffer) noexcept { return ringBuffer.FramesAvailableToRead(); }
+	/// Returns the number of frames available for writing
+	static inline uint32_t AvailableToWrite(const AudioRingBuffer& ringBuffer) noexcept { return ringBuffer.FramesAvailableToWrite(); }
+	/// Returns the capacity in frames
+	static inline uint32_t Capacity(const AudioRingBuffer& ringBuffer) noexcept { return ringBuffer.CapacityFrames(); }
+};
+
+/// A ring buffer facade allowing a non-real-time thread to block until data or space is available.
+///
+/// Reads and writes are forwarded to the underlying ring buffer. A reader may call @c WaitForReadable() to block
+/// until a minimum amount of data is available and a writer may call @c WaitForWritable() to block until a
+/// minimum amount of space is available. The opposite side remains wait-free: after each transfer it performs a
+/// fence and an atomic load, and only signals the semaphore when a waiter is present and its threshold has been reached.
+///
+/// Optional watermark callbacks are invoked when the fill level rises to the high watermark after a write or falls
+/// to the low watermark after a read. Callbacks are invoked on the thread performing the transfer so they must be
+/// real-time safe if that thread is a real-time thread.
+///
+/// Amounts are measured in bytes for @c RingBuffer and in frames for @c AudioRingBuffer.
+///
+/// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer model).
+/// @note The watermark setters are not thread safe.
+template <typename T, typename Traits = WaitableRingBufferTraits<T>>
+class WaitableRingBuffer
+{
+
+public:
+
+	/// A watermark callback receiving the fill level
+	using WatermarkCallback = std::function<void(uint32_t)>;
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new @c WaitableRingBuffer
+	/// @note @c Allocate() must be called before the object may be used.
+	/// @throw @c std::runtime_error If the semaphores could not be created
+	WaitableRingBuffer()
+	: mReadSemaphore(0), mWriteSemaphore(0), mReadThreshold(0), mWriteThreshold(0), mLowWatermark(0), mHighWatermark(0)
+	{}
+
+	// This class is non-copyable
+	WaitableRingBuffer(const WaitableRingBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	WaitableRingBuffer& operator=(const WaitableRingBuffer& rhs) = delete;
+
+	/// Destroys the @c WaitableRingBuffer and release all associated resources.
+	~WaitableRingBuffer() = default;
+
+	// This class is non-movable
+	WaitableRingBuffer(WaitableRingBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	WaitableRingBuffer& operator=(WaitableRingBuffer&& rhs) = delete;
+
+#pragma mark Buffer management
+
+	/// Allocates the underlying ring buffer
+	/// @note This method is not thread safe.
+	/// @param args The arguments to pass to the underlying ring buffer's @c Allocate()
+	/// @return @c true on success, @c false on error
+	template <typename... Args>
+	inline bool Allocate(Args&&... args) noexcept
+	{
+		return mRingBuffer.Allocate(std::forward<Args>(args)...);
+	}
+
+	/// Frees the resources used by the underlying ring buffer
+	/// @note This method is not thread safe.
+	inline void Deallocate() noexcept
+	{
+		mRingBuffer.Deallocate();
+	}
+
+	/// Resets the underlying ring buffer to its default state.
+	/// @note This method is not thread safe.
+	inline void Reset() noexcept
+	{
+		mRingBuffer.Reset();
+	}
+
+	/// Returns the underlying ring buffer
+	/// @note Transfers performed directly on the underlying ring buffer must be reported using @c DidRead() or @c DidWrite()
+	inline T& Buffer() noexcept
+	{
+		return mRingBuffer;
+	}
+
+	/// Returns the underlying ring buffer
+	inline const T& Buffer() const noexcept
+	{
+		return mRingBuffer;
+	}
+
+	/// Returns the amount available for reading
+	inline uint32_t AvailableToRead() const noexcept
+	{
+		return Traits::AvailableToRead(mRingBuffer);
+	}
+
+	/// Returns the amount available for writing
+	inline uint32_t AvailableToWrite() const noexcept
+	{
+		return Traits::AvailableToWrite(mRingBuffer);
+	}
+
+#pragma mark Watermarks
+
+	/// Sets the low watermark and the callback to invoke when the fill level falls to or below it after a read
+	/// @note This method is not thread safe.
+	/// @param level The low watermark
+	/// @param callback The callback to invoke or @c nullptr for none
+	inline void SetLowWatermark(uint32_t level, WatermarkCallback callback) noexcept
+	{
+		mLowWatermark = level;
+		mLowWatermarkCallback = std::move(callback);
+	}
+
+	/// Sets the high watermark and the callback to invoke when the fill level rises to or above it after a write
+	/// @note This method is not thread safe.
+	/// @param level The high watermark
+	/// @param callback The callback to invoke or @c nullptr for none
+	inline void SetHighWatermark(uint32_t level, WatermarkCallback callback) noexcept
+	{
+		mHighWatermark = level;
+		mHighWatermarkCallback = std::move(callback);
+	}
+
+#pragma mark Reading and writing
+
+	/// Reads from the underlying ring buffer and wakes a waiting writer if sufficient space has become available
+	/// @param args The arguments to pass to the underlying ring buffer's @c Read()
+	/// @return The amount actually read
+	template <typename... Args>
+	inline uint32_t Read(Args&&... args) noexcept
+	{
+		const auto count = mRingBuffer.Read(std::forward<Args>(args)...);
+		DidRead(count);
+		return count;
+	}
+
+	/// Writes to the underlying ring buffer and wakes a waiting reader if sufficient data has become available
+	/// @param args The arguments to pass to the underlying ring buffer's @c Write()
+	/// @return The amount actually written
+	template <typename... Args>
+	inline uint32_t Write(Args&&... args) noexcept
+	{
+		const auto count = mRingBuffer.Write(std::forward<Args>(args)...);
+		DidWrite(count);
+		return count;
+	}
+
+	/// Notifies waiters and watermark callbacks of a read performed directly on the underlying ring buffer
+	/// @note This method is wait-free
+	/// @param count The amount read
+	void DidRead(uint32_t count) noexcept
+	{
+		if(count == 0)
+			return;
+
+		const auto available = Notify(mWriteThreshold, mWriteSemaphore, Traits::AvailableToWrite(mRingBuffer));
+		if(mLowWatermarkCallback) {
+			const auto level = Traits::Capacity(mRingBuffer) - 1 - available;
+			if(level <= mLowWatermark && level + count > mLowWatermark)
+				mLowWatermarkCallback(level);
+		}
+	}
+
+	/// Notifies waiters and watermark callbacks of a write performed directly on the underlying ring buffer
+	/// @note This method is wait-free
+	/// @param count The amount written
+	void DidWrite(uint32_t count) noexcept
+	{
+		if(count == 0)
+			return;
+
+		const auto level = Notify(mReadThreshold, mReadSemaphore, Traits::AvailableToRead(mRingBuffer));
+		if(mHighWatermarkCallback) {
+			if(level >= mHighWatermark && (level < count || level - count < mHighWatermark))
+				mHighWatermarkCallback(level);
+		}
+	}
+
+#pragma mark Waiting
+
+	/// Blocks until at least @c count is available for reading or @c deadline passes
+	/// @note This method must not be called from a real-time thread
+	/// @param count The desired amount
+	/// @param deadline The time at which to stop waiting, for example @c dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_MSEC)
+	/// @return @c true if at least @c count is available for reading, @c false if the deadline passed or @c count exceeds the capacity
+	inline bool WaitForReadable(uint32_t count, dispatch_time_t deadline = DISPATCH_TIME_FOREVER) noexcept
+	{
+		return Wait(count, deadline, mReadThreshold, mReadSemaphore, [this] { return Traits::AvailableToRead(mRingBuffer); });
+	}
+
+	/// Blocks until at least @c count is available for writing or @c deadline passes
+	/// @note This method must not be called from a real-time thread
+	/// @param count The desired amount
+	/// @param deadline The time at which to stop waiting, for example @c dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_MSEC)
+	/// @return @c true if at least @c count is available for writing, @c false if the deadline passed or @c count exceeds the capacity
+	inline bool WaitForWritable(uint32_t count, dispatch_time_t deadline = DISPATCH_TIME_FOREVER) noexcept
+	{
+		return Wait(count, deadline, mWriteThreshold, mWriteSemaphore, [this] { return Traits::AvailableToWrite(mRingBuffer); });
+	}
+
+private:
+
+	/// Signals @c semaphore if a waiter's threshold has been reached
+	/// @param threshold The waiter's threshold, or zero if there is no waiter
+	/// @param semaphore The waiter's semaphore
+	/// @param available The amount available to the waiter
+	/// @return @c available
+	static uint32_t Notify(std::atomic_uint32_t& threshold, DispatchSemaphore& semaphore, uint32_t available) noexcept
+	{
+		// Order the preceding position update before the load of the threshold
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto waitingFor = threshold.load(std::memory_order_relaxed);
+		if(waitingFor != 0 && available >= waitingFor && threshold.compare_exchange_strong(waitingFor, 0, std::memory_order_relaxed))
+			semaphore.Signal();
+		return available;
+	}
+
+	/// Blocks until @c available() returns at least @c count or @c deadline passes
+	template <typename F>
+	bool Wait(uint32_t count, dispatch_time_t deadline, std::atomic_uint32_t& threshold, DispatchSemaphore& semaphore, F available) noexcept
+	{
+		if(count == 0)
+			return true;
+
+		if(count >= Traits::Capacity(mRingBuffer))
+			return false;
+
+		for(;;) {
+			if(available() >= count)
+				return true;
+
+			threshold.store(count, std::memory_order_relaxed);
+			// Order the store of the threshold before the load of the position
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if(available() >= count) {
+				Disarm(threshold, semaphore);
+				return true;
+			}
+
+			if(!semaphore.Wait(deadline)) {
+				Disarm(threshold, semaphore);
+				return available() >= count;
+			}
+		}
+	}
+
+	/// Clears @c threshold, consuming a signal that raced with the clear
+	static void Disarm(std::atomic_uint32_t& threshold, DispatchSemaphore& semaphore) noexcept
+	{
+		// If the threshold was already cleared the other side has signaled or is about to
+		if(threshold.exchange(0, std::memory_order_relaxed) == 0)
+			semaphore.Wait();
+	}
+
+	/// The underlying ring buffer
+	T mRingBuffer;
+
+	/// The semaphore used to wake a waiting reader
+	DispatchSemaphore mReadSemaphore;
+	/// The semaphore used to wake a waiting writer
+	DispatchSemaphore mWriteSemaphore;
+
+	/// The amount a waiting reader requires, or zero if no reader is waiting
+	std::atomic_uint32_t mReadThreshold;
+	/// The amount a waiting writer requires, or zero if no writer is waiting
+	std::atomic_uint32_t mWriteThreshold;
+
+	/// The low watermark
+	uint32_t mLowWatermark;
+	/// The callback invoked when the fill level falls to the low watermark
+	WatermarkCallback mLowWatermarkCallback;
+	/// The high watermark
+	uint32_t mHighWatermark;
+	/// The callback invoked when the fill level rises to the high watermark
+	WatermarkCallback mHighWatermarkCallback;
+
+};
+
+/// A @c WaitableRingBuffer wrapping a @c RingBuffer
+using WaitableByteRingBuffer = WaitableRingBuffer<RingBuffer>;
+
+/// A @c WaitableRingBuffer wrapping an @c AudioRingBuffer
+using WaitableAudioRingBuffer = WaitableRingBuffer<AudioRingBuffer>;
+
+} // namespace SFB
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cstdint>
+#import <cstring>
+#import <vector>
+
+#import "SFBAudioInterleaving.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// Returns a byte identifying position @c i of @c channel
+inline uint8_t SampleByte(uint32_t channel, uint32_t i) noexcept
+{
+	return static_cast<uint8_t>(channel * 37 + i * 11 + 1);
+}
+
+/// Interleaves and deinterleaves a layout and compares the results with a straightforward implementation
+bool RoundTrips(uint32_t channelCount, uint32_t bytesPerSample, uint32_t frameCount)
+{
+	const auto channelBytes = bytesPerSample * frameCount;
+
+	std::vector<std::vector<uint8_t>> channels(channelCount, std::vector<uint8_t>(channelBytes));
+	std::vector<uint8_t> expected(channelCount * channelBytes);
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		for(uint32_t i = 0; i < channelBytes; ++i)
+			channels[channel][i] = SampleByte(channel, i);
+		for(uint32_t frame = 0; frame < frameCount; ++frame)
+			std::memcpy(expected.data() + (frame * channelCount + channel) * bytesPerSample, channels[channel].data() + frame * bytesPerSample, bytesPerSample);
+	}
+
+	// The extra byte detects writes past the end of the interleaved buffer
+	std::vector<uint8_t> interleaved(expected.size() + 1, 0xee);
+	SFB::AudioInterleaving::Interleave(interleaved.data(), [&](uint32_t channel) -> const uint8_t * {
+		return channels[channel].data();
+	}, channelCount, bytesPerSample, frameCount);
+
+	if(!std::equal(expected.begin(), expected.end(), interleaved.begin()) || interleaved.back() != 0xee)
+		return false;
+
+	std::vector<std::vector<uint8_t>> deinterleaved(channelCount, std::vector<uint8_t>(channelBytes + 1, 0xee));
+	SFB::AudioInterleaving::Deinterleave([&](uint32_t channel) -> uint8_t * {
+		return deinterleaved[channel].data();
+	}, interleaved.data(), channelCount, bytesPerSample, frameCount);
+
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		if(!std::equal(channels[channel].begin(), channels[channel].end(), deinterleaved[channel].begin()) || deinterleaved[channel].back() != 0xee)
+			return false;
+	}
+
+	return true;
+}
+
+/// Every combination of the vectorized and scalar layouts, including frame counts with partial vectors
+void TestLayouts()
+{
+	constexpr uint32_t sampleSizes [] = { 1, 2, 3, 4, 5, 8 };
+	constexpr uint32_t frameCounts [] = { 0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 63, 64, 65, 1000 };
+
+	for(uint32_t channelCount = 1; channelCount <= 9; ++channelCount) {
+		for(auto bytesPerSample : sampleSizes) {
+			for(auto frameCount : frameCounts) {
+				const auto success = RoundTrips(channelCount, bytesPerSample, frameCount);
+				if(!success)
+					std::fprintf(stderr, "%u channels, %u bytes per sample, %u frames\n", channelCount, bytesPerSample, frameCount);
+				SFB_CHECK(success);
+			}
+		}
+	}
+}
+
+} // namespace
+
+int main()
+{
+	TestLayouts();
+	return SFB::Test::ExitStatus();
+}
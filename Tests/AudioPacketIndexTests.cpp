@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <array>
+#import <cstdint>
+#import <vector>
+
+#import "SFBAudioPacketIndex.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// Appends @c value to @c bytes in little-endian byte order
+template <typename T>
+void AppendLE(std::vector<uint8_t>& bytes, T value)
+{
+	for(size_t i = 0; i < sizeof value; ++i)
+		bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+/// Appends @c value to @c bytes as an unsigned LEB128 variable-length integer
+void AppendVarint(std::vector<uint8_t>& bytes, uint64_t value)
+{
+	while(value >= 0x80) {
+		bytes.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(static_cast<uint8_t>(value));
+}
+
+/// The header of a sidecar representation
+struct SidecarHeader
+{
+	uint64_t mPacketCount;
+	uint32_t mBytesPerPacket;
+	uint32_t mFramesPerPacket;
+	uint32_t mMaximumPacketSize;
+	uint64_t mValidFrames;
+	uint32_t mPrimingFrames;
+	uint32_t mRemainderFrames;
+	uint64_t mAudioDataByteCount;
+};
+
+/// Returns a sidecar representation built independently of @c AudioPacketIndex::Serialize()
+std::vector<uint8_t> MakeSidecar(const SidecarHeader& header, const std::vector<uint64_t>& deltas, uint32_t version = 1)
+{
+	std::vector<uint8_t> bytes;
+	AppendLE(bytes, uint32_t{'SFPI'});
+	AppendLE(bytes, version);
+	AppendLE(bytes, header.mPacketCount);
+	AppendLE(bytes, header.mBytesPerPacket);
+	AppendLE(bytes, header.mFramesPerPacket);
+	AppendLE(bytes, header.mMaximumPacketSize);
+	AppendLE(bytes, header.mValidFrames);
+	AppendLE(bytes, header.mPrimingFrames);
+	AppendLE(bytes, header.mRemainderFrames);
+	AppendLE(bytes, header.mAudioDataByteCount);
+	for(auto delta : deltas)
+		AppendVarint(bytes, delta);
+	return bytes;
+}
+
+/// Packets of varying size with a constant number of frames, as in AAC
+void TestVariableBytesPerPacket()
+{
+	// Sizes above 127 bytes need two bytes when encoded
+	const SidecarHeader header = { 4, 0, 1024, 300, 3900, 100, 96, 650 };
+	const auto sidecar = MakeSidecar(header, { 100, 200, 50, 300 });
+
+	SFB::AudioPacketIndex index;
+	SFB_CHECK(index.IsEmpty());
+	SFB_CHECK(index.Deserialize(sidecar.data(), sidecar.size()));
+	SFB_CHECK(!index.IsEmpty());
+	SFB_CHECK(index.PacketCount() == 4);
+	SFB_CHECK(index.FrameLength() == 3900);
+	SFB_CHECK(index.PrimingFrames() == 100);
+	SFB_CHECK(index.RemainderFrames() == 96);
+	SFB_CHECK(index.MaximumPacketSize() == 300);
+	SFB_CHECK(index.PacketFrameCount(2) == 1024);
+	SFB_CHECK(index.PacketFrameCount(4) == 0);
+
+	// Frame positions exclude the priming frames
+	SFB::AudioPacketIndex::Location location;
+	SFB_CHECK(index.Locate(0, location));
+	SFB_CHECK(location.mPacket == 0 && location.mFrameOffset == 100 && location.mByteOffset == 0 && location.mByteSize == 100);
+	SFB_CHECK(index.Locate(924, location));
+	SFB_CHECK(location.mPacket == 1 && location.mFrameOffset == 0 && location.mByteOffset == 100 && location.mByteSize == 200);
+	SFB_CHECK(index.Locate(3899, location));
+	SFB_CHECK(location.mPacket == 3 && location.mFrameOffset == 927 && location.mByteOffset == 350 && location.mByteSize == 300);
+	SFB_CHECK(!index.Locate(3900, location));
+	SFB_CHECK(!index.Locate(-1, location));
+
+	// Descriptions are relative to the first packet described
+	std::array<AudioStreamPacketDescription, 8> descriptions{};
+	SFB_CHECK(index.PacketDescriptions(1, 8, descriptions.data()) == 3);
+	SFB_CHECK(descriptions[0].mStartOffset == 0 && descriptions[0].mDataByteSize == 200);
+	SFB_CHECK(descriptions[1].mStartOffset == 200 && descriptions[1].mDataByteSize == 50);
+	SFB_CHECK(descriptions[2].mStartOffset == 250 && descriptions[2].mDataByteSize == 300);
+	SFB_CHECK(descriptions[2].mVariableFramesInPacket == 0);
+
+	SFB_CHECK(index.Serialize() == sidecar);
+}
+
+/// Packets of constant size with a varying number of frames
+void TestVariableFramesPerPacket()
+{
+	const SidecarHeader header = { 3, 4, 0, 4, 700, 0, 0, 12 };
+	const auto sidecar = MakeSidecar(header, { 100, 500, 100 });
+
+	SFB::AudioPacketIndex index;
+	SFB_CHECK(index.Deserialize(sidecar.data(), sidecar.size()));
+	SFB_CHECK(index.PacketCount() == 3);
+	SFB_CHECK(index.PacketFrameCount(1) == 500);
+
+	SFB::AudioPacketIndex::Location location;
+	SFB_CHECK(index.Locate(99, location));
+	SFB_CHECK(location.mPacket == 0 && location.mFrameOffset == 99);
+	SFB_CHECK(index.Locate(100, location));
+	SFB_CHECK(location.mPacket == 1 && location.mFrameOffset == 0 && location.mByteOffset == 4 && location.mByteSize == 4);
+	SFB_CHECK(index.Locate(650, location));
+	SFB_CHECK(location.mPacket == 2 && location.mFrameOffset == 50 && location.mByteOffset == 8);
+	SFB_CHECK(!index.Locate(700, location));
+
+	std::array<AudioStreamPacketDescription, 3> descriptions{};
+	SFB_CHECK(index.PacketDescriptions(0, 3, descriptions.data()) == 3);
+	SFB_CHECK(descriptions[1].mVariableFramesInPacket == 500);
+
+	SFB_CHECK(index.Serialize() == sidecar);
+
+	// A copy reloaded from its own serialization is identical
+	const auto serialized = index.Serialize();
+	SFB::AudioPacketIndex reloaded;
+	SFB_CHECK(reloaded.Deserialize(serialized.data(), serialized.size()));
+	SFB_CHECK(reloaded.Serialize() == serialized);
+}
+
+/// Malformed sidecars are rejected and leave the index unchanged
+void TestInvalidSidecars()
+{
+	const SidecarHeader header = { 4, 0, 1024, 300, 3900, 100, 96, 650 };
+	const std::vector<uint64_t> deltas = { 100, 200, 50, 300 };
+	const auto sidecar = MakeSidecar(header, deltas);
+
+	SFB::AudioPacketIndex index;
+	SFB_CHECK(index.Deserialize(sidecar.data(), sidecar.size()));
+
+	auto truncated = sidecar;
+	truncated.pop_back();
+	SFB_CHECK(!index.Deserialize(truncated.data(), truncated.size()));
+
+	auto extended = sidecar;
+	extended.push_back(0);
+	SFB_CHECK(!index.Deserialize(extended.data(), extended.size()));
+
+	auto badMagic = sidecar;
+	badMagic[0] ^= 0xff;
+	SFB_CHECK(!index.Deserialize(badMagic.data(), badMagic.size()));
+
+	const auto badVersion = MakeSidecar(header, deltas, 2);
+	SFB_CHECK(!index.Deserialize(badVersion.data(), badVersion.size()));
+
+	// More valid frames than the packets contain
+	auto tooLong = header;
+	tooLong.mValidFrames = 4000;
+	const auto tooLongSidecar = MakeSidecar(tooLong, deltas);
+	SFB_CHECK(!index.Deserialize(tooLongSidecar.data(), tooLongSidecar.size()));
+
+	// A packet count exceeding the data present
+	auto tooMany = header;
+	tooMany.mPacketCount = 1000000;
+	const auto tooManySidecar = MakeSidecar(tooMany, deltas);
+	SFB_CHECK(!index.Deserialize(tooManySidecar.data(), tooManySidecar.size()));
+
+	SFB_CHECK(!index.Deserialize(sidecar.data(), 0));
+
+	SFB_CHECK(index.PacketCount() == 4);
+	SFB_CHECK(index.Serialize() == sidecar);
+}
+
+} // namespace
+
+int main()
+{
+	TestVariableBytesPerPacket();
+	TestVariableFramesPerPacket();
+	TestInvalidSidecars();
+	return SFB::Test::ExitStatus();
+}
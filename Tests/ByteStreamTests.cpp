@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <array>
+#import <cstdint>
+
+#import <libkern/OSByteOrder.h>
+
+#import "SFBByteStream.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// A RIFF chunk header
+struct ChunkHeader
+{
+	char mID[4];
+	uint32_t mSize;
+};
+
+using ChunkHeaderLayout = SFB::ByteStream::Layout<ChunkHeader, SFB::ByteStream::Field<&ChunkHeader::mID>, SFB::ByteStream::FieldLE<&ChunkHeader::mSize>>;
+
+/// A structure with mixed byte orders and a signed field
+struct Mixed
+{
+	uint16_t mLittle;
+	uint32_t mBig;
+	int8_t mSigned;
+};
+
+using MixedLayout = SFB::ByteStream::Layout<Mixed, SFB::ByteStream::FieldLE<&Mixed::mLittle>, SFB::ByteStream::FieldBE<&Mixed::mBig>, SFB::ByteStream::Field<&Mixed::mSigned>>;
+
+static_assert(ChunkHeaderLayout::sSize == 8);
+static_assert(MixedLayout::sSize == 7);
+
+// Layouts decode in constant expressions
+constexpr std::array<uint8_t, 7> sMixedBytes = { 0x34, 0x12, 0x01, 0x02, 0x03, 0x04, 0xff };
+static_assert(MixedLayout::Decode(sMixedBytes).mLittle == 0x1234);
+static_assert(MixedLayout::Decode(sMixedBytes).mBig == 0x01020304);
+static_assert(MixedLayout::Decode(sMixedBytes).mSigned == -1);
+
+void TestScalars()
+{
+	const uint8_t bytes [] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e };
+
+	SFB::ByteStream stream(bytes, sizeof bytes);
+	SFB_CHECK(stream.ReadLE<uint16_t>() == 0x0201);
+	SFB_CHECK(stream.ReadBE<uint16_t>() == 0x0304);
+	SFB_CHECK(stream.ReadLE<uint32_t>() == 0x08070605);
+	SFB_CHECK(stream.ReadBE<uint32_t>() == 0x090a0b0c);
+	SFB_CHECK(stream.Position() == 12);
+
+	// Too few bytes remain for a 32-bit value, so nothing is read
+	uint32_t value = 0;
+	SFB_CHECK(!stream.ReadLE(value));
+	SFB_CHECK(stream.Position() == 12);
+	SFB_CHECK(stream.Read<uint8_t>() == 0x0d);
+	SFB_CHECK(stream.Remaining() == 1);
+
+	stream.SetPosition(0);
+	const auto native = stream.Read<uint16_t>();
+	stream.SetPosition(0);
+	SFB_CHECK(stream.ReadSwapped<uint16_t>() == OSSwapInt16(native));
+	SFB_CHECK(stream.ReadLE<uint64_t>() == 0x0a09080706050403);
+
+	SFB_CHECK(stream.SetPosition(100) == sizeof bytes);
+	SFB_CHECK(stream.Remaining() == 0);
+	SFB_CHECK(stream.Rewind(4) == 4);
+	SFB_CHECK(stream.Skip(100) == 4);
+}
+
+void TestArrays()
+{
+	const uint8_t bytes [] = { 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00, 0x05 };
+
+	SFB::ByteStream stream(bytes, sizeof bytes);
+	std::array<uint16_t, 5> values{};
+	SFB_CHECK(stream.ReadArrayBE(values.data(), values.size()));
+	SFB_CHECK((values == std::array<uint16_t, 5>{ 1, 2, 3, 4, 5 }));
+	SFB_CHECK(stream.Remaining() == 0);
+
+	stream.SetPosition(0);
+	SFB_CHECK(stream.ReadArrayLE(values.data(), values.size()));
+	SFB_CHECK((values == std::array<uint16_t, 5>{ 0x0100, 0x0200, 0x0300, 0x0400, 0x0500 }));
+
+	stream.SetPosition(0);
+	std::array<uint16_t, 5> native{};
+	SFB_CHECK(stream.ReadArray(native.data(), native.size()));
+	stream.SetPosition(0);
+	SFB_CHECK(stream.ReadArraySwapped(values.data(), values.size()));
+	for(size_t i = 0; i < values.size(); ++i)
+		SFB_CHECK(values[i] == OSSwapInt16(native[i]));
+
+	// The bounds are checked for the whole array before anything is read
+	stream.SetPosition(2);
+	values.fill(0xffff);
+	SFB_CHECK(!stream.ReadArrayBE(values.data(), values.size()));
+	SFB_CHECK(stream.Position() == 2);
+	SFB_CHECK(values[0] == 0xffff);
+
+	uint32_t longValues [2];
+	SFB_CHECK(stream.ReadArrayBE(longValues, 2));
+	SFB_CHECK(longValues[0] == 0x00020003 && longValues[1] == 0x00040005);
+}
+
+void TestStructs()
+{
+	const uint8_t bytes [] = { 'f', 'm', 't', ' ', 0x10, 0x00, 0x00, 0x00, 0x34, 0x12, 0x01, 0x02, 0x03, 0x04, 0x80 };
+
+	SFB::ByteStream stream(bytes, sizeof bytes);
+	ChunkHeader header;
+	SFB_CHECK(stream.ReadStruct<ChunkHeaderLayout>(header));
+	SFB_CHECK(header.mID[0] == 'f' && header.mID[3] == ' ');
+	SFB_CHECK(header.mSize == 16);
+
+	Mixed mixed;
+	SFB_CHECK(stream.ReadStruct<MixedLayout>(mixed));
+	SFB_CHECK(mixed.mLittle == 0x1234);
+	SFB_CHECK(mixed.mBig == 0x01020304);
+	SFB_CHECK(mixed.mSigned == -128);
+	SFB_CHECK(stream.Remaining() == 0);
+
+	stream.SetPosition(8);
+	SFB_CHECK(!stream.ReadStruct<ChunkHeaderLayout>(header));
+	SFB_CHECK(stream.Position() == 8);
+}
+
+void TestSpans()
+{
+	const uint8_t bytes [] = { 1, 2, 3, 4, 5, 6 };
+
+	SFB::ByteStream stream(bytes, sizeof bytes);
+	const auto first = stream.ReadSpan(4);
+	SFB_CHECK(first.size() == 4);
+	SFB_CHECK(first.data() == bytes);
+	SFB_CHECK(stream.Position() == 4);
+
+	SFB_CHECK(stream.ReadSpan(3).empty());
+	SFB_CHECK(stream.Position() == 4);
+	SFB_CHECK(stream.ReadSpan(2).data() == bytes + 4);
+
+	SFB::ByteStream empty;
+	SFB_CHECK(empty.Remaining() == 0);
+	SFB_CHECK(empty.ReadSpan(1).empty());
+	SFB_CHECK(empty.ReadLE<uint16_t>() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	TestScalars();
+	TestArrays();
+	TestStructs();
+	TestSpans();
+	return SFB::Test::ExitStatus();
+}
@@ -0,0 +1,183 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <array>
+#import <cstdint>
+#import <cstring>
+
+#import <libkern/OSByteOrder.h>
+
+#import "SFBByteStream.hpp"
+#import "SFBByteStreamWriter.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// A RIFF chunk header
+struct ChunkHeader
+{
+	char mID[4];
+	uint32_t mSize;
+};
+
+using ChunkHeaderLayout = SFB::ByteStream::Layout<ChunkHeader, SFB::ByteStream::Field<&ChunkHeader::mID>, SFB::ByteStream::FieldLE<&ChunkHeader::mSize>>;
+
+/// Values written in each byte ordering are read back unchanged
+void TestScalarRoundTrip()
+{
+	SFB::ByteStreamWriter writer;
+	SFB_CHECK(writer.Write(uint8_t{0xab}));
+	SFB_CHECK(writer.WriteLE(uint16_t{0x1234}));
+	SFB_CHECK(writer.WriteBE(uint32_t{0x89abcdef}));
+	SFB_CHECK(writer.WriteLE(uint64_t{0x0102030405060708}));
+	SFB_CHECK(writer.WriteSwapped(uint32_t{0xdeadbeef}));
+	SFB_CHECK(writer.Write(int16_t{-2}));
+	SFB_CHECK(writer.Write("tail", 4) == 4);
+	SFB_CHECK(writer.Length() == 1 + 2 + 4 + 8 + 4 + 2 + 4);
+
+	// The byte orderings are those requested regardless of the host
+	const auto bytes = writer.Bytes();
+	SFB_CHECK(bytes[1] == 0x34 && bytes[2] == 0x12);
+	SFB_CHECK(bytes[3] == 0x89 && bytes[6] == 0xef);
+	SFB_CHECK(bytes[7] == 0x08 && bytes[14] == 0x01);
+
+	auto reader = writer.Reader();
+	SFB_CHECK(reader.Read<uint8_t>() == 0xab);
+	SFB_CHECK(reader.ReadLE<uint16_t>() == 0x1234);
+	SFB_CHECK(reader.ReadBE<uint32_t>() == 0x89abcdef);
+	SFB_CHECK(reader.ReadLE<uint64_t>() == 0x0102030405060708);
+	SFB_CHECK(reader.ReadSwapped<uint32_t>() == 0xdeadbeef);
+	SFB_CHECK(reader.Read<int16_t>() == -2);
+
+	char tail [4];
+	SFB_CHECK(reader.Read(tail, sizeof tail) == 4);
+	SFB_CHECK(!std::memcmp(tail, "tail", 4));
+	SFB_CHECK(reader.Remaining() == 0);
+
+	// A failed read leaves the position unchanged
+	uint32_t value;
+	SFB_CHECK(!reader.ReadLE(value));
+	SFB_CHECK(reader.Position() == reader.Length());
+}
+
+/// Arrays written in each byte ordering are read back unchanged
+void TestArrayRoundTrip()
+{
+	const std::array<uint16_t, 5> shorts = { 1, 0x0203, 0x8000, 0xffff, 42 };
+	const std::array<uint32_t, 3> longs = { 0x01020304, 0, 0xfedcba98 };
+	const std::array<uint64_t, 2> quads = { 0x0102030405060708, 0x8877665544332211 };
+
+	SFB::ByteStreamWriter writer;
+	SFB_CHECK(writer.WriteArrayLE(shorts.data(), shorts.size()));
+	SFB_CHECK(writer.WriteArrayBE(longs.data(), longs.size()));
+	SFB_CHECK(writer.WriteArraySwapped(quads.data(), quads.size()));
+	SFB_CHECK(writer.WriteArray(shorts.data(), shorts.size()));
+
+	// The array forms agree with the scalar forms
+	auto reader = writer.Reader();
+	for(auto value : shorts)
+		SFB_CHECK(reader.ReadLE<uint16_t>() == value);
+	for(auto value : longs)
+		SFB_CHECK(reader.ReadBE<uint32_t>() == value);
+	for(auto value : quads)
+		SFB_CHECK(reader.ReadSwapped<uint64_t>() == value);
+
+	reader.SetPosition(0);
+	std::array<uint16_t, 5> shortsRead;
+	std::array<uint32_t, 3> longsRead;
+	std::array<uint64_t, 2> quadsRead;
+	std::array<uint16_t, 5> nativeRead;
+	SFB_CHECK(reader.ReadArrayLE(shortsRead.data(), shortsRead.size()));
+	SFB_CHECK(reader.ReadArrayBE(longsRead.data(), longsRead.size()));
+	SFB_CHECK(reader.ReadArraySwapped(quadsRead.data(), quadsRead.size()));
+	SFB_CHECK(reader.ReadArray(nativeRead.data(), nativeRead.size()));
+	SFB_CHECK(shortsRead == shorts);
+	SFB_CHECK(longsRead == longs);
+	SFB_CHECK(quadsRead == quads);
+	SFB_CHECK(nativeRead == shorts);
+	SFB_CHECK(reader.Remaining() == 0);
+
+	// The bounds are checked for the entire array before reading
+	reader.SetPosition(reader.Length() - 3);
+	SFB_CHECK(!reader.ReadArrayLE(shortsRead.data(), 2));
+	SFB_CHECK(reader.Position() == reader.Length() - 3);
+}
+
+/// Packed structures are encoded without padding
+void TestStructRoundTrip()
+{
+	static_assert(ChunkHeaderLayout::sSize == 8);
+
+	const ChunkHeader header = { { 'd', 'a', 't', 'a' }, 0x11223344 };
+
+	SFB::ByteStreamWriter writer;
+	SFB_CHECK(writer.WriteStruct<ChunkHeaderLayout>(header));
+	SFB_CHECK(writer.WriteStruct<ChunkHeaderLayout>(header));
+	SFB_CHECK(writer.Length() == 2 * ChunkHeaderLayout::sSize);
+
+	const std::array<uint8_t, 8> expected = { 'd', 'a', 't', 'a', 0x44, 0x33, 0x22, 0x11 };
+	SFB_CHECK(!std::memcmp(writer.Data(), expected.data(), expected.size()));
+	SFB_CHECK(ChunkHeaderLayout::Encode(header) == expected);
+
+	auto reader = writer.Reader();
+	for(int i = 0; i < 2; ++i) {
+		ChunkHeader decoded{};
+		SFB_CHECK(reader.ReadStruct<ChunkHeaderLayout>(decoded));
+		SFB_CHECK(!std::memcmp(decoded.mID, header.mID, 4));
+		SFB_CHECK(decoded.mSize == header.mSize);
+	}
+
+	ChunkHeader decoded{};
+	SFB_CHECK(!reader.ReadStruct<ChunkHeaderLayout>(decoded));
+}
+
+/// A field may be patched after the data it describes is written
+void TestPatching()
+{
+	SFB::ByteStreamWriter writer;
+	SFB_CHECK(writer.WriteBE(uint32_t{0}));
+	SFB_CHECK(writer.Write("payload", 7) == 7);
+
+	const auto end = writer.Position();
+	SFB_CHECK(writer.SetPosition(0));
+	SFB_CHECK(writer.WriteBE(static_cast<uint32_t>(end - 4)));
+	SFB_CHECK(writer.SetPosition(end));
+	SFB_CHECK(!writer.SetPosition(end + 1));
+	SFB_CHECK(writer.Length() == end);
+
+	auto reader = writer.Reader();
+	SFB_CHECK(reader.ReadBE<uint32_t>() == 7);
+	const auto payload = reader.ReadSpan(7);
+	SFB_CHECK(payload.size() == 7 && !std::memcmp(payload.data(), "payload", 7));
+}
+
+/// A writer using caller-provided storage never writes past it
+void TestFixedCapacity()
+{
+	std::array<uint8_t, 6> storage{};
+	SFB::ByteStreamWriter writer(storage.data(), storage.size());
+	SFB_CHECK(!writer.OwnsBuffer());
+	SFB_CHECK(writer.WriteLE(uint32_t{0x04030201}));
+	SFB_CHECK(!writer.WriteLE(uint32_t{0}));
+	SFB_CHECK(writer.WriteLE(uint16_t{0x0605}));
+	SFB_CHECK(!writer.Write(uint8_t{0}));
+	SFB_CHECK(writer.Length() == 6);
+
+	const std::array<uint8_t, 6> expected = { 1, 2, 3, 4, 5, 6 };
+	SFB_CHECK(storage == expected);
+}
+
+} // namespace
+
+int main()
+{
+	TestScalarRoundTrip();
+	TestArrayRoundTrip();
+	TestStructRoundTrip();
+	TestPatching();
+	TestFixedCapacity();
+	return SFB::Test::ExitStatus();
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <cstdint>
+
+#import "SFBCABufferList.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+constexpr uint32_t sChannelCount = 2;
+constexpr uint32_t sFrameCapacity = 1024;
+constexpr uint32_t sEditFrames = 256;
+
+SFB::CAStreamBasicDescription Format() noexcept
+{
+	return SFB::CAStreamBasicDescription(SFB::CommonPCMFormat::float32, 48000, sChannelCount, false);
+}
+
+/// Returns the sample expected in @c channel at @c frame
+float Sample(uint32_t frame, uint32_t channel) noexcept
+{
+	return static_cast<float>(frame * sChannelCount + channel);
+}
+
+/// Sets the frame length of @c buffer to @c frameLength and fills it with the samples starting at @c firstFrame
+void Fill(SFB::CABufferList& buffer, uint32_t frameLength, uint32_t firstFrame = 0) noexcept
+{
+	buffer.SetFrameLength(frameLength);
+	for(uint32_t channel = 0; channel < sChannelCount; ++channel) {
+		auto samples = static_cast<float *>(buffer->mBuffers[channel].mData);
+		for(uint32_t i = 0; i < frameLength; ++i)
+			samples[i] = Sample(firstFrame + i, channel);
+	}
+}
+
+/// Returns @c true if @c buffer contains the samples starting at @c firstFrame
+bool Matches(const SFB::CABufferList& buffer, uint32_t firstFrame) noexcept
+{
+	for(uint32_t channel = 0; channel < sChannelCount; ++channel) {
+		if(buffer->mBuffers[channel].mDataByteSize != buffer.FrameLength() * sizeof(float))
+			return false;
+		const auto samples = static_cast<const float *>(buffer->mBuffers[channel].mData);
+		for(uint32_t i = 0; i < buffer.FrameLength(); ++i) {
+			if(samples[i] != Sample(firstFrame + i, channel))
+				return false;
+		}
+	}
+	return true;
+}
+
+/// Trimming every frame releases the headroom so the whole capacity is usable again
+void TestTrimAllFrames()
+{
+	SFB::CABufferList buffer(Format(), sFrameCapacity);
+	Fill(buffer, sFrameCapacity);
+	SFB_CHECK(buffer.IsFull());
+
+	SFB_CHECK(buffer.TrimAtOffset(0, sFrameCapacity) == sFrameCapacity);
+	SFB_CHECK(buffer.IsEmpty());
+	SFB_CHECK(!buffer.IsFull());
+	SFB_CHECK(buffer.Headroom() == 0);
+	SFB_CHECK(buffer.FrameCapacity() == sFrameCapacity);
+
+	SFB::CABufferList source(Format(), sFrameCapacity);
+	Fill(source, sFrameCapacity);
+	SFB_CHECK(buffer.InsertFromBuffer(source, 0, sFrameCapacity, 0) == sFrameCapacity);
+	SFB_CHECK(buffer.IsFull());
+	SFB_CHECK(Matches(buffer, 0));
+}
+
+/// The frame capacity and fullness include the headroom that insertions reclaim
+void TestHeadroomIsCapacity()
+{
+	SFB::CABufferList buffer(Format(), sFrameCapacity);
+	Fill(buffer, sFrameCapacity);
+
+	SFB_CHECK(buffer.TrimAtOffset(0, sEditFrames) == sEditFrames);
+	SFB_CHECK(buffer.Headroom() == sEditFrames);
+	SFB_CHECK(buffer.FrameLength() == sFrameCapacity - sEditFrames);
+	SFB_CHECK(buffer.FrameCapacity() == sFrameCapacity);
+	SFB_CHECK(!buffer.IsFull());
+	SFB_CHECK(Matches(buffer, sEditFrames));
+
+	// Appending requires reclaiming the headroom
+	SFB::CABufferList source(Format(), sEditFrames);
+	Fill(source, sEditFrames, sFrameCapacity);
+	SFB_CHECK(buffer.InsertFromBuffer(source, 0, sEditFrames, buffer.FrameLength()) == sEditFrames);
+	SFB_CHECK(buffer.Headroom() == 0);
+	SFB_CHECK(buffer.IsFull());
+	SFB_CHECK(Matches(buffer, sEditFrames));
+	SFB_CHECK(buffer.InsertFromBuffer(source, 0, sEditFrames, 0) == 0);
+}
+
+/// Extending the frame length past the end of the allocation moves the valid frames out of the headroom
+void TestSetFrameLengthReclaimsHeadroom()
+{
+	SFB::CABufferList buffer(Format(), sFrameCapacity);
+	Fill(buffer, sFrameCapacity);
+	SFB_CHECK(buffer.TrimAtOffset(0, sEditFrames) == sEditFrames);
+
+	// A length that fits following the first valid frame keeps the headroom
+	SFB_CHECK(buffer.SetFrameLength(sFrameCapacity - 2 * sEditFrames));
+	SFB_CHECK(buffer.Headroom() == sEditFrames);
+	SFB_CHECK(Matches(buffer, sEditFrames));
+
+	SFB_CHECK(buffer.SetFrameLength(sFrameCapacity));
+	SFB_CHECK(buffer.Headroom() == 0);
+	SFB_CHECK(buffer.IsFull());
+	SFB_CHECK(buffer.SetFrameLength(sFrameCapacity - 2 * sEditFrames));
+	SFB_CHECK(Matches(buffer, sEditFrames));
+
+	SFB_CHECK(!buffer.SetFrameLength(sFrameCapacity + 1));
+
+	SFB_CHECK(buffer.TrimAtOffset(0, sEditFrames) == sEditFrames);
+	SFB_CHECK(buffer.SetFrameLength(0));
+	SFB_CHECK(buffer.Headroom() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	TestTrimAllFrames();
+	TestHeadroomIsCapacity();
+	TestSetFrameLengthReclaimsHeadroom();
+
+	return SFB::Test::ExitStatus();
+}
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <atomic>
+#import <cstdint>
+#import <cstring>
+#import <thread>
+#import <vector>
+
+#import "SFBMPMCRingBuffer.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+void TestAllocation()
+{
+	SFB::MPMCRingBuffer rb;
+	SFB_CHECK(!rb.Allocate(0, 8));
+	SFB_CHECK(!rb.Allocate(sizeof(uint64_t), 1));
+	SFB_CHECK(rb.Allocate(sizeof(uint64_t), 5));
+	SFB_CHECK(rb.Capacity() == 8);
+	SFB_CHECK(rb.ElementSize() == sizeof(uint64_t));
+	SFB_CHECK(rb.ApproximateElementsAvailableToRead() == 0);
+}
+
+/// Elements are read in the order they were written and every slot is usable
+void TestOrdering()
+{
+	SFB::MPMCRingBuffer rb;
+	SFB_CHECK(rb.Allocate(sizeof(uint64_t), 8));
+
+	uint64_t value;
+	SFB_CHECK(!rb.TryRead(&value));
+
+	// Several laps exercise the sequence numbers of reused slots
+	uint64_t next = 0;
+	for(int lap = 0; lap < 4; ++lap) {
+		for(uint64_t i = 0; i < 8; ++i) {
+			value = next + i;
+			SFB_CHECK(rb.TryWrite(&value));
+		}
+		SFB_CHECK(!rb.TryWrite(&value));
+		SFB_CHECK(rb.ApproximateElementsAvailableToRead() == 8);
+
+		for(uint64_t i = 0; i < 8; ++i) {
+			SFB_CHECK(rb.TryRead(&value));
+			SFB_CHECK(value == next + i);
+		}
+		SFB_CHECK(!rb.TryRead(&value));
+		next += 8;
+	}
+
+	rb.Reset();
+	SFB_CHECK(rb.ApproximateElementsAvailableToRead() == 0);
+}
+
+/// Slots claimed in batches are accessed in place and become visible only when committed
+void TestClaims()
+{
+	SFB::MPMCRingBuffer rb;
+	SFB_CHECK(rb.Allocate(sizeof(uint32_t), 8));
+
+	SFB::MPMCRingBuffer::SlotRange first;
+	SFB_CHECK(rb.ClaimWrite(5, first) == 5);
+
+	SFB::MPMCRingBuffer::SlotRange second;
+	SFB_CHECK(rb.ClaimWrite(5, second) == 3);
+	SFB::MPMCRingBuffer::SlotRange none;
+	SFB_CHECK(rb.ClaimWrite(1, none) == 0);
+
+	for(uint32_t i = 0; i < second.mCount; ++i) {
+		const uint32_t value = 100 + i;
+		std::memcpy(rb.WriteSlot(second, i), &value, sizeof value);
+	}
+	rb.CommitWrite(second);
+
+	// The uncommitted first claim hides the slots following it
+	SFB::MPMCRingBuffer::SlotRange read;
+	SFB_CHECK(rb.ClaimRead(8, read) == 0);
+
+	for(uint32_t i = 0; i < first.mCount; ++i) {
+		const uint32_t value = i;
+		std::memcpy(rb.WriteSlot(first, i), &value, sizeof value);
+	}
+	rb.CommitWrite(first);
+
+	SFB_CHECK(rb.ClaimRead(8, read) == 8);
+	for(uint32_t i = 0; i < read.mCount; ++i) {
+		uint32_t value;
+		std::memcpy(&value, rb.ReadSlot(read, i), sizeof value);
+		SFB_CHECK(value == (i < 5 ? i : 100 + i - 5));
+	}
+
+	// Slots are not reusable until the read claim is committed
+	SFB_CHECK(rb.ClaimWrite(1, none) == 0);
+	rb.CommitRead(read);
+	SFB_CHECK(rb.ClaimWrite(1, none) == 1);
+	rb.CommitWrite(none);
+}
+
+/// Several producers and consumers transferring tagged sequences
+void TestConcurrentTransfer()
+{
+	constexpr uint32_t producerCount = 4;
+	constexpr uint32_t consumerCount = 4;
+	constexpr uint64_t valuesPerProducer = 100000;
+
+	SFB::MPMCRingBuffer rb;
+	SFB_CHECK(rb.Allocate(sizeof(uint64_t), 64));
+
+	std::atomic_uint64_t consumed = 0;
+	std::vector<std::vector<uint64_t>> received(consumerCount);
+	std::vector<std::thread> threads;
+
+	for(uint32_t p = 0; p < producerCount; ++p) {
+		threads.emplace_back([&rb, p] {
+			for(uint64_t i = 0; i < valuesPerProducer; ++i) {
+				const uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+				while(!rb.TryWrite(&value))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	for(uint32_t c = 0; c < consumerCount; ++c) {
+		threads.emplace_back([&rb, &consumed, &received, c] {
+			auto& values = received[c];
+			while(consumed.load(std::memory_order_relaxed) < producerCount * valuesPerProducer) {
+				uint64_t value;
+				if(rb.TryRead(&value)) {
+					values.push_back(value);
+					consumed.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	for(auto& thread : threads)
+		thread.join();
+
+	// Every value is received exactly once and each consumer sees a producer's values in order
+	std::vector<std::vector<bool>> seen(producerCount, std::vector<bool>(valuesPerProducer, false));
+	bool ordered = true;
+	bool unique = true;
+	for(const auto& values : received) {
+		std::vector<int64_t> last(producerCount, -1);
+		for(auto value : values) {
+			const auto p = static_cast<uint32_t>(value >> 32);
+			const auto i = static_cast<int64_t>(value & 0xffffffff);
+			if(p >= producerCount || i >= static_cast<int64_t>(valuesPerProducer)) {
+				unique = false;
+				continue;
+			}
+			ordered = ordered && i > last[p];
+			last[p] = i;
+			unique = unique && !seen[p][static_cast<size_t>(i)];
+			seen[p][static_cast<size_t>(i)] = true;
+		}
+	}
+
+	SFB_CHECK(consumed.load() == producerCount * valuesPerProducer);
+	SFB_CHECK(ordered);
+	SFB_CHECK(unique);
+	uint64_t value;
+	SFB_CHECK(!rb.TryRead(&value));
+}
+
+} // namespace
+
+int main()
+{
+	TestAllocation();
+	TestOrdering();
+	TestClaims();
+	TestConcurrentTransfer();
+	return SFB::Test::ExitStatus();
+}
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <cstdint>
+
+#import "SFBMappedAudioFile.hpp"
+#import "SFBMirroredMemory.hpp"
+#import "SFBTestAudioFile.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+constexpr uint32_t sChannelCount = 2;
+constexpr uint32_t sFrameCount = 10000;
+/// Places the audio data past the first page at an offset that is not page-aligned
+constexpr uint32_t sJunkByteCount = 5000;
+
+/// Returns @c true if the frame at @c data contains the expected samples for @c frame
+bool FrameMatches(const SFB::Test::TemporaryWAVEFile& file, const void *data, int64_t frame) noexcept
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+	for(uint32_t channel = 0; channel < sChannelCount; ++channel) {
+		if(SFB::Test::TemporaryWAVEFile::DecodeSample(bytes + 2 * channel) != file.Sample(frame, channel))
+			return false;
+	}
+	return true;
+}
+
+void TestDataOffset(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::MappedAudioFile mappedFile(file.URL());
+	SFB_CHECK(mappedFile.IsOpen());
+	SFB_CHECK(mappedFile.Format().IsPCM());
+	SFB_CHECK(mappedFile.Format().mChannelsPerFrame == sChannelCount);
+	SFB_CHECK(mappedFile.Format().mBytesPerFrame == 2 * sChannelCount);
+	SFB_CHECK(mappedFile.FrameLength() == sFrameCount);
+
+	// The data offset must be found through the container rather than assumed
+	SFB_CHECK(file.DataOffset() > static_cast<int64_t>(SFB::VirtualMemoryPageSize()));
+	SFB_CHECK(file.DataOffset() % static_cast<int64_t>(SFB::VirtualMemoryPageSize()) != 0);
+
+	for(int64_t frame : { int64_t{0}, int64_t{1}, int64_t{sFrameCount / 2}, int64_t{sFrameCount - 1} }) {
+		auto data = mappedFile.FrameData(frame);
+		SFB_CHECK(data != nullptr);
+		if(data)
+			SFB_CHECK(FrameMatches(file, data, frame));
+	}
+
+	SFB_CHECK(mappedFile.FrameData(-1) == nullptr);
+	SFB_CHECK(mappedFile.FrameData(sFrameCount) == nullptr);
+	SFB_CHECK(mappedFile.FramesAvailable(sFrameCount - 10) == 10);
+	SFB_CHECK(mappedFile.FramesAvailable(sFrameCount) == 0);
+}
+
+void TestPageAlignedMapping(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::MappedAudioFile mappedFile(file.URL());
+	const auto pageSize = static_cast<uintptr_t>(SFB::VirtualMemoryPageSize());
+
+	// The mapping starts on the page containing the audio data, so the data keeps its offset within that page
+	auto data = reinterpret_cast<uintptr_t>(mappedFile.FrameData(0));
+	SFB_CHECK(data % pageSize == static_cast<uintptr_t>(file.DataOffset()) % pageSize);
+
+	// Every frame is contiguous and mapped, including the last
+	auto bytes = static_cast<const uint8_t *>(mappedFile.FrameData(0));
+	for(int64_t frame = 0; frame < sFrameCount; ++frame) {
+		if(!FrameMatches(file, bytes + frame * 2 * sChannelCount, frame)) {
+			SFB_CHECK(FrameMatches(file, bytes + frame * 2 * sChannelCount, frame));
+			break;
+		}
+	}
+
+	mappedFile.Close();
+	SFB_CHECK(!mappedFile.IsOpen());
+	SFB_CHECK(mappedFile.FrameData(0) == nullptr);
+}
+
+void TestMapFrames(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::MappedAudioFile mappedFile(file.URL());
+
+	SFB::CABufferList view;
+	SFB_CHECK(mappedFile.MapFrames(view, 100, 256));
+	SFB_CHECK(view.FrameLength() == 256);
+	SFB_CHECK(view->mNumberBuffers == 1);
+	SFB_CHECK(view->mBuffers[0].mNumberChannels == sChannelCount);
+	SFB_CHECK(view->mBuffers[0].mDataByteSize == 256 * 2 * sChannelCount);
+	// The view refers to the mapping instead of a copy
+	SFB_CHECK(view->mBuffers[0].mData == mappedFile.FrameData(100));
+
+	// Views are shortened at the end of the audio data
+	SFB_CHECK(mappedFile.MapFrames(view, sFrameCount - 10, 256));
+	SFB_CHECK(view.FrameLength() == 10);
+	SFB_CHECK(view->mBuffers[0].mDataByteSize == 10 * 2 * sChannelCount);
+	SFB_CHECK(FrameMatches(file, view->mBuffers[0].mData, sFrameCount - 10));
+
+	SFB_CHECK(!mappedFile.MapFrames(view, sFrameCount, 1));
+	SFB_CHECK(!mappedFile.MapFrames(view, -1, 1));
+}
+
+void TestAdvise(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::MappedAudioFile mappedFile(file.URL());
+
+	// The frame address is not page-aligned so this fails unless the range is rounded to a page boundary
+	SFB_CHECK(mappedFile.Advise(1234, 100, SFB::MappedAudioFile::Access::sequential));
+	SFB_CHECK(mappedFile.Advise(sFrameCount - 1, 100, SFB::MappedAudioFile::Access::willNeed));
+	SFB_CHECK(mappedFile.Advise(SFB::MappedAudioFile::Access::random));
+
+	SFB_CHECK(!mappedFile.Advise(sFrameCount, 1, SFB::MappedAudioFile::Access::normal));
+	SFB_CHECK(!mappedFile.Advise(-1, 1, SFB::MappedAudioFile::Access::normal));
+	SFB_CHECK(!mappedFile.Advise(0, 0, SFB::MappedAudioFile::Access::normal));
+
+	mappedFile.Close();
+	SFB_CHECK(!mappedFile.Advise(SFB::MappedAudioFile::Access::normal));
+}
+
+} // namespace
+
+int main()
+{
+	SFB::Test::TemporaryWAVEFile file(sChannelCount, sFrameCount, sJunkByteCount);
+	SFB_CHECK(file.URL() != nullptr);
+	if(!file.URL())
+		return SFB::Test::ExitStatus();
+
+	TestDataOffset(file);
+	TestPageAlignedMapping(file);
+	TestMapFrames(file);
+	TestAdvise(file);
+
+	return SFB::Test::ExitStatus();
+}
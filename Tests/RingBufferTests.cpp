@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <cstdint>
+#import <cstring>
+#import <thread>
+#import <vector>
+
+#import "SFBRingBuffer.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// Fills @c buf with bytes counting up from @c first
+void FillPattern(uint8_t *buf, uint32_t count, uint8_t first) noexcept
+{
+	for(uint32_t i = 0; i < count; ++i)
+		buf[i] = static_cast<uint8_t>(first + i);
+}
+
+/// Returns @c true if @c buf contains bytes counting up from @c first
+bool MatchesPattern(const uint8_t *buf, uint32_t count, uint8_t first) noexcept
+{
+	for(uint32_t i = 0; i < count; ++i) {
+		if(buf[i] != static_cast<uint8_t>(first + i))
+			return false;
+	}
+	return true;
+}
+
+void TestCapacity()
+{
+	SFB::RingBuffer rb;
+	SFB_CHECK(!rb.Allocate(1));
+	SFB_CHECK(rb.Allocate(100));
+	SFB_CHECK(rb.CapacityBytes() == 128);
+	SFB_CHECK(rb.BytesAvailableToRead() == 0);
+	SFB_CHECK(rb.BytesAvailableToWrite() == 127);
+
+	uint8_t buf [256];
+	FillPattern(buf, 256, 0);
+	SFB_CHECK(rb.Write(buf, 256) == 127);
+	SFB_CHECK(rb.BytesAvailableToWrite() == 0);
+	SFB_CHECK(rb.Write(buf, 1) == 0);
+
+	rb.Reset();
+	SFB_CHECK(rb.BytesAvailableToRead() == 0);
+	SFB_CHECK(rb.BytesAvailableToWrite() == 127);
+}
+
+/// Reads and writes straddling the end of the buffer
+void TestWrap(bool mirrored)
+{
+	SFB::RingBuffer rb;
+	SFB_CHECK(rb.Allocate(16, mirrored));
+	SFB_CHECK(rb.IsMirrored() == mirrored);
+	const auto capacity = rb.CapacityBytes();
+
+	std::vector<uint8_t> buf(capacity);
+	std::vector<uint8_t> out(capacity);
+
+	// Move the positions near the end of the buffer
+	const auto lead = capacity - 5;
+	FillPattern(buf.data(), lead, 0);
+	SFB_CHECK(rb.Write(buf.data(), lead) == lead);
+	SFB_CHECK(rb.Read(out.data(), lead) == lead);
+	SFB_CHECK(MatchesPattern(out.data(), lead, 0));
+
+	FillPattern(buf.data(), 12, 100);
+	SFB_CHECK(rb.Write(buf.data(), 12) == 12);
+	SFB_CHECK(rb.BytesAvailableToRead() == 12);
+
+	std::memset(out.data(), 0, out.size());
+	SFB_CHECK(rb.Peek(out.data(), 12) == 12);
+	SFB_CHECK(MatchesPattern(out.data(), 12, 100));
+	SFB_CHECK(rb.BytesAvailableToRead() == 12);
+
+	std::memset(out.data(), 0, out.size());
+	SFB_CHECK(rb.Read(out.data(), 7) == 7);
+	SFB_CHECK(rb.Read(out.data() + 7, 7) == 5);
+	SFB_CHECK(MatchesPattern(out.data(), 12, 100));
+	SFB_CHECK(rb.BytesAvailableToRead() == 0);
+}
+
+/// Access through the read and write vectors
+void TestVectors(bool mirrored)
+{
+	SFB::RingBuffer rb;
+	SFB_CHECK(rb.Allocate(16, mirrored));
+	const auto capacity = rb.CapacityBytes();
+
+	std::vector<uint8_t> buf(capacity);
+	const auto lead = capacity - 4;
+	SFB_CHECK(rb.Write(buf.data(), lead) == lead);
+	SFB_CHECK(rb.Read(buf.data(), lead) == lead);
+
+	// The writable space starts four bytes before the end of the buffer
+	const auto [w1, w2] = rb.WriteVector();
+	SFB_CHECK(w1.mBufferCapacity + w2.mBufferCapacity == capacity - 1);
+	if(mirrored) {
+		SFB_CHECK(w1.mBufferCapacity == capacity - 1);
+		SFB_CHECK(w2.mBufferCapacity == 0);
+	}
+	else {
+		SFB_CHECK(w1.mBufferCapacity == 4);
+		SFB_CHECK(w2.mBufferCapacity == capacity - 5);
+	}
+
+	// Write ten bytes in place
+	uint8_t value = 50;
+	uint32_t remaining = 10;
+	for(const auto& w : { w1, w2 }) {
+		const auto count = std::min(remaining, w.mBufferCapacity);
+		FillPattern(w.mBuffer, count, value);
+		value = static_cast<uint8_t>(value + count);
+		remaining -= count;
+	}
+	rb.AdvanceWritePosition(10);
+	SFB_CHECK(rb.BytesAvailableToRead() == 10);
+
+	const auto [r1, r2] = rb.ReadVector();
+	SFB_CHECK(r1.mBufferSize + r2.mBufferSize == 10);
+	SFB_CHECK(r1.mBufferSize == (mirrored ? 10 : 4));
+	SFB_CHECK(MatchesPattern(r1.mBuffer, r1.mBufferSize, 50));
+	if(r2.mBufferSize)
+		SFB_CHECK(MatchesPattern(r2.mBuffer, r2.mBufferSize, static_cast<uint8_t>(50 + r1.mBufferSize)));
+
+	rb.AdvanceReadPosition(10);
+	SFB_CHECK(rb.BytesAvailableToRead() == 0);
+	const auto [e1, e2] = rb.ReadVector();
+	SFB_CHECK(e1.mBufferSize == 0 && e2.mBufferSize == 0);
+}
+
+/// A producer and consumer transferring a counting sequence in irregular chunks
+void TestConcurrentTransfer(bool mirrored)
+{
+	SFB::RingBuffer rb;
+	SFB_CHECK(rb.Allocate(256, mirrored));
+
+	constexpr uint32_t totalBytes = 1 << 20;
+
+	std::thread producer([&rb] {
+		uint8_t buf [97];
+		uint32_t written = 0;
+		uint32_t chunk = 1;
+		while(written < totalBytes) {
+			const auto count = std::min(chunk, totalBytes - written);
+			FillPattern(buf, count, static_cast<uint8_t>(written));
+			uint32_t offset = 0;
+			while(offset < count) {
+				const auto n = rb.Write(buf + offset, count - offset);
+				if(n == 0)
+					std::this_thread::yield();
+				offset += n;
+			}
+			written += count;
+			chunk = chunk % 97 + 1;
+		}
+	});
+
+	uint8_t buf [61];
+	uint32_t read = 0;
+	uint32_t chunk = 1;
+	bool matches = true;
+	while(read < totalBytes) {
+		const auto count = rb.Read(buf, chunk);
+		if(count == 0)
+			std::this_thread::yield();
+		matches = matches && MatchesPattern(buf, count, static_cast<uint8_t>(read));
+		read += count;
+		chunk = chunk % 61 + 1;
+	}
+
+	producer.join();
+	SFB_CHECK(matches);
+	SFB_CHECK(rb.BytesAvailableToRead() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	TestCapacity();
+	TestWrap(false);
+	TestWrap(true);
+	TestVectors(false);
+	TestVectors(true);
+	TestConcurrentTransfer(false);
+	TestConcurrentTransfer(true);
+	return SFB::Test::ExitStatus();
+}
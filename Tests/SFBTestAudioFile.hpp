@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdint>
+#import <cstdio>
+#import <cstdlib>
+#import <cstring>
+#import <string>
+#import <vector>
+
+#import <unistd.h>
+
+#import <CoreFoundation/CoreFoundation.h>
+
+namespace SFB {
+namespace Test {
+
+/// A temporary 16-bit linear PCM WAVE file that is deleted on destruction
+///
+/// A @c JUNK chunk of @c junkByteCount bytes precedes the @c data chunk so the audio data may be placed at an offset
+/// that is not page-aligned. Each sample has the value returned by @c Sample().
+class TemporaryWAVEFile
+{
+
+public:
+
+	/// Returns the value of the sample for @c channel in @c frame
+	static int16_t Sample(uint32_t channelCount, int64_t frame, uint32_t channel) noexcept
+	{
+		return static_cast<int16_t>((frame * channelCount + channel) % 32749);
+	}
+
+	/// Returns the sample at @c bytes, which are little-endian
+	static int16_t DecodeSample(const void * const bytes) noexcept
+	{
+		auto b = static_cast<const uint8_t *>(bytes);
+		return static_cast<int16_t>(b[0] | (b[1] << 8));
+	}
+
+	/// Writes a WAVE file containing @c frameCount frames of @c channelCount channels at 44.1 kHz
+	TemporaryWAVEFile(uint32_t channelCount, uint32_t frameCount, uint32_t junkByteCount)
+	: mChannelCount(channelCount)
+	{
+		char path [] = "/tmp/SFBAudioUtilitiesTest-XXXXXX.wav";
+		auto fd = mkstemps(path, 4);
+		if(fd == -1)
+			return;
+		mPath = path;
+
+		const uint32_t bytesPerFrame = 2 * channelCount;
+		const uint32_t dataByteCount = frameCount * bytesPerFrame;
+
+		std::vector<uint8_t> bytes;
+		const auto append = [&bytes](uint32_t value, int size) {
+			for(int i = 0; i < size; ++i)
+				bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		};
+		const auto appendID = [&bytes](const char *id) {
+			bytes.insert(bytes.end(), id, id + 4);
+		};
+
+		appendID("RIFF");
+		append(4 + (8 + 16) + (8 + junkByteCount) + (8 + dataByteCount), 4);
+		appendID("WAVE");
+
+		appendID("fmt ");
+		append(16, 4);
+		append(1, 2);
+		append(channelCount, 2);
+		append(44100, 4);
+		append(44100 * bytesPerFrame, 4);
+		append(bytesPerFrame, 2);
+		append(16, 2);
+
+		appendID("JUNK");
+		append(junkByteCount, 4);
+		bytes.insert(bytes.end(), junkByteCount, 0);
+
+		appendID("data");
+		append(dataByteCount, 4);
+		mDataOffset = static_cast<int64_t>(bytes.size());
+		for(uint32_t frame = 0; frame < frameCount; ++frame) {
+			for(uint32_t channel = 0; channel < channelCount; ++channel)
+				append(static_cast<uint16_t>(Sample(channelCount, frame, channel)), 2);
+		}
+
+		auto written = write(fd, bytes.data(), bytes.size());
+		close(fd);
+		if(written != static_cast<ssize_t>(bytes.size()))
+			return;
+
+		mURL = CFURLCreateFromFileSystemRepresentation(kCFAllocatorDefault, reinterpret_cast<const UInt8 *>(mPath.c_str()), static_cast<CFIndex>(mPath.size()), false);
+	}
+
+	TemporaryWAVEFile(const TemporaryWAVEFile& rhs) = delete;
+	TemporaryWAVEFile& operator=(const TemporaryWAVEFile& rhs) = delete;
+
+	/// Deletes the file
+	~TemporaryWAVEFile()
+	{
+		if(mURL)
+			CFRelease(mURL);
+		if(!mPath.empty())
+			unlink(mPath.c_str());
+	}
+
+	/// Returns the URL of the file or @c nullptr if it could not be written
+	CFURLRef _Nullable URL() const noexcept
+	{
+		return mURL;
+	}
+
+	/// Returns the offset of the audio data in the file
+	int64_t DataOffset() const noexcept
+	{
+		return mDataOffset;
+	}
+
+	/// Returns the value of the sample for @c channel in @c frame
+	int16_t Sample(int64_t frame, uint32_t channel) const noexcept
+	{
+		return Sample(mChannelCount, frame, channel);
+	}
+
+private:
+
+	/// The path of the file
+	std::string mPath;
+	/// The URL of the file
+	CFURLRef _Nullable mURL = nullptr;
+	/// The number of channels
+	uint32_t mChannelCount;
+	/// The offset of the audio data in the file
+	int64_t mDataOffset = 0;
+
+};
+
+} // namespace Test
+} // namespace SFB
@@ -0,0 +1,38 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#pragma once
+
+#import <cstdio>
+#import <cstdlib>
+
+namespace SFB {
+namespace Test {
+
+/// The number of checks that have failed
+inline int sFailureCount = 0;
+
+/// Returns the exit status of a test program
+inline int ExitStatus() noexcept
+{
+	if(sFailureCount != 0) {
+		std::fprintf(stderr, "%d check(s) failed\n", sFailureCount);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+} // namespace Test
+} // namespace SFB
+
+/// Reports a failure if @c expr is false
+#define SFB_CHECK(expr) \
+	do { \
+		if(!(expr)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+			++SFB::Test::sFailureCount; \
+		} \
+	} while(0)
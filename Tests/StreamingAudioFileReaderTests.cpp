@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <chrono>
+#import <cstdint>
+#import <thread>
+
+#import "SFBStreamingAudioFileReader.hpp"
+#import "SFBTestAudioFile.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+constexpr uint32_t sChannelCount = 2;
+constexpr uint32_t sFrameCount = 20000;
+/// A lead shorter than a chunk, so refilling can't wait for the lead to drain by a whole chunk
+constexpr uint32_t sTargetLeadFrames = 256;
+constexpr uint32_t sChunkFrames = 1024;
+constexpr uint32_t sReadFrames = 64;
+
+/// Waits up to one second for @c condition to return @c true
+template <typename F>
+bool WaitUntil(F&& condition)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while(!condition()) {
+		if(std::chrono::steady_clock::now() > deadline)
+			return false;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	return true;
+}
+
+/// Opens @c file for reading in its own format
+SFB::CAExtAudioFile OpenFile(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::CAExtAudioFile extAudioFile;
+	extAudioFile.OpenURL(file.URL());
+	extAudioFile.SetClientDataFormat(extAudioFile.FileDataFormat());
+	return extAudioFile;
+}
+
+/// The decode thread tops the ring buffer up to the target lead after every read until the end of the file
+void TestLeadIsMaintained(const SFB::Test::TemporaryWAVEFile& file)
+{
+	SFB::StreamingAudioFileReader reader(OpenFile(file), sTargetLeadFrames, sChunkFrames);
+	SFB_CHECK(reader.TargetLeadFrames() == sTargetLeadFrames);
+	SFB_CHECK(WaitUntil([&] { return reader.FramesBuffered() >= sTargetLeadFrames; }));
+
+	SFB::CABufferList buffer(reader.Format(), sReadFrames);
+	bool leadMaintained = true;
+	bool samplesMatch = true;
+	int64_t frame = 0;
+	while(frame < sFrameCount) {
+		const auto framesRead = reader.Read(buffer.ABL(), sReadFrames);
+		SFB_CHECK(framesRead == std::min<int64_t>(sReadFrames, sFrameCount - frame));
+		if(framesRead == 0)
+			break;
+
+		auto bytes = static_cast<const uint8_t *>(buffer->mBuffers[0].mData);
+		for(uint32_t i = 0; i < framesRead; ++i) {
+			for(uint32_t channel = 0; channel < sChannelCount; ++channel)
+				samplesMatch = samplesMatch && SFB::Test::TemporaryWAVEFile::DecodeSample(bytes + 2 * (i * sChannelCount + channel)) == file.Sample(frame + i, channel);
+		}
+		frame += framesRead;
+		SFB_CHECK(reader.Position() == frame);
+
+		const auto framesRemaining = static_cast<uint32_t>(sFrameCount - frame);
+		leadMaintained = leadMaintained && WaitUntil([&] { return reader.FramesBuffered() >= std::min(sTargetLeadFrames, framesRemaining); });
+	}
+
+	SFB_CHECK(leadMaintained);
+	SFB_CHECK(samplesMatch);
+	SFB_CHECK(frame == sFrameCount);
+	SFB_CHECK(WaitUntil([&] { return reader.IsAtEnd(); }));
+
+	const auto statistics = reader.Statistics();
+	SFB_CHECK(statistics.mUnderruns == 0);
+	SFB_CHECK(statistics.mDecodeErrors == 0);
+}
+
+} // namespace
+
+int main()
+{
+	SFB::Test::TemporaryWAVEFile file(sChannelCount, sFrameCount, 0);
+	SFB_CHECK(file.URL() != nullptr);
+	if(!file.URL())
+		return SFB::Test::ExitStatus();
+
+	TestLeadIsMaintained(file);
+
+	return SFB::Test::ExitStatus();
+}
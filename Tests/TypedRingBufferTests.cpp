@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioUtilities
+// MIT license
+//
+
+#import <algorithm>
+#import <array>
+#import <cstdint>
+#import <span>
+#import <thread>
+
+#import "SFBTypedRingBuffer.hpp"
+#import "SFBTestSupport.hpp"
+
+namespace {
+
+/// A trivially copyable element larger than a byte
+struct Event
+{
+	uint32_t mSequence;
+	float mValue;
+};
+
+void TestCapacity()
+{
+	SFB::TypedRingBuffer<Event, 8> rb;
+	static_assert(SFB::TypedRingBuffer<Event, 8>::CapacityElements() == 8);
+	SFB_CHECK(rb.ElementsAvailableToRead() == 0);
+	SFB_CHECK(rb.ElementsAvailableToWrite() == 7);
+
+	for(uint32_t i = 0; i < 7; ++i)
+		SFB_CHECK(rb.Write(Event{ i, static_cast<float>(i) / 2 }));
+	SFB_CHECK(!rb.Write(Event{ 7, 0 }));
+	SFB_CHECK(rb.ElementsAvailableToRead() == 7);
+	SFB_CHECK(rb.ElementsAvailableToWrite() == 0);
+
+	Event event;
+	for(uint32_t i = 0; i < 7; ++i) {
+		SFB_CHECK(rb.Read(event));
+		SFB_CHECK(event.mSequence == i && event.mValue == static_cast<float>(i) / 2);
+	}
+	SFB_CHECK(!rb.Read(event));
+
+	rb.Reset();
+	SFB_CHECK(rb.ElementsAvailableToRead() == 0);
+	SFB_CHECK(rb.ElementsAvailableToWrite() == 7);
+}
+
+/// Span reads and writes straddling the end of the storage
+void TestWrap()
+{
+	SFB::TypedRingBuffer<uint32_t, 16> rb;
+
+	std::array<uint32_t, 16> values;
+	for(uint32_t i = 0; i < 16; ++i)
+		values[i] = i + 1000;
+
+	SFB_CHECK(rb.Write(std::span<const uint32_t>(values.data(), 13)) == 13);
+	std::array<uint32_t, 16> out{};
+	SFB_CHECK(rb.Read(std::span<uint32_t>(out.data(), 13)) == 13);
+
+	// Writes past the capacity are truncated
+	SFB_CHECK(rb.Write(std::span<const uint32_t>(values)) == 15);
+	SFB_CHECK(rb.Peek(std::span<uint32_t>(out.data(), 10)) == 10);
+	SFB_CHECK(rb.ElementsAvailableToRead() == 15);
+	SFB_CHECK(rb.Read(std::span<uint32_t>(out)) == 15);
+	for(uint32_t i = 0; i < 15; ++i)
+		SFB_CHECK(out[i] == i + 1000);
+	SFB_CHECK(rb.ElementsAvailableToRead() == 0);
+}
+
+/// Access through the read and write vectors
+void TestVectors()
+{
+	SFB::TypedRingBuffer<uint16_t, 8> rb;
+
+	std::array<uint16_t, 6> filler{};
+	SFB_CHECK(rb.Write(std::span<const uint16_t>(filler)) == 6);
+	SFB_CHECK(rb.Read(std::span<uint16_t>(filler)) == 6);
+
+	const auto [w1, w2] = rb.WriteVector();
+	SFB_CHECK(w1.size() == 2);
+	SFB_CHECK(w2.size() == 5);
+	uint16_t value = 1;
+	for(auto& element : w1)
+		element = value++;
+	for(auto& element : w2.first(3))
+		element = value++;
+	rb.AdvanceWritePosition(5);
+
+	const auto [r1, r2] = rb.ReadVector();
+	SFB_CHECK(r1.size() == 2);
+	SFB_CHECK(r2.size() == 3);
+	value = 1;
+	for(auto element : r1)
+		SFB_CHECK(element == value++);
+	for(auto element : r2)
+		SFB_CHECK(element == value++);
+	rb.AdvanceReadPosition(5);
+
+	const auto [e1, e2] = rb.ReadVector();
+	SFB_CHECK(e1.empty() && e2.empty());
+}
+
+/// A producer and consumer transferring a counting sequence
+void TestConcurrentTransfer()
+{
+	SFB::TypedRingBuffer<uint64_t, 64> rb;
+	constexpr uint64_t valueCount = 1 << 20;
+
+	std::thread producer([&rb] {
+		std::array<uint64_t, 13> buf;
+		uint64_t next = 0;
+		while(next < valueCount) {
+			const auto count = static_cast<uint32_t>(std::min<uint64_t>(buf.size(), valueCount - next));
+			for(uint32_t i = 0; i < count; ++i)
+				buf[i] = next + i;
+			const auto written = rb.Write(std::span<const uint64_t>(buf.data(), count));
+			if(written == 0)
+				std::this_thread::yield();
+			next += written;
+		}
+	});
+
+	std::array<uint64_t, 7> buf;
+	uint64_t next = 0;
+	bool ordered = true;
+	while(next < valueCount) {
+		const auto count = rb.Read(std::span<uint64_t>(buf));
+		if(count == 0)
+			std::this_thread::yield();
+		for(uint32_t i = 0; i < count; ++i)
+			ordered = ordered && buf[i] == next + i;
+		next += count;
+	}
+
+	producer.join();
+	SFB_CHECK(ordered);
+	SFB_CHECK(rb.ElementsAvailableToRead() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	TestCapacity();
+	TestWrap();
+	TestVectors();
+	TestConcurrentTransfer();
+	return SFB::Test::ExitStatus();
+}